@@ -49,6 +49,8 @@
 #include "btif/include/stack_manager.h"
 #include "common/message_loop_thread.h"
 #include "device/include/controller.h"
+#include "main/shim/btm_api.h"
+#include "main/shim/shim.h"
 #include "osi/include/future.h"
 #include "osi/include/log.h"
 #include "osi/include/properties.h"
@@ -564,7 +566,12 @@ void btif_get_adapter_property(bt_property_type_t type) {
 
     /* LE features are not stored in storage. Should be retrived from stack
      */
-    BTM_BleGetVendorCapabilities(&cmn_vsc_cb);
+    if (bluetooth::shim::is_gd_scanning_enabled()) {
+      /* Includes the scan filters done on the host */
+      bluetooth::shim::BTM_BleGetVendorCapabilities(&cmn_vsc_cb);
+    } else {
+      BTM_BleGetVendorCapabilities(&cmn_vsc_cb);
+    }
     local_le_features.local_privacy_enabled = BTM_BleLocalPrivacyEnabled();
 
     prop.len = sizeof(bt_local_le_features_t);
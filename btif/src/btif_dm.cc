@@ -68,6 +68,7 @@
 #include "device/include/controller.h"
 #include "device/include/interop.h"
 #include "internal_include/stack_config.h"
+#include "main/shim/btm_api.h"
 #include "main/shim/shim.h"
 #include "osi/include/allocator.h"
 #include "osi/include/log.h"
@@ -1717,7 +1718,12 @@ static void btif_dm_upstreams_evt(uint16_t event, char* p_param) {
       prop.len = sizeof(bt_local_le_features_t);
 
       /* LE features are not stored in storage. Should be retrived from stack */
-      BTM_BleGetVendorCapabilities(&cmn_vsc_cb);
+      if (bluetooth::shim::is_gd_scanning_enabled()) {
+        /* Includes the scan filters done on the host */
+        bluetooth::shim::BTM_BleGetVendorCapabilities(&cmn_vsc_cb);
+      } else {
+        BTM_BleGetVendorCapabilities(&cmn_vsc_cb);
+      }
       local_le_features.local_privacy_enabled = BTM_BleLocalPrivacyEnabled();
 
       if (cmn_vsc_cb.filter_support == 1)
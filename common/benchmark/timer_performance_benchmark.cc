@@ -19,6 +19,7 @@
 #include <base/threading/thread.h>
 #include <benchmark/benchmark.h>
 #include <future>
+#include <vector>
 
 #include "common/message_loop_thread.h"
 #include "common/once_timer.h"
@@ -45,6 +46,14 @@ int g_task_counter;
 
 void TimerFire(void*) { g_promise->set_value(); }
 
+void DoNothing(void*) {}
+
+void CountFiredAlarm(void*) {
+  if (++g_task_counter == g_scheduled_tasks) {
+    g_promise->set_value();
+  }
+}
+
 void AlarmSleepAndCountDelayedTime(void*) {
   auto end_time_us = time_get_os_boottime_us();
   auto time_after_start_ms = (end_time_us - g_start_time) / 1000;
@@ -267,6 +276,92 @@ BENCHMARK_REGISTER_F(BM_AlarmTaskPeriodicTimer, periodic_accuracy)
     ->Iterations(1)
     ->UseRealTime();
 
+class BM_OsiAlarmScale : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    for (int i = 0; i < st.range(0); i++) {
+      alarms_.push_back(alarm_new("osi_alarm_scale_test"));
+    }
+    g_promise = std::make_shared<std::promise<void>>();
+    g_scheduled_tasks = alarms_.size();
+    g_task_counter = 0;
+  }
+
+  void TearDown(State& st) override {
+    for (alarm_t* alarm : alarms_) {
+      alarm_free(alarm);
+    }
+    alarms_.clear();
+    g_promise = nullptr;
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  std::vector<alarm_t*> alarms_;
+};
+
+// Arm thousands of long timeouts at spread out deadlines, then cancel them
+BENCHMARK_DEFINE_F(BM_OsiAlarmScale, schedule_and_cancel)(State& state) {
+  for (auto _ : state) {
+    for (size_t i = 0; i < alarms_.size(); i++) {
+      alarm_set(alarms_[i], 10000 + (i * 7919) % 10000, &DoNothing, nullptr);
+    }
+    for (alarm_t* alarm : alarms_) {
+      alarm_cancel(alarm);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * alarms_.size());
+};
+
+BENCHMARK_REGISTER_F(BM_OsiAlarmScale, schedule_and_cancel)
+    ->Arg(10)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(5000);
+
+// Keep thousands of timeouts pending and keep pushing them back, the way
+// supervision and idle timers are refreshed by protocol traffic
+BENCHMARK_DEFINE_F(BM_OsiAlarmScale, reschedule)(State& state) {
+  for (size_t i = 0; i < alarms_.size(); i++) {
+    alarm_set(alarms_[i], 10000 + (i * 7919) % 10000, &DoNothing, nullptr);
+  }
+  size_t next = 0;
+  for (auto _ : state) {
+    alarm_set(alarms_[next], 10000 + (next * 104729) % 10000, &DoNothing,
+              nullptr);
+    next = (next + 1) % alarms_.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+};
+
+BENCHMARK_REGISTER_F(BM_OsiAlarmScale, reschedule)
+    ->Arg(10)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(5000);
+
+// Arm thousands of alarms due within a few milliseconds of each other and
+// wait for all of them to fire
+BENCHMARK_DEFINE_F(BM_OsiAlarmScale, schedule_and_fire)(State& state) {
+  for (auto _ : state) {
+    g_task_counter = 0;
+    g_promise = std::make_shared<std::promise<void>>();
+    auto future = g_promise->get_future();
+    for (size_t i = 0; i < alarms_.size(); i++) {
+      alarm_set(alarms_[i], 1 + i % 20, &CountFiredAlarm, nullptr);
+    }
+    future.get();
+  }
+  state.SetItemsProcessed(state.iterations() * alarms_.size());
+};
+
+BENCHMARK_REGISTER_F(BM_OsiAlarmScale, schedule_and_fire)
+    ->Arg(10)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(5000)
+    ->UseRealTime();
+
 int main(int argc, char** argv) {
   // Disable LOG() output from libchrome
   logging::LoggingSettings log_settings;
@@ -16,11 +16,15 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <iterator>
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <vector>
 
 namespace bluetooth {
 namespace common {
@@ -43,6 +47,34 @@ class CircularBuffer {
   mutable std::mutex mutex_;
 };
 
+// A bounded ring of variable length byte records, stored back to back in one fixed size allocation. Pushing a record
+// that does not fit evicts the oldest records first, so no memory is allocated after construction.
+class CircularByteBuffer {
+ public:
+  explicit CircularByteBuffer(size_t capacity_bytes);
+
+  // Push one record to the circular buffer. Records larger than the buffer are dropped.
+  void Push(const uint8_t* data, size_t length);
+  // Take a snapshot of the circular buffer and return all records concatenated, oldest first
+  std::vector<uint8_t> Pull() const;
+  // Drain everything from the circular buffer and return all records concatenated, oldest first
+  std::vector<uint8_t> Drain();
+
+ private:
+  // Each record is stored after its length
+  using LengthType = uint32_t;
+
+  void write_bytes(size_t offset, const void* data, size_t length);
+  void read_bytes(size_t offset, void* data, size_t length) const;
+  std::vector<uint8_t> pull_locked() const;
+
+  std::vector<uint8_t> buffer_;
+  size_t head_ = 0;
+  size_t used_ = 0;
+  size_t record_bytes_ = 0;
+  mutable std::mutex mutex_;
+};
+
 class Timestamper {
  public:
   virtual long long GetTimestamp() const = 0;
@@ -128,3 +160,69 @@ template <typename T>
 std::vector<struct bluetooth::common::TimestampedEntry<T>> bluetooth::common::TimestampedCircularBuffer<T>::Drain() {
   return bluetooth::common::CircularBuffer<TimestampedEntry<T>>::Drain();
 }
+
+inline bluetooth::common::CircularByteBuffer::CircularByteBuffer(size_t capacity_bytes) : buffer_(capacity_bytes) {}
+
+inline void bluetooth::common::CircularByteBuffer::Push(const uint8_t* data, size_t length) {
+  size_t total_length = sizeof(LengthType) + length;
+  if (total_length > buffer_.size()) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (buffer_.size() - used_ < total_length) {
+    LengthType oldest_length;
+    read_bytes(head_, &oldest_length, sizeof(LengthType));
+    head_ = (head_ + sizeof(LengthType) + oldest_length) % buffer_.size();
+    used_ -= sizeof(LengthType) + oldest_length;
+    record_bytes_ -= oldest_length;
+  }
+  LengthType record_length = static_cast<LengthType>(length);
+  size_t tail = (head_ + used_) % buffer_.size();
+  write_bytes(tail, &record_length, sizeof(LengthType));
+  write_bytes((tail + sizeof(LengthType)) % buffer_.size(), data, length);
+  used_ += total_length;
+  record_bytes_ += length;
+}
+
+inline std::vector<uint8_t> bluetooth::common::CircularByteBuffer::Pull() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return pull_locked();
+}
+
+inline std::vector<uint8_t> bluetooth::common::CircularByteBuffer::Drain() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto bytes = pull_locked();
+  head_ = 0;
+  used_ = 0;
+  record_bytes_ = 0;
+  return bytes;
+}
+
+inline void bluetooth::common::CircularByteBuffer::write_bytes(size_t offset, const void* data, size_t length) {
+  size_t first_part = std::min(length, buffer_.size() - offset);
+  std::memcpy(buffer_.data() + offset, data, first_part);
+  std::memcpy(buffer_.data(), static_cast<const uint8_t*>(data) + first_part, length - first_part);
+}
+
+inline void bluetooth::common::CircularByteBuffer::read_bytes(size_t offset, void* data, size_t length) const {
+  size_t first_part = std::min(length, buffer_.size() - offset);
+  std::memcpy(data, buffer_.data() + offset, first_part);
+  std::memcpy(static_cast<uint8_t*>(data) + first_part, buffer_.data(), length - first_part);
+}
+
+inline std::vector<uint8_t> bluetooth::common::CircularByteBuffer::pull_locked() const {
+  std::vector<uint8_t> bytes(record_bytes_);
+  size_t offset = head_;
+  size_t remaining = used_;
+  uint8_t* out = bytes.data();
+  while (remaining > 0) {
+    LengthType record_length;
+    read_bytes(offset, &record_length, sizeof(LengthType));
+    offset = (offset + sizeof(LengthType)) % buffer_.size();
+    read_bytes(offset, out, record_length);
+    offset = (offset + record_length) % buffer_.size();
+    out += record_length;
+    remaining -= sizeof(LengthType) + record_length;
+  }
+  return bytes;
+}
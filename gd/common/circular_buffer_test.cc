@@ -18,6 +18,7 @@
 #include <gtest/gtest.h>
 #include <limits>
 #include <string>
+#include <vector>
 
 #include "common/circular_buffer.h"
 #include "os/log.h"
@@ -103,4 +104,44 @@ TEST(CircularBufferTest, max_timestamps) {
   }
 }
 
+TEST(CircularByteBufferTest, simple_drain) {
+  bluetooth::common::CircularByteBuffer buffer(64);
+  std::vector<uint8_t> one = {1, 2, 3};
+  std::vector<uint8_t> two = {4, 5};
+
+  buffer.Push(one.data(), one.size());
+  buffer.Push(two.data(), two.size());
+
+  std::vector<uint8_t> expected = {1, 2, 3, 4, 5};
+  ASSERT_EQ(expected, buffer.Pull());
+  ASSERT_EQ(expected, buffer.Drain());
+  ASSERT_TRUE(buffer.Pull().empty());
+}
+
+TEST(CircularByteBufferTest, evicts_oldest_records) {
+  // Room for three 4 byte records with their 4 byte lengths
+  bluetooth::common::CircularByteBuffer buffer(24);
+
+  std::vector<uint8_t> expected;
+  for (uint8_t i = 0; i < 10; i++) {
+    std::vector<uint8_t> record(4, i);
+    buffer.Push(record.data(), record.size());
+    if (i >= 7) {
+      expected.insert(expected.end(), record.begin(), record.end());
+    }
+  }
+  ASSERT_EQ(expected, buffer.Pull());
+}
+
+TEST(CircularByteBufferTest, drops_oversized_record) {
+  bluetooth::common::CircularByteBuffer buffer(16);
+  std::vector<uint8_t> small = {1, 2};
+  std::vector<uint8_t> big(16, 0xff);
+
+  buffer.Push(small.data(), small.size());
+  buffer.Push(big.data(), big.size());
+
+  ASSERT_EQ(small, buffer.Pull());
+}
+
 }  // namespace testing
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace bluetooth {
+namespace common {
+
+// A bounded, lock-free, multi-producer single-consumer ring buffer.
+//
+// Any number of threads may call TryPush() concurrently, while TryPop() must only be called by one thread at a time.
+// Each slot carries a sequence number that tells producers whether it is free and tells the consumer whether it has
+// been published, so producers only contend on a single atomic increment and never block each other or the consumer.
+//
+// T must be default constructible and move assignable. Popped slots are reset to T() so that resources held by an
+// item are released as soon as it is taken out of the ring.
+template <typename T>
+class MpscRing {
+ public:
+  // Create a ring that can hold at least |capacity| items. The actual capacity is rounded up to a power of two
+  // no smaller than 2.
+  explicit MpscRing(size_t capacity);
+
+  MpscRing(const MpscRing&) = delete;
+  MpscRing& operator=(const MpscRing&) = delete;
+
+  // Move |item| into the ring and return true, or return false and leave |item| untouched if the ring is full.
+  // Safe to call from any thread.
+  bool TryPush(T& item);
+
+  // Move the oldest published item into |item| and return true, or return false if there is none. A slot reserved by
+  // a producer that has not finished publishing it yet is reported as empty. Must only be called by the consumer.
+  bool TryPop(T* item);
+
+  size_t Capacity() const {
+    return mask_ + 1;
+  }
+
+ private:
+  static constexpr size_t kCacheLineSize = 64;
+
+  struct Slot {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  // The sequence numbers can only tell a free slot from a published one with at least two slots
+  static size_t round_up_to_power_of_two(size_t capacity) {
+    size_t rounded = 2;
+    while (rounded < capacity) {
+      rounded <<= 1;
+    }
+    return rounded;
+  }
+
+  const size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+  alignas(kCacheLineSize) std::atomic<size_t> enqueue_position_;
+  alignas(kCacheLineSize) size_t dequeue_position_;
+};
+
+template <typename T>
+MpscRing<T>::MpscRing(size_t capacity)
+    : mask_(round_up_to_power_of_two(capacity) - 1),
+      slots_(new Slot[mask_ + 1]),
+      enqueue_position_(0),
+      dequeue_position_(0) {
+  for (size_t i = 0; i <= mask_; i++) {
+    slots_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+template <typename T>
+bool MpscRing<T>::TryPush(T& item) {
+  size_t position = enqueue_position_.load(std::memory_order_relaxed);
+  Slot* slot;
+  while (true) {
+    slot = &slots_[position & mask_];
+    size_t sequence = slot->sequence.load(std::memory_order_acquire);
+    auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+    if (diff == 0) {
+      if (enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // The consumer has not released this slot from the previous lap yet
+      return false;
+    } else {
+      position = enqueue_position_.load(std::memory_order_relaxed);
+    }
+  }
+  slot->value = std::move(item);
+  slot->sequence.store(position + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+bool MpscRing<T>::TryPop(T* item) {
+  Slot* slot = &slots_[dequeue_position_ & mask_];
+  if (slot->sequence.load(std::memory_order_acquire) != dequeue_position_ + 1) {
+    return false;
+  }
+  *item = std::move(slot->value);
+  slot->value = T();
+  slot->sequence.store(dequeue_position_ + mask_ + 1, std::memory_order_release);
+  dequeue_position_++;
+  return true;
+}
+
+}  // namespace common
+}  // namespace bluetooth
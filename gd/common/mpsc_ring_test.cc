@@ -0,0 +1,121 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "common/mpsc_ring.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace testing {
+
+using bluetooth::common::MpscRing;
+
+TEST(MpscRingTest, capacity_rounded_up) {
+  MpscRing<int> ring(5);
+  ASSERT_EQ(ring.Capacity(), 8ul);
+  MpscRing<int> tiny_ring(1);
+  ASSERT_EQ(tiny_ring.Capacity(), 2ul);
+}
+
+TEST(MpscRingTest, push_pop_in_order) {
+  MpscRing<int> ring(4);
+  for (int i = 0; i < 4; i++) {
+    int value = i;
+    ASSERT_TRUE(ring.TryPush(value));
+  }
+  int value = 4;
+  ASSERT_FALSE(ring.TryPush(value));
+  ASSERT_EQ(value, 4);
+
+  for (int i = 0; i < 4; i++) {
+    int popped = -1;
+    ASSERT_TRUE(ring.TryPop(&popped));
+    ASSERT_EQ(popped, i);
+  }
+  int popped = -1;
+  ASSERT_FALSE(ring.TryPop(&popped));
+}
+
+TEST(MpscRingTest, wraps_around) {
+  MpscRing<int> ring(2);
+  for (int i = 0; i < 100; i++) {
+    int value = i;
+    ASSERT_TRUE(ring.TryPush(value));
+    int popped = -1;
+    ASSERT_TRUE(ring.TryPop(&popped));
+    ASSERT_EQ(popped, i);
+  }
+}
+
+TEST(MpscRingTest, failed_push_keeps_move_only_item) {
+  MpscRing<std::unique_ptr<int>> ring(2);
+  auto first = std::make_unique<int>(1);
+  ASSERT_TRUE(ring.TryPush(first));
+  ASSERT_EQ(first, nullptr);
+  auto second = std::make_unique<int>(2);
+  ASSERT_TRUE(ring.TryPush(second));
+  auto third = std::make_unique<int>(3);
+  ASSERT_FALSE(ring.TryPush(third));
+  ASSERT_NE(third, nullptr);
+
+  std::unique_ptr<int> popped;
+  ASSERT_TRUE(ring.TryPop(&popped));
+  ASSERT_EQ(*popped, 1);
+}
+
+TEST(MpscRingTest, concurrent_producers) {
+  constexpr int kNumProducers = 4;
+  constexpr int kItemsPerProducer = 10000;
+  MpscRing<int> ring(64);
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kNumProducers; p++) {
+    producers.emplace_back([&ring, p]() {
+      for (int i = 0; i < kItemsPerProducer; i++) {
+        int value = p * kItemsPerProducer + i;
+        while (!ring.TryPush(value)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  // Items from one producer must come out in the order that producer pushed them
+  std::vector<int> last_seen(kNumProducers, -1);
+  int received = 0;
+  while (received < kNumProducers * kItemsPerProducer) {
+    int value;
+    if (!ring.TryPop(&value)) {
+      std::this_thread::yield();
+      continue;
+    }
+    int producer = value / kItemsPerProducer;
+    int index = value % kItemsPerProducer;
+    ASSERT_GT(index, last_seen[producer]);
+    last_seen[producer] = index;
+    received++;
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  for (int p = 0; p < kNumProducers; p++) {
+    ASSERT_EQ(last_seen[p], kItemsPerProducer - 1);
+  }
+}
+
+}  // namespace testing
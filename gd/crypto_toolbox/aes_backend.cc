@@ -0,0 +1,200 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "crypto_toolbox/aes_backend.h"
+
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define AES_BACKEND_X86
+#elif defined(__aarch64__) && defined(__linux__)
+#include <arm_neon.h>
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#define AES_BACKEND_ARMV8
+#endif
+
+namespace bluetooth {
+namespace crypto_toolbox {
+
+namespace {
+
+#if defined(AES_BACKEND_X86)
+
+bool is_supported_x86_aes_ni() {
+  return __builtin_cpu_supports("aes");
+}
+
+// One step of the FIPS-197 key expansion, the round constant of AESKEYGENASSIST has to be an immediate
+template <int kRcon>
+__attribute__((target("aes,sse2"))) __m128i expand_key_x86_aes_ni_step(__m128i key) {
+  __m128i word = _mm_shuffle_epi32(_mm_aeskeygenassist_si128(key, kRcon), 0xff);
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  return _mm_xor_si128(key, word);
+}
+
+__attribute__((target("aes,sse2"))) void set_key_x86_aes_ni(const uint8_t key[N_BLOCK], aes_context* ctx) {
+  __m128i* round_keys = reinterpret_cast<__m128i*>(ctx->ksch);
+  __m128i round_key = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key));
+  _mm_storeu_si128(&round_keys[0], round_key);
+  round_key = expand_key_x86_aes_ni_step<0x01>(round_key);
+  _mm_storeu_si128(&round_keys[1], round_key);
+  round_key = expand_key_x86_aes_ni_step<0x02>(round_key);
+  _mm_storeu_si128(&round_keys[2], round_key);
+  round_key = expand_key_x86_aes_ni_step<0x04>(round_key);
+  _mm_storeu_si128(&round_keys[3], round_key);
+  round_key = expand_key_x86_aes_ni_step<0x08>(round_key);
+  _mm_storeu_si128(&round_keys[4], round_key);
+  round_key = expand_key_x86_aes_ni_step<0x10>(round_key);
+  _mm_storeu_si128(&round_keys[5], round_key);
+  round_key = expand_key_x86_aes_ni_step<0x20>(round_key);
+  _mm_storeu_si128(&round_keys[6], round_key);
+  round_key = expand_key_x86_aes_ni_step<0x40>(round_key);
+  _mm_storeu_si128(&round_keys[7], round_key);
+  round_key = expand_key_x86_aes_ni_step<0x80>(round_key);
+  _mm_storeu_si128(&round_keys[8], round_key);
+  round_key = expand_key_x86_aes_ni_step<0x1b>(round_key);
+  _mm_storeu_si128(&round_keys[9], round_key);
+  round_key = expand_key_x86_aes_ni_step<0x36>(round_key);
+  _mm_storeu_si128(&round_keys[10], round_key);
+  ctx->rnd = 10;
+}
+
+// Round keys are not aligned in aes_context, hence the unaligned loads
+__attribute__((target("aes,sse2"))) void encrypt_x86_aes_ni(
+    const aes_context* ctx, const uint8_t in[N_BLOCK], uint8_t out[N_BLOCK]) {
+  const __m128i* round_keys = reinterpret_cast<const __m128i*>(ctx->ksch);
+  __m128i state = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+  state = _mm_xor_si128(state, _mm_loadu_si128(&round_keys[0]));
+  for (uint8_t round = 1; round < ctx->rnd; round++) {
+    state = _mm_aesenc_si128(state, _mm_loadu_si128(&round_keys[round]));
+  }
+  state = _mm_aesenclast_si128(state, _mm_loadu_si128(&round_keys[ctx->rnd]));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), state);
+}
+
+#endif
+
+#if defined(AES_BACKEND_ARMV8)
+
+#if defined(__clang__)
+#define TARGET_ARMV8_CRYPTO __attribute__((target("crypto")))
+#else
+#define TARGET_ARMV8_CRYPTO __attribute__((target("+crypto")))
+#endif
+
+bool is_supported_armv8_crypto() {
+  return (getauxval(AT_HWCAP) & HWCAP_AES) != 0;
+}
+
+// AESE adds the round key before substituting and shifting, so the key addition moves one round earlier than in
+// FIPS-197, and the last round key is added on its own
+TARGET_ARMV8_CRYPTO void encrypt_armv8_crypto(
+    const aes_context* ctx, const uint8_t in[N_BLOCK], uint8_t out[N_BLOCK]) {
+  uint8x16_t state = vld1q_u8(in);
+  for (uint8_t round = 0; round + 1 < ctx->rnd; round++) {
+    state = vaesmcq_u8(vaeseq_u8(state, vld1q_u8(ctx->ksch + round * N_BLOCK)));
+  }
+  state = vaeseq_u8(state, vld1q_u8(ctx->ksch + (ctx->rnd - 1) * N_BLOCK));
+  state = veorq_u8(state, vld1q_u8(ctx->ksch + ctx->rnd * N_BLOCK));
+  vst1q_u8(out, state);
+}
+
+#endif
+
+bool is_supported(AesImplementation implementation) {
+  switch (implementation) {
+    case AesImplementation::PORTABLE:
+      return true;
+    case AesImplementation::X86_AES_NI:
+#if defined(AES_BACKEND_X86)
+      return is_supported_x86_aes_ni();
+#else
+      return false;
+#endif
+    case AesImplementation::ARMV8_CRYPTO:
+#if defined(AES_BACKEND_ARMV8)
+      return is_supported_armv8_crypto();
+#else
+      return false;
+#endif
+  }
+  return false;
+}
+
+AesImplementation best_implementation() {
+  if (is_supported(AesImplementation::X86_AES_NI)) {
+    return AesImplementation::X86_AES_NI;
+  }
+  if (is_supported(AesImplementation::ARMV8_CRYPTO)) {
+    return AesImplementation::ARMV8_CRYPTO;
+  }
+  return AesImplementation::PORTABLE;
+}
+
+std::atomic<AesImplementation>& current_implementation() {
+  static std::atomic<AesImplementation> implementation{best_implementation()};
+  return implementation;
+}
+
+}  // namespace
+
+AesImplementation get_aes_implementation() {
+  return current_implementation().load(std::memory_order_relaxed);
+}
+
+bool set_aes_implementation(AesImplementation implementation) {
+  if (!is_supported(implementation)) {
+    return false;
+  }
+  current_implementation().store(implementation, std::memory_order_relaxed);
+  return true;
+}
+
+void aes_128_set_key(const uint8_t key[N_BLOCK], aes_context* ctx) {
+#if defined(AES_BACKEND_X86)
+  if (get_aes_implementation() == AesImplementation::X86_AES_NI) {
+    set_key_x86_aes_ni(key, ctx);
+    return;
+  }
+#endif
+  // ARMv8 has no instruction for the key expansion, it is done once per key anyway
+  aes_set_key(key, N_BLOCK, ctx);
+}
+
+void aes_encrypt_block(const aes_context* ctx, const uint8_t in[N_BLOCK], uint8_t out[N_BLOCK]) {
+  switch (get_aes_implementation()) {
+#if defined(AES_BACKEND_X86)
+    case AesImplementation::X86_AES_NI:
+      encrypt_x86_aes_ni(ctx, in, out);
+      return;
+#endif
+#if defined(AES_BACKEND_ARMV8)
+    case AesImplementation::ARMV8_CRYPTO:
+      encrypt_armv8_crypto(ctx, in, out);
+      return;
+#endif
+    default:
+      aes_encrypt(in, out, ctx);
+      return;
+  }
+}
+
+}  // namespace crypto_toolbox
+}  // namespace bluetooth
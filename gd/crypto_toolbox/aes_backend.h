@@ -0,0 +1,49 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "crypto_toolbox/aes.h"
+
+namespace bluetooth {
+namespace crypto_toolbox {
+
+// AES-128 block encryption, selected once at run time from the instructions the CPU has. All the implementations take
+// the key schedule computed by aes_set_key(), whose round keys are laid out as FIPS-197 expands them, and blocks in the
+// big endian order of aes_encrypt().
+enum class AesImplementation {
+  PORTABLE,      // aes_encrypt(), byte oriented tables
+  X86_AES_NI,    // x86 AES-NI
+  ARMV8_CRYPTO,  // ARMv8 cryptography extensions
+};
+
+// Implementation in use, the fastest one the CPU supports unless another one was set
+AesImplementation get_aes_implementation();
+
+// Use |implementation| from now on, for tests and benchmarks. Return false, and keep the current one, if the CPU does
+// not support it.
+bool set_aes_implementation(AesImplementation implementation);
+
+// Compute the key schedule |ctx| of a 128 bit key, as aes_set_key() does
+void aes_128_set_key(const uint8_t key[N_BLOCK], aes_context* ctx);
+
+// Encrypt one block with the key schedule |ctx|, as aes_encrypt() does
+void aes_encrypt_block(const aes_context* ctx, const uint8_t in[N_BLOCK], uint8_t out[N_BLOCK]);
+
+}  // namespace crypto_toolbox
+}  // namespace bluetooth
@@ -23,8 +23,10 @@
  ******************************************************************************/
 
 #include <algorithm>
+#include <new>
 
 #include "crypto_toolbox/aes.h"
+#include "crypto_toolbox/aes_backend.h"
 #include "crypto_toolbox/crypto_toolbox.h"
 
 namespace bluetooth {
@@ -57,23 +59,32 @@ static void xor_128(Octet16* a, const Octet16& b) {
 }
 }  // namespace
 
-/* This function computes AES_128(key, message) */
-Octet16 aes_128(const Octet16& key, const Octet16& message) {
+static_assert(sizeof(aes_context) <= sizeof(AesContext), "AesContext too small for aes_context");
+
+AesContext::AesContext(const Octet16& key) {
   Octet16 key_reversed;
+  std::reverse_copy(key.begin(), key.end(), key_reversed.begin());
+
+  aes_context* ctx = new (schedule_) aes_context;
+  aes_128_set_key(key_reversed.data(), ctx);
+}
+
+Octet16 AesContext::Encrypt(const Octet16& message) const {
   Octet16 message_reversed;
   Octet16 output;
 
-  std::reverse_copy(key.begin(), key.end(), key_reversed.begin());
   std::reverse_copy(message.begin(), message.end(), message_reversed.begin());
-
-  aes_context ctx;
-  aes_set_key(key_reversed.data(), key_reversed.size(), &ctx);
-  aes_encrypt(message_reversed.data(), output.data(), &ctx);
+  aes_encrypt_block(reinterpret_cast<const aes_context*>(schedule_), message_reversed.data(), output.data());
 
   std::reverse(output.begin(), output.end());
   return output;
 }
 
+/* This function computes AES_128(key, message) */
+Octet16 aes_128(const Octet16& key, const Octet16& message) {
+  return AesContext(key).Encrypt(message);
+}
+
 /** utility function to padding the given text to be a 128 bits data. The
  * parameter dest is input and output parameter, it must point to a
  * OCTET16_LEN memory space; where include length bytes valid data. */
@@ -96,7 +107,7 @@ static void leftshift_onebit(uint8_t* input, uint8_t* output) {
 }
 
 /** This function is the calculation of block cipher using AES-128. */
-static Octet16 cmac_aes_k_calculate(const Octet16& key) {
+static Octet16 cmac_aes_k_calculate(const AesContext& key) {
   Octet16 output;
   Octet16 x{0};  // zero initialized
 
@@ -105,7 +116,7 @@ static Octet16 cmac_aes_k_calculate(const Octet16& key) {
     /* Mi' := Mi (+) X  */
     xor_128((Octet16*)&cmac_cb.text[(cmac_cb.round - i) * OCTET16_LEN], x);
 
-    output = aes_128(key, &cmac_cb.text[(cmac_cb.round - i) * OCTET16_LEN], OCTET16_LEN);
+    output = key.Encrypt(*(Octet16*)&cmac_cb.text[(cmac_cb.round - i) * OCTET16_LEN]);
     x = output;
     i++;
   }
@@ -136,9 +147,9 @@ static void cmac_prepare_last_block(const Octet16& k1, const Octet16& k2) {
 /** This is the function to generate the two subkeys.
  * |key| is CMAC key, expect SRK when used by SMP.
  */
-static void cmac_generate_subkey(const Octet16& key) {
+static void cmac_generate_subkey(const AesContext& key) {
   Octet16 zero{};
-  Octet16 p = aes_128(key, zero.data(), OCTET16_LEN);
+  Octet16 p = key.Encrypt(zero);
 
   Octet16 k1, k2;
   uint8_t* pp = p.data();
@@ -169,6 +180,12 @@ static void cmac_generate_subkey(const Octet16& key) {
  *  length - length of the input in byte.
  */
 Octet16 aes_cmac(const Octet16& key, const uint8_t* input, uint16_t length) {
+  return aes_cmac(AesContext(key), input, length);
+}
+
+/** Same as above, with the key schedule of the CMAC key computed beforehand.
+ */
+Octet16 aes_cmac(const AesContext& key, const uint8_t* input, uint16_t length) {
   uint32_t len;
   uint16_t diff;
   /* n is number of rounds */
@@ -51,7 +51,7 @@ Octet16 f4(uint8_t* u, uint8_t* v, const Octet16& x, uint8_t z) {
 
 /** helper for f5 */
 static Octet16 calculate_mac_key_or_ltk(
-    const Octet16& t,
+    const AesContext& t,
     uint8_t counter,
     uint8_t* key_id,
     const Octet16& n1,
@@ -81,7 +81,8 @@ void f5(uint8_t* w, const Octet16& n1, const Octet16& n2, uint8_t* a1, uint8_t*
   //          7);
 
   const Octet16 salt{0xBE, 0x83, 0x60, 0x5A, 0xDB, 0x0B, 0x37, 0x60, 0x38, 0xA5, 0xF5, 0xAA, 0x91, 0x83, 0x88, 0x6C};
-  Octet16 t = aes_cmac(salt, w, OCTET32_LEN);
+  // T keys both the MacKey and the LTK CMACs, expand it once
+  AesContext t(aes_cmac(salt, w, OCTET32_LEN));
 
   // DVLOG(2) << "T=" << HexEncode(t.data(), t.size());
 
@@ -179,6 +180,8 @@ Octet16 c1(
     const uint8_t* ia,
     const uint8_t rat,
     const uint8_t* ra) {
+  AesContext key(k);
+
   Octet16 p1;
   auto it = p1.begin();
   it = std::copy(&iat, &iat + 1, it);
@@ -190,7 +193,7 @@ Octet16 c1(
     p1[i] = r[i] ^ p1[i];
   }
 
-  Octet16 p1bis = aes_128(k, p1);
+  Octet16 p1bis = key.Encrypt(p1);
 
   std::array<uint8_t, 4> padding{0};
   Octet16 p2;
@@ -203,7 +206,7 @@ Octet16 c1(
     p2[i] = p1bis[i] ^ p2[i];
   }
 
-  return aes_128(k, p2);
+  return key.Encrypt(p2);
 }
 
 Octet16 s1(const Octet16& k, const Octet16& r1, const Octet16& r2) {
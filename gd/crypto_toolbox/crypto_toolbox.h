@@ -26,6 +26,20 @@ namespace crypto_toolbox {
 constexpr int OCTET16_LEN = 16;
 using Octet16 = std::array<uint8_t, OCTET16_LEN>;
 
+// AES-128 key, expanded once to encrypt any number of blocks, or compute any number of CMACs. Keys, messages and
+// outputs are in the same little endian order as aes_128() and aes_cmac().
+class AesContext {
+ public:
+  explicit AesContext(const Octet16& key);
+
+  // AES_128(key, message)
+  Octet16 Encrypt(const Octet16& message) const;
+
+ private:
+  // Key schedule of the aes_context type of aes.h, which is not included here
+  alignas(16) uint8_t schedule_[256];
+};
+
 Octet16 c1(
     const Octet16& k,
     const Octet16& r,
@@ -39,6 +53,7 @@ Octet16 s1(const Octet16& k, const Octet16& r1, const Octet16& r2);
 
 extern Octet16 aes_128(const Octet16& key, const Octet16& message);
 extern Octet16 aes_cmac(const Octet16& key, const uint8_t* message, uint16_t length);
+extern Octet16 aes_cmac(const AesContext& key, const uint8_t* message, uint16_t length);
 extern Octet16 f4(uint8_t* u, uint8_t* v, const Octet16& x, uint8_t z);
 extern void f5(
     uint8_t* w, const Octet16& n1, const Octet16& n2, uint8_t* a1, uint8_t* a2, Octet16* mac_key, Octet16* ltk);
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <array>
+#include <cstdint>
+
+#include "benchmark/benchmark.h"
+#include "crypto_toolbox/aes_backend.h"
+#include "crypto_toolbox/crypto_toolbox.h"
+
+using ::benchmark::State;
+using ::bluetooth::crypto_toolbox::aes_128;
+using ::bluetooth::crypto_toolbox::aes_cmac;
+using ::bluetooth::crypto_toolbox::AesContext;
+using ::bluetooth::crypto_toolbox::AesImplementation;
+using ::bluetooth::crypto_toolbox::f5;
+using ::bluetooth::crypto_toolbox::get_aes_implementation;
+using ::bluetooth::crypto_toolbox::Octet16;
+using ::bluetooth::crypto_toolbox::set_aes_implementation;
+
+namespace {
+
+// Run with each implementation the CPU supports, restoring the default one after
+class AesImplementationScope {
+ public:
+  explicit AesImplementationScope(State& state) : default_implementation_(get_aes_implementation()) {
+    if (!set_aes_implementation(static_cast<AesImplementation>(state.range(0)))) {
+      state.SkipWithError("AES implementation not supported by this CPU");
+    }
+  }
+  ~AesImplementationScope() {
+    set_aes_implementation(default_implementation_);
+  }
+
+ private:
+  AesImplementation default_implementation_;
+};
+
+void AesImplementations(benchmark::internal::Benchmark* benchmark) {
+  benchmark->Arg(static_cast<int64_t>(AesImplementation::PORTABLE));
+  benchmark->Arg(static_cast<int64_t>(AesImplementation::X86_AES_NI));
+  benchmark->Arg(static_cast<int64_t>(AesImplementation::ARMV8_CRYPTO));
+}
+
+// One block with a new key each time, as when checking an RPA against an IRK
+void BM_Aes128(State& state) {
+  AesImplementationScope scope(state);
+  Octet16 key{0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+  Octet16 message{};
+  for (auto _ : state) {
+    message = aes_128(key, message);
+    benchmark::DoNotOptimize(message);
+  }
+}
+BENCHMARK(BM_Aes128)->Apply(AesImplementations);
+
+// One block with an expanded key
+void BM_AesContextEncrypt(State& state) {
+  AesImplementationScope scope(state);
+  AesContext context({0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c});
+  Octet16 message{};
+  for (auto _ : state) {
+    message = context.Encrypt(message);
+    benchmark::DoNotOptimize(message);
+  }
+}
+BENCHMARK(BM_AesContextEncrypt)->Apply(AesImplementations);
+
+// CMAC of the 65 bytes message of f4, the largest of the SMP functions
+void BM_AesCmac(State& state) {
+  AesImplementationScope scope(state);
+  Octet16 key{0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+  std::array<uint8_t, 65> message{};
+  for (auto _ : state) {
+    key = aes_cmac(key, message.data(), message.size());
+    benchmark::DoNotOptimize(key);
+  }
+}
+BENCHMARK(BM_AesCmac)->Apply(AesImplementations);
+
+void BM_F5(State& state) {
+  AesImplementationScope scope(state);
+  std::array<uint8_t, 32> w{};
+  Octet16 n1{}, n2{};
+  std::array<uint8_t, 7> a1{}, a2{};
+  Octet16 mac_key, ltk;
+  for (auto _ : state) {
+    f5(w.data(), n1, n2, a1.data(), a2.data(), &mac_key, &ltk);
+    n1 = ltk;
+    benchmark::DoNotOptimize(mac_key);
+  }
+}
+BENCHMARK(BM_F5)->Apply(AesImplementations);
+
+}  // namespace
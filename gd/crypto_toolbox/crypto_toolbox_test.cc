@@ -20,9 +20,11 @@
 
 #include <gtest/gtest.h>
 
+#include <random>
 #include <vector>
 
 #include "crypto_toolbox/aes.h"
+#include "crypto_toolbox/aes_backend.h"
 
 namespace bluetooth {
 namespace crypto_toolbox {
@@ -352,5 +354,74 @@ TEST(CryptoToolboxTest, bt_spec_example_d_12_test) {
   EXPECT_EQ(expected_ltk, ltk);
 }
 
+TEST(CryptoToolboxTest, aes_context_test) {
+  std::mt19937 random(0);
+  for (int i = 0; i < 64; i++) {
+    Octet16 key, message;
+    for (auto& byte : key) byte = random();
+    for (auto& byte : message) byte = random();
+
+    AesContext context(key);
+    EXPECT_EQ(context.Encrypt(message), aes_128(key, message));
+    EXPECT_EQ(aes_cmac(context, message.data(), i % OCTET16_LEN), aes_cmac(key, message.data(), i % OCTET16_LEN));
+  }
+}
+
+class CryptoToolboxAesImplementationTest : public ::testing::TestWithParam<AesImplementation> {
+ protected:
+  void SetUp() override {
+    default_implementation_ = get_aes_implementation();
+    if (!set_aes_implementation(GetParam())) {
+      GTEST_SKIP() << "AES implementation not supported by this CPU";
+    }
+  }
+
+  void TearDown() override {
+    set_aes_implementation(default_implementation_);
+  }
+
+  AesImplementation default_implementation_;
+};
+
+// BT Spec 5.0 | Vol 3, Part H D.1
+TEST_P(CryptoToolboxAesImplementationTest, bt_spec_test_d_1_test) {
+  Octet16 k{0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+  Octet16 m{};
+  Octet16 aes_k_m{0x7d, 0xf7, 0x6b, 0x0c, 0x1a, 0xb8, 0x99, 0xb3, 0x3e, 0x42, 0xf0, 0x47, 0xb9, 0x1b, 0x54, 0x6f};
+
+  // algorithm expect all input to be in little endian format, so reverse
+  std::reverse(std::begin(k), std::end(k));
+  std::reverse(std::begin(aes_k_m), std::end(aes_k_m));
+
+  EXPECT_EQ(aes_k_m, AesContext(k).Encrypt(m));
+}
+
+// The other tests of this file run with the implementation in use, compare the others to the portable one
+TEST_P(CryptoToolboxAesImplementationTest, matches_portable_test) {
+  std::mt19937 random(0);
+  for (int i = 0; i < 256; i++) {
+    Octet16 key;
+    std::array<uint8_t, 3 * OCTET16_LEN> message;
+    for (auto& byte : key) byte = random();
+    for (auto& byte : message) byte = random();
+    uint16_t length = i % message.size();
+
+    AesContext context(key);
+    Octet16 output = context.Encrypt(*(Octet16*)message.data());
+    Octet16 cmac = aes_cmac(context, message.data(), length);
+
+    ASSERT_TRUE(set_aes_implementation(AesImplementation::PORTABLE));
+    EXPECT_EQ(output, context.Encrypt(*(Octet16*)message.data()));
+    EXPECT_EQ(cmac, aes_cmac(key, message.data(), length));
+    ASSERT_TRUE(set_aes_implementation(GetParam()));
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    CryptoToolboxAesImplementationTest,
+    CryptoToolboxAesImplementationTest,
+    ::testing::Values(
+        AesImplementation::PORTABLE, AesImplementation::X86_AES_NI, AesImplementation::ARMV8_CRYPTO));
+
 }  // namespace crypto_toolbox
 }  // namespace bluetooth
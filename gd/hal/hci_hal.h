@@ -16,9 +16,12 @@
 
 #pragma once
 
+#include <memory>
 #include <vector>
 
+#include "hal/serialize_packet.h"
 #include "module.h"
+#include "packet/base_packet_builder.h"
 
 namespace bluetooth {
 namespace hal {
@@ -88,6 +91,14 @@ class HciHal : public ::bluetooth::Module {
   // Packets must be processed in order.
   virtual void sendAclData(HciPacket data) = 0;
 
+  // Serialize and send an HCI ACL data packet built by the stack. The default
+  // serializes into a buffer sized from the builder and calls sendAclData().
+  // HALs that frame packets on the wire can override this to serialize
+  // straight into their transmit buffer, after their own header.
+  virtual void sendAclPacket(std::unique_ptr<packet::BasePacketBuilder> packet) {
+    sendAclData(SerializePacket(std::move(packet)));
+  }
+
   // Send an SCO data packet (as specified in the Bluetooth Specification
   // V4.2, Vol 2, Part 5, Section 5.4.3) to the Bluetooth controller.
   // Packets must be processed in order.
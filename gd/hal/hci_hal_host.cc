@@ -21,18 +21,21 @@
 #include <poll.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <chrono>
 #include <csignal>
+#include <deque>
 #include <mutex>
-#include <queue>
 
 #include "hal/hci_hal.h"
 #include "hal/snoop_logger.h"
 #include "os/log.h"
 #include "os/reactor.h"
 #include "os/thread.h"
+#include "packet/bit_inserter.h"
 
 namespace {
 constexpr int INVALID_FD = -1;
@@ -48,7 +51,11 @@ constexpr uint8_t kHciAclHeaderSize = 4;
 constexpr uint8_t kHciScoHeaderSize = 3;
 constexpr uint8_t kHciEvtHeaderSize = 2;
 constexpr uint8_t kHciIsoHeaderSize = 4;
-constexpr int kBufSize = 1024 + 4 + 1;  // DeviceProperties::acl_data_packet_size_ + ACL header + H4 header
+// Initial size of the receive buffer, which grows when a packet does not fit
+constexpr size_t kRxBufferSize = 16 * 1024;
+constexpr size_t kMaxPooledTxBuffers = 16;
+// Most packets written with a single system call
+constexpr size_t kMaxTxBatch = 32;
 
 #ifdef USE_LINUX_HCI_SOCKET
 constexpr uint8_t BTPROTO_HCI = 1;
@@ -272,37 +279,58 @@ class HciHalHost : public HciHal {
   void sendHciCommand(HciPacket command) override {
     std::lock_guard<std::mutex> lock(api_mutex_);
     ASSERT(sock_fd_ != INVALID_FD);
-    std::vector<uint8_t> packet = std::move(command);
-    btsnoop_logger_->Capture(packet, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::CMD);
-    packet.insert(packet.cbegin(), kH4Command);
-    write_to_fd(packet);
+    btsnoop_logger_->Capture(command, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::CMD);
+    HciPacket packet = take_tx_buffer(kH4HeaderSize + command.size());
+    packet.push_back(kH4Command);
+    packet.insert(packet.end(), command.begin(), command.end());
+    write_to_fd(std::move(packet));
   }
 
   void sendAclData(HciPacket data) override {
     std::lock_guard<std::mutex> lock(api_mutex_);
     ASSERT(sock_fd_ != INVALID_FD);
-    std::vector<uint8_t> packet = std::move(data);
-    btsnoop_logger_->Capture(packet, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::ACL);
-    packet.insert(packet.cbegin(), kH4Acl);
-    write_to_fd(packet);
+    btsnoop_logger_->Capture(data, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::ACL);
+    HciPacket packet = take_tx_buffer(kH4HeaderSize + data.size());
+    packet.push_back(kH4Acl);
+    packet.insert(packet.end(), data.begin(), data.end());
+    write_to_fd(std::move(packet));
+  }
+
+  void sendAclPacket(std::unique_ptr<packet::BasePacketBuilder> data) override {
+    std::lock_guard<std::mutex> lock(api_mutex_);
+    ASSERT(sock_fd_ != INVALID_FD);
+    HciPacket buffer = take_tx_buffer(kH4HeaderSize + data->size());
+    buffer.push_back(kH4Acl);
+    {
+      packet::BitInserter it(buffer);
+      data->Serialize(it);
+    }
+    btsnoop_logger_->Capture(
+        buffer.data() + kH4HeaderSize,
+        buffer.size() - kH4HeaderSize,
+        SnoopLogger::Direction::OUTGOING,
+        SnoopLogger::PacketType::ACL);
+    write_to_fd(std::move(buffer));
   }
 
   void sendScoData(HciPacket data) override {
     std::lock_guard<std::mutex> lock(api_mutex_);
     ASSERT(sock_fd_ != INVALID_FD);
-    std::vector<uint8_t> packet = std::move(data);
-    btsnoop_logger_->Capture(packet, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::SCO);
-    packet.insert(packet.cbegin(), kH4Sco);
-    write_to_fd(packet);
+    btsnoop_logger_->Capture(data, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::SCO);
+    HciPacket packet = take_tx_buffer(kH4HeaderSize + data.size());
+    packet.push_back(kH4Sco);
+    packet.insert(packet.end(), data.begin(), data.end());
+    write_to_fd(std::move(packet));
   }
 
   void sendIsoData(HciPacket data) override {
     std::lock_guard<std::mutex> lock(api_mutex_);
     ASSERT(sock_fd_ != INVALID_FD);
-    std::vector<uint8_t> packet = std::move(data);
-    btsnoop_logger_->Capture(packet, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::ISO);
-    packet.insert(packet.cbegin(), kH4Iso);
-    write_to_fd(packet);
+    btsnoop_logger_->Capture(data, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::ISO);
+    HciPacket packet = take_tx_buffer(kH4HeaderSize + data.size());
+    packet.push_back(kH4Iso);
+    packet.insert(packet.end(), data.begin(), data.end());
+    write_to_fd(std::move(packet));
   }
 
  protected:
@@ -355,12 +383,31 @@ class HciHalHost : public HciHal {
   bluetooth::os::Thread hci_incoming_thread_ =
       bluetooth::os::Thread("hci_incoming_thread", bluetooth::os::Thread::Priority::NORMAL);
   bluetooth::os::Reactor::Reactable* reactable_ = nullptr;
-  std::queue<std::vector<uint8_t>> hci_outgoing_queue_;
+  std::deque<HciPacket> hci_outgoing_queue_;
+  // Bytes of the first queued packet already written
+  size_t tx_offset_ = 0;
+  // Written-out H4 buffers kept for reuse, so steady-state sends don't allocate
+  std::vector<HciPacket> tx_buffer_pool_;
   SnoopLogger* btsnoop_logger_ = nullptr;
+  // Received H4 bytes not delivered yet are rx_buffer_[0, rx_end_)
+  std::vector<uint8_t> rx_buffer_ = std::vector<uint8_t>(kRxBufferSize);
+  size_t rx_end_ = 0;
+
+  // Must be called with api_mutex_ held
+  HciPacket take_tx_buffer(size_t size) {
+    HciPacket buffer;
+    if (!tx_buffer_pool_.empty()) {
+      buffer = std::move(tx_buffer_pool_.back());
+      tx_buffer_pool_.pop_back();
+      buffer.clear();
+    }
+    buffer.reserve(size);
+    return buffer;
+  }
 
   void write_to_fd(HciPacket packet) {
     // TODO: replace this with new queue when it's ready
-    hci_outgoing_queue_.emplace(packet);
+    hci_outgoing_queue_.emplace_back(std::move(packet));
     if (hci_outgoing_queue_.size() == 1) {
       hci_incoming_thread_.GetReactor()->ModifyRegistration(
           reactable_,
@@ -369,14 +416,50 @@ class HciHalHost : public HciHal {
     }
   }
 
+  // Write as many queued packets as possible with a single system call
   void send_packet_ready() {
     std::lock_guard<std::mutex> lock(this->api_mutex_);
-    auto packet_to_send = this->hci_outgoing_queue_.front();
-    auto bytes_written = write(this->sock_fd_, (void*)packet_to_send.data(), packet_to_send.size());
-    this->hci_outgoing_queue_.pop();
-    if (bytes_written == -1) {
+    size_t num_packets = std::min(hci_outgoing_queue_.size(), kMaxTxBatch);
+    struct iovec iov[kMaxTxBatch];
+    for (size_t i = 0; i < num_packets; i++) {
+      size_t offset = i == 0 ? tx_offset_ : 0;
+      iov[i].iov_base = hci_outgoing_queue_[i].data() + offset;
+      iov[i].iov_len = hci_outgoing_queue_[i].size() - offset;
+    }
+#ifdef USE_LINUX_HCI_SOCKET
+    // Each message written to the HCI socket is a packet of its own
+    struct mmsghdr messages[kMaxTxBatch] = {};
+    for (size_t i = 0; i < num_packets; i++) {
+      messages[i].msg_hdr.msg_iov = &iov[i];
+      messages[i].msg_hdr.msg_iovlen = 1;
+    }
+    int num_sent;
+    RUN_NO_INTR(num_sent = sendmmsg(this->sock_fd_, messages, num_packets, 0));
+    if (num_sent == -1) {
+      abort();
+    }
+    size_t bytes_written = 0;
+    for (int i = 0; i < num_sent; i++) {
+      bytes_written += iov[i].iov_len;
+    }
+#else
+    ssize_t result;
+    RUN_NO_INTR(result = writev(this->sock_fd_, iov, num_packets));
+    if (result == -1) {
       abort();
     }
+    size_t bytes_written = result;
+#endif
+    // The last packet written may only be partially written, in which case it is finished next time
+    bytes_written += tx_offset_;
+    while (!hci_outgoing_queue_.empty() && bytes_written >= hci_outgoing_queue_.front().size()) {
+      bytes_written -= hci_outgoing_queue_.front().size();
+      if (tx_buffer_pool_.size() < kMaxPooledTxBuffers) {
+        tx_buffer_pool_.push_back(std::move(hci_outgoing_queue_.front()));
+      }
+      hci_outgoing_queue_.pop_front();
+    }
+    tx_offset_ = bytes_written;
     if (hci_outgoing_queue_.empty()) {
       this->hci_incoming_thread_.GetReactor()->ModifyRegistration(
           this->reactable_,
@@ -385,6 +468,7 @@ class HciHalHost : public HciHal {
     }
   }
 
+  // Read as much as the socket has in one call, then deliver every complete packet received so far
   void incoming_packet_received() {
     {
       std::lock_guard<std::mutex> incoming_packet_callback_lock(incoming_packet_callback_mutex_);
@@ -393,123 +477,118 @@ class HciHalHost : public HciHal {
         return;
       }
     }
-    uint8_t buf[kBufSize] = {};
+    if (rx_end_ == rx_buffer_.size()) {
+      // Only a packet larger than the buffer can fill it, as unparsed bytes are moved to the front after parsing
+      rx_buffer_.resize(rx_buffer_.size() * 2);
+    }
 
     ssize_t received_size;
-    RUN_NO_INTR(received_size = recv(sock_fd_, buf, kH4HeaderSize, 0));
+    RUN_NO_INTR(received_size = recv(sock_fd_, rx_buffer_.data() + rx_end_, rx_buffer_.size() - rx_end_, 0));
     ASSERT_LOG(received_size != -1, "Can't receive from socket: %s", strerror(errno));
     if (received_size == 0) {
       LOG_WARN("Can't read H4 header. EOF received");
       raise(SIGINT);
       return;
     }
+    rx_end_ += received_size;
 
-    if (buf[0] == kH4Event) {
-      RUN_NO_INTR(received_size = recv(sock_fd_, buf + kH4HeaderSize, kHciEvtHeaderSize, 0));
-      ASSERT_LOG(received_size != -1, "Can't receive from socket: %s", strerror(errno));
-      ASSERT_LOG(received_size == kHciEvtHeaderSize, "malformed HCI event header received");
-
-      uint8_t hci_evt_parameter_total_length = buf[2];
-      ssize_t payload_size;
-      RUN_NO_INTR(
-          payload_size = recv(sock_fd_, buf + kH4HeaderSize + kHciEvtHeaderSize, hci_evt_parameter_total_length, 0));
-      ASSERT_LOG(payload_size != -1, "Can't receive from socket: %s", strerror(errno));
-      ASSERT_LOG(
-          payload_size == hci_evt_parameter_total_length,
-          "malformed HCI event total parameter size received: %zu != %d",
-          payload_size,
-          hci_evt_parameter_total_length);
-
-      HciPacket receivedHciPacket;
-      receivedHciPacket.assign(buf + kH4HeaderSize, buf + kH4HeaderSize + kHciEvtHeaderSize + payload_size);
-      btsnoop_logger_->Capture(receivedHciPacket, SnoopLogger::Direction::INCOMING, SnoopLogger::PacketType::EVT);
-      {
-        std::lock_guard<std::mutex> incoming_packet_callback_lock(incoming_packet_callback_mutex_);
+    size_t rx_begin = 0;
+    while (deliver_packet(&rx_begin)) {
+    }
+    // Keep the start of an incomplete packet for the next read
+    std::copy(rx_buffer_.begin() + rx_begin, rx_buffer_.begin() + rx_end_, rx_buffer_.begin());
+    rx_end_ -= rx_begin;
+  }
+
+  // Deliver the packet at |*rx_begin| in the receive buffer and advance |*rx_begin| past it, if it was received in full
+  bool deliver_packet(size_t* rx_begin) {
+    size_t available = rx_end_ - *rx_begin;
+    if (available < kH4HeaderSize) {
+      return false;
+    }
+    const uint8_t* h4_packet = rx_buffer_.data() + *rx_begin;
+    uint8_t h4_type = h4_packet[0];
+    size_t header_size;
+    switch (h4_type) {
+      case kH4Event:
+        header_size = kHciEvtHeaderSize;
+        break;
+      case kH4Acl:
+        header_size = kHciAclHeaderSize;
+        break;
+      case kH4Sco:
+        header_size = kHciScoHeaderSize;
+        break;
+      case kH4Iso:
+        header_size = kHciIsoHeaderSize;
+        break;
+      default:
+        LOG_WARN("Skipping unexpected H4 packet type 0x%02hhx", h4_type);
+        *rx_begin += kH4HeaderSize;
+        return true;
+    }
+    if (available < kH4HeaderSize + header_size) {
+      return false;
+    }
+
+    const uint8_t* header = h4_packet + kH4HeaderSize;
+    size_t payload_size;
+    switch (h4_type) {
+      case kH4Event:
+        payload_size = header[1];
+        break;
+      case kH4Acl:
+        payload_size = (header[3] << 8) + header[2];
+        break;
+      case kH4Sco:
+        payload_size = header[2];
+        break;
+      default:
+        payload_size = ((header[3] & 0x3f) << 8) + header[2];
+        break;
+    }
+    if (available < kH4HeaderSize + header_size + payload_size) {
+      return false;
+    }
+
+    HciPacket packet(header, header + header_size + payload_size);
+    *rx_begin += kH4HeaderSize + header_size + payload_size;
+    std::lock_guard<std::mutex> incoming_packet_callback_lock(incoming_packet_callback_mutex_);
+    switch (h4_type) {
+      case kH4Event:
+        btsnoop_logger_->Capture(packet, SnoopLogger::Direction::INCOMING, SnoopLogger::PacketType::EVT);
         if (incoming_packet_callback_ == nullptr) {
           LOG_INFO("Dropping an event after processing");
-          return;
+          break;
         }
-        incoming_packet_callback_->hciEventReceived(receivedHciPacket);
-      }
-    }
-
-    if (buf[0] == kH4Acl) {
-      RUN_NO_INTR(received_size = recv(sock_fd_, buf + kH4HeaderSize, kHciAclHeaderSize, 0));
-      ASSERT_LOG(received_size != -1, "Can't receive from socket: %s", strerror(errno));
-      ASSERT_LOG(received_size == kHciAclHeaderSize, "malformed ACL header received");
-
-      uint16_t hci_acl_data_total_length = (buf[4] << 8) + buf[3];
-      int payload_size;
-      RUN_NO_INTR(payload_size = recv(sock_fd_, buf + kH4HeaderSize + kHciAclHeaderSize, hci_acl_data_total_length, 0));
-      ASSERT_LOG(payload_size != -1, "Can't receive from socket: %s", strerror(errno));
-      ASSERT_LOG(
-          payload_size == hci_acl_data_total_length,
-          "malformed ACL length received: %d != %d",
-          payload_size,
-          hci_acl_data_total_length);
-      ASSERT_LOG(hci_acl_data_total_length <= kBufSize - kH4HeaderSize - kHciAclHeaderSize, "packet too long");
-
-      HciPacket receivedHciPacket;
-      receivedHciPacket.assign(buf + kH4HeaderSize, buf + kH4HeaderSize + kHciAclHeaderSize + payload_size);
-      btsnoop_logger_->Capture(receivedHciPacket, SnoopLogger::Direction::INCOMING, SnoopLogger::PacketType::ACL);
-      {
-        std::lock_guard<std::mutex> incoming_packet_callback_lock(incoming_packet_callback_mutex_);
+        incoming_packet_callback_->hciEventReceived(std::move(packet));
+        break;
+      case kH4Acl:
+        btsnoop_logger_->Capture(packet, SnoopLogger::Direction::INCOMING, SnoopLogger::PacketType::ACL);
         if (incoming_packet_callback_ == nullptr) {
           LOG_INFO("Dropping an ACL packet after processing");
-          return;
+          break;
         }
-        incoming_packet_callback_->aclDataReceived(receivedHciPacket);
-      }
-    }
-
-    if (buf[0] == kH4Sco) {
-      RUN_NO_INTR(received_size = recv(sock_fd_, buf + kH4HeaderSize, kHciScoHeaderSize, 0));
-      ASSERT_LOG(received_size != -1, "Can't receive from socket: %s", strerror(errno));
-      ASSERT_LOG(received_size == kHciScoHeaderSize, "malformed SCO header received");
-
-      uint8_t hci_sco_data_total_length = buf[3];
-      int payload_size;
-      RUN_NO_INTR(payload_size = recv(sock_fd_, buf + kH4HeaderSize + kHciScoHeaderSize, hci_sco_data_total_length, 0));
-      ASSERT_LOG(payload_size != -1, "Can't receive from socket: %s", strerror(errno));
-      ASSERT_LOG(payload_size == hci_sco_data_total_length, "malformed SCO packet received: size mismatch");
-
-      HciPacket receivedHciPacket;
-      receivedHciPacket.assign(buf + kH4HeaderSize, buf + kH4HeaderSize + kHciScoHeaderSize + payload_size);
-      btsnoop_logger_->Capture(receivedHciPacket, SnoopLogger::Direction::INCOMING, SnoopLogger::PacketType::SCO);
-      {
-        std::lock_guard<std::mutex> incoming_packet_callback_lock(incoming_packet_callback_mutex_);
+        incoming_packet_callback_->aclDataReceived(std::move(packet));
+        break;
+      case kH4Sco:
+        btsnoop_logger_->Capture(packet, SnoopLogger::Direction::INCOMING, SnoopLogger::PacketType::SCO);
         if (incoming_packet_callback_ == nullptr) {
           LOG_INFO("Dropping a SCO packet after processing");
-          return;
+          break;
         }
-        incoming_packet_callback_->scoDataReceived(receivedHciPacket);
-      }
-    }
-
-    if (buf[0] == kH4Iso) {
-      RUN_NO_INTR(received_size = recv(sock_fd_, buf + kH4HeaderSize, kHciIsoHeaderSize, 0));
-      ASSERT_LOG(received_size != -1, "Can't receive from socket: %s", strerror(errno));
-      ASSERT_LOG(received_size == kHciIsoHeaderSize, "malformed ISO header received");
-
-      uint16_t hci_iso_data_total_length = ((buf[4] & 0x3f) << 8) + buf[3];
-      int payload_size;
-      RUN_NO_INTR(payload_size = recv(sock_fd_, buf + kH4HeaderSize + kHciIsoHeaderSize, hci_iso_data_total_length, 0));
-      ASSERT_LOG(payload_size != -1, "Can't receive from socket: %s", strerror(errno));
-      ASSERT_LOG(payload_size == hci_iso_data_total_length, "malformed ISO packet received: size mismatch");
-
-      HciPacket receivedHciPacket;
-      receivedHciPacket.assign(buf + kH4HeaderSize, buf + kH4HeaderSize + kHciIsoHeaderSize + payload_size);
-      btsnoop_logger_->Capture(receivedHciPacket, SnoopLogger::Direction::INCOMING, SnoopLogger::PacketType::ISO);
-      {
-        std::lock_guard<std::mutex> incoming_packet_callback_lock(incoming_packet_callback_mutex_);
+        incoming_packet_callback_->scoDataReceived(std::move(packet));
+        break;
+      case kH4Iso:
+        btsnoop_logger_->Capture(packet, SnoopLogger::Direction::INCOMING, SnoopLogger::PacketType::ISO);
         if (incoming_packet_callback_ == nullptr) {
           LOG_INFO("Dropping a ISO packet after processing");
-          return;
+          break;
         }
-        incoming_packet_callback_->isoDataReceived(receivedHciPacket);
-      }
+        incoming_packet_callback_->isoDataReceived(std::move(packet));
+        break;
     }
-    memset(buf, 0, kBufSize);
+    return true;
   }
 };
 
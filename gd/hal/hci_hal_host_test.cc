@@ -25,6 +25,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <chrono>
 #include <cstring>
 #include <queue>
 #include <thread>
@@ -347,6 +348,43 @@ TEST_F(HciHalRootcanalTest, receive_multiple_acl_sequential) {
   }
 }
 
+TEST_F(HciHalRootcanalTest, receive_large_acl) {
+  // Larger than the controller buffers of most chips, and than the initial receive buffer
+  uint16_t payload_size = 20000;
+  H4Packet incoming_packet(1 + 2 + 2 + payload_size, 0x01);
+  incoming_packet[0] = kH4Acl;
+  incoming_packet[3] = payload_size & 0xff;
+  incoming_packet[4] = payload_size >> 8;
+  SetFakeServerSocketToBlocking();
+  write(fake_server_socket_, incoming_packet.data(), incoming_packet.size());
+  while (incoming_packets_queue_.size() != 1) {
+  }
+  auto packet = incoming_packets_queue_.front();
+  incoming_packets_queue_.pop();
+  check_packet_equal(packet, incoming_packet);
+}
+
+TEST_F(HciHalRootcanalTest, receive_packets_split_across_writes) {
+  H4Packet incoming_packet = make_sample_h4_evt_pkt(3);
+  H4Packet incoming_packet2 = make_sample_h4_acl_pkt(5);
+  H4Packet stream = incoming_packet;
+  stream.insert(stream.end(), incoming_packet2.begin(), incoming_packet2.end());
+  // Cut in the middle of the ACL header, and then in the middle of the ACL payload
+  size_t cuts[] = {0, incoming_packet.size() + 2, incoming_packet.size() + 7, stream.size()};
+  for (size_t i = 0; i + 1 < sizeof(cuts) / sizeof(cuts[0]); i++) {
+    write(fake_server_socket_, stream.data() + cuts[i], cuts[i + 1] - cuts[i]);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  while (incoming_packets_queue_.size() != 2) {
+  }
+  auto packet = incoming_packets_queue_.front();
+  incoming_packets_queue_.pop();
+  check_packet_equal(packet, incoming_packet);
+  packet = incoming_packets_queue_.front();
+  incoming_packets_queue_.pop();
+  check_packet_equal(packet, incoming_packet2);
+}
+
 TEST_F(HciHalRootcanalTest, send_hci_cmd) {
   uint8_t hci_cmd_param_size = 2;
   HciPacket hci_data = make_sample_hci_cmd_pkt(hci_cmd_param_size);
@@ -371,6 +409,19 @@ TEST_F(HciHalRootcanalTest, send_acl) {
   check_packet_equal({kH4Acl, acl_packet}, read_buf);
 }
 
+TEST_F(HciHalRootcanalTest, send_acl_packet_builder) {
+  uint8_t acl_payload_size = 200;
+  HciPacket acl_packet = make_sample_hci_acl_pkt(acl_payload_size);
+  SetFakeServerSocketToBlocking();
+  for (int i = 0; i < 3; i++) {
+    hal_->sendAclPacket(std::make_unique<packet::RawBuilder>(acl_packet));
+    H4Packet read_buf(1 + 2 + 2 + acl_payload_size);
+    auto size_read = read_with_retry(fake_server_socket_, read_buf.data(), read_buf.size());
+    ASSERT_EQ(size_read, 1 + acl_packet.size());
+    check_packet_equal({kH4Acl, acl_packet}, read_buf);
+  }
+}
+
 TEST_F(HciHalRootcanalTest, send_sco) {
   uint8_t sco_payload_size = 200;
   HciPacket sco_packet = make_sample_hci_sco_pkt(sco_payload_size);
@@ -17,12 +17,15 @@
 #include "hal/snoop_logger.h"
 
 #include <arpa/inet.h>
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 #include <algorithm>
 #include <bitset>
 #include <chrono>
-#include <sstream>
+#include <cstring>
 
 #include "common/circular_buffer.h"
 #include "common/init_flags.h"
@@ -31,6 +34,7 @@
 #include "os/log.h"
 #include "os/parameter_provider.h"
 #include "os/system_properties.h"
+#include "os/utils.h"
 
 namespace bluetooth {
 namespace hal {
@@ -73,9 +77,18 @@ constexpr size_t kDefaultBtsnoozMaxMemoryUsageBytes = 256 * 1024;
 constexpr size_t kDefaultBtSnoozMaxBytesPerPacket = 150;
 constexpr size_t kDefaultBtSnoozMaxPayloadBytesPerPacket =
     kDefaultBtSnoozMaxBytesPerPacket - sizeof(SnoopLogger::PacketHeaderType);
-// Calculate max number of packets based on max memory usage and max packet size
-constexpr size_t kDefaultBtSnoozMaxPacketsPerBuffer =
-    kDefaultBtsnoozMaxMemoryUsageBytes / kDefaultBtSnoozMaxBytesPerPacket;
+
+// Packets are written to btsnoop by the capturing thread by default
+constexpr bool kDefaultBtSnoopAsyncWrite = false;
+
+// Number of captured packets that can wait for the btsnoop writer thread. When it is full, the capturing thread
+// writes the pending packets out itself.
+constexpr size_t kBtSnoopPendingPackets = 4096;
+// Number of packets written with a single writev()
+constexpr size_t kBtSnoopPacketsPerWrite = 128;
+
+// The btsnoop ring file is disabled by default
+constexpr size_t kDefaultBtSnoopRingFileSizeMb = 0;
 
 std::string get_btsnoop_log_path(std::string log_dir, bool filtered) {
   if (filtered) {
@@ -88,6 +101,10 @@ std::string get_last_log_path(std::string log_file_path) {
   return log_file_path.append(".last");
 }
 
+std::string get_ring_log_path(std::string log_file_path) {
+  return log_file_path.append(".ring");
+}
+
 void delete_btsnoop_files(const std::string& log_path) {
   LOG_INFO("Deleting logs if they exist");
   if (os::FileExists(log_path)) {
@@ -105,9 +122,15 @@ void delete_btsnoop_files(const std::string& log_path) {
   } else {
     LOG_INFO("Last log file does not exist at \"%s\"", log_path.c_str());
   }
+  auto ring_log_path = get_ring_log_path(log_path);
+  if (os::FileExists(ring_log_path)) {
+    if (!os::RemoveFile(ring_log_path)) {
+      LOG_ERROR("Failed to remove ring log file at \"%s\"", ring_log_path.c_str());
+    }
+  }
 }
 
-size_t get_btsnooz_packet_length_to_write(const HciPacket& packet, SnoopLogger::PacketType type) {
+size_t get_btsnooz_packet_length_to_write(const uint8_t* packet, size_t length, SnoopLogger::PacketType type) {
   static const size_t kAclHeaderSize = 4;
   static const size_t kL2capHeaderSize = 4;
   static const size_t kL2capCidOffset = (kAclHeaderSize + 2);
@@ -123,14 +146,14 @@ size_t get_btsnooz_packet_length_to_write(const HciPacket& packet, SnoopLogger::
   switch (type) {
     case SnoopLogger::PacketType::CMD:
     case SnoopLogger::PacketType::EVT:
-      included_length = packet.size();
+      included_length = length;
       break;
 
     case SnoopLogger::PacketType::ACL: {
       // Log ACL and L2CAP header by default
       size_t len_hci_acl = kAclHeaderSize + kL2capHeaderSize;
       // Check if we have enough data for an L2CAP header
-      if (packet.size() > len_hci_acl) {
+      if (length > len_hci_acl) {
         uint16_t l2cap_cid =
             static_cast<uint16_t>(packet[kL2capCidOffset]) |
             static_cast<uint16_t>((static_cast<uint16_t>(packet[kL2capCidOffset + 1]) << static_cast<uint16_t>(8)));
@@ -138,13 +161,13 @@ size_t get_btsnooz_packet_length_to_write(const HciPacket& packet, SnoopLogger::
           // For the signaling CID, take the full packet.
           // That way, the PSM setup is captured, allowing decoding of PSMs down
           // the road.
-          return packet.size();
+          return length;
         } else {
           // Otherwise, return as much as we reasonably can
           len_hci_acl = kMaxBtsnoozAclSize;
         }
       }
-      included_length = std::min(len_hci_acl, packet.size());
+      included_length = std::min(len_hci_acl, length);
       break;
     }
 
@@ -157,6 +180,27 @@ size_t get_btsnooz_packet_length_to_write(const HciPacket& packet, SnoopLogger::
   return std::min(included_length, kDefaultBtSnoozMaxPayloadBytesPerPacket);
 }
 
+// Write all of |iov| to |fd|, resuming after short writes
+bool write_all(int fd, struct iovec* iov, int iovcnt) {
+  while (iovcnt > 0) {
+    ssize_t written;
+    RUN_NO_INTR(written = writev(fd, iov, iovcnt));
+    if (written < 0) {
+      return false;
+    }
+    while (iovcnt > 0 && static_cast<size_t>(written) >= iov->iov_len) {
+      written -= iov->iov_len;
+      iov++;
+      iovcnt--;
+    }
+    if (iovcnt > 0) {
+      iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + written;
+      iov->iov_len -= written;
+    }
+  }
+  return true;
+}
+
 }  // namespace
 
 const std::string SnoopLogger::kBtSnoopLogModeDisabled = "disabled";
@@ -164,6 +208,8 @@ const std::string SnoopLogger::kBtSnoopLogModeFiltered = "filtered";
 const std::string SnoopLogger::kBtSnoopLogModeFull = "full";
 
 const std::string SnoopLogger::kBtSnoopMaxPacketsPerFileProperty = "persist.bluetooth.btsnoopsize";
+const std::string SnoopLogger::kBtSnoopRingFileSizeMbProperty = "persist.bluetooth.btsnoopringsizemb";
+const std::string SnoopLogger::kBtSnoopAsyncWriteProperty = "persist.bluetooth.btsnoopasyncwrite";
 const std::string SnoopLogger::kIsDebuggableProperty = "ro.debuggable";
 const std::string SnoopLogger::kBtSnoopLogModeProperty = "persist.bluetooth.btsnooplogmode";
 const std::string SnoopLogger::kBtSnoopDefaultLogModeProperty = "persist.bluetooth.btsnoopdefaultmode";
@@ -172,11 +218,16 @@ SnoopLogger::SnoopLogger(
     std::string snoop_log_path,
     std::string snooz_log_path,
     size_t max_packets_per_file,
-    const std::string& btsnoop_mode)
+    const std::string& btsnoop_mode,
+    size_t ring_file_size,
+    bool async_write)
     : snoop_log_path_(std::move(snoop_log_path)),
       snooz_log_path_(std::move(snooz_log_path)),
+      ring_file_size_(ring_file_size),
       max_packets_per_file_(max_packets_per_file),
-      btsnooz_buffer_(kDefaultBtSnoozMaxPacketsPerBuffer) {
+      btsnooz_buffer_(kDefaultBtsnoozMaxMemoryUsageBytes),
+      async_write_(async_write),
+      pending_packets_(async_write ? kBtSnoopPendingPackets : 1) {
   if (false && btsnoop_mode == kBtSnoopLogModeFiltered) {
     // TODO(b/163733538): implement filtered snoop log in GD, currently filtered == disabled
     LOG_INFO("Filtered Snoop Logs enabled");
@@ -204,13 +255,14 @@ SnoopLogger::SnoopLogger(
   }
   // Add ".filtered" extension if necessary
   snoop_log_path_ = get_btsnoop_log_path(snoop_log_path_, is_filtered_);
+  snoop_ring_path_ = get_ring_log_path(snoop_log_path_);
 }
 
 void SnoopLogger::CloseCurrentSnoopLogFile() {
   std::lock_guard<std::recursive_mutex> lock(file_mutex_);
-  if (btsnoop_ostream_.is_open()) {
-    btsnoop_ostream_.flush();
-    btsnoop_ostream_.close();
+  if (btsnoop_fd_ != -1) {
+    ::close(btsnoop_fd_);
+    btsnoop_fd_ = -1;
   }
   packet_counter_ = 0;
 }
@@ -233,21 +285,120 @@ void SnoopLogger::OpenNextSnoopLogFile() {
   }
 
   mode_t prevmask = umask(0);
-  // do not use std::ios::app as we want override the existing file
-  btsnoop_ostream_.open(snoop_log_path_, std::ios::binary | std::ios::out);
-  if (!btsnoop_ostream_.good()) {
+  // do not use O_APPEND as we want override the existing file
+  RUN_NO_INTR(btsnoop_fd_ = open(snoop_log_path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666));
+  if (btsnoop_fd_ == -1) {
     LOG_ALWAYS_FATAL("Unable to open snoop log at \"%s\", error: \"%s\"", snoop_log_path_.c_str(), strerror(errno));
   }
   umask(prevmask);
-  if (!btsnoop_ostream_.write(reinterpret_cast<const char*>(&kBtSnoopFileHeader), sizeof(FileHeaderType))) {
+  struct iovec iov = {.iov_base = const_cast<FileHeaderType*>(&kBtSnoopFileHeader), .iov_len = sizeof(FileHeaderType)};
+  if (!write_all(btsnoop_fd_, &iov, 1)) {
     LOG_ALWAYS_FATAL("Unable to write file header to \"%s\", error: \"%s\"", snoop_log_path_.c_str(), strerror(errno));
   }
-  if (!btsnoop_ostream_.flush()) {
-    LOG_ERROR("Failed to flush, error: \"%s\"", strerror(errno));
+}
+
+void SnoopLogger::OpenSnoopRingFile() {
+  std::lock_guard<std::recursive_mutex> lock(file_mutex_);
+  auto last_file_path = get_last_log_path(snoop_log_path_);
+  if (os::FileExists(snoop_log_path_)) {
+    if (!os::RenameFile(snoop_log_path_, last_file_path)) {
+      LOG_ERROR(
+          "Unabled to rename existing snoop log from \"%s\" to \"%s\"",
+          snoop_log_path_.c_str(),
+          last_file_path.c_str());
+    }
+  }
+  // A ring file left behind means the previous session did not stop cleanly, and is newer than the existing log
+  if (os::FileExists(snoop_ring_path_)) {
+    LOG_INFO("Recovering snoop ring file \"%s\" to \"%s\"", snoop_ring_path_.c_str(), last_file_path.c_str());
+    ExtractRingFile(snoop_ring_path_, last_file_path);
+  }
+
+  mode_t prevmask = umask(0);
+  ring_file_ = SnoopRingFile::Create(snoop_ring_path_, ring_file_size_);
+  umask(prevmask);
+  if (ring_file_ == nullptr) {
+    LOG_ALWAYS_FATAL("Unable to create snoop ring file at \"%s\"", snoop_ring_path_.c_str());
+  }
+}
+
+void SnoopLogger::WriteRecord(const std::vector<uint8_t>& record) {
+  if (ring_file_ != nullptr) {
+    if (!ring_file_->Append(record.data(), record.size())) {
+      LOG_ERROR("Packet of %zu bytes does not fit in the snoop ring file", record.size());
+    }
+    return;
+  }
+  packet_counter_++;
+  if (packet_counter_ > max_packets_per_file_) {
+    OpenNextSnoopLogFile();
+  }
+  struct iovec iov = {.iov_base = const_cast<uint8_t*>(record.data()), .iov_len = record.size()};
+  if (btsnoop_fd_ != -1 && !write_all(btsnoop_fd_, &iov, 1)) {
+    LOG_ERROR("Failed to write packet for btsnoop, error: \"%s\"", strerror(errno));
+  }
+}
+
+void SnoopLogger::WritePendingPackets() {
+  std::vector<uint8_t> batch[kBtSnoopPacketsPerWrite];
+  struct iovec iov[kBtSnoopPacketsPerWrite];
+  size_t batch_size = 0;
+  auto write_batch = [&]() {
+    if (batch_size == 0) {
+      return;
+    }
+    if (btsnoop_fd_ != -1 && !write_all(btsnoop_fd_, iov, batch_size)) {
+      LOG_ERROR("Failed to write packets for btsnoop, error: \"%s\"", strerror(errno));
+    }
+    for (size_t i = 0; i < batch_size; i++) {
+      batch[i].clear();
+    }
+    batch_size = 0;
+  };
+  while (pending_packets_.TryPop(&batch[batch_size])) {
+    if (ring_file_ != nullptr) {
+      if (!ring_file_->Append(batch[batch_size].data(), batch[batch_size].size())) {
+        LOG_ERROR("Packet of %zu bytes does not fit in the snoop ring file", batch[batch_size].size());
+      }
+      continue;
+    }
+    packet_counter_++;
+    if (packet_counter_ > max_packets_per_file_) {
+      // Packets before this one belong to the file being rotated out
+      std::vector<uint8_t> packet = std::move(batch[batch_size]);
+      write_batch();
+      OpenNextSnoopLogFile();
+      batch[batch_size] = std::move(packet);
+    }
+    iov[batch_size] = {.iov_base = batch[batch_size].data(), .iov_len = batch[batch_size].size()};
+    batch_size++;
+    if (batch_size == kBtSnoopPacketsPerWrite) {
+      write_batch();
+    }
+  }
+  write_batch();
+}
+
+void SnoopLogger::WriterLoop() {
+  bool stopping = false;
+  while (!stopping) {
+    {
+      std::unique_lock<std::mutex> lock(writer_mutex_);
+      writer_cv_.wait(lock, [this] { return writer_wakeup_pending_.load() || writer_stopping_; });
+      stopping = writer_stopping_;
+    }
+    // Clear the flag before draining, so a packet queued after the drain wakes us up again
+    writer_wakeup_pending_.store(false);
+    std::lock_guard<std::recursive_mutex> lock(file_mutex_);
+    WritePendingPackets();
   }
 }
 
 void SnoopLogger::Capture(const HciPacket& packet, Direction direction, PacketType type) {
+  Capture(packet.data(), packet.size(), direction, type);
+}
+
+void SnoopLogger::Capture(const uint8_t* packet, size_t length, Direction direction, PacketType type) {
   uint64_t timestamp_us =
       std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch())
           .count();
@@ -271,50 +422,44 @@ void SnoopLogger::Capture(const HciPacket& packet, Direction direction, PacketTy
       flags.set(1, true);
       break;
   }
-  uint32_t length = packet.size() + /* type byte */ 1;
-  PacketHeaderType header = {.length_original = htonl(length),
-                             .length_captured = htonl(length),
+  uint32_t length_with_type = length + /* type byte */ 1;
+  PacketHeaderType header = {.length_original = htonl(length_with_type),
+                             .length_captured = htonl(length_with_type),
                              .flags = htonl(static_cast<uint32_t>(flags.to_ulong())),
                              .dropped_packets = 0,
                              .timestamp = htonll(timestamp_us + kBtSnoopEpochDelta),
                              .type = static_cast<uint8_t>(type)};
-  {
+  if (!is_enabled_) {
+    // btsnoop disabled, log in-memory btsnooz log only
+    size_t included_length = get_btsnooz_packet_length_to_write(packet, length, type);
+    header.length_captured = htonl(included_length + /* type byte */ 1);
+    uint8_t record[kDefaultBtSnoozMaxBytesPerPacket];
+    std::memcpy(record, &header, sizeof(PacketHeaderType));
+    std::memcpy(record + sizeof(PacketHeaderType), packet, included_length);
+    btsnooz_buffer_.Push(record, sizeof(PacketHeaderType) + included_length);
+    return;
+  }
+  std::vector<uint8_t> record(sizeof(PacketHeaderType) + length);
+  std::memcpy(record.data(), &header, sizeof(PacketHeaderType));
+  std::memcpy(record.data() + sizeof(PacketHeaderType), packet, length);
+  if (!async_write_) {
+    // The fd is unbuffered, so the packet is in the kernel once this returns
     std::lock_guard<std::recursive_mutex> lock(file_mutex_);
-    if (!is_enabled_) {
-      // btsnoop disabled, log in-memory btsnooz log only
-      std::stringstream ss;
-      size_t included_length = get_btsnooz_packet_length_to_write(packet, type);
-      header.length_captured = htonl(included_length + /* type byte */ 1);
-      if (!ss.write(reinterpret_cast<const char*>(&header), sizeof(PacketHeaderType))) {
-        LOG_ERROR("Failed to write packet header for btsnooz, error: \"%s\"", strerror(errno));
-      }
-      if (!ss.write(reinterpret_cast<const char*>(packet.data()), included_length)) {
-        LOG_ERROR("Failed to write packet payload for btsnooz, error: \"%s\"", strerror(errno));
-      }
-      btsnooz_buffer_.Push(ss.str());
-      return;
-    }
-    packet_counter_++;
-    if (packet_counter_ > max_packets_per_file_) {
-      OpenNextSnoopLogFile();
-    }
-    if (!btsnoop_ostream_.write(reinterpret_cast<const char*>(&header), sizeof(PacketHeaderType))) {
-      LOG_ERROR("Failed to write packet header for btsnoop, error: \"%s\"", strerror(errno));
-    }
-    if (!btsnoop_ostream_.write(reinterpret_cast<const char*>(packet.data()), packet.size())) {
-      LOG_ERROR("Failed to write packet payload for btsnoop, error: \"%s\"", strerror(errno));
-    }
-    // std::ofstream::flush() pushes user data into kernel memory. The data will be written even if this process
-    // crashes. However, data will be lost if there is a kernel panic, which is out of scope of BT snoop log.
-    // NOTE: std::ofstream::write() followed by std::ofstream::flush() has similar effect as UNIX write(fd, data, len)
-    //       as write() syscall dumps data into kernel memory directly
-    if (!btsnoop_ostream_.flush()) {
-      LOG_ERROR("Failed to flush, error: \"%s\"", strerror(errno));
-    }
+    WriteRecord(record);
+    return;
+  }
+  while (!pending_packets_.TryPush(record)) {
+    // The writer thread is behind. Write the queued packets from here to keep the order and lose nothing.
+    std::lock_guard<std::recursive_mutex> lock(file_mutex_);
+    WritePendingPackets();
+  }
+  if (!writer_wakeup_pending_.exchange(true)) {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    writer_cv_.notify_one();
   }
 }
 
-void SnoopLogger::DumpSnoozLogToFile(const std::vector<std::string>& data) const {
+void SnoopLogger::DumpSnoozLogToFile(const std::vector<uint8_t>& data) const {
   std::lock_guard<std::recursive_mutex> lock(file_mutex_);
   if (is_enabled_) {
     LOG_DEBUG("btsnoop log is enabled, skip dumping btsnooz log");
@@ -344,10 +489,8 @@ void SnoopLogger::DumpSnoozLogToFile(const std::vector<std::string>& data) const
   if (!btsnooz_ostream.write(reinterpret_cast<const char*>(&kBtSnoopFileHeader), sizeof(FileHeaderType))) {
     LOG_ALWAYS_FATAL("Unable to write file header to \"%s\", error: \"%s\"", snooz_log_path_.c_str(), strerror(errno));
   }
-  for (const auto& packet : data) {
-    if (!btsnooz_ostream.write(packet.data(), packet.size())) {
-      LOG_ERROR("Failed to write packet payload for btsnooz, error: \"%s\"", strerror(errno));
-    }
+  if (!btsnooz_ostream.write(reinterpret_cast<const char*>(data.data()), data.size())) {
+    LOG_ERROR("Failed to write packet payload for btsnooz, error: \"%s\"", strerror(errno));
   }
   if (!btsnooz_ostream.flush()) {
     LOG_ERROR("Failed to flush, error: \"%s\"", strerror(errno));
@@ -361,16 +504,39 @@ void SnoopLogger::ListDependencies(ModuleList* list) {
 void SnoopLogger::Start() {
   std::lock_guard<std::recursive_mutex> lock(file_mutex_);
   if (is_enabled_) {
-    OpenNextSnoopLogFile();
+    if (ring_file_size_ > 0) {
+      OpenSnoopRingFile();
+    } else {
+      OpenNextSnoopLogFile();
+    }
+    if (async_write_) {
+      writer_stopping_ = false;
+      writer_thread_ = std::thread(&SnoopLogger::WriterLoop, this);
+    }
   }
 }
 
 void SnoopLogger::Stop() {
+  if (writer_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(writer_mutex_);
+      writer_stopping_ = true;
+      writer_cv_.notify_one();
+    }
+    // The writer drains everything captured so far before it exits
+    writer_thread_.join();
+  }
   std::lock_guard<std::recursive_mutex> lock(file_mutex_);
   LOG_DEBUG("Dumping btsnooz log data to %s", snooz_log_path_.c_str());
   DumpSnoozLogToFile(btsnooz_buffer_.Drain());
   LOG_DEBUG("Closing btsnoop log data at %s", snoop_log_path_.c_str());
   CloseCurrentSnoopLogFile();
+  if (ring_file_ != nullptr) {
+    ring_file_.reset();
+    if (ExtractRingFile(snoop_ring_path_, snoop_log_path_)) {
+      os::RemoveFile(snoop_ring_path_);
+    }
+  }
 }
 
 DumpsysDataFinisher SnoopLogger::GetDumpsysData(flatbuffers::FlatBufferBuilder* builder) const {
@@ -394,6 +560,48 @@ size_t SnoopLogger::GetMaxPacketsPerFile() {
   return max_packets_per_file;
 }
 
+size_t SnoopLogger::GetRingFileSize() {
+  auto ring_file_size_mb = kDefaultBtSnoopRingFileSizeMb;
+  auto ring_file_size_mb_prop = os::GetSystemProperty(kBtSnoopRingFileSizeMbProperty);
+  if (ring_file_size_mb_prop) {
+    auto ring_file_size_mb_number = common::Uint64FromString(ring_file_size_mb_prop.value());
+    if (ring_file_size_mb_number) {
+      ring_file_size_mb = ring_file_size_mb_number.value();
+    }
+  }
+  return ring_file_size_mb * 1024 * 1024;
+}
+
+bool SnoopLogger::GetAsyncWrite() {
+  auto async_write = kDefaultBtSnoopAsyncWrite;
+  auto async_write_prop = os::GetSystemProperty(kBtSnoopAsyncWriteProperty);
+  if (async_write_prop) {
+    async_write = common::StringTrim(async_write_prop.value()) == "true";
+  }
+  return async_write;
+}
+
+bool SnoopLogger::ExtractRingFile(const std::string& ring_path, const std::string& btsnoop_path) {
+  std::vector<uint8_t> records;
+  if (!SnoopRingFile::ReadRecords(ring_path, &records)) {
+    return false;
+  }
+  mode_t prevmask = umask(0);
+  std::ofstream btsnoop_ostream(btsnoop_path, std::ios::binary | std::ios::out);
+  umask(prevmask);
+  if (!btsnoop_ostream.good()) {
+    LOG_ERROR("Unable to open snoop log at \"%s\", error: \"%s\"", btsnoop_path.c_str(), strerror(errno));
+    return false;
+  }
+  if (!btsnoop_ostream.write(reinterpret_cast<const char*>(&kBtSnoopFileHeader), sizeof(FileHeaderType)) ||
+      !btsnoop_ostream.write(reinterpret_cast<const char*>(records.data()), records.size()) ||
+      !btsnoop_ostream.flush()) {
+    LOG_ERROR("Failed to write snoop log at \"%s\", error: \"%s\"", btsnoop_path.c_str(), strerror(errno));
+    return false;
+  }
+  return true;
+}
+
 std::string SnoopLogger::GetBtSnoopMode() {
   // Default mode is DISABLED on user build.
   // In userdebug/eng build, it can also be overwritten by modifying the global setting
@@ -424,7 +632,9 @@ const ModuleFactory SnoopLogger::Factory = ModuleFactory([]() {
       os::ParameterProvider::SnoopLogFilePath(),
       os::ParameterProvider::SnoozLogFilePath(),
       GetMaxPacketsPerFile(),
-      GetBtSnoopMode());
+      GetBtSnoopMode(),
+      GetRingFileSize(),
+      GetAsyncWrite());
 });
 
 }  // namespace hal
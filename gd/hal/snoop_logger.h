@@ -16,13 +16,19 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <fstream>
 #include <iostream>
 #include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "common/circular_buffer.h"
+#include "common/mpsc_ring.h"
 #include "hal/hci_hal.h"
+#include "hal/snoop_ring_file.h"
 #include "module.h"
 
 namespace bluetooth {
@@ -37,6 +43,8 @@ class SnoopLogger : public ::bluetooth::Module {
   static const std::string kBtSnoopLogModeFull;
 
   static const std::string kBtSnoopMaxPacketsPerFileProperty;
+  static const std::string kBtSnoopRingFileSizeMbProperty;
+  static const std::string kBtSnoopAsyncWriteProperty;
   static const std::string kIsDebuggableProperty;
   static const std::string kBtSnoopLogModeProperty;
   static const std::string kBtSnoopDefaultLogModeProperty;
@@ -62,6 +70,18 @@ class SnoopLogger : public ::bluetooth::Module {
   // Changes to this value is only effective after restarting Bluetooth
   static size_t GetMaxPacketsPerFile();
 
+  // Returns the size of the btsnoop ring file, or 0 to log to rotated btsnoop files instead
+  // Changes to this value is only effective after restarting Bluetooth
+  static size_t GetRingFileSize();
+
+  // Returns true if packets are written to the btsnoop log by a writer thread instead of the capturing thread
+  // Changes to this value is only effective after restarting Bluetooth
+  static bool GetAsyncWrite();
+
+  // Write the packets of the btsnoop ring file at |ring_path| to a standard btsnoop file at |btsnoop_path|, oldest
+  // first. Return false if |ring_path| can't be read as a ring file.
+  static bool ExtractRingFile(const std::string& ring_path, const std::string& btsnoop_path);
+
   // Get snoop logger mode based on current system setup
   // Changes to this values is only effective after restarting Bluetooth
   static std::string GetBtSnoopMode();
@@ -80,8 +100,15 @@ class SnoopLogger : public ::bluetooth::Module {
     OUTGOING,
   };
 
+  // When btsnoop is enabled, each packet is written to the log before this returns, so the log is complete up to the
+  // last packet if the process crashes. With async write, packets are instead queued without blocking and written by a
+  // writer thread in batches, which takes the write syscall off the HCI threads but loses the packets still queued
+  // (up to a few thousand) on a crash.
   void Capture(const HciPacket& packet, Direction direction, PacketType type);
 
+  // Same as above, for packets that live inside a larger buffer, e.g. after an H4 header
+  void Capture(const uint8_t* packet, size_t length, Direction direction, PacketType type);
+
  protected:
   void ListDependencies(ModuleList* list) override;
   void Start() override;
@@ -96,21 +123,44 @@ class SnoopLogger : public ::bluetooth::Module {
       std::string snoop_log_path,
       std::string snooz_log_path,
       size_t max_packets_per_file,
-      const std::string& btsnoop_mode);
+      const std::string& btsnoop_mode,
+      size_t ring_file_size = 0,
+      bool async_write = false);
   void CloseCurrentSnoopLogFile();
   void OpenNextSnoopLogFile();
-  void DumpSnoozLogToFile(const std::vector<std::string>& data) const;
+  void DumpSnoozLogToFile(const std::vector<uint8_t>& data) const;
 
  private:
   std::string snoop_log_path_;
   std::string snooz_log_path_;
-  std::ofstream btsnoop_ostream_;
+  std::string snoop_ring_path_;
+  int btsnoop_fd_ = -1;
+  // When set, packets go to this ring file instead of btsnoop_fd_, and are extracted to snoop_log_path_ on Stop()
+  size_t ring_file_size_;
+  std::unique_ptr<SnoopRingFile> ring_file_;
   bool is_enabled_ = false;
   bool is_filtered_ = false;
   size_t max_packets_per_file_;
-  common::CircularBuffer<std::string> btsnooz_buffer_;
+  common::CircularByteBuffer btsnooz_buffer_;
   size_t packet_counter_ = 0;
   mutable std::recursive_mutex file_mutex_;
+
+  bool async_write_;
+
+  void OpenSnoopRingFile();
+  // Writes out one btsnoop record. Must be called with file_mutex_ held.
+  void WriteRecord(const std::vector<uint8_t>& record);
+  // Writes out everything in pending_packets_. Must be called with file_mutex_ held.
+  void WritePendingPackets();
+  void WriterLoop();
+
+  // Serialized btsnoop records (header and payload) waiting for the writer thread, with async write only
+  common::MpscRing<std::vector<uint8_t>> pending_packets_;
+  std::thread writer_thread_;
+  std::mutex writer_mutex_;
+  std::condition_variable writer_cv_;
+  std::atomic<bool> writer_wakeup_pending_{false};
+  bool writer_stopping_ = false;
 };
 
 }  // namespace hal
@@ -19,6 +19,8 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <thread>
+
 namespace testing {
 
 namespace {
@@ -59,8 +61,16 @@ class TestSnoopLoggerModule : public SnoopLogger {
       std::string snoop_log_path,
       std::string snooz_log_path,
       size_t max_packets_per_file,
-      const std::string& btsnoop_mode)
-      : SnoopLogger(std::move(snoop_log_path), std::move(snooz_log_path), max_packets_per_file, btsnoop_mode) {}
+      const std::string& btsnoop_mode,
+      size_t ring_file_size = 0,
+      bool async_write = false)
+      : SnoopLogger(
+            std::move(snoop_log_path),
+            std::move(snooz_log_path),
+            max_packets_per_file,
+            btsnoop_mode,
+            ring_file_size,
+            async_write) {}
 
   std::string ToString() const override {
     return std::string("TestSnoopLoggerModule");
@@ -75,6 +85,7 @@ class SnoopLoggerModuleTest : public Test {
     temp_snoop_log_last_ = temp_dir_ / "btsnoop_hci.log.last";
     temp_snooz_log_ = temp_dir_ / "btsnooz_hci.log";
     temp_snooz_log_last_ = temp_dir_ / "btsnooz_hci.log.last";
+    temp_snoop_ring_ = temp_dir_ / "btsnoop_hci.log.ring";
     DeleteSnoopLogFiles();
     ASSERT_FALSE(std::filesystem::exists(temp_snoop_log_));
     ASSERT_FALSE(std::filesystem::exists(temp_snoop_log_last_));
@@ -99,6 +110,9 @@ class SnoopLoggerModuleTest : public Test {
     if (std::filesystem::exists(temp_snooz_log_last_)) {
       ASSERT_TRUE(std::filesystem::remove(temp_snooz_log_last_));
     }
+    if (std::filesystem::exists(temp_snoop_ring_)) {
+      ASSERT_TRUE(std::filesystem::remove(temp_snoop_ring_));
+    }
   }
 
   std::filesystem::path temp_dir_;
@@ -106,6 +120,7 @@ class SnoopLoggerModuleTest : public Test {
   std::filesystem::path temp_snoop_log_last_;
   std::filesystem::path temp_snooz_log_;
   std::filesystem::path temp_snooz_log_last_;
+  std::filesystem::path temp_snoop_ring_;
 };
 
 TEST_F(SnoopLoggerModuleTest, empty_snoop_log_test) {
@@ -299,4 +314,123 @@ TEST_F(SnoopLoggerModuleTest, rotate_file_after_full_test) {
       sizeof(SnoopLogger::FileHeaderType) + (sizeof(SnoopLogger::PacketHeaderType) + kInformationRequest.size()) * 10);
 }
 
+void CaptureFromMultipleThreads(
+    const std::filesystem::path& snoop_log, const std::filesystem::path& snooz_log, bool async_write) {
+  // Enough packets to fill the pending packet ring several times over
+  constexpr int kNumThreads = 4;
+  constexpr int kPacketsPerThread = 5000;
+  auto* snoop_looger = new TestSnoopLoggerModule(
+      snoop_log.string(),
+      snooz_log.string(),
+      kNumThreads * kPacketsPerThread,
+      SnoopLogger::kBtSnoopLogModeFull,
+      0,
+      async_write);
+  TestModuleRegistry test_registry;
+  test_registry.InjectTestModule(&SnoopLogger::Factory, snoop_looger);
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([snoop_looger]() {
+      for (int j = 0; j < kPacketsPerThread; j++) {
+        snoop_looger->Capture(kAvdtpSuspend, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::ACL);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  test_registry.StopAll();
+
+  // Verify every packet was written out by the time the module stopped
+  ASSERT_TRUE(std::filesystem::exists(snoop_log));
+  ASSERT_EQ(
+      std::filesystem::file_size(snoop_log),
+      sizeof(SnoopLogger::FileHeaderType) +
+          (sizeof(SnoopLogger::PacketHeaderType) + kAvdtpSuspend.size()) * kNumThreads * kPacketsPerThread);
+}
+
+TEST_F(SnoopLoggerModuleTest, capture_from_multiple_threads_test) {
+  CaptureFromMultipleThreads(temp_snoop_log_, temp_snooz_log_, false);
+  ASSERT_FALSE(std::filesystem::exists(temp_snoop_log_last_));
+}
+
+TEST_F(SnoopLoggerModuleTest, capture_from_multiple_threads_async_write_test) {
+  CaptureFromMultipleThreads(temp_snoop_log_, temp_snooz_log_, true);
+  ASSERT_FALSE(std::filesystem::exists(temp_snoop_log_last_));
+}
+
+TEST_F(SnoopLoggerModuleTest, packet_written_before_capture_returns_test) {
+  auto* snoop_looger = new TestSnoopLoggerModule(
+      temp_snoop_log_.string(), temp_snooz_log_.string(), 10, SnoopLogger::kBtSnoopLogModeFull);
+  TestModuleRegistry test_registry;
+  test_registry.InjectTestModule(&SnoopLogger::Factory, snoop_looger);
+
+  snoop_looger->Capture(kInformationRequest, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::CMD);
+
+  // Without async write, the packet is in the log even if the process dies right after capturing it
+  ASSERT_EQ(
+      std::filesystem::file_size(temp_snoop_log_),
+      sizeof(SnoopLogger::FileHeaderType) + sizeof(SnoopLogger::PacketHeaderType) + kInformationRequest.size());
+
+  test_registry.StopAll();
+}
+
+TEST_F(SnoopLoggerModuleTest, ring_file_keeps_newest_packets_test) {
+  constexpr size_t kRingFileSize = 4096;
+  constexpr size_t kPacketSize = sizeof(SnoopLogger::PacketHeaderType) + 14;
+  auto* snoop_looger = new TestSnoopLoggerModule(
+      temp_snoop_log_.string(), temp_snooz_log_.string(), 10, SnoopLogger::kBtSnoopLogModeFull, kRingFileSize);
+  TestModuleRegistry test_registry;
+  test_registry.InjectTestModule(&SnoopLogger::Factory, snoop_looger);
+
+  // Far more packets than the ring holds, and than max_packets_per_file
+  for (int i = 0; i < 1000; i++) {
+    snoop_looger->Capture(kInformationRequest, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::CMD);
+  }
+  ASSERT_TRUE(std::filesystem::exists(temp_snoop_ring_));
+
+  test_registry.StopAll();
+
+  // Verify the ring was extracted to a btsnoop file without rotation
+  ASSERT_TRUE(std::filesystem::exists(temp_snoop_log_));
+  ASSERT_FALSE(std::filesystem::exists(temp_snoop_log_last_));
+  ASSERT_FALSE(std::filesystem::exists(temp_snoop_ring_));
+  auto packets_size = std::filesystem::file_size(temp_snoop_log_) - sizeof(SnoopLogger::FileHeaderType);
+  ASSERT_EQ(packets_size % kPacketSize, 0u);
+  ASSERT_GT(packets_size, kRingFileSize / 2);
+  ASSERT_LT(packets_size, kRingFileSize);
+}
+
+TEST_F(SnoopLoggerModuleTest, ring_file_recovered_at_start_test) {
+  // Leave a ring file behind, as a session that crashed would
+  {
+    auto ring_file = bluetooth::hal::SnoopRingFile::Create(temp_snoop_ring_.string(), 4096);
+    SnoopLogger::PacketHeaderType header = {};
+    std::vector<uint8_t> record(reinterpret_cast<uint8_t*>(&header), reinterpret_cast<uint8_t*>(&header + 1));
+    record.insert(record.end(), kInformationRequest.begin(), kInformationRequest.end());
+    for (int i = 0; i < 3; i++) {
+      ASSERT_TRUE(ring_file->Append(record.data(), record.size()));
+    }
+  }
+
+  auto* snoop_looger = new TestSnoopLoggerModule(
+      temp_snoop_log_.string(), temp_snooz_log_.string(), 10, SnoopLogger::kBtSnoopLogModeFull, 4096);
+  TestModuleRegistry test_registry;
+  test_registry.InjectTestModule(&SnoopLogger::Factory, snoop_looger);
+  snoop_looger->Capture(kInformationRequest, SnoopLogger::Direction::OUTGOING, SnoopLogger::PacketType::CMD);
+  test_registry.StopAll();
+
+  // Verify the previous session ended up in the last log, and this one in the current log
+  ASSERT_TRUE(std::filesystem::exists(temp_snoop_log_last_));
+  ASSERT_EQ(
+      std::filesystem::file_size(temp_snoop_log_last_),
+      sizeof(SnoopLogger::FileHeaderType) + (sizeof(SnoopLogger::PacketHeaderType) + kInformationRequest.size()) * 3);
+  ASSERT_TRUE(std::filesystem::exists(temp_snoop_log_));
+  ASSERT_EQ(
+      std::filesystem::file_size(temp_snoop_log_),
+      sizeof(SnoopLogger::FileHeaderType) + sizeof(SnoopLogger::PacketHeaderType) + kInformationRequest.size());
+}
+
 }  // namespace testing
@@ -0,0 +1,212 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hal/snoop_ring_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "os/log.h"
+#include "os/utils.h"
+
+namespace bluetooth {
+namespace hal {
+
+namespace {
+
+constexpr uint8_t kIdentificationPattern[8] = {'b', 't', 's', 'n', 'r', 'i', 'n', 'g'};
+constexpr uint32_t kVersionNumber = 1;
+
+size_t align_record(size_t length) {
+  return (length + SnoopRingFile::kRecordAlignment - 1) & ~(SnoopRingFile::kRecordAlignment - 1);
+}
+
+}  // namespace
+
+std::unique_ptr<SnoopRingFile> SnoopRingFile::Create(const std::string& path, size_t data_size) {
+  data_size = data_size & ~(kRecordAlignment - 1);
+  if (data_size < sizeof(RecordHeaderType) || data_size > UINT32_MAX) {
+    LOG_ERROR("Invalid snoop ring data size %zu", data_size);
+    return nullptr;
+  }
+  size_t file_size = sizeof(FileHeaderType) + data_size;
+
+  int fd;
+  RUN_NO_INTR(fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666));
+  if (fd == -1) {
+    LOG_ERROR("Unable to open snoop ring file at \"%s\", error: \"%s\"", path.c_str(), strerror(errno));
+    return nullptr;
+  }
+  // The file is sparse, so pages are only allocated as the ring reaches them
+  if (ftruncate(fd, file_size) != 0) {
+    LOG_ERROR("Unable to size snoop ring file at \"%s\", error: \"%s\"", path.c_str(), strerror(errno));
+    close(fd);
+    return nullptr;
+  }
+  void* mapping = mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (mapping == MAP_FAILED) {
+    LOG_ERROR("Unable to map snoop ring file at \"%s\", error: \"%s\"", path.c_str(), strerror(errno));
+    close(fd);
+    return nullptr;
+  }
+  return std::unique_ptr<SnoopRingFile>(new SnoopRingFile(fd, static_cast<uint8_t*>(mapping), data_size));
+}
+
+SnoopRingFile::SnoopRingFile(int fd, uint8_t* mapping, size_t data_size)
+    : fd_(fd),
+      mapping_(mapping),
+      header_(reinterpret_cast<FileHeaderType*>(mapping)),
+      data_(mapping + sizeof(FileHeaderType)),
+      data_size_(data_size) {
+  std::memcpy(header_->identification_pattern, kIdentificationPattern, sizeof(kIdentificationPattern));
+  header_->version_number = kVersionNumber;
+  header_->data_size = static_cast<uint32_t>(data_size_);
+  header_->oldest_offset = 0;
+  header_->reserved = 0;
+}
+
+SnoopRingFile::~SnoopRingFile() {
+  munmap(mapping_, sizeof(FileHeaderType) + data_size_);
+  close(fd_);
+}
+
+SnoopRingFile::RecordHeaderType* SnoopRingFile::record_at(size_t offset) const {
+  return reinterpret_cast<RecordHeaderType*>(data_ + offset);
+}
+
+bool SnoopRingFile::Append(const uint8_t* data, size_t length) {
+  size_t total_length = align_record(sizeof(RecordHeaderType) + length);
+  if (total_length > data_size_) {
+    return false;
+  }
+
+  if (write_offset_ + total_length > data_size_) {
+    evict(write_offset_, data_size_);
+    if (data_size_ - write_offset_ >= sizeof(RecordHeaderType)) {
+      RecordHeaderType* wrap = record_at(write_offset_);
+      wrap->length = kWrapMarker;
+      std::atomic_thread_fence(std::memory_order_release);
+      wrap->sequence = next_sequence_;
+    }
+    write_offset_ = 0;
+  }
+  evict(write_offset_, write_offset_ + total_length);
+  if (oldest_sequence_ == next_sequence_) {
+    // The ring was empty, so this record becomes the oldest one
+    oldest_offset_ = write_offset_;
+    header_->oldest_offset = oldest_offset_;
+  }
+
+  RecordHeaderType* record = record_at(write_offset_);
+  record->sequence = 0;
+  std::atomic_thread_fence(std::memory_order_release);
+  record->length = static_cast<uint32_t>(length);
+  std::memcpy(data_ + write_offset_ + sizeof(RecordHeaderType), data, length);
+  std::atomic_thread_fence(std::memory_order_release);
+  record->sequence = next_sequence_++;
+
+  write_offset_ += total_length;
+  return true;
+}
+
+void SnoopRingFile::evict(size_t start, size_t end) {
+  bool evicted = false;
+  while (oldest_sequence_ != next_sequence_ && oldest_offset_ >= start && oldest_offset_ < end) {
+    oldest_offset_ += align_record(sizeof(RecordHeaderType) + record_at(oldest_offset_)->length);
+    oldest_sequence_++;
+    skip_wrap();
+    evicted = true;
+  }
+  if (evicted) {
+    // Published before the records are overwritten, so the header never points into a partially written record
+    std::atomic_thread_fence(std::memory_order_release);
+    header_->oldest_offset = oldest_offset_;
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+}
+
+void SnoopRingFile::skip_wrap() {
+  if (oldest_sequence_ == next_sequence_) {
+    return;
+  }
+  if (data_size_ - oldest_offset_ < sizeof(RecordHeaderType) || record_at(oldest_offset_)->length == kWrapMarker) {
+    oldest_offset_ = 0;
+  }
+}
+
+bool SnoopRingFile::ReadRecords(const std::string& path, std::vector<uint8_t>* records) {
+  std::ifstream file(path, std::ios::binary | std::ios::in);
+  if (!file.good()) {
+    LOG_ERROR("Unable to read snoop ring file at \"%s\", error: \"%s\"", path.c_str(), strerror(errno));
+    return false;
+  }
+  std::vector<uint8_t> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  FileHeaderType header;
+  if (contents.size() < sizeof(FileHeaderType)) {
+    LOG_ERROR("\"%s\" is not a snoop ring file", path.c_str());
+    return false;
+  }
+  std::memcpy(&header, contents.data(), sizeof(FileHeaderType));
+  if (std::memcmp(header.identification_pattern, kIdentificationPattern, sizeof(kIdentificationPattern)) != 0 ||
+      header.version_number != kVersionNumber || header.data_size < sizeof(RecordHeaderType) ||
+      contents.size() < sizeof(FileHeaderType) + header.data_size) {
+    LOG_ERROR("\"%s\" is not a snoop ring file", path.c_str());
+    return false;
+  }
+
+  const uint8_t* data = contents.data() + sizeof(FileHeaderType);
+  const size_t data_size = header.data_size;
+  size_t offset = header.oldest_offset;
+  uint64_t expected_sequence = 0;
+  // A valid ring holds at most one record per header size and wraps once, which bounds the walk on corrupted files
+  for (size_t steps = 0; steps < data_size / sizeof(RecordHeaderType) + 2; steps++) {
+    if (offset > data_size - sizeof(RecordHeaderType)) {
+      offset = 0;
+      continue;
+    }
+    RecordHeaderType record;
+    std::memcpy(&record, data + offset, sizeof(RecordHeaderType));
+    if (expected_sequence == 0) {
+      expected_sequence = record.sequence;
+    }
+    // A record that is stale, or was being written when the process died, ends the ring
+    if (record.sequence == 0 || record.sequence != expected_sequence) {
+      break;
+    }
+    if (record.length == kWrapMarker) {
+      offset = 0;
+      continue;
+    }
+    if (sizeof(RecordHeaderType) + record.length > data_size - offset) {
+      break;
+    }
+    const uint8_t* record_data = data + offset + sizeof(RecordHeaderType);
+    records->insert(records->end(), record_data, record_data + record.length);
+    offset += align_record(sizeof(RecordHeaderType) + record.length);
+    expected_sequence++;
+  }
+  return true;
+}
+
+}  // namespace hal
+}  // namespace bluetooth
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace bluetooth {
+namespace hal {
+
+// A fixed size, memory mapped file holding the newest records written to it.
+//
+// Records are stored back to back, each after a RecordHeader carrying a sequence number, and wrap around to the start
+// of the data area when they reach its end, overwriting the oldest records. The file header points at the oldest
+// record still intact, and a record's sequence number is only set once its data has been written. Since the mapping
+// is shared with the page cache, everything appended survives a crash of the process without any syscall per record,
+// and ReadRecords() can recover the records in order from the file left behind.
+//
+// All fields are stored in host byte order.
+class SnoopRingFile {
+ public:
+  struct FileHeaderType {
+    uint8_t identification_pattern[8];
+    uint32_t version_number;
+    uint32_t data_size;
+    // Offset in the data area of the oldest intact record
+    uint64_t oldest_offset;
+    uint64_t reserved;
+  } __attribute__((__packed__));
+
+  struct RecordHeaderType {
+    // 0 while the record is being written
+    uint64_t sequence;
+    // Length of the data following this header, or kWrapMarker
+    uint32_t length;
+    uint32_t reserved;
+  } __attribute__((__packed__));
+
+  // Record length marking that the record with this sequence number starts at the beginning of the data area
+  static constexpr uint32_t kWrapMarker = 0xffffffff;
+  // Records are padded to this alignment so their headers can be updated with aligned stores
+  static constexpr size_t kRecordAlignment = 8;
+
+  // Create, or truncate, |path| with room for |data_size| bytes of records and map it. Return nullptr on failure.
+  static std::unique_ptr<SnoopRingFile> Create(const std::string& path, size_t data_size);
+
+  // Read the ring file at |path| and append its records to |records|, oldest first, without their RecordHeaderType.
+  // Return false if |path| is not a ring file.
+  static bool ReadRecords(const std::string& path, std::vector<uint8_t>* records);
+
+  ~SnoopRingFile();
+
+  SnoopRingFile(const SnoopRingFile&) = delete;
+  SnoopRingFile& operator=(const SnoopRingFile&) = delete;
+
+  // Append a record of |length| bytes, overwriting the oldest records as needed. Return false if the record can
+  // never fit in the data area.
+  bool Append(const uint8_t* data, size_t length);
+
+ private:
+  SnoopRingFile(int fd, uint8_t* mapping, size_t data_size);
+
+  RecordHeaderType* record_at(size_t offset) const;
+  // Forget the records starting in [start, end) so they can be overwritten
+  void evict(size_t start, size_t end);
+  // Move past a wrap marker or the unusable end of the data area at oldest_offset_
+  void skip_wrap();
+
+  int fd_;
+  uint8_t* mapping_;
+  FileHeaderType* header_;
+  uint8_t* data_;
+  const size_t data_size_;
+
+  size_t write_offset_ = 0;
+  size_t oldest_offset_ = 0;
+  uint64_t oldest_sequence_ = 1;
+  uint64_t next_sequence_ = 1;
+};
+
+}  // namespace hal
+}  // namespace bluetooth
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hal/snoop_ring_file.h"
+
+#include <gtest/gtest.h>
+
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace testing {
+
+using bluetooth::hal::SnoopRingFile;
+
+class SnoopRingFileTest : public Test {
+ protected:
+  void SetUp() override {
+    ring_path_ = std::filesystem::temp_directory_path() / "btsnoop_hci.log.ring";
+    std::filesystem::remove(ring_path_);
+  }
+
+  void TearDown() override {
+    std::filesystem::remove(ring_path_);
+  }
+
+  std::vector<uint8_t> ReadRecords() {
+    std::vector<uint8_t> records;
+    EXPECT_TRUE(SnoopRingFile::ReadRecords(ring_path_.string(), &records));
+    return records;
+  }
+
+  static std::vector<uint8_t> MakeRecord(size_t index) {
+    // Vary the length so records wrap at different offsets
+    return std::vector<uint8_t>(1 + index % 37, static_cast<uint8_t>(index));
+  }
+
+  std::filesystem::path ring_path_;
+};
+
+TEST_F(SnoopRingFileTest, empty_ring) {
+  auto ring = SnoopRingFile::Create(ring_path_.string(), 4096);
+  ASSERT_NE(ring, nullptr);
+  ASSERT_TRUE(ReadRecords().empty());
+}
+
+TEST_F(SnoopRingFileTest, records_in_order) {
+  auto ring = SnoopRingFile::Create(ring_path_.string(), 4096);
+  std::vector<uint8_t> expected;
+  for (size_t i = 0; i < 10; i++) {
+    auto record = MakeRecord(i);
+    ASSERT_TRUE(ring->Append(record.data(), record.size()));
+    expected.insert(expected.end(), record.begin(), record.end());
+  }
+  ASSERT_EQ(expected, ReadRecords());
+}
+
+TEST_F(SnoopRingFileTest, keeps_newest_records_after_wrapping) {
+  constexpr size_t kDataSize = 512;
+  auto ring = SnoopRingFile::Create(ring_path_.string(), kDataSize);
+  std::deque<std::vector<uint8_t>> kept;
+  size_t kept_size = 0;
+  for (size_t i = 0; i < 1000; i++) {
+    auto record = MakeRecord(i);
+    ASSERT_TRUE(ring->Append(record.data(), record.size()));
+    kept.push_back(record);
+    kept_size += (sizeof(SnoopRingFile::RecordHeaderType) + record.size() + 7) & ~size_t(7);
+
+    auto records = ReadRecords();
+    std::vector<uint8_t> newest;
+    size_t newest_size = 0;
+    for (auto it = kept.rbegin(); it != kept.rend() && newest.size() < records.size(); it++) {
+      newest.insert(newest.begin(), it->begin(), it->end());
+      newest_size += (sizeof(SnoopRingFile::RecordHeaderType) + it->size() + 7) & ~size_t(7);
+    }
+    // The ring holds a suffix of what was appended, and never less than half of its capacity once it has wrapped
+    ASSERT_EQ(newest, records);
+    if (kept_size > kDataSize) {
+      ASSERT_GE(newest_size, kDataSize / 2);
+    }
+  }
+}
+
+TEST_F(SnoopRingFileTest, record_being_written_is_ignored) {
+  auto ring = SnoopRingFile::Create(ring_path_.string(), 4096);
+  auto first = MakeRecord(1);
+  auto second = MakeRecord(2);
+  ASSERT_TRUE(ring->Append(first.data(), first.size()));
+  ASSERT_TRUE(ring->Append(second.data(), second.size()));
+  ring.reset();
+
+  // Clear the sequence number of the second record, as if the process died while writing it
+  std::fstream file(ring_path_, std::ios::binary | std::ios::in | std::ios::out);
+  size_t second_offset = sizeof(SnoopRingFile::FileHeaderType) +
+                         ((sizeof(SnoopRingFile::RecordHeaderType) + first.size() + 7) & ~size_t(7));
+  uint64_t zero = 0;
+  file.seekp(second_offset);
+  file.write(reinterpret_cast<const char*>(&zero), sizeof(zero));
+  file.close();
+
+  ASSERT_EQ(first, ReadRecords());
+}
+
+TEST_F(SnoopRingFileTest, oversized_record_is_rejected) {
+  auto ring = SnoopRingFile::Create(ring_path_.string(), 64);
+  std::vector<uint8_t> record(64, 0xff);
+  ASSERT_FALSE(ring->Append(record.data(), record.size()));
+  ASSERT_TRUE(ReadRecords().empty());
+}
+
+TEST_F(SnoopRingFileTest, not_a_ring_file) {
+  std::ofstream file(ring_path_, std::ios::binary | std::ios::out);
+  file << "btsnoop";
+  file.close();
+  std::vector<uint8_t> records;
+  ASSERT_FALSE(SnoopRingFile::ReadRecords(ring_path_.string(), &records));
+}
+
+}  // namespace testing
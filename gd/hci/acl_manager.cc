@@ -94,17 +94,34 @@ struct AclManager::impl {
     if (handle == kQualcommDebugHandle) {
       return;
     }
+    acl_manager::assembler* assembler = nullptr;
     auto connection_pair = classic_impl_->acl_connections_.find(handle);
     if (connection_pair != classic_impl_->acl_connections_.end()) {
-      connection_pair->second.assembler_.on_incoming_packet(*packet);
+      assembler = &connection_pair->second.assembler_;
     } else {
       auto le_connection_pair = le_impl_->le_acl_connections_.find(handle);
       if (le_connection_pair == le_impl_->le_acl_connections_.end()) {
         LOG_INFO("Dropping packet of size %zu to unknown connection 0x%0hx", packet->size(), handle);
         return;
       }
-      le_connection_pair->second.assembler_.on_incoming_packet(*packet);
+      assembler = &le_connection_pair->second.assembler_;
     }
+    assembler->on_incoming_packet(*packet);
+    if (assembler->is_congested()) {
+      // Leave incoming packets in the HCI queue until the upper layer of this connection catches up, rather than drop
+      // them. Without Host Flow Control, the HCI queue is shared, so the other connections wait as well.
+      hci_queue_end_->UnregisterDequeue();
+      assembler->notify_on_congestion_cleared(
+          common::BindOnce(&impl::on_connection_congestion_cleared, common::Unretained(this)));
+    }
+  }
+
+  void on_connection_congestion_cleared() {
+    if (hci_queue_end_ == nullptr) {
+      return;
+    }
+    hci_queue_end_->RegisterDequeue(
+        handler_, common::Bind(&impl::dequeue_and_route_acl_packet_to_connection, common::Unretained(this)));
   }
 
   void Dump(
@@ -16,8 +16,10 @@
 
 #include "hci/acl_manager/acl_fragmenter.h"
 
+#include <algorithm>
+
 #include "os/log.h"
-#include "packet/fragmenting_inserter.h"
+#include "packet/bit_inserter.h"
 
 namespace bluetooth {
 namespace hci {
@@ -26,11 +28,20 @@ namespace acl_manager {
 AclFragmenter::AclFragmenter(size_t mtu, std::unique_ptr<packet::BasePacketBuilder> packet)
     : mtu_(mtu), packet_(std::move(packet)) {}
 
-std::vector<std::unique_ptr<packet::RawBuilder>> AclFragmenter::GetFragments() {
-  std::vector<std::unique_ptr<packet::RawBuilder>> to_return;
-  packet::FragmentingInserter fragmenting_inserter(mtu_, std::back_insert_iterator(to_return));
-  packet_->Serialize(fragmenting_inserter);
-  fragmenting_inserter.finalize();
+std::vector<std::unique_ptr<packet::FragmentBuilder>> AclFragmenter::GetFragments() {
+  ASSERT(mtu_ > 0);
+  auto buffer = std::make_shared<std::vector<uint8_t>>();
+  buffer->reserve(packet_->size());
+  {
+    packet::BitInserter it(*buffer);
+    packet_->Serialize(it);
+  }
+  std::vector<std::unique_ptr<packet::FragmentBuilder>> to_return;
+  to_return.reserve((buffer->size() + mtu_ - 1) / mtu_);
+  for (size_t offset = 0; offset < buffer->size(); offset += mtu_) {
+    to_return.push_back(
+        std::make_unique<packet::FragmentBuilder>(buffer, offset, std::min(mtu_, buffer->size() - offset)));
+  }
   return to_return;
 }
 
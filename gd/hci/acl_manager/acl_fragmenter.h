@@ -23,7 +23,7 @@
 #include <vector>
 
 #include "packet/base_packet_builder.h"
-#include "packet/raw_builder.h"
+#include "packet/fragment_builder.h"
 
 namespace bluetooth {
 namespace hci {
@@ -34,7 +34,8 @@ class AclFragmenter {
   AclFragmenter(size_t mtu, std::unique_ptr<packet::BasePacketBuilder> input);
   virtual ~AclFragmenter() = default;
 
-  std::vector<std::unique_ptr<packet::RawBuilder>> GetFragments();
+  // Serialize the packet once, and return fragments of at most |mtu| bytes that share the serialized buffer
+  std::vector<std::unique_ptr<packet::FragmentBuilder>> GetFragments();
 
  private:
   size_t mtu_;
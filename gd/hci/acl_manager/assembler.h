@@ -51,25 +51,58 @@ struct assembler {
   AddressWithType address_with_type_;
   AclConnection::QueueDownEnd* down_end_;
   os::Handler* handler_;
-  PacketViewForRecombination recombination_stage_{PacketView<kLittleEndian>(std::make_shared<std::vector<uint8_t>>())};
+  // Shared by every empty recombination stage, so that resetting the stage does not allocate
+  PacketView<kLittleEndian> empty_payload_{std::make_shared<std::vector<uint8_t>>()};
+  PacketViewForRecombination recombination_stage_{empty_payload_};
   int remaining_sdu_continuation_packet_size_ = 0;
   std::shared_ptr<std::atomic_bool> enqueue_registered_ = std::make_shared<std::atomic_bool>(false);
-  std::queue<packet::PacketView<kLittleEndian>> incoming_queue_;
+  // Complete L2CAP PDUs, ready to be handed over as they are
+  std::queue<std::unique_ptr<packet::PacketView<kLittleEndian>>> incoming_queue_;
+  // Set when incoming_queue_ fills up, until the upper layer dequeued half of it
+  bool congested_ = false;
+  common::OnceClosure on_congestion_cleared_;
 
   ~assembler() {
     if (enqueue_registered_->exchange(false)) {
       down_end_->UnregisterEnqueue();
     }
+    // Nothing is queued for this connection anymore
+    if (!on_congestion_cleared_.is_null()) {
+      std::move(on_congestion_cleared_).Run();
+    }
   }
 
   // Invoked from some external Queue Reactable context
   std::unique_ptr<packet::PacketView<kLittleEndian>> on_le_incoming_data_ready() {
-    auto packet = incoming_queue_.front();
+    auto packet = std::move(incoming_queue_.front());
     incoming_queue_.pop();
     if (incoming_queue_.empty() && enqueue_registered_->exchange(false)) {
       down_end_->UnregisterEnqueue();
     }
-    return std::make_unique<PacketView<kLittleEndian>>(packet);
+    if (congested_ && incoming_queue_.size() <= kMaxQueuedPacketsPerConnection / 2) {
+      congested_ = false;
+      if (!on_congestion_cleared_.is_null()) {
+        std::move(on_congestion_cleared_).Run();
+      }
+    }
+    return packet;
+  }
+
+  // True once kMaxQueuedPacketsPerConnection PDUs wait for the upper layer. The caller then holds back the packets of
+  // this connection until the callback given to notify_on_congestion_cleared() runs.
+  bool is_congested() const {
+    return congested_;
+  }
+
+  void notify_on_congestion_cleared(common::OnceClosure callback) {
+    ASSERT(congested_);
+    ASSERT(on_congestion_cleared_.is_null());
+    on_congestion_cleared_ = std::move(callback);
+  }
+
+  void reset_recombination_stage() {
+    recombination_stage_ = PacketViewForRecombination(empty_payload_);
+    remaining_sdu_continuation_packet_size_ = 0;
   }
 
   void on_incoming_packet(AclView packet) {
@@ -88,9 +121,7 @@ struct assembler {
     if (packet_boundary_flag == PacketBoundaryFlag::CONTINUING_FRAGMENT) {
       if (remaining_sdu_continuation_packet_size_ < payload_size) {
         LOG_WARN("Remote sent unexpected L2CAP PDU. Drop the entire L2CAP PDU");
-        recombination_stage_ =
-            PacketViewForRecombination(PacketView<kLittleEndian>(std::make_shared<std::vector<uint8_t>>()));
-        remaining_sdu_continuation_packet_size_ = 0;
+        reset_recombination_stage();
         return;
       }
       remaining_sdu_continuation_packet_size_ -= payload_size;
@@ -99,8 +130,7 @@ struct assembler {
         return;
       } else {
         payload = recombination_stage_;
-        recombination_stage_ =
-            PacketViewForRecombination(PacketView<kLittleEndian>(std::make_shared<std::vector<uint8_t>>()));
+        reset_recombination_stage();
       }
     } else if (packet_boundary_flag == PacketBoundaryFlag::FIRST_AUTOMATICALLY_FLUSHABLE) {
       if (recombination_stage_.size() > 0) {
@@ -113,16 +143,21 @@ struct assembler {
         return;
       }
     }
-    if (incoming_queue_.size() > kMaxQueuedPacketsPerConnection) {
+    if (congested_) {
       LOG_ERROR("Dropping packet from %s due to congestion", address_with_type_.ToString().c_str());
       return;
     }
 
-    incoming_queue_.push(payload);
+    incoming_queue_.push(std::make_unique<PacketView<kLittleEndian>>(payload));
     if (!enqueue_registered_->exchange(true)) {
       down_end_->RegisterEnqueue(handler_,
                                  common::Bind(&assembler::on_le_incoming_data_ready, common::Unretained(this)));
     }
+    if (incoming_queue_.size() >= kMaxQueuedPacketsPerConnection) {
+      LOG_WARN("Holding back incoming packets until the upper layer of %s catches up",
+               address_with_type_.ToString().c_str());
+      congested_ = true;
+    }
   }
 };
 
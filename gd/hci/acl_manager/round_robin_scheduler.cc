@@ -15,118 +15,135 @@
  */
 
 #include "hci/acl_manager/round_robin_scheduler.h"
+
+#include <algorithm>
+
 #include "hci/acl_manager/acl_fragmenter.h"
 
 namespace bluetooth {
 namespace hci {
 namespace acl_manager {
 
+namespace {
+
+// Fragments of the largest size a connection may send in one turn
+constexpr size_t kFragmentsPerTurn = 4;
+// Size of the ACL header in front of each fragment, which counts towards the deficit as well
+constexpr size_t kAclHeaderSize = 4;
+// Controller buffers reserved for each class, indexed by QosClass, while it has connections. Each reservation is
+// capped to a quarter of the buffers so that they always add up to at most all of them
+constexpr std::array<uint16_t, RoundRobinScheduler::kNumQosClasses> kReservedCredits = {1, 1, 1, 2};
+
+}  // namespace
+
 RoundRobinScheduler::RoundRobinScheduler(
     os::Handler* handler, Controller* controller, common::BidiQueueEnd<AclBuilder, AclView>* hci_queue_end)
     : handler_(handler), controller_(controller), hci_queue_end_(hci_queue_end) {
-  max_acl_packet_credits_ = controller_->GetNumAclPacketBuffers();
-  acl_packet_credits_ = max_acl_packet_credits_;
+  classic_credits_.max_credits_ = controller_->GetNumAclPacketBuffers();
   hci_mtu_ = controller_->GetAclPacketLength();
   LeBufferSize le_buffer_size = controller_->GetLeBufferSize();
-  le_max_acl_packet_credits_ = le_buffer_size.total_num_le_packets_;
-  le_acl_packet_credits_ = le_max_acl_packet_credits_;
+  le_credits_.max_credits_ = le_buffer_size.total_num_le_packets_;
   le_hci_mtu_ = le_buffer_size.le_data_packet_length_;
+  for (credit_pool* pool : {&classic_credits_, &le_credits_}) {
+    pool->credits_ = pool->max_credits_;
+    for (size_t i = 0; i < kNumQosClasses; i++) {
+      pool->reserved_credits_[i] = std::min<uint16_t>(kReservedCredits[i], pool->max_credits_ / kNumQosClasses);
+    }
+  }
   controller_->RegisterCompletedAclPacketsCallback(handler->BindOn(this, &RoundRobinScheduler::incoming_acl_credits));
 }
 
 RoundRobinScheduler::~RoundRobinScheduler() {
   unregister_all_connections();
+  if (enqueue_registered_.exchange(false)) {
+    hci_queue_end_->UnregisterEnqueue();
+  }
   controller_->UnregisterCompletedAclPacketsCallback();
 }
 
 void RoundRobinScheduler::Register(ConnectionType connection_type, uint16_t handle,
                                    std::shared_ptr<acl_manager::AclConnection::Queue> queue) {
-  acl_queue_handler acl_queue_handler = {connection_type, std::move(queue), false, 0};
-  acl_queue_handlers_.insert(std::pair<uint16_t, RoundRobinScheduler::acl_queue_handler>(handle, acl_queue_handler));
-  if (fragments_to_send_.size() == 0) {
-    start_round_robin();
-  }
+  acl_queue_handler acl_queue_handler;
+  acl_queue_handler.connection_type_ = connection_type;
+  acl_queue_handler.queue_ = std::move(queue);
+  acl_queue_handlers_.emplace(handle, std::move(acl_queue_handler));
+  get_credit_pool(connection_type).number_of_connections_[static_cast<size_t>(QosClass::BEST_EFFORT)]++;
+  start_round_robin();
 }
 
 void RoundRobinScheduler::Unregister(uint16_t handle) {
   ASSERT(acl_queue_handlers_.count(handle) == 1);
-  auto acl_queue_handler = acl_queue_handlers_.find(handle)->second;
+  auto acl_queue_handler = acl_queue_handlers_.find(handle);
+  auto& pool = get_credit_pool(acl_queue_handler->second.connection_type_);
+  size_t qos_class = static_cast<size_t>(acl_queue_handler->second.qos_class_);
   // Reclaim outstanding packets
-  if (acl_queue_handler.connection_type_ == ConnectionType::CLASSIC) {
-    acl_packet_credits_ += acl_queue_handler.number_of_sent_packets_;
-  } else {
-    le_acl_packet_credits_ += acl_queue_handler.number_of_sent_packets_;
-  }
-  acl_queue_handler.number_of_sent_packets_ = 0;
+  pool.credits_ += acl_queue_handler->second.number_of_sent_packets_;
+  pool.number_of_sent_packets_[qos_class] -= acl_queue_handler->second.number_of_sent_packets_;
+  pool.number_of_connections_[qos_class]--;
+  acl_queue_handler->second.number_of_sent_packets_ = 0;
 
-  if (acl_queue_handler.dequeue_is_registered_) {
-    acl_queue_handler.dequeue_is_registered_ = false;
-    acl_queue_handler.queue_->GetDownEnd()->UnregisterDequeue();
+  if (acl_queue_handler->second.dequeue_is_registered_) {
+    acl_queue_handler->second.dequeue_is_registered_ = false;
+    acl_queue_handler->second.queue_->GetDownEnd()->UnregisterDequeue();
   }
-  acl_queue_handlers_.erase(handle);
-  starting_point_ = acl_queue_handlers_.begin();
+  // Fragments that were not sent yet are dropped along with the connection
+  if (!acl_queue_handler->second.fragments_to_send_.empty()) {
+    deactivate(acl_queue_handler);
+  }
+  acl_queue_handlers_.erase(acl_queue_handler);
+  start_round_robin();
 }
 
 void RoundRobinScheduler::SetLinkPriority(uint16_t handle, bool high_priority) {
+  SetLinkQosClass(handle, high_priority ? QosClass::AUDIO : QosClass::BEST_EFFORT);
+}
+
+void RoundRobinScheduler::SetLinkQosClass(uint16_t handle, QosClass qos_class) {
   auto acl_queue_handler = acl_queue_handlers_.find(handle);
   if (acl_queue_handler == acl_queue_handlers_.end()) {
     LOG_WARN("handle %d is invalid", handle);
     return;
   }
-  acl_queue_handler->second.high_priority_ = high_priority;
+  QosClass previous_qos_class = acl_queue_handler->second.qos_class_;
+  if (qos_class == previous_qos_class) {
+    return;
+  }
+  auto& pool = get_credit_pool(acl_queue_handler->second.connection_type_);
+  uint16_t number_of_sent_packets = acl_queue_handler->second.number_of_sent_packets_;
+  pool.number_of_connections_[static_cast<size_t>(previous_qos_class)]--;
+  pool.number_of_sent_packets_[static_cast<size_t>(previous_qos_class)] -= number_of_sent_packets;
+  pool.number_of_connections_[static_cast<size_t>(qos_class)]++;
+  pool.number_of_sent_packets_[static_cast<size_t>(qos_class)] += number_of_sent_packets;
+  if (!acl_queue_handler->second.fragments_to_send_.empty()) {
+    active_connections_[static_cast<size_t>(previous_qos_class)].remove(handle);
+    active_connections_[static_cast<size_t>(qos_class)].push_back(handle);
+  }
+  acl_queue_handler->second.qos_class_ = qos_class;
+  start_round_robin();
 }
 
 uint16_t RoundRobinScheduler::GetCredits() {
-  return acl_packet_credits_;
+  return classic_credits_.credits_;
 }
 
 uint16_t RoundRobinScheduler::GetLeCredits() {
-  return le_acl_packet_credits_;
+  return le_credits_.credits_;
 }
 
 void RoundRobinScheduler::start_round_robin() {
-  if (acl_packet_credits_ == 0 && le_acl_packet_credits_ == 0) {
-    return;
-  }
-  if (!fragments_to_send_.empty()) {
-    auto connection_type = fragments_to_send_.front().first;
-    bool classic_buffer_full = acl_packet_credits_ == 0 && connection_type == ConnectionType::CLASSIC;
-    bool le_buffer_full = le_acl_packet_credits_ == 0 && connection_type == ConnectionType::LE;
-    if (classic_buffer_full || le_buffer_full) {
-      LOG_WARN("Buffer of connection_type %d is full", connection_type);
-      return;
-    }
-    send_next_fragment();
-    return;
-  }
-  if (acl_queue_handlers_.empty()) {
-    LOG_INFO("No any acl connection");
-    return;
-  }
-
-  if (acl_queue_handlers_.size() == 1 || starting_point_ == acl_queue_handlers_.end()) {
-    starting_point_ = acl_queue_handlers_.begin();
-  }
-  size_t count = acl_queue_handlers_.size();
-
-  for (auto acl_queue_handler = starting_point_; count > 0; count--) {
+  // Give every connection that is done with its previous packet a chance to queue its next one, so that they all take
+  // turns with the connections that are still sending
+  for (auto acl_queue_handler = acl_queue_handlers_.begin(); acl_queue_handler != acl_queue_handlers_.end();
+       acl_queue_handler = std::next(acl_queue_handler)) {
     // Prevent registration when credits is zero
-    bool classic_buffer_full =
-        acl_packet_credits_ == 0 && acl_queue_handler->second.connection_type_ == ConnectionType::CLASSIC;
-    bool le_buffer_full =
-        le_acl_packet_credits_ == 0 && acl_queue_handler->second.connection_type_ == ConnectionType::LE;
-    if (!acl_queue_handler->second.dequeue_is_registered_ && !classic_buffer_full && !le_buffer_full) {
+    if (!acl_queue_handler->second.dequeue_is_registered_ && acl_queue_handler->second.fragments_to_send_.empty() &&
+        can_send(acl_queue_handler->second.connection_type_, acl_queue_handler->second.qos_class_)) {
       acl_queue_handler->second.dequeue_is_registered_ = true;
       acl_queue_handler->second.queue_->GetDownEnd()->RegisterDequeue(
           handler_, common::Bind(&RoundRobinScheduler::buffer_packet, common::Unretained(this), acl_queue_handler));
     }
-    acl_queue_handler = std::next(acl_queue_handler);
-    if (acl_queue_handler == acl_queue_handlers_.end()) {
-      acl_queue_handler = acl_queue_handlers_.begin();
-    }
   }
-
-  starting_point_ = std::next(starting_point_);
+  send_next_fragment();
 }
 
 void RoundRobinScheduler::buffer_packet(std::map<uint16_t, acl_queue_handler>::iterator acl_queue_handler) {
@@ -142,27 +159,24 @@ void RoundRobinScheduler::buffer_packet(std::map<uint16_t, acl_queue_handler>::i
                                                 ? PacketBoundaryFlag::FIRST_AUTOMATICALLY_FLUSHABLE
                                                 : PacketBoundaryFlag::FIRST_NON_AUTOMATICALLY_FLUSHABLE;
 
-  int acl_priority = acl_queue_handler->second.high_priority_ ? 1 : 0;
+  auto& fragments_to_send = acl_queue_handler->second.fragments_to_send_;
   if (packet->size() <= mtu) {
-    fragments_to_send_.push(
-        std::make_pair(
-            connection_type, AclBuilder::Create(handle, packet_boundary_flag, broadcast_flag, std::move(packet))),
-        acl_priority);
+    fragments_to_send.push(AclBuilder::Create(handle, packet_boundary_flag, broadcast_flag, std::move(packet)));
   } else {
     auto fragments = AclFragmenter(mtu, std::move(packet)).GetFragments();
     for (size_t i = 0; i < fragments.size(); i++) {
-      fragments_to_send_.push(
-          std::make_pair(
-              connection_type,
-              AclBuilder::Create(handle, packet_boundary_flag, broadcast_flag, std::move(fragments[i]))),
-          acl_priority);
+      fragments_to_send.push(
+          AclBuilder::Create(handle, packet_boundary_flag, broadcast_flag, std::move(fragments[i])));
       packet_boundary_flag = PacketBoundaryFlag::CONTINUING_FRAGMENT;
     }
   }
-  ASSERT(fragments_to_send_.size() > 0);
-  unregister_all_connections();
+  ASSERT(fragments_to_send.size() > 0);
+  // Only one packet per connection is fragmented at a time
+  acl_queue_handler->second.dequeue_is_registered_ = false;
+  acl_queue_handler->second.queue_->GetDownEnd()->UnregisterDequeue();
 
-  acl_queue_handler->second.number_of_sent_packets_ += fragments_to_send_.size();
+  acl_queue_handler->second.deficit_ = get_quantum(connection_type);
+  active_connections_[static_cast<size_t>(acl_queue_handler->second.qos_class_)].push_back(handle);
   send_next_fragment();
 }
 
@@ -177,39 +191,36 @@ void RoundRobinScheduler::unregister_all_connections() {
 }
 
 void RoundRobinScheduler::send_next_fragment() {
-  if (!enqueue_registered_.exchange(true)) {
-    hci_queue_end_->RegisterEnqueue(
-        handler_, common::Bind(&RoundRobinScheduler::handle_enqueue_next_fragment, common::Unretained(this)));
+  if (has_fragments_to_send()) {
+    if (!enqueue_registered_.exchange(true)) {
+      hci_queue_end_->RegisterEnqueue(
+          handler_, common::Bind(&RoundRobinScheduler::handle_enqueue_next_fragment, common::Unretained(this)));
+    }
+  } else if (enqueue_registered_.exchange(false)) {
+    hci_queue_end_->UnregisterEnqueue();
   }
 }
 
 // Invoked from some external Queue Reactable context 1
 std::unique_ptr<AclBuilder> RoundRobinScheduler::handle_enqueue_next_fragment() {
-  ConnectionType connection_type = fragments_to_send_.front().first;
-  if (connection_type == ConnectionType::CLASSIC) {
-    ASSERT(acl_packet_credits_ > 0);
-    acl_packet_credits_ -= 1;
-  } else {
-    ASSERT(le_acl_packet_credits_ > 0);
-    le_acl_packet_credits_ -= 1;
-  }
+  auto acl_queue_handler = next_connection_to_send();
+  ASSERT(acl_queue_handler != acl_queue_handlers_.end());
+  auto& pool = get_credit_pool(acl_queue_handler->second.connection_type_);
+  ASSERT(pool.credits_ > 0);
+  pool.credits_ -= 1;
+  pool.number_of_sent_packets_[static_cast<size_t>(acl_queue_handler->second.qos_class_)]++;
+  acl_queue_handler->second.number_of_sent_packets_++;
 
-  auto raw_pointer = fragments_to_send_.front().second.release();
-  fragments_to_send_.pop();
-  if (fragments_to_send_.empty()) {
-    if (enqueue_registered_.exchange(false)) {
-      hci_queue_end_->UnregisterEnqueue();
-    }
+  auto& fragments_to_send = acl_queue_handler->second.fragments_to_send_;
+  auto fragment = std::move(fragments_to_send.front());
+  fragments_to_send.pop();
+  acl_queue_handler->second.deficit_ -= fragment->size();
+  if (fragments_to_send.empty()) {
+    deactivate(acl_queue_handler);
     handler_->Post(common::BindOnce(&RoundRobinScheduler::start_round_robin, common::Unretained(this)));
-  } else {
-    ConnectionType next_connection_type = fragments_to_send_.front().first;
-    bool classic_buffer_full = next_connection_type == ConnectionType::CLASSIC && acl_packet_credits_ == 0;
-    bool le_buffer_full = next_connection_type == ConnectionType::LE && le_acl_packet_credits_ == 0;
-    if ((classic_buffer_full || le_buffer_full) && enqueue_registered_.exchange(false)) {
-      hci_queue_end_->UnregisterEnqueue();
-    }
   }
-  return std::unique_ptr<AclBuilder>(raw_pointer);
+  send_next_fragment();
+  return fragment;
 }
 
 void RoundRobinScheduler::incoming_acl_credits(uint16_t handle, uint16_t credits) {
@@ -219,36 +230,91 @@ void RoundRobinScheduler::incoming_acl_credits(uint16_t handle, uint16_t credits
     return;
   }
 
-  if (acl_queue_handler->second.number_of_sent_packets_ >= credits) {
-    acl_queue_handler->second.number_of_sent_packets_ -= credits;
-  } else {
+  auto& pool = get_credit_pool(acl_queue_handler->second.connection_type_);
+  uint16_t completed_packets = credits;
+  if (acl_queue_handler->second.number_of_sent_packets_ < credits) {
     LOG_WARN("receive more credits than we sent");
-    acl_queue_handler->second.number_of_sent_packets_ = 0;
+    completed_packets = acl_queue_handler->second.number_of_sent_packets_;
   }
+  acl_queue_handler->second.number_of_sent_packets_ -= completed_packets;
+  pool.number_of_sent_packets_[static_cast<size_t>(acl_queue_handler->second.qos_class_)] -= completed_packets;
 
-  bool credit_was_zero = false;
-  if (acl_queue_handler->second.connection_type_ == ConnectionType::CLASSIC) {
-    if (acl_packet_credits_ == 0) {
-      credit_was_zero = true;
-    }
-    acl_packet_credits_ += credits;
-    if (acl_packet_credits_ > max_acl_packet_credits_) {
-      acl_packet_credits_ = max_acl_packet_credits_;
-      LOG_WARN("acl packet credits overflow due to receive %hx credits", credits);
-    }
-  } else {
-    if (le_acl_packet_credits_ == 0) {
-      credit_was_zero = true;
+  pool.credits_ += credits;
+  if (pool.credits_ > pool.max_credits_) {
+    pool.credits_ = pool.max_credits_;
+    LOG_WARN("%s acl packet credits overflow due to receive %hx credits",
+             acl_queue_handler->second.connection_type_ == ConnectionType::CLASSIC ? "classic" : "le", credits);
+  }
+  // Credits may also unblock a class that was waiting for the reservations of the others
+  start_round_robin();
+}
+
+RoundRobinScheduler::credit_pool& RoundRobinScheduler::get_credit_pool(ConnectionType connection_type) {
+  return connection_type == ConnectionType::CLASSIC ? classic_credits_ : le_credits_;
+}
+
+bool RoundRobinScheduler::can_send(ConnectionType connection_type, QosClass qos_class) {
+  auto& pool = get_credit_pool(connection_type);
+  // Keep enough credits for the other classes to use their reservations
+  uint16_t held_back_credits = 0;
+  for (size_t i = 0; i < kNumQosClasses; i++) {
+    if (i != static_cast<size_t>(qos_class) && pool.number_of_connections_[i] > 0 &&
+        pool.number_of_sent_packets_[i] < pool.reserved_credits_[i]) {
+      held_back_credits += pool.reserved_credits_[i] - pool.number_of_sent_packets_[i];
     }
-    le_acl_packet_credits_ += credits;
-    if (le_acl_packet_credits_ > le_max_acl_packet_credits_) {
-      le_acl_packet_credits_ = le_max_acl_packet_credits_;
-      LOG_WARN("le acl packet credits overflow due to receive %hx credits", credits);
+  }
+  return pool.credits_ > held_back_credits;
+}
+
+size_t RoundRobinScheduler::get_quantum(ConnectionType connection_type) {
+  size_t mtu = connection_type == ConnectionType::CLASSIC ? hci_mtu_ : le_hci_mtu_;
+  return kFragmentsPerTurn * (mtu + kAclHeaderSize);
+}
+
+bool RoundRobinScheduler::has_fragments_to_send() {
+  for (size_t i = 0; i < kNumQosClasses; i++) {
+    for (uint16_t handle : active_connections_[i]) {
+      if (can_send(acl_queue_handlers_.find(handle)->second.connection_type_, static_cast<QosClass>(i))) {
+        return true;
+      }
     }
   }
-  if (credit_was_zero) {
-    start_round_robin();
+  return false;
+}
+
+std::map<uint16_t, RoundRobinScheduler::acl_queue_handler>::iterator RoundRobinScheduler::next_connection_to_send() {
+  for (size_t i = kNumQosClasses; i-- > 0;) {
+    auto& active_connections = active_connections_[i];
+    auto handle = active_connections.begin();
+    // A connection is visited twice at most: once to end its turn, and once to send with its new quantum
+    for (size_t visits = 2 * active_connections.size(); visits > 0; visits--) {
+      if (handle == active_connections.end()) {
+        handle = active_connections.begin();
+      }
+      auto acl_queue_handler = acl_queue_handlers_.find(*handle);
+      // Connections waiting for credits keep their place until they get some
+      if (!can_send(acl_queue_handler->second.connection_type_, static_cast<QosClass>(i))) {
+        handle = std::next(handle);
+        continue;
+      }
+      if (acl_queue_handler->second.deficit_ >= acl_queue_handler->second.fragments_to_send_.front()->size()) {
+        return acl_queue_handler;
+      }
+      // Its turn is over, it goes last with a new quantum
+      acl_queue_handler->second.deficit_ += get_quantum(acl_queue_handler->second.connection_type_);
+      auto turn_over = handle;
+      handle = std::next(handle);
+      active_connections.splice(active_connections.end(), active_connections, turn_over);
+    }
   }
+  return acl_queue_handlers_.end();
+}
+
+void RoundRobinScheduler::deactivate(std::map<uint16_t, acl_queue_handler>::iterator acl_queue_handler) {
+  active_connections_[static_cast<size_t>(acl_queue_handler->second.qos_class_)].remove(acl_queue_handler->first);
+  acl_queue_handler->second.deficit_ = 0;
+  std::queue<std::unique_ptr<AclBuilder>> empty;
+  std::swap(acl_queue_handler->second.fragments_to_send_, empty);
 }
 
 }  // namespace acl_manager
@@ -18,8 +18,12 @@
 
 #include <stdint.h>
 
+#include <array>
+#include <list>
+#include <map>
+#include <queue>
+
 #include "common/bidi_queue.h"
-#include "common/multi_priority_queue.h"
 #include "hci/acl_manager.h"
 #include "hci/controller.h"
 #include "hci/hci_packets.h"
@@ -29,6 +33,13 @@ namespace bluetooth {
 namespace hci {
 namespace acl_manager {
 
+// Schedules outgoing ACL fragments of all connections onto the shared controller buffers
+//
+// Connections are sorted into QoS classes which are served in strict priority order. Connections of the same class
+// share the controller in deficit round robin: each of them may send up to a quantum of fragments in turn, so a
+// connection fragmenting a large packet cannot hold back the others until the whole packet is sent. Each class also
+// has a few controller buffers reserved for it while it has connections, so that lower classes cannot leave higher
+// ones waiting for credits, and higher classes cannot starve lower ones.
 class RoundRobinScheduler {
  public:
   RoundRobinScheduler(
@@ -37,43 +48,66 @@ class RoundRobinScheduler {
 
   enum ConnectionType { CLASSIC, LE };
 
+  // Ordered from the lowest to the highest priority
+  enum class QosClass { BACKGROUND, BEST_EFFORT, INTERACTIVE, AUDIO };
+  static constexpr size_t kNumQosClasses = 4;
+
   struct acl_queue_handler {
     ConnectionType connection_type_;
     std::shared_ptr<acl_manager::AclConnection::Queue> queue_;
     bool dequeue_is_registered_ = false;
     uint16_t number_of_sent_packets_ = 0;  // Track credits
-    bool high_priority_ = false;           // For A2dp use
+    QosClass qos_class_ = QosClass::BEST_EFFORT;
+    // Fragments of the packet being sent, only dequeue the next packet once they are all sent
+    std::queue<std::unique_ptr<AclBuilder>> fragments_to_send_;
+    // Bytes this connection may still send in its current turn
+    size_t deficit_ = 0;
   };
 
   void Register(ConnectionType connection_type, uint16_t handle,
                 std::shared_ptr<acl_manager::AclConnection::Queue> queue);
   void Unregister(uint16_t handle);
+  // high_priority is kept for A2dp, and maps to QosClass::AUDIO
   void SetLinkPriority(uint16_t handle, bool high_priority);
+  void SetLinkQosClass(uint16_t handle, QosClass qos_class);
   uint16_t GetCredits();
   uint16_t GetLeCredits();
 
  private:
+  // Credit accounting of one controller buffer pool
+  struct credit_pool {
+    uint16_t max_credits_ = 0;
+    uint16_t credits_ = 0;
+    std::array<uint16_t, kNumQosClasses> reserved_credits_{};
+    std::array<uint16_t, kNumQosClasses> number_of_connections_{};
+    std::array<uint16_t, kNumQosClasses> number_of_sent_packets_{};
+  };
+
   void start_round_robin();
   void buffer_packet(std::map<uint16_t, acl_queue_handler>::iterator acl_queue_handler);
   void unregister_all_connections();
   void send_next_fragment();
   std::unique_ptr<AclBuilder> handle_enqueue_next_fragment();
   void incoming_acl_credits(uint16_t handle, uint16_t credits);
+  credit_pool& get_credit_pool(ConnectionType connection_type);
+  bool can_send(ConnectionType connection_type, QosClass qos_class);
+  size_t get_quantum(ConnectionType connection_type);
+  bool has_fragments_to_send();
+  // Return the connection whose next fragment should be sent, or acl_queue_handlers_.end() if none can be sent
+  std::map<uint16_t, acl_queue_handler>::iterator next_connection_to_send();
+  void deactivate(std::map<uint16_t, acl_queue_handler>::iterator acl_queue_handler);
 
   os::Handler* handler_ = nullptr;
   Controller* controller_ = nullptr;
   std::map<uint16_t, acl_queue_handler> acl_queue_handlers_;
-  common::MultiPriorityQueue<std::pair<ConnectionType, std::unique_ptr<AclBuilder>>, 2> fragments_to_send_;
-  uint16_t max_acl_packet_credits_ = 0;
-  uint16_t acl_packet_credits_ = 0;
-  uint16_t le_max_acl_packet_credits_ = 0;
-  uint16_t le_acl_packet_credits_ = 0;
+  // Connections with fragments to send, per class, in the order they take turns
+  std::array<std::list<uint16_t>, kNumQosClasses> active_connections_;
+  credit_pool classic_credits_;
+  credit_pool le_credits_;
   size_t hci_mtu_{0};
   size_t le_hci_mtu_{0};
   std::atomic_bool enqueue_registered_ = false;
   common::BidiQueueEnd<AclBuilder, AclView>* hci_queue_end_ = nullptr;
-  // first register queue end for the Round-robin schedule
-  std::map<uint16_t, acl_queue_handler>::iterator starting_point_;
 };
 
 }  // namespace acl_manager
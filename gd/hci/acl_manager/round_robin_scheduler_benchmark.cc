@@ -0,0 +1,264 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <deque>
+#include <future>
+#include <map>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "common/bidi_queue.h"
+#include "common/bind.h"
+#include "hci/acl_manager/round_robin_scheduler.h"
+#include "hci/controller.h"
+#include "hci/hci_packets.h"
+#include "os/handler.h"
+#include "os/queue.h"
+#include "os/thread.h"
+#include "packet/raw_builder.h"
+
+using ::benchmark::State;
+using ::bluetooth::common::BidiQueue;
+using ::bluetooth::hci::AclBuilder;
+using ::bluetooth::hci::AclView;
+using ::bluetooth::hci::Controller;
+using ::bluetooth::hci::LeBufferSize;
+using ::bluetooth::hci::acl_manager::AclConnection;
+using ::bluetooth::hci::acl_manager::RoundRobinScheduler;
+using ::bluetooth::os::EnqueueBuffer;
+using ::bluetooth::os::Handler;
+using ::bluetooth::os::Thread;
+using ::bluetooth::packet::BasePacketBuilder;
+
+namespace {
+
+// Air slots simulated per iteration. The simulated controller sends one buffered ACL packet per slot
+constexpr uint64_t kSimulatedSlots = 20000;
+
+class SimulatedController : public Controller {
+ public:
+  uint16_t GetNumAclPacketBuffers() const override {
+    return 8;
+  }
+
+  uint16_t GetAclPacketLength() const override {
+    return 1021;
+  }
+
+  LeBufferSize GetLeBufferSize() const override {
+    LeBufferSize le_buffer_size;
+    le_buffer_size.le_data_packet_length_ = 251;
+    le_buffer_size.total_num_le_packets_ = 8;
+    return le_buffer_size;
+  }
+
+  void RegisterCompletedAclPacketsCallback(CompletedAclPacketsCallback cb) override {
+    acl_credits_callback_ = cb;
+  }
+
+  void UnregisterCompletedAclPacketsCallback() override {
+    acl_credits_callback_ = {};
+  }
+
+  void SendCompletedAclPackets(uint16_t handle, uint16_t credits) {
+    acl_credits_callback_.Invoke(handle, credits);
+  }
+
+ private:
+  CompletedAclPacketsCallback acl_credits_callback_;
+};
+
+struct SimulatedLink {
+  std::string name_;
+  RoundRobinScheduler::ConnectionType connection_type_;
+  RoundRobinScheduler::QosClass qos_class_;
+  size_t packet_size_;
+  // A packet is queued every period_ slots, or whenever the previous one is sent if 0
+  uint64_t period_;
+
+  std::shared_ptr<AclConnection::Queue> queue_;
+  std::unique_ptr<EnqueueBuffer<BasePacketBuilder>> enqueue_buffer_;
+  // Slot at which each packet that is not fully sent yet was queued
+  std::queue<uint64_t> queued_at_;
+  size_t bytes_sent_of_current_packet_ = 0;
+  std::vector<uint64_t> latencies_;
+};
+
+}  // namespace
+
+// Simulates a mix of links sharing the controller buffers, and reports the latency of each link in air slots, from
+// the time a packet is queued to the time its last fragment is sent over the air. state.range(0) is 1 if the links
+// are given their QoS class, and 0 if they all stay best effort.
+class BM_RoundRobinScheduler : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    benchmark::Fixture::SetUp(st);
+    thread_ = std::make_unique<Thread>("BM_RoundRobinScheduler thread", Thread::Priority::NORMAL);
+    handler_ = std::make_unique<Handler>(thread_.get());
+    controller_ = std::make_unique<SimulatedController>();
+    round_robin_scheduler_ =
+        std::make_unique<RoundRobinScheduler>(handler_.get(), controller_.get(), hci_queue_.GetUpEnd());
+    hci_queue_.GetDownEnd()->RegisterDequeue(
+        handler_.get(), bluetooth::common::Bind(&BM_RoundRobinScheduler::hci_down_end_dequeue,
+                                                bluetooth::common::Unretained(this)));
+
+    using ConnectionType = RoundRobinScheduler::ConnectionType;
+    using QosClass = RoundRobinScheduler::QosClass;
+    links_.push_back({"file_transfer", ConnectionType::CLASSIC, QosClass::BACKGROUND, 8192, 0});
+    links_.push_back({"a2dp", ConnectionType::CLASSIC, QosClass::AUDIO, 660, 20});
+    links_.push_back({"hid", ConnectionType::LE, QosClass::INTERACTIVE, 20, 12});
+    links_.push_back({"le_audio_control", ConnectionType::LE, QosClass::INTERACTIVE, 40, 50});
+    links_.push_back({"gatt_bulk", ConnectionType::LE, QosClass::BEST_EFFORT, 4096, 0});
+    links_.push_back({"gatt_notify", ConnectionType::LE, QosClass::BEST_EFFORT, 100, 30});
+    uint16_t handle = 1;
+    for (auto& link : links_) {
+      link.queue_ = std::make_shared<AclConnection::Queue>(10);
+      link.enqueue_buffer_ = std::make_unique<EnqueueBuffer<BasePacketBuilder>>(link.queue_->GetUpEnd());
+      handle_to_link_[handle] = &link;
+      round_robin_scheduler_->Register(link.connection_type_, handle, link.queue_);
+      if (st.range(0) == 1) {
+        round_robin_scheduler_->SetLinkQosClass(handle, link.qos_class_);
+      }
+      handle++;
+    }
+    handler_->Post(bluetooth::common::BindOnce(&BM_RoundRobinScheduler::queue_backlog,
+                                               bluetooth::common::Unretained(this)));
+  }
+
+  void TearDown(State& st) override {
+    hci_queue_.GetDownEnd()->UnregisterDequeue();
+    for (auto& link : links_) {
+      link.enqueue_buffer_->Clear();
+    }
+    handler_->Clear();
+    round_robin_scheduler_ = nullptr;
+    for (auto& link : links_) {
+      link.enqueue_buffer_ = nullptr;
+    }
+    links_.clear();
+    handle_to_link_.clear();
+    controller_ = nullptr;
+    handler_ = nullptr;
+    thread_->Stop();
+    thread_ = nullptr;
+    benchmark::Fixture::TearDown(st);
+  }
+
+  void queue_packet(SimulatedLink* link) {
+    auto packet = std::make_unique<bluetooth::packet::RawBuilder>();
+    packet->AddOctets(std::vector<uint8_t>(link->packet_size_));
+    link->queued_at_.push(slot_);
+    link->enqueue_buffer_->Enqueue(std::move(packet), handler_.get());
+  }
+
+  // Backlogged links always have a packet waiting behind the one being sent
+  void queue_backlog() {
+    for (auto& link : links_) {
+      if (link.period_ == 0) {
+        queue_packet(&link);
+        queue_packet(&link);
+      }
+    }
+  }
+
+  // Packets still in flight at the end of a run carry over to the next one
+  void run_simulation() {
+    last_slot_ = slot_ + kSimulatedSlots;
+    send_over_the_air();
+  }
+
+  void hci_down_end_dequeue() {
+    auto packet = hci_queue_.GetDownEnd()->TryDequeue();
+    auto bytes = std::make_shared<std::vector<uint8_t>>();
+    bluetooth::packet::BitInserter i(*bytes);
+    bytes->reserve(packet->size());
+    packet->Serialize(i);
+    AclView acl_packet_view =
+        AclView::Create(bluetooth::packet::PacketView<bluetooth::packet::kLittleEndian>(bytes));
+    controller_buffer_.emplace_back(acl_packet_view.GetHandle(), acl_packet_view.GetPayload().size());
+  }
+
+  // One air slot: send the oldest buffered packet, give its credit back, and let the periodic links queue packets
+  void send_over_the_air() {
+    slot_++;
+    if (!controller_buffer_.empty()) {
+      auto [handle, payload_size] = controller_buffer_.front();
+      controller_buffer_.pop_front();
+      controller_->SendCompletedAclPackets(handle, 1);
+      SimulatedLink* link = handle_to_link_[handle];
+      link->bytes_sent_of_current_packet_ += payload_size;
+      if (link->bytes_sent_of_current_packet_ == link->packet_size_) {
+        link->bytes_sent_of_current_packet_ = 0;
+        link->latencies_.push_back(slot_ - link->queued_at_.front());
+        link->queued_at_.pop();
+        if (link->period_ == 0) {
+          queue_packet(link);
+        }
+      }
+    }
+    for (auto& link : links_) {
+      if (link.period_ != 0 && slot_ % link.period_ == 0) {
+        queue_packet(&link);
+      }
+    }
+    if (slot_ == last_slot_) {
+      simulation_promise_.set_value();
+      return;
+    }
+    handler_->Post(bluetooth::common::BindOnce(&BM_RoundRobinScheduler::send_over_the_air,
+                                               bluetooth::common::Unretained(this)));
+  }
+
+  std::unique_ptr<Thread> thread_;
+  std::unique_ptr<Handler> handler_;
+  std::unique_ptr<SimulatedController> controller_;
+  BidiQueue<AclView, AclBuilder> hci_queue_{3};
+  std::unique_ptr<RoundRobinScheduler> round_robin_scheduler_;
+  std::vector<SimulatedLink> links_;
+  std::map<uint16_t, SimulatedLink*> handle_to_link_;
+  // Handle and payload size of the packets buffered in the controller, in the order they are sent
+  std::deque<std::pair<uint16_t, size_t>> controller_buffer_;
+  uint64_t slot_ = 0;
+  uint64_t last_slot_ = 0;
+  std::promise<void> simulation_promise_;
+};
+
+BENCHMARK_DEFINE_F(BM_RoundRobinScheduler, link_latency)(State& state) {
+  for (auto _ : state) {
+    simulation_promise_ = std::promise<void>();
+    auto simulation_future = simulation_promise_.get_future();
+    handler_->Post(bluetooth::common::BindOnce(&BM_RoundRobinScheduler::run_simulation,
+                                               bluetooth::common::Unretained(this)));
+    simulation_future.wait();
+  }
+  // The handler thread is done with the links once the last slot has run
+  for (auto& link : links_) {
+    auto& latencies = link.latencies_;
+    if (latencies.empty()) {
+      continue;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    state.counters[link.name_ + "_p50"] = latencies[latencies.size() / 2];
+    state.counters[link.name_ + "_p99"] = latencies[latencies.size() * 99 / 100];
+  }
+  state.SetItemsProcessed(state.iterations() * kSimulatedSlots);
+};
+
+BENCHMARK_REGISTER_F(BM_RoundRobinScheduler, link_latency)->Arg(0)->Arg(1)->UseRealTime();
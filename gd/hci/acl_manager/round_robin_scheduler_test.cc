@@ -410,6 +410,85 @@ TEST_F(RoundRobinSchedulerTest, receive_le_credit_when_next_fragment_is_classic)
   round_robin_scheduler_->Unregister(le_handle);
 }
 
+TEST_F(RoundRobinSchedulerTest, large_packet_does_not_hold_back_other_connections) {
+  uint16_t handle = 0x01;
+  uint16_t le_handle = 0x02;
+  auto connection_queue = std::make_shared<AclConnection::Queue>(10);
+  auto le_connection_queue = std::make_shared<AclConnection::Queue>(10);
+
+  round_robin_scheduler_->Register(RoundRobinScheduler::ConnectionType::CLASSIC, handle, connection_queue);
+  round_robin_scheduler_->Register(RoundRobinScheduler::ConnectionType::LE, le_handle, le_connection_queue);
+
+  // Stall the controller so that the classic packet is queued while the LE packet is being sent
+  hci_queue_.GetDownEnd()->UnregisterDequeue();
+  SetPacketFuture(7);
+  std::vector<uint8_t> le_packet(controller_->le_hci_mtu_ * 6, 0x01);
+  std::vector<uint8_t> packet = {0x01, 0x02, 0x03};
+  EnqueueAclUpEnd(le_connection_queue->GetUpEnd(), le_packet);
+  EnqueueAclUpEnd(connection_queue->GetUpEnd(), packet);
+  enqueue_future_->wait();
+  sync_handler();
+  hci_queue_.GetDownEnd()->RegisterDequeue(
+      handler_, common::Bind(&RoundRobinSchedulerTest::HciDownEndDequeue, common::Unretained(this)));
+
+  packet_future_->wait();
+  // The LE connection ends its turn after 4 fragments
+  std::vector<uint16_t> expected_handles = {le_handle, le_handle, le_handle, le_handle, handle, le_handle, le_handle};
+  for (auto expected_handle : expected_handles) {
+    ASSERT_EQ(sent_acl_packets_.front().GetHandle(), expected_handle);
+    sent_acl_packets_.pop();
+  }
+
+  round_robin_scheduler_->Unregister(handle);
+  round_robin_scheduler_->Unregister(le_handle);
+}
+
+TEST_F(RoundRobinSchedulerTest, credits_are_reserved_for_high_priority_connection) {
+  uint16_t handle = 0x01;
+  uint16_t audio_handle = 0x02;
+  auto connection_queue = std::make_shared<AclConnection::Queue>(15);
+  auto audio_connection_queue = std::make_shared<AclConnection::Queue>(10);
+
+  round_robin_scheduler_->Register(RoundRobinScheduler::ConnectionType::CLASSIC, handle, connection_queue);
+  round_robin_scheduler_->Register(RoundRobinScheduler::ConnectionType::CLASSIC, audio_handle, audio_connection_queue);
+  round_robin_scheduler_->SetLinkPriority(audio_handle, true);
+
+  // 2 of the 10 classic buffers are kept for the audio connection
+  SetPacketFuture(8);
+  AclConnection::QueueUpEnd* queue_up_end = connection_queue->GetUpEnd();
+  for (uint8_t i = 0; i < 12; i++) {
+    std::vector<uint8_t> packet = {0x01, 0x02, 0x03, i};
+    EnqueueAclUpEnd(queue_up_end, packet);
+  }
+  packet_future_->wait();
+  sync_handler();
+  for (uint8_t i = 0; i < 8; i++) {
+    std::vector<uint8_t> packet = {0x01, 0x02, 0x03, i};
+    VerifyPacket(handle, packet);
+  }
+  ASSERT_EQ(round_robin_scheduler_->GetCredits(), 2);
+
+  SetPacketFuture(1);
+  std::vector<uint8_t> audio_packet = {0x04, 0x05, 0x06};
+  EnqueueAclUpEnd(audio_connection_queue->GetUpEnd(), audio_packet);
+  packet_future_->wait();
+  VerifyPacket(audio_handle, audio_packet);
+  ASSERT_EQ(round_robin_scheduler_->GetCredits(), 1);
+
+  // The other connection may use all but the credit still reserved for the audio connection
+  SetPacketFuture(4);
+  controller_->SendCompletedAclPacketsCallback(handle, 4);
+  packet_future_->wait();
+  for (uint8_t i = 8; i < 12; i++) {
+    std::vector<uint8_t> packet = {0x01, 0x02, 0x03, i};
+    VerifyPacket(handle, packet);
+  }
+  ASSERT_EQ(round_robin_scheduler_->GetCredits(), 1);
+
+  round_robin_scheduler_->Unregister(handle);
+  round_robin_scheduler_->Unregister(audio_handle);
+}
+
 }  // namespace acl_manager
 }  // namespace hci
 }  // namespace bluetooth
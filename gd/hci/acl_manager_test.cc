@@ -20,6 +20,7 @@
 #include <chrono>
 #include <future>
 #include <map>
+#include <optional>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -951,6 +952,33 @@ TEST_F(AclManagerWithConnectionTest, acl_send_data_one_connection) {
   test_hci_layer_->Disconnect(handle_, reason);
 }
 
+TEST_F(AclManagerWithConnectionTest, incoming_acl_data_is_held_back_when_upper_layer_is_slow) {
+  // The connection queue and the connection's assembler fill up first, then packets wait in the HCI queue
+  constexpr size_t kNumPackets = 23;
+  for (size_t i = 0; i < kNumPackets; i++) {
+    test_hci_layer_->IncomingAclData(handle_);
+  }
+
+  // Nothing was dropped, and packets arrive in order once the upper layer dequeues them
+  auto queue_end = connection_->GetAclQueueEnd();
+  std::optional<uint32_t> last_packet_number;
+  auto deadline = std::chrono::steady_clock::now() + kTimeout;
+  for (size_t received = 0; received < kNumPackets;) {
+    ASSERT_LT(std::chrono::steady_clock::now(), deadline);
+    auto packet = queue_end->TryDequeue();
+    if (packet == nullptr) {
+      continue;
+    }
+    auto it = packet->begin() + 6;
+    uint32_t packet_number = it.extract<uint32_t>();
+    if (last_packet_number) {
+      EXPECT_EQ(packet_number, *last_packet_number + 1);
+    }
+    last_packet_number = packet_number;
+    received++;
+  }
+}
+
 TEST_F(AclManagerWithConnectionTest, acl_send_data_credits) {
   // Use all the credits
   for (uint16_t credits = 0; credits < test_controller_->total_acl_buffers_; credits++) {
@@ -16,6 +16,9 @@
 
 #include "hci/hci_layer.h"
 
+#include <algorithm>
+#include <chrono>
+
 #include "common/bind.h"
 #include "common/init_flags.h"
 #include "common/stop_watch.h"
@@ -23,6 +26,7 @@
 #include "os/alarm.h"
 #include "os/metrics.h"
 #include "os/queue.h"
+#include "os/system_properties.h"
 #include "packet/packet_builder.h"
 #include "storage/storage_module.h"
 
@@ -69,7 +73,12 @@ class CommandQueueEntry {
       : command(move(command_packet)), waiting_for_status_(true), on_status(move(on_status_function)) {}
 
   unique_ptr<CommandBuilder> command;
+  // Serialized command, set once it is first considered for sending
+  std::shared_ptr<std::vector<uint8_t>> bytes;
   unique_ptr<CommandView> command_view;
+  OpCode op_code = OpCode::NONE;
+  // When to give up waiting for the response, set once sent
+  std::chrono::steady_clock::time_point deadline;
 
   bool waiting_for_status_;
   ContextualOnceCallback<void(CommandStatusView)> on_status;
@@ -94,6 +103,10 @@ class CommandQueueEntry {
 struct HciLayer::impl {
   impl(hal::HciHal* hal, HciLayer& module) : hal_(hal), module_(module) {
     hci_timeout_alarm_ = new Alarm(module.GetHandler());
+    serial_commands_ = os::GetSystemProperty(HciLayer::kSerialCommandsProperty) == "true";
+    if (serial_commands_) {
+      LOG_INFO("Only one HCI command is sent at a time");
+    }
   }
 
   ~impl() {
@@ -106,6 +119,7 @@ struct HciLayer::impl {
       delete hci_abort_alarm_;
     }
     command_queue_.clear();
+    sent_commands_.clear();
   }
 
   void drop(EventView event) {
@@ -114,10 +128,7 @@ struct HciLayer::impl {
 
   void on_outbound_acl_ready() {
     auto packet = acl_queue_.GetDownEnd()->TryDequeue();
-    std::vector<uint8_t> bytes;
-    BitInserter bi(bytes);
-    packet->Serialize(bi);
-    hal_->sendAclData(bytes);
+    hal_->sendAclPacket(std::move(packet));
   }
 
   void on_outbound_iso_ready() {
@@ -165,32 +176,53 @@ struct HciLayer::impl {
     }
     bool is_status = logging_id == "status";
 
-    ASSERT_LOG(!command_queue_.empty(), "Unexpected %s event with OpCode 0x%02hx (%s)", logging_id.c_str(), op_code,
-               OpCodeText(op_code).c_str());
-    ASSERT_LOG(waiting_command_ == op_code, "Waiting for 0x%02hx (%s), got 0x%02hx (%s)", waiting_command_,
-               OpCodeText(waiting_command_).c_str(), op_code, OpCodeText(op_code).c_str());
-    ASSERT_LOG(command_queue_.front().waiting_for_status_ == is_status, "0x%02hx (%s) was not expecting %s event",
-               op_code, OpCodeText(op_code).c_str(), logging_id.c_str());
+    auto sent_command = find_sent_command(op_code);
+    ASSERT_LOG(sent_command != sent_commands_.end(), "Unexpected %s event with OpCode 0x%02hx (%s)",
+               logging_id.c_str(), op_code, OpCodeText(op_code).c_str());
+    ASSERT_LOG(sent_command->waiting_for_status_ == is_status, "0x%02hx (%s) was not expecting %s event", op_code,
+               OpCodeText(op_code).c_str(), logging_id.c_str());
 
-    command_queue_.front().GetCallback<TResponse>()->Invoke(move(response_view));
-    command_queue_.pop_front();
-    waiting_command_ = OpCode::NONE;
+    sent_command->GetCallback<TResponse>()->Invoke(move(response_view));
+    sent_commands_.erase(sent_command);
     if (hci_timeout_alarm_ != nullptr) {
-      hci_timeout_alarm_->Cancel();
+      schedule_hci_timeout();
       send_next_command();
     }
   }
 
+  // Return the oldest sent command with |op_code|, as the controller responds to commands with the same OpCode in the
+  // order they were sent
+  std::list<CommandQueueEntry>::iterator find_sent_command(OpCode op_code) {
+    return std::find_if(sent_commands_.begin(), sent_commands_.end(), [op_code](const CommandQueueEntry& command) {
+      return command.op_code == op_code;
+    });
+  }
+
+  // Time out waiting for the response to the oldest sent command
+  void schedule_hci_timeout() {
+    if (sent_commands_.empty()) {
+      hci_timeout_alarm_->Cancel();
+      return;
+    }
+    const CommandQueueEntry& oldest_command = sent_commands_.front();
+    auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(
+        oldest_command.deadline - std::chrono::steady_clock::now());
+    // A zero delay would disarm the alarm
+    hci_timeout_alarm_->Schedule(
+        BindOnce(&impl::on_hci_timeout, common::Unretained(this), oldest_command.op_code),
+        std::max(delay, std::chrono::milliseconds(1)));
+  }
+
   void on_hci_timeout(OpCode op_code) {
     common::StopWatch::DumpStopWatchLog();
     LOG_ERROR("Timed out waiting for 0x%02hx (%s)", op_code, OpCodeText(op_code).c_str());
     // TODO: LogMetricHciTimeoutEvent(static_cast<uint32_t>(op_code));
 
-    LOG_ERROR("Flushing %zd waiting commands", command_queue_.size());
+    LOG_ERROR("Flushing %zd waiting commands", command_queue_.size() + sent_commands_.size());
     // Clear any waiting commands (there is an abort coming anyway)
     command_queue_.clear();
+    sent_commands_.clear();
     command_credits_ = 1;
-    waiting_command_ = OpCode::NONE;
     enqueue_command(
         ControllerDebugInfoBuilder::Create(), module_.GetHandler()->BindOnce(&fail_if_reset_complete_not_success));
     // Don't time out for this one;
@@ -208,32 +240,35 @@ struct HciLayer::impl {
   }
 
   void send_next_command() {
-    if (command_credits_ == 0) {
-      return;
-    }
-    if (waiting_command_ != OpCode::NONE) {
-      return;
-    }
-    if (command_queue_.size() == 0) {
-      return;
-    }
-    std::shared_ptr<std::vector<uint8_t>> bytes = std::make_shared<std::vector<uint8_t>>();
-    BitInserter bi(*bytes);
-    command_queue_.front().command->Serialize(bi);
-    hal_->sendHciCommand(*bytes);
-
-    auto cmd_view = CommandView::Create(PacketView<kLittleEndian>(bytes));
-    ASSERT(cmd_view.IsValid());
-    OpCode op_code = cmd_view.GetOpCode();
-    command_queue_.front().command_view = std::make_unique<CommandView>(std::move(cmd_view));
-    log_link_layer_connection_command_status(command_queue_.front().command_view, ErrorCode::STATUS_UNKNOWN);
-    log_classic_pairing_command_status(command_queue_.front().command_view, ErrorCode::STATUS_UNKNOWN);
-    waiting_command_ = op_code;
-    command_credits_ = 0;  // Only allow one outstanding command
-    if (hci_timeout_alarm_ != nullptr) {
-      hci_timeout_alarm_->Schedule(BindOnce(&impl::on_hci_timeout, common::Unretained(this), op_code), kHciTimeoutMs);
-    } else {
-      LOG_WARN("%s sent without an hci-timeout timer", OpCodeText(op_code).c_str());
+    while (command_credits_ > 0 && !command_queue_.empty()) {
+      CommandQueueEntry& command = command_queue_.front();
+      if (command.bytes == nullptr) {
+        command.bytes = std::make_shared<std::vector<uint8_t>>();
+        BitInserter bi(*command.bytes);
+        command.command->Serialize(bi);
+        auto cmd_view = CommandView::Create(PacketView<kLittleEndian>(command.bytes));
+        ASSERT(cmd_view.IsValid());
+        command.op_code = cmd_view.GetOpCode();
+        command.command_view = std::make_unique<CommandView>(std::move(cmd_view));
+      }
+      // A reset drops the other commands the controller is working on, so it is never sent alongside them
+      if (!sent_commands_.empty() && (serial_commands_ || command.op_code == OpCode::RESET ||
+                                      sent_commands_.front().op_code == OpCode::RESET)) {
+        return;
+      }
+      hal_->sendHciCommand(*command.bytes);
+
+      log_link_layer_connection_command_status(command.command_view, ErrorCode::STATUS_UNKNOWN);
+      log_classic_pairing_command_status(command.command_view, ErrorCode::STATUS_UNKNOWN);
+      command.deadline = std::chrono::steady_clock::now() + HciLayer::kHciTimeoutMs;
+      command_credits_--;
+      OpCode op_code = command.op_code;
+      sent_commands_.splice(sent_commands_.end(), command_queue_, command_queue_.begin());
+      if (hci_timeout_alarm_ == nullptr) {
+        LOG_WARN("%s sent without an hci-timeout timer", OpCodeText(op_code).c_str());
+      } else if (sent_commands_.size() == 1) {
+        schedule_hci_timeout();
+      }
     }
   }
 
@@ -299,7 +334,7 @@ struct HciLayer::impl {
 
   void on_hci_event(EventView event) {
     ASSERT(event.IsValid());
-    log_hci_event(command_queue_.front().command_view, event, module_.GetDependency<storage::StorageModule>());
+    log_hci_event(get_command_view(event), event, module_.GetDependency<storage::StorageModule>());
     EventCode event_code = event.GetEventCode();
     // Root Inflamation is a special case, since it aborts here
     if (event_code == EventCode::VENDOR_SPECIFIC) {
@@ -321,6 +356,27 @@ struct HciLayer::impl {
     event_handlers_[event_code].Invoke(event);
   }
 
+  // Return the command |event| responds to, if any, for metrics logging
+  std::unique_ptr<CommandView>& get_command_view(EventView event) {
+    OpCode op_code = OpCode::NONE;
+    if (event.GetEventCode() == EventCode::COMMAND_COMPLETE) {
+      auto complete_view = CommandCompleteView::Create(event);
+      if (complete_view.IsValid()) {
+        op_code = complete_view.GetCommandOpCode();
+      }
+    } else if (event.GetEventCode() == EventCode::COMMAND_STATUS) {
+      auto status_view = CommandStatusView::Create(event);
+      if (status_view.IsValid()) {
+        op_code = status_view.GetCommandOpCode();
+      }
+    }
+    auto sent_command = find_sent_command(op_code);
+    if (op_code == OpCode::NONE || sent_command == sent_commands_.end()) {
+      return no_command_view_;
+    }
+    return sent_command->command_view;
+  }
+
   void on_le_meta_event(EventView event) {
     LeMetaEventView meta_event_view = LeMetaEventView::Create(event);
     ASSERT(meta_event_view.IsValid());
@@ -336,12 +392,18 @@ struct HciLayer::impl {
   HciLayer& module_;
 
   // Command Handling
+  // Commands waiting for a command credit, in the order they were enqueued
   std::list<CommandQueueEntry> command_queue_;
+  // Commands sent to the controller and waiting for their response, oldest first
+  std::list<CommandQueueEntry> sent_commands_;
+  std::unique_ptr<CommandView> no_command_view_;
 
   std::map<EventCode, ContextualCallback<void(EventView)>> event_handlers_;
   std::map<SubeventCode, ContextualCallback<void(LeMetaEventView)>> subevent_handlers_;
-  OpCode waiting_command_{OpCode::NONE};
+  // Number of commands the controller can take, as of its last Command Complete or Command Status event
   uint8_t command_credits_{1};  // Send reset first
+  // Only allow one outstanding command, whatever the credits
+  bool serial_commands_{false};
   Alarm* hci_timeout_alarm_{nullptr};
   Alarm* hci_abort_alarm_{nullptr};
 
@@ -383,6 +445,8 @@ struct HciLayer::hal_callbacks : public hal::HciHalCallbacks {
   HciLayer& module_;
 };
 
+const std::string HciLayer::kSerialCommandsProperty = "persist.bluetooth.serialhcicommands";
+
 HciLayer::HciLayer() : impl_(nullptr), hal_callbacks_(nullptr) {}
 
 HciLayer::~HciLayer() {
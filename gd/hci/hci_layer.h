@@ -18,6 +18,7 @@
 
 #include <chrono>
 #include <map>
+#include <string>
 
 #include "address.h"
 #include "class_of_device.h"
@@ -96,6 +97,9 @@ class HciLayer : public Module, public CommandInterface<CommandBuilder> {
 
   static constexpr std::chrono::milliseconds kHciTimeoutMs = std::chrono::milliseconds(2000);
   static constexpr std::chrono::milliseconds kHciTimeoutRestartMs = std::chrono::milliseconds(5000);
+  // Set to "true" for controllers that cannot take a command before they responded to the previous one, no matter how
+  // many Num_HCI_Command_Packets they advertise
+  static const std::string kSerialCommandsProperty;
 
   static const ModuleFactory Factory;
 
@@ -24,6 +24,7 @@
 #include "hci/hci_packets.h"
 #include "module.h"
 #include "os/log.h"
+#include "os/system_properties.h"
 #include "os/thread.h"
 #include "packet/bit_inserter.h"
 #include "packet/raw_builder.h"
@@ -621,6 +622,96 @@ TEST_F(HciTest, creditsTest) {
       ReadLocalSupportedFeaturesCompleteView::Create(CommandCompleteView::Create(EventView::Create(event))).IsValid());
 }
 
+TEST_F(HciTest, pipelinedCommandsTest) {
+  ASSERT_EQ(0, hal->GetNumSentCommands());
+
+  // Let the controller take three commands
+  uint8_t num_packets = 3;
+  hal->callbacks->hciEventReceived(GetPacketBytes(NoCommandCompleteBuilder::Create(num_packets)));
+  fake_registry_.SynchronizeModuleHandler(&HciLayer::Factory, kTimeout);
+
+  upper->SendHciCommandExpectingComplete(ReadLocalVersionInformationBuilder::Create());
+  upper->SendHciCommandExpectingComplete(ReadLocalSupportedCommandsBuilder::Create());
+  upper->SendHciCommandExpectingComplete(ReadLocalSupportedFeaturesBuilder::Create());
+  fake_registry_.SynchronizeModuleHandler(&HciLayer::Factory, kTimeout);
+
+  // Verify that all three were sent without waiting for a response, in order
+  ASSERT_EQ(3, hal->GetNumSentCommands());
+  ASSERT_TRUE(ReadLocalVersionInformationView::Create(hal->GetSentCommand()).IsValid());
+  ASSERT_TRUE(ReadLocalSupportedCommandsView::Create(hal->GetSentCommand()).IsValid());
+  ASSERT_TRUE(ReadLocalSupportedFeaturesView::Create(hal->GetSentCommand()).IsValid());
+
+  // The controller may respond out of order
+  ErrorCode error_code = ErrorCode::SUCCESS;
+  auto event_future = upper->GetReceivedEventFuture();
+  uint64_t lmp_features = 0x012345678abcdef;
+  hal->callbacks->hciEventReceived(
+      GetPacketBytes(ReadLocalSupportedFeaturesCompleteBuilder::Create(num_packets, error_code, lmp_features)));
+  ASSERT_EQ(event_future.wait_for(kTimeout), std::future_status::ready);
+  auto event = upper->GetReceivedEvent();
+  ASSERT_TRUE(
+      ReadLocalSupportedFeaturesCompleteView::Create(CommandCompleteView::Create(EventView::Create(event))).IsValid());
+
+  event_future = upper->GetReceivedEventFuture();
+  LocalVersionInformation local_version_information;
+  local_version_information.hci_version_ = HciVersion::V_5_0;
+  local_version_information.hci_revision_ = 0x1234;
+  local_version_information.lmp_version_ = LmpVersion::V_4_2;
+  local_version_information.manufacturer_name_ = 0xBAD;
+  local_version_information.lmp_subversion_ = 0x5678;
+  hal->callbacks->hciEventReceived(GetPacketBytes(
+      ReadLocalVersionInformationCompleteBuilder::Create(num_packets, error_code, local_version_information)));
+  ASSERT_EQ(event_future.wait_for(kTimeout), std::future_status::ready);
+  event = upper->GetReceivedEvent();
+  ASSERT_TRUE(
+      ReadLocalVersionInformationCompleteView::Create(CommandCompleteView::Create(EventView::Create(event))).IsValid());
+
+  event_future = upper->GetReceivedEventFuture();
+  std::array<uint8_t, 64> supported_commands{};
+  hal->callbacks->hciEventReceived(
+      GetPacketBytes(ReadLocalSupportedCommandsCompleteBuilder::Create(num_packets, error_code, supported_commands)));
+  ASSERT_EQ(event_future.wait_for(kTimeout), std::future_status::ready);
+  event = upper->GetReceivedEvent();
+  ASSERT_TRUE(
+      ReadLocalSupportedCommandsCompleteView::Create(CommandCompleteView::Create(EventView::Create(event))).IsValid());
+}
+
+TEST_F(HciTest, resetIsNotPipelined) {
+  uint8_t num_packets = 3;
+  hal->callbacks->hciEventReceived(GetPacketBytes(NoCommandCompleteBuilder::Create(num_packets)));
+  fake_registry_.SynchronizeModuleHandler(&HciLayer::Factory, kTimeout);
+
+  upper->SendHciCommandExpectingComplete(ReadLocalVersionInformationBuilder::Create());
+  upper->SendHciCommandExpectingComplete(ResetBuilder::Create());
+  upper->SendHciCommandExpectingComplete(ReadLocalSupportedFeaturesBuilder::Create());
+  fake_registry_.SynchronizeModuleHandler(&HciLayer::Factory, kTimeout);
+
+  // The reset waits for the first command to complete
+  ASSERT_EQ(1, hal->GetNumSentCommands());
+  ASSERT_TRUE(ReadLocalVersionInformationView::Create(hal->GetSentCommand()).IsValid());
+
+  auto event_future = upper->GetReceivedEventFuture();
+  LocalVersionInformation local_version_information;
+  hal->callbacks->hciEventReceived(GetPacketBytes(ReadLocalVersionInformationCompleteBuilder::Create(
+      num_packets, ErrorCode::SUCCESS, local_version_information)));
+  ASSERT_EQ(event_future.wait_for(kTimeout), std::future_status::ready);
+  upper->GetReceivedEvent();
+  fake_registry_.SynchronizeModuleHandler(&HciLayer::Factory, kTimeout);
+
+  // Nothing follows the reset before it completes
+  ASSERT_EQ(1, hal->GetNumSentCommands());
+  ASSERT_TRUE(ResetView::Create(hal->GetSentCommand()).IsValid());
+
+  event_future = upper->GetReceivedEventFuture();
+  hal->callbacks->hciEventReceived(GetPacketBytes(ResetCompleteBuilder::Create(num_packets, ErrorCode::SUCCESS)));
+  ASSERT_EQ(event_future.wait_for(kTimeout), std::future_status::ready);
+  upper->GetReceivedEvent();
+  fake_registry_.SynchronizeModuleHandler(&HciLayer::Factory, kTimeout);
+
+  ASSERT_EQ(1, hal->GetNumSentCommands());
+  ASSERT_TRUE(ReadLocalSupportedFeaturesView::Create(hal->GetSentCommand()).IsValid());
+}
+
 TEST_F(HciTest, leSecurityInterfaceTest) {
   // Send LeRand to the controller
   auto command_future = hal->GetSentCommandFuture();
@@ -904,5 +995,41 @@ TEST_F(HciTest, receiveMultipleIsoPackets) {
   ASSERT_EQ(handle, itr.extract<uint16_t>());
   ASSERT_EQ(received_packets, itr.extract<uint16_t>());
 }
+
+class HciSerialCommandsTest : public HciTest {
+ public:
+  void SetUp() override {
+    os::SetSystemProperty(HciLayer::kSerialCommandsProperty, "true");
+    HciTest::SetUp();
+  }
+
+  void TearDown() override {
+    HciTest::TearDown();
+    os::SetSystemProperty(HciLayer::kSerialCommandsProperty, "false");
+  }
+};
+
+TEST_F(HciSerialCommandsTest, oneCommandAtATime) {
+  uint8_t num_packets = 3;
+  hal->callbacks->hciEventReceived(GetPacketBytes(NoCommandCompleteBuilder::Create(num_packets)));
+  fake_registry_.SynchronizeModuleHandler(&HciLayer::Factory, kTimeout);
+
+  upper->SendHciCommandExpectingComplete(ReadLocalVersionInformationBuilder::Create());
+  upper->SendHciCommandExpectingComplete(ReadLocalSupportedFeaturesBuilder::Create());
+  fake_registry_.SynchronizeModuleHandler(&HciLayer::Factory, kTimeout);
+
+  // Verify that only one was sent, whatever the credits
+  ASSERT_EQ(1, hal->GetNumSentCommands());
+  ASSERT_TRUE(ReadLocalVersionInformationView::Create(hal->GetSentCommand()).IsValid());
+
+  auto command_future = hal->GetSentCommandFuture();
+  LocalVersionInformation local_version_information;
+  hal->callbacks->hciEventReceived(GetPacketBytes(ReadLocalVersionInformationCompleteBuilder::Create(
+      num_packets, ErrorCode::SUCCESS, local_version_information)));
+  ASSERT_EQ(command_future.wait_for(kTimeout), std::future_status::ready);
+  ASSERT_EQ(1, hal->GetNumSentCommands());
+  ASSERT_TRUE(ReadLocalSupportedFeaturesView::Create(hal->GetSentCommand()).IsValid());
+}
+
 }  // namespace hci
 }  // namespace bluetooth
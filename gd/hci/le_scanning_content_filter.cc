@@ -0,0 +1,472 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hci/le_scanning_content_filter.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "os/log.h"
+
+namespace bluetooth {
+namespace hci {
+
+namespace {
+
+constexpr size_t Feature(ApcfFilterType filter_type) {
+  return static_cast<size_t>(filter_type);
+}
+
+uint64_t AddressKey(const Address& address, ApcfApplicationAddressType address_type) {
+  uint64_t key = 0;
+  for (size_t i = 0; i < Address::kLength; i++) {
+    key |= static_cast<uint64_t>(address.address[i]) << (8 * i);
+  }
+  return key | static_cast<uint64_t>(address_type) << 48;
+}
+
+// FNV-1a
+uint64_t HashName(const uint8_t* name, size_t length) {
+  uint64_t hash = 0xcbf29ce484222325;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= name[i];
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
+
+uint16_t ToUint16(const uint8_t* data) {
+  return data[0] | (data[1] << 8);
+}
+
+// The mask of |uuid| over its 128 bits representation, from |uuid_mask| given in the shortest representation of |uuid|
+Uuid::UUID128Bit ExpandUuidMask(const Uuid& uuid, const Uuid& uuid_mask) {
+  Uuid::UUID128Bit mask;
+  mask.fill(0xFF);
+  switch (uuid.GetShortestRepresentationSize()) {
+    case Uuid::kNumBytes16: {
+      uint16_t mask16 = uuid_mask.As16Bit();
+      mask[2] = mask16 >> 8;
+      mask[3] = mask16;
+    } break;
+    case Uuid::kNumBytes32: {
+      uint32_t mask32 = uuid_mask.As32Bit();
+      mask[0] = mask32 >> 24;
+      mask[1] = mask32 >> 16;
+      mask[2] = mask32 >> 8;
+      mask[3] = mask32;
+    } break;
+    default:
+      mask = uuid_mask.To128BitBE();
+      break;
+  }
+  return mask;
+}
+
+}  // namespace
+
+bool LeScanningContentFilter::Pattern::Matches(const uint8_t* field, size_t length) const {
+  if (data.size() > length) {
+    return false;
+  }
+  for (size_t i = 0; i < data.size(); i++) {
+    if ((field[i] & mask[i]) != (data[i] & mask[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t LeScanningContentFilter::UuidHash::operator()(const Uuid& uuid) const {
+  uint64_t high;
+  uint64_t low;
+  std::memcpy(&high, uuid.To128BitBE().data(), sizeof(high));
+  std::memcpy(&low, uuid.To128BitBE().data() + sizeof(high), sizeof(low));
+  // 16 and 32 bits UUIDs only differ in their first bytes, the rest is the base UUID
+  return (high * 0x9e3779b97f4a7c15) ^ low;
+}
+
+uint8_t LeScanningContentFilter::SetParameters(
+    ApcfAction action, uint8_t filter_index, const AdvertisingFilterParameter& parameter) {
+  switch (action) {
+    case ApcfAction::ADD: {
+      uint16_t feature_selection = parameter.feature_selection;
+      if (feature_selection & (1 << Feature(ApcfFilterType::SERVICE_DATA_CHANGE))) {
+        LOG_WARN("Service data change filter is not supported, ignored for filter %hhu", filter_index);
+        feature_selection &= ~(1 << Feature(ApcfFilterType::SERVICE_DATA_CHANGE));
+      }
+      parameters_[filter_index] = {
+          feature_selection, parameter.list_logic_type, static_cast<int8_t>(parameter.rssi_high_thresh)};
+      update_feature_sets(filter_index);
+    } break;
+    case ApcfAction::DELETE:
+      parameters_.erase(filter_index);
+      update_feature_sets(filter_index);
+      remove_entries(filter_index);
+      break;
+    case ApcfAction::CLEAR:
+      *this = LeScanningContentFilter();
+      break;
+    default:
+      LOG_ERROR("Unknown action type: %d", (uint16_t)action);
+      break;
+  }
+  return std::min<size_t>(kMaxFilters - parameters_.size(), UINT8_MAX);
+}
+
+bool LeScanningContentFilter::AddEntry(uint8_t filter_index, const AdvertisingPacketContentFilterCommand& command) {
+  size_t feature = Feature(command.filter_type);
+  if (feature >= kNumFeatures || command.filter_type == ApcfFilterType::SERVICE_DATA_CHANGE) {
+    LOG_ERROR("Unsupported filter type: %d", (uint16_t)command.filter_type);
+    return false;
+  }
+  if (num_entries_[feature] == kMaxEntriesPerFeature) {
+    LOG_WARN("No space left for filter type %d", (uint16_t)command.filter_type);
+    return false;
+  }
+  if (!command.data_mask.empty() && command.data_mask.size() != command.data.size()) {
+    LOG_ERROR("data and data_mask are of different size");
+    return false;
+  }
+  std::vector<uint8_t> data_mask = command.data_mask;
+  if (data_mask.empty()) {
+    data_mask.resize(command.data.size(), 0xFF);
+  }
+
+  switch (command.filter_type) {
+    case ApcfFilterType::BROADCASTER_ADDRESS: {
+      auto& filters = addresses_[AddressKey(command.address, command.application_address_type)];
+      if (filters[filter_index]) {
+        return true;
+      }
+      filters.set(filter_index);
+    } break;
+    case ApcfFilterType::SERVICE_UUID:
+    case ApcfFilterType::SERVICE_SOLICITATION_UUID: {
+      bool is_service = command.filter_type == ApcfFilterType::SERVICE_UUID;
+      if (command.uuid_mask.IsEmpty()) {
+        auto& filters = is_service ? service_uuids_[command.uuid] : solicitation_uuids_[command.uuid];
+        if (filters[filter_index]) {
+          return true;
+        }
+        filters.set(filter_index);
+      } else {
+        auto& masked_uuids = is_service ? masked_service_uuids_ : masked_solicitation_uuids_;
+        masked_uuids.push_back(
+            {filter_index, command.uuid.To128BitBE(), ExpandUuidMask(command.uuid, command.uuid_mask)});
+      }
+    } break;
+    case ApcfFilterType::LOCAL_NAME: {
+      if (command.name.empty()) {
+        LOG_ERROR("Empty local name");
+        return false;
+      }
+      local_names_[HashName(command.name.data(), command.name.size())].push_back({filter_index, command.name});
+    } break;
+    case ApcfFilterType::MANUFACTURER_DATA: {
+      Pattern pattern{filter_index, command.data, data_mask};
+      // A mask of 0 is the default, for the whole company identifier
+      if (command.company_mask == 0 || command.company_mask == 0xFFFF) {
+        manufacturer_data_[command.company].push_back(std::move(pattern));
+      } else {
+        masked_manufacturer_data_.push_back({command.company_mask, command.company, std::move(pattern)});
+      }
+    } break;
+    case ApcfFilterType::SERVICE_DATA: {
+      Pattern pattern{filter_index, command.data, data_mask};
+      if (pattern.data.size() >= 2 && pattern.mask[0] == 0xFF && pattern.mask[1] == 0xFF) {
+        service_data_[ToUint16(pattern.data.data())].push_back(std::move(pattern));
+      } else {
+        unkeyed_service_data_.push_back(std::move(pattern));
+      }
+    } break;
+    default:
+      break;
+  }
+  num_entries_[feature]++;
+  return true;
+}
+
+uint8_t LeScanningContentFilter::GetAvailableSpaces(ApcfFilterType filter_type) const {
+  size_t feature = Feature(filter_type);
+  if (feature >= kNumFeatures) {
+    return 0;
+  }
+  return kMaxEntriesPerFeature - num_entries_[feature];
+}
+
+bool LeScanningContentFilter::Matches(
+    uint8_t address_type, const Address& address, int8_t rssi, const uint8_t* data, size_t length) const {
+  if (enabled_filters_.none()) {
+    return false;
+  }
+
+  FeatureSets matches;
+  if (address_type != static_cast<uint8_t>(DirectAdvertisingAddressType::NO_ADDRESS) && !addresses_.empty()) {
+    // Random device and random identity addresses have the lowest bit set
+    auto application_address_type =
+        (address_type & 0x01) ? ApcfApplicationAddressType::RANDOM : ApcfApplicationAddressType::PUBLIC;
+    for (auto type : {application_address_type, ApcfApplicationAddressType::NOT_APPLICABLE}) {
+      auto filters = addresses_.find(AddressKey(address, type));
+      if (filters != addresses_.end()) {
+        matches[Feature(ApcfFilterType::BROADCASTER_ADDRESS)] |= filters->second;
+      }
+    }
+  }
+  match_fields(data, length, &matches);
+
+  FilterSet result = enabled_filters_;
+  FilterSet or_matches;
+  for (size_t feature = 0; feature < kNumFeatures; feature++) {
+    result &= matches[feature] | ~and_features_[feature];
+    or_matches |= matches[feature] & or_features_[feature];
+  }
+  result &= or_matches | ~with_or_features_;
+
+  FilterSet below_threshold = result & with_rssi_threshold_;
+  if (below_threshold.any()) {
+    for (const auto& [filter_index, parameter] : parameters_) {
+      if (below_threshold[filter_index] && rssi < parameter.rssi_high_thresh) {
+        result.reset(filter_index);
+      }
+    }
+  }
+  return result.any();
+}
+
+void LeScanningContentFilter::update_feature_sets(uint8_t filter_index) {
+  enabled_filters_.reset(filter_index);
+  with_or_features_.reset(filter_index);
+  with_rssi_threshold_.reset(filter_index);
+  for (size_t feature = 0; feature < kNumFeatures; feature++) {
+    and_features_[feature].reset(filter_index);
+    or_features_[feature].reset(filter_index);
+  }
+
+  auto parameter = parameters_.find(filter_index);
+  if (parameter == parameters_.end()) {
+    return;
+  }
+  enabled_filters_.set(filter_index);
+  for (size_t feature = 0; feature < kNumFeatures; feature++) {
+    if (!(parameter->second.feature_selection & (1 << feature))) {
+      continue;
+    }
+    if (parameter->second.list_logic_type & (1 << feature)) {
+      and_features_[feature].set(filter_index);
+    } else {
+      or_features_[feature].set(filter_index);
+      with_or_features_.set(filter_index);
+    }
+  }
+  // The lowest threshold lets every report through
+  if (parameter->second.rssi_high_thresh != INT8_MIN) {
+    with_rssi_threshold_.set(filter_index);
+  }
+}
+
+void LeScanningContentFilter::remove_entries(uint8_t filter_index) {
+  auto remove_from_sets = [filter_index](auto& sets, size_t& num_entries) {
+    for (auto it = sets.begin(); it != sets.end();) {
+      if (it->second[filter_index]) {
+        it->second.reset(filter_index);
+        num_entries--;
+      }
+      it = it->second.none() ? sets.erase(it) : std::next(it);
+    }
+  };
+  auto remove_from_list = [filter_index](auto& list, size_t& num_entries) {
+    auto removed = std::remove_if(
+        list.begin(), list.end(), [filter_index](const auto& entry) { return entry.filter_index == filter_index; });
+    num_entries -= std::distance(removed, list.end());
+    list.erase(removed, list.end());
+  };
+  auto remove_from_lists = [&remove_from_list](auto& lists, size_t& num_entries) {
+    for (auto it = lists.begin(); it != lists.end();) {
+      remove_from_list(it->second, num_entries);
+      it = it->second.empty() ? lists.erase(it) : std::next(it);
+    }
+  };
+
+  remove_from_sets(addresses_, num_entries_[Feature(ApcfFilterType::BROADCASTER_ADDRESS)]);
+  remove_from_sets(service_uuids_, num_entries_[Feature(ApcfFilterType::SERVICE_UUID)]);
+  remove_from_list(masked_service_uuids_, num_entries_[Feature(ApcfFilterType::SERVICE_UUID)]);
+  remove_from_sets(solicitation_uuids_, num_entries_[Feature(ApcfFilterType::SERVICE_SOLICITATION_UUID)]);
+  remove_from_list(masked_solicitation_uuids_, num_entries_[Feature(ApcfFilterType::SERVICE_SOLICITATION_UUID)]);
+  remove_from_lists(local_names_, num_entries_[Feature(ApcfFilterType::LOCAL_NAME)]);
+  remove_from_lists(manufacturer_data_, num_entries_[Feature(ApcfFilterType::MANUFACTURER_DATA)]);
+  size_t num_masked_manufacturer_data = masked_manufacturer_data_.size();
+  masked_manufacturer_data_.erase(
+      std::remove_if(
+          masked_manufacturer_data_.begin(),
+          masked_manufacturer_data_.end(),
+          [filter_index](const ManufacturerData& entry) { return entry.pattern.filter_index == filter_index; }),
+      masked_manufacturer_data_.end());
+  num_entries_[Feature(ApcfFilterType::MANUFACTURER_DATA)] -=
+      num_masked_manufacturer_data - masked_manufacturer_data_.size();
+  remove_from_lists(service_data_, num_entries_[Feature(ApcfFilterType::SERVICE_DATA)]);
+  remove_from_list(unkeyed_service_data_, num_entries_[Feature(ApcfFilterType::SERVICE_DATA)]);
+}
+
+void LeScanningContentFilter::match_uuid(
+    const Uuid& uuid,
+    const std::unordered_map<Uuid, FilterSet, UuidHash>& uuids,
+    const std::vector<MaskedUuid>& masked_uuids,
+    FilterSet* matches) const {
+  auto filters = uuids.find(uuid);
+  if (filters != uuids.end()) {
+    *matches |= filters->second;
+  }
+  const auto& uuid_bytes = uuid.To128BitBE();
+  for (const auto& masked_uuid : masked_uuids) {
+    bool match = true;
+    for (size_t i = 0; i < Uuid::kNumBytes128 && match; i++) {
+      match = (uuid_bytes[i] & masked_uuid.mask[i]) == (masked_uuid.uuid[i] & masked_uuid.mask[i]);
+    }
+    if (match) {
+      matches->set(masked_uuid.filter_index);
+    }
+  }
+}
+
+void LeScanningContentFilter::match_fields(const uint8_t* data, size_t length, FeatureSets* matches) const {
+  auto& service_uuid_matches = (*matches)[Feature(ApcfFilterType::SERVICE_UUID)];
+  auto& solicitation_uuid_matches = (*matches)[Feature(ApcfFilterType::SERVICE_SOLICITATION_UUID)];
+  bool has_service_uuids = num_entries_[Feature(ApcfFilterType::SERVICE_UUID)] > 0;
+  bool has_solicitation_uuids = num_entries_[Feature(ApcfFilterType::SERVICE_SOLICITATION_UUID)] > 0;
+
+  size_t offset = 0;
+  while (offset < length) {
+    size_t field_length = data[offset];
+    // The rest is zero padding, or a field cut short
+    if (field_length == 0 || offset + 1 + field_length > length) {
+      break;
+    }
+    auto type = static_cast<GapDataType>(data[offset + 1]);
+    const uint8_t* field = data + offset + 2;
+    size_t size = field_length - 1;
+    offset += 1 + field_length;
+
+    switch (type) {
+      case GapDataType::INCOMPLETE_LIST_16_BIT_UUIDS:
+      case GapDataType::COMPLETE_LIST_16_BIT_UUIDS:
+      case GapDataType::LIST_16BIT_SERVICE_SOLICITATION_UUIDS: {
+        bool is_service = type != GapDataType::LIST_16BIT_SERVICE_SOLICITATION_UUIDS;
+        if (is_service ? !has_service_uuids : !has_solicitation_uuids) {
+          break;
+        }
+        for (size_t i = 0; i + Uuid::kNumBytes16 <= size; i += Uuid::kNumBytes16) {
+          auto uuid = Uuid::From16Bit(ToUint16(field + i));
+          if (is_service) {
+            match_uuid(uuid, service_uuids_, masked_service_uuids_, &service_uuid_matches);
+          } else {
+            match_uuid(uuid, solicitation_uuids_, masked_solicitation_uuids_, &solicitation_uuid_matches);
+          }
+        }
+      } break;
+      case GapDataType::INCOMPLETE_LIST_32_BIT_UUIDS:
+      case GapDataType::COMPLETE_LIST_32_BIT_UUIDS:
+      case GapDataType::LIST_32BIT_SERVICE_SOLICITATION_UUIDS: {
+        bool is_service = type != GapDataType::LIST_32BIT_SERVICE_SOLICITATION_UUIDS;
+        if (is_service ? !has_service_uuids : !has_solicitation_uuids) {
+          break;
+        }
+        for (size_t i = 0; i + Uuid::kNumBytes32 <= size; i += Uuid::kNumBytes32) {
+          auto uuid = Uuid::From32Bit(ToUint16(field + i) | (ToUint16(field + i + 2) << 16));
+          if (is_service) {
+            match_uuid(uuid, service_uuids_, masked_service_uuids_, &service_uuid_matches);
+          } else {
+            match_uuid(uuid, solicitation_uuids_, masked_solicitation_uuids_, &solicitation_uuid_matches);
+          }
+        }
+      } break;
+      case GapDataType::INCOMPLETE_LIST_128_BIT_UUIDS:
+      case GapDataType::COMPLETE_LIST_128_BIT_UUIDS:
+      case GapDataType::LIST_128BIT_SERVICE_SOLICITATION_UUIDS: {
+        bool is_service = type != GapDataType::LIST_128BIT_SERVICE_SOLICITATION_UUIDS;
+        if (is_service ? !has_service_uuids : !has_solicitation_uuids) {
+          break;
+        }
+        for (size_t i = 0; i + Uuid::kNumBytes128 <= size; i += Uuid::kNumBytes128) {
+          auto uuid = Uuid::From128BitLE(field + i);
+          if (is_service) {
+            match_uuid(uuid, service_uuids_, masked_service_uuids_, &service_uuid_matches);
+          } else {
+            match_uuid(uuid, solicitation_uuids_, masked_solicitation_uuids_, &solicitation_uuid_matches);
+          }
+        }
+      } break;
+      case GapDataType::SHORTENED_LOCAL_NAME:
+      case GapDataType::COMPLETE_LOCAL_NAME: {
+        auto names = local_names_.find(HashName(field, size));
+        if (names == local_names_.end()) {
+          break;
+        }
+        for (const auto& local_name : names->second) {
+          if (local_name.name.size() == size && std::equal(local_name.name.begin(), local_name.name.end(), field)) {
+            (*matches)[Feature(ApcfFilterType::LOCAL_NAME)].set(local_name.filter_index);
+          }
+        }
+      } break;
+      case GapDataType::MANUFACTURER_SPECIFIC_DATA: {
+        if (size < 2) {
+          break;
+        }
+        auto& manufacturer_data_matches = (*matches)[Feature(ApcfFilterType::MANUFACTURER_DATA)];
+        uint16_t company = ToUint16(field);
+        auto patterns = manufacturer_data_.find(company);
+        if (patterns != manufacturer_data_.end()) {
+          for (const auto& pattern : patterns->second) {
+            if (pattern.Matches(field + 2, size - 2)) {
+              manufacturer_data_matches.set(pattern.filter_index);
+            }
+          }
+        }
+        for (const auto& entry : masked_manufacturer_data_) {
+          if ((company & entry.company_mask) == (entry.company & entry.company_mask) &&
+              entry.pattern.Matches(field + 2, size - 2)) {
+            manufacturer_data_matches.set(entry.pattern.filter_index);
+          }
+        }
+      } break;
+      case GapDataType::SERVICE_DATA_16_BIT_UUIDS:
+      case GapDataType::SERVICE_DATA_32_BIT_UUIDS:
+      case GapDataType::SERVICE_DATA_128_BIT_UUIDS: {
+        auto& service_data_matches = (*matches)[Feature(ApcfFilterType::SERVICE_DATA)];
+        if (size >= 2) {
+          auto patterns = service_data_.find(ToUint16(field));
+          if (patterns != service_data_.end()) {
+            for (const auto& pattern : patterns->second) {
+              if (pattern.Matches(field, size)) {
+                service_data_matches.set(pattern.filter_index);
+              }
+            }
+          }
+        }
+        for (const auto& pattern : unkeyed_service_data_) {
+          if (pattern.Matches(field, size)) {
+            service_data_matches.set(pattern.filter_index);
+          }
+        }
+      } break;
+      default:
+        break;
+    }
+  }
+}
+
+}  // namespace hci
+}  // namespace bluetooth
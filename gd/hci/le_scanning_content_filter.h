@@ -0,0 +1,148 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "hci/address.h"
+#include "hci/hci_packets.h"
+#include "hci/le_scanning_manager.h"
+#include "hci/uuid.h"
+
+namespace bluetooth {
+namespace hci {
+
+// Host implementation of the advertising packet content filters (APCF), for controllers without LE_ADV_FILTER.
+//
+// Filters are configured as with the controller: the parameters of a filter index select the features it checks, and
+// each feature holds a list of entries, any of which matches the feature. A filter matches a report when all its
+// features with an AND list logic match, and at least one of its features with an OR list logic matches, if it has
+// any. The filter logic type is not used, entries of a feature always combine with OR.
+//
+// The entries of all the filters are compiled into lookup tables, keyed on the address, the UUID, the local name, the
+// company identifier or the service data UUID, with a linear scan left only for the masked entries that cannot be
+// keyed. A report is parsed once, each of its fields looked up once, and the matches of all the filters are combined as
+// bitsets, so the cost of a report does not grow with the number of filters.
+//
+// Reports are delivered as they come, the on found and batched delivery modes are handled as immediate. The service
+// data change feature is not supported.
+//
+// NOT THREAD SAFE
+class LeScanningContentFilter {
+ public:
+  // Filter indices are 8 bits
+  static constexpr size_t kMaxFilters = 256;
+  // Entries of each feature, across all the filters
+  static constexpr size_t kMaxEntriesPerFeature = 255;
+
+  // Add, delete or clear the parameters of filter |filter_index|. Deleting a filter, or clearing all of them, also
+  // drops their entries. Return the number of filters that can still be added.
+  uint8_t SetParameters(ApcfAction action, uint8_t filter_index, const AdvertisingFilterParameter& parameter);
+
+  // Add an entry to filter |filter_index|. Return false if the command is invalid or the feature is full
+  bool AddEntry(uint8_t filter_index, const AdvertisingPacketContentFilterCommand& command);
+
+  // Number of entries that can still be added to |filter_type|
+  uint8_t GetAvailableSpaces(ApcfFilterType filter_type) const;
+
+  // Return true if the report matches at least one filter
+  bool Matches(uint8_t address_type, const Address& address, int8_t rssi, const uint8_t* data, size_t length) const;
+
+ private:
+  using FilterSet = std::bitset<kMaxFilters>;
+  // Features, by bit of the feature selection, which is also their ApcfFilterType
+  static constexpr size_t kNumFeatures = 7;
+  using FeatureSets = std::array<FilterSet, kNumFeatures>;
+
+  // Byte pattern compared to the start of an advertising data field, under a mask
+  struct Pattern {
+    uint8_t filter_index;
+    std::vector<uint8_t> data;
+    std::vector<uint8_t> mask;
+
+    bool Matches(const uint8_t* field, size_t length) const;
+  };
+
+  struct MaskedUuid {
+    uint8_t filter_index;
+    Uuid::UUID128Bit uuid;
+    Uuid::UUID128Bit mask;
+  };
+
+  struct LocalName {
+    uint8_t filter_index;
+    std::vector<uint8_t> name;
+  };
+
+  struct ManufacturerData {
+    uint16_t company_mask;
+    uint16_t company;
+    Pattern pattern;
+  };
+
+  struct UuidHash {
+    size_t operator()(const Uuid& uuid) const;
+  };
+
+  struct Parameter {
+    uint16_t feature_selection;
+    uint16_t list_logic_type;
+    int8_t rssi_high_thresh;
+  };
+
+  std::unordered_map<uint8_t, Parameter> parameters_;
+  // Filters that have parameters
+  FilterSet enabled_filters_;
+  // Filters that select each feature, with an AND and with an OR list logic
+  FeatureSets and_features_;
+  FeatureSets or_features_;
+  // Filters that select at least one feature with an OR list logic
+  FilterSet with_or_features_;
+  // Filters with an RSSI threshold, checked on the matching filters only
+  FilterSet with_rssi_threshold_;
+
+  // Address with its ApcfApplicationAddressType in the high bits
+  std::unordered_map<uint64_t, FilterSet> addresses_;
+  std::unordered_map<Uuid, FilterSet, UuidHash> service_uuids_;
+  std::vector<MaskedUuid> masked_service_uuids_;
+  std::unordered_map<Uuid, FilterSet, UuidHash> solicitation_uuids_;
+  std::vector<MaskedUuid> masked_solicitation_uuids_;
+  // Keyed on the hash of the name, names with the same hash are all compared
+  std::unordered_map<uint64_t, std::vector<LocalName>> local_names_;
+  std::unordered_map<uint16_t, std::vector<Pattern>> manufacturer_data_;
+  std::vector<ManufacturerData> masked_manufacturer_data_;
+  // Keyed on the first two bytes of the pattern, the 16 least significant bits of the service UUID
+  std::unordered_map<uint16_t, std::vector<Pattern>> service_data_;
+  std::vector<Pattern> unkeyed_service_data_;
+  std::array<size_t, kNumFeatures> num_entries_{};
+
+  void update_feature_sets(uint8_t filter_index);
+  void remove_entries(uint8_t filter_index);
+  void match_uuid(
+      const Uuid& uuid,
+      const std::unordered_map<Uuid, FilterSet, UuidHash>& uuids,
+      const std::vector<MaskedUuid>& masked_uuids,
+      FilterSet* matches) const;
+  void match_fields(const uint8_t* data, size_t length, FeatureSets* matches) const;
+};
+
+}  // namespace hci
+}  // namespace bluetooth
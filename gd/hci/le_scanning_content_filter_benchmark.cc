@@ -0,0 +1,80 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "hci/le_scanning_content_filter.h"
+
+using ::benchmark::State;
+using ::bluetooth::hci::AdvertisingFilterParameter;
+using ::bluetooth::hci::AdvertisingPacketContentFilterCommand;
+using ::bluetooth::hci::ApcfAction;
+using ::bluetooth::hci::ApcfFilterType;
+using ::bluetooth::hci::Address;
+using ::bluetooth::hci::AddressType;
+using ::bluetooth::hci::LeScanningContentFilter;
+using ::bluetooth::hci::Uuid;
+
+namespace {
+
+// One filter per application, each on a service UUID, a local name and manufacturer data, as set from ScanFilter
+void AddFilters(LeScanningContentFilter* filter, size_t num_filters) {
+  uint16_t features = (1 << static_cast<uint8_t>(ApcfFilterType::SERVICE_UUID)) |
+                      (1 << static_cast<uint8_t>(ApcfFilterType::LOCAL_NAME)) |
+                      (1 << static_cast<uint8_t>(ApcfFilterType::MANUFACTURER_DATA));
+  for (size_t i = 0; i < num_filters; i++) {
+    AdvertisingFilterParameter parameter{};
+    parameter.feature_selection = features;
+    parameter.list_logic_type = 0;
+    parameter.rssi_high_thresh = static_cast<uint8_t>(INT8_MIN);
+    filter->SetParameters(ApcfAction::ADD, i, parameter);
+
+    AdvertisingPacketContentFilterCommand command{};
+    command.filter_type = ApcfFilterType::SERVICE_UUID;
+    command.uuid = Uuid::From16Bit(0x1000 + i);
+    filter->AddEntry(i, command);
+    command.filter_type = ApcfFilterType::LOCAL_NAME;
+    std::string name = "device " + std::to_string(i);
+    command.name = std::vector<uint8_t>(name.begin(), name.end());
+    filter->AddEntry(i, command);
+    command.filter_type = ApcfFilterType::MANUFACTURER_DATA;
+    command.company = 0x0100 + i;
+    command.data = {0x02, 0x15};
+    filter->AddEntry(i, command);
+  }
+}
+
+void BM_ContentFilter(State& state) {
+  LeScanningContentFilter filter;
+  AddFilters(&filter, state.range(0));
+  // Flags, two 16 bits service UUIDs, a local name and manufacturer data, none of them matching
+  std::vector<uint8_t> data = {0x02, 0x01, 0x06, 0x05, 0x03, 0x0d, 0x18, 0x0f, 0x18, 0x07, 0x09, 'o', 't', 'h',
+                               'e',  'r',  's',  0x07, 0xff, 0x4c, 0x00, 0x02, 0x15, 0x01, 0x02};
+  Address address({0x01, 0x02, 0x03, 0x04, 0x05, 0x06});
+  for (auto _ : state) {
+    bool matches = filter.Matches(
+        static_cast<uint8_t>(AddressType::RANDOM_DEVICE_ADDRESS), address, -60, data.data(), data.size());
+    benchmark::DoNotOptimize(matches);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_ContentFilter)->Arg(1)->Arg(16)->Arg(128);
+
+}  // namespace
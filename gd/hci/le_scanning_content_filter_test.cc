@@ -0,0 +1,287 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hci/le_scanning_content_filter.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace bluetooth {
+namespace hci {
+namespace {
+
+constexpr uint8_t kPublic = static_cast<uint8_t>(AddressType::PUBLIC_DEVICE_ADDRESS);
+constexpr uint8_t kRandom = static_cast<uint8_t>(AddressType::RANDOM_DEVICE_ADDRESS);
+constexpr int8_t kRssi = -60;
+const Address kAddress({0x01, 0x02, 0x03, 0x04, 0x05, 0x06});
+const Address kOtherAddress({0x11, 0x12, 0x13, 0x14, 0x15, 0x16});
+
+uint16_t FeatureBit(ApcfFilterType filter_type) {
+  return 1 << static_cast<uint8_t>(filter_type);
+}
+
+AdvertisingFilterParameter MakeParameter(uint16_t feature_selection, uint16_t and_features) {
+  AdvertisingFilterParameter parameter{};
+  parameter.feature_selection = feature_selection;
+  parameter.list_logic_type = and_features;
+  parameter.rssi_high_thresh = static_cast<uint8_t>(INT8_MIN);
+  parameter.delivery_mode = DeliveryMode::IMMEDIATE;
+  return parameter;
+}
+
+// Advertising data made of the given fields
+class AdvertisingData {
+ public:
+  AdvertisingData& Add(GapDataType type, const std::vector<uint8_t>& field) {
+    data_.push_back(field.size() + 1);
+    data_.push_back(static_cast<uint8_t>(type));
+    data_.insert(data_.end(), field.begin(), field.end());
+    return *this;
+  }
+
+  AdvertisingData& AddName(const std::string& name) {
+    return Add(GapDataType::COMPLETE_LOCAL_NAME, std::vector<uint8_t>(name.begin(), name.end()));
+  }
+
+  const std::vector<uint8_t>& Get() const {
+    return data_;
+  }
+
+ private:
+  std::vector<uint8_t> data_;
+};
+
+class LeScanningContentFilterTest : public ::testing::Test {
+ protected:
+  void AddFilter(uint8_t filter_index, ApcfFilterType filter_type, uint16_t and_features = 0xFFFF) {
+    filter_.SetParameters(ApcfAction::ADD, filter_index, MakeParameter(FeatureBit(filter_type), and_features));
+  }
+
+  bool AddName(uint8_t filter_index, const std::string& name) {
+    AdvertisingPacketContentFilterCommand command{};
+    command.filter_type = ApcfFilterType::LOCAL_NAME;
+    command.name = std::vector<uint8_t>(name.begin(), name.end());
+    return filter_.AddEntry(filter_index, command);
+  }
+
+  bool AddUuid(uint8_t filter_index, ApcfFilterType filter_type, Uuid uuid, Uuid uuid_mask = Uuid::kEmpty) {
+    AdvertisingPacketContentFilterCommand command{};
+    command.filter_type = filter_type;
+    command.uuid = uuid;
+    command.uuid_mask = uuid_mask;
+    return filter_.AddEntry(filter_index, command);
+  }
+
+  bool AddManufacturerData(
+      uint8_t filter_index,
+      uint16_t company,
+      uint16_t company_mask,
+      std::vector<uint8_t> data,
+      std::vector<uint8_t> data_mask = {}) {
+    AdvertisingPacketContentFilterCommand command{};
+    command.filter_type = ApcfFilterType::MANUFACTURER_DATA;
+    command.company = company;
+    command.company_mask = company_mask;
+    command.data = data;
+    command.data_mask = data_mask;
+    return filter_.AddEntry(filter_index, command);
+  }
+
+  bool AddServiceData(uint8_t filter_index, std::vector<uint8_t> data, std::vector<uint8_t> data_mask = {}) {
+    AdvertisingPacketContentFilterCommand command{};
+    command.filter_type = ApcfFilterType::SERVICE_DATA;
+    command.data = data;
+    command.data_mask = data_mask;
+    return filter_.AddEntry(filter_index, command);
+  }
+
+  bool Matches(const AdvertisingData& data, const Address& address = kAddress, int8_t rssi = kRssi) {
+    return filter_.Matches(kPublic, address, rssi, data.Get().data(), data.Get().size());
+  }
+
+  LeScanningContentFilter filter_;
+};
+
+TEST_F(LeScanningContentFilterTest, no_filter_matches_nothing) {
+  ASSERT_FALSE(Matches(AdvertisingData().AddName("name")));
+}
+
+TEST_F(LeScanningContentFilterTest, filter_without_feature_matches_everything) {
+  filter_.SetParameters(ApcfAction::ADD, 0, MakeParameter(0, 0));
+  ASSERT_TRUE(Matches(AdvertisingData().AddName("name")));
+  ASSERT_TRUE(Matches(AdvertisingData()));
+}
+
+TEST_F(LeScanningContentFilterTest, address) {
+  AddFilter(0, ApcfFilterType::BROADCASTER_ADDRESS);
+  AdvertisingPacketContentFilterCommand command{};
+  command.filter_type = ApcfFilterType::BROADCASTER_ADDRESS;
+  command.address = kAddress;
+  command.application_address_type = ApcfApplicationAddressType::PUBLIC;
+  ASSERT_TRUE(filter_.AddEntry(0, command));
+
+  AdvertisingData data;
+  ASSERT_TRUE(filter_.Matches(kPublic, kAddress, kRssi, data.Get().data(), data.Get().size()));
+  ASSERT_FALSE(filter_.Matches(kRandom, kAddress, kRssi, data.Get().data(), data.Get().size()));
+  ASSERT_FALSE(filter_.Matches(kPublic, kOtherAddress, kRssi, data.Get().data(), data.Get().size()));
+
+  command.address = kOtherAddress;
+  command.application_address_type = ApcfApplicationAddressType::NOT_APPLICABLE;
+  ASSERT_TRUE(filter_.AddEntry(0, command));
+  ASSERT_TRUE(filter_.Matches(kRandom, kOtherAddress, kRssi, data.Get().data(), data.Get().size()));
+  ASSERT_TRUE(filter_.Matches(kPublic, kOtherAddress, kRssi, data.Get().data(), data.Get().size()));
+}
+
+TEST_F(LeScanningContentFilterTest, service_uuid) {
+  AddFilter(0, ApcfFilterType::SERVICE_UUID);
+  ASSERT_TRUE(AddUuid(0, ApcfFilterType::SERVICE_UUID, Uuid::From16Bit(0x180d)));
+  auto uuid128 = Uuid::FromString("12345678-9abc-def0-1234-56789abcdef0").value();
+  ASSERT_TRUE(AddUuid(0, ApcfFilterType::SERVICE_UUID, uuid128));
+
+  ASSERT_TRUE(Matches(AdvertisingData().Add(GapDataType::COMPLETE_LIST_16_BIT_UUIDS, {0x0f, 0x18, 0x0d, 0x18})));
+  ASSERT_FALSE(Matches(AdvertisingData().Add(GapDataType::COMPLETE_LIST_16_BIT_UUIDS, {0x0f, 0x18})));
+  // The same UUID as a 32 bits UUID
+  ASSERT_TRUE(Matches(AdvertisingData().Add(GapDataType::INCOMPLETE_LIST_32_BIT_UUIDS, {0x0d, 0x18, 0x00, 0x00})));
+  auto uuid128_le = uuid128.To128BitLE();
+  ASSERT_TRUE(Matches(AdvertisingData().Add(
+      GapDataType::COMPLETE_LIST_128_BIT_UUIDS, std::vector<uint8_t>(uuid128_le.begin(), uuid128_le.end()))));
+  // A solicitation UUID is another feature
+  ASSERT_FALSE(Matches(AdvertisingData().Add(GapDataType::LIST_16BIT_SERVICE_SOLICITATION_UUIDS, {0x0d, 0x18})));
+}
+
+TEST_F(LeScanningContentFilterTest, masked_solicitation_uuid) {
+  AddFilter(0, ApcfFilterType::SERVICE_SOLICITATION_UUID);
+  ASSERT_TRUE(
+      AddUuid(0, ApcfFilterType::SERVICE_SOLICITATION_UUID, Uuid::From16Bit(0x1800), Uuid::From16Bit(0xff00)));
+  ASSERT_TRUE(Matches(AdvertisingData().Add(GapDataType::LIST_16BIT_SERVICE_SOLICITATION_UUIDS, {0x0d, 0x18})));
+  ASSERT_TRUE(Matches(AdvertisingData().Add(GapDataType::LIST_16BIT_SERVICE_SOLICITATION_UUIDS, {0xff, 0x18})));
+  ASSERT_FALSE(Matches(AdvertisingData().Add(GapDataType::LIST_16BIT_SERVICE_SOLICITATION_UUIDS, {0x0d, 0x19})));
+  ASSERT_FALSE(Matches(AdvertisingData().Add(GapDataType::COMPLETE_LIST_16_BIT_UUIDS, {0x0d, 0x18})));
+}
+
+TEST_F(LeScanningContentFilterTest, local_name) {
+  AddFilter(0, ApcfFilterType::LOCAL_NAME);
+  ASSERT_TRUE(AddName(0, "device"));
+  ASSERT_FALSE(AddName(0, ""));
+  ASSERT_TRUE(Matches(AdvertisingData().AddName("device")));
+  ASSERT_TRUE(Matches(AdvertisingData().Add(GapDataType::SHORTENED_LOCAL_NAME, {'d', 'e', 'v', 'i', 'c', 'e'})));
+  ASSERT_FALSE(Matches(AdvertisingData().AddName("device 2")));
+  ASSERT_FALSE(Matches(AdvertisingData().AddName("devic")));
+}
+
+TEST_F(LeScanningContentFilterTest, manufacturer_data) {
+  AddFilter(0, ApcfFilterType::MANUFACTURER_DATA);
+  ASSERT_TRUE(AddManufacturerData(0, 0x00e0, 0, {0x01, 0x00, 0x03}, {0xff, 0x00, 0xff}));
+  ASSERT_TRUE(Matches(AdvertisingData().Add(GapDataType::MANUFACTURER_SPECIFIC_DATA, {0xe0, 0x00, 0x01, 0x02, 0x03})));
+  ASSERT_TRUE(
+      Matches(AdvertisingData().Add(GapDataType::MANUFACTURER_SPECIFIC_DATA, {0xe0, 0x00, 0x01, 0x55, 0x03, 0x04})));
+  ASSERT_FALSE(Matches(AdvertisingData().Add(GapDataType::MANUFACTURER_SPECIFIC_DATA, {0xe0, 0x00, 0x02, 0x02, 0x03})));
+  ASSERT_FALSE(Matches(AdvertisingData().Add(GapDataType::MANUFACTURER_SPECIFIC_DATA, {0xe0, 0x00, 0x01, 0x02})));
+  ASSERT_FALSE(Matches(AdvertisingData().Add(GapDataType::MANUFACTURER_SPECIFIC_DATA, {0x4c, 0x00, 0x01, 0x02, 0x03})));
+
+  // Any company in 0x0000-0x00ff
+  ASSERT_TRUE(AddManufacturerData(0, 0x0000, 0xff00, {}));
+  ASSERT_TRUE(Matches(AdvertisingData().Add(GapDataType::MANUFACTURER_SPECIFIC_DATA, {0x4c, 0x00, 0x01, 0x02, 0x03})));
+  ASSERT_FALSE(Matches(AdvertisingData().Add(GapDataType::MANUFACTURER_SPECIFIC_DATA, {0x4c, 0x01})));
+}
+
+TEST_F(LeScanningContentFilterTest, service_data) {
+  AddFilter(0, ApcfFilterType::SERVICE_DATA);
+  ASSERT_TRUE(AddServiceData(0, {0xaa, 0xfe, 0x10}));
+  ASSERT_TRUE(Matches(AdvertisingData().Add(GapDataType::SERVICE_DATA_16_BIT_UUIDS, {0xaa, 0xfe, 0x10, 0x00})));
+  ASSERT_FALSE(Matches(AdvertisingData().Add(GapDataType::SERVICE_DATA_16_BIT_UUIDS, {0xaa, 0xfe, 0x20, 0x00})));
+
+  // Not keyed on the UUID, masked
+  ASSERT_TRUE(AddServiceData(0, {0x00, 0x00, 0x20}, {0x00, 0x00, 0xff}));
+  ASSERT_TRUE(Matches(AdvertisingData().Add(GapDataType::SERVICE_DATA_16_BIT_UUIDS, {0xaa, 0xfe, 0x20, 0x00})));
+  ASSERT_TRUE(Matches(AdvertisingData().Add(GapDataType::SERVICE_DATA_32_BIT_UUIDS, {0x01, 0x02, 0x20})));
+}
+
+TEST_F(LeScanningContentFilterTest, and_list_logic) {
+  uint16_t features = FeatureBit(ApcfFilterType::LOCAL_NAME) | FeatureBit(ApcfFilterType::MANUFACTURER_DATA);
+  filter_.SetParameters(ApcfAction::ADD, 0, MakeParameter(features, features));
+  AddName(0, "device");
+  AddManufacturerData(0, 0x00e0, 0, {});
+
+  ASSERT_FALSE(Matches(AdvertisingData().AddName("device")));
+  ASSERT_FALSE(Matches(AdvertisingData().Add(GapDataType::MANUFACTURER_SPECIFIC_DATA, {0xe0, 0x00})));
+  ASSERT_TRUE(
+      Matches(AdvertisingData().AddName("device").Add(GapDataType::MANUFACTURER_SPECIFIC_DATA, {0xe0, 0x00})));
+}
+
+TEST_F(LeScanningContentFilterTest, or_list_logic) {
+  uint16_t features = FeatureBit(ApcfFilterType::LOCAL_NAME) | FeatureBit(ApcfFilterType::MANUFACTURER_DATA);
+  filter_.SetParameters(ApcfAction::ADD, 0, MakeParameter(features, 0));
+  AddName(0, "device");
+  AddManufacturerData(0, 0x00e0, 0, {});
+
+  ASSERT_TRUE(Matches(AdvertisingData().AddName("device")));
+  ASSERT_TRUE(Matches(AdvertisingData().Add(GapDataType::MANUFACTURER_SPECIFIC_DATA, {0xe0, 0x00})));
+  ASSERT_FALSE(Matches(AdvertisingData().AddName("other")));
+}
+
+TEST_F(LeScanningContentFilterTest, rssi_threshold) {
+  auto parameter = MakeParameter(FeatureBit(ApcfFilterType::LOCAL_NAME), 0xFFFF);
+  parameter.rssi_high_thresh = static_cast<uint8_t>(-70);
+  filter_.SetParameters(ApcfAction::ADD, 0, parameter);
+  AddName(0, "device");
+  ASSERT_TRUE(Matches(AdvertisingData().AddName("device"), kAddress, -70));
+  ASSERT_FALSE(Matches(AdvertisingData().AddName("device"), kAddress, -71));
+}
+
+TEST_F(LeScanningContentFilterTest, filters_are_independent) {
+  for (int i = 0; i < 100; i++) {
+    AddFilter(i, ApcfFilterType::LOCAL_NAME);
+    AddName(i, "device " + std::to_string(i));
+  }
+  ASSERT_TRUE(Matches(AdvertisingData().AddName("device 42")));
+  ASSERT_FALSE(Matches(AdvertisingData().AddName("device 100")));
+
+  // A name of filter 42 does not make filter 43 match
+  AddName(42, "device 43");
+  filter_.SetParameters(ApcfAction::DELETE, 42, {});
+  ASSERT_FALSE(Matches(AdvertisingData().AddName("device 42")));
+  ASSERT_TRUE(Matches(AdvertisingData().AddName("device 43")));
+}
+
+TEST_F(LeScanningContentFilterTest, delete_and_clear_free_spaces) {
+  uint8_t available_filters = filter_.SetParameters(ApcfAction::ADD, 1, MakeParameter(0, 0));
+  ASSERT_EQ(filter_.SetParameters(ApcfAction::ADD, 2, MakeParameter(0, 0)), available_filters - 1);
+  uint8_t available_names = filter_.GetAvailableSpaces(ApcfFilterType::LOCAL_NAME);
+  AddName(1, "device 1");
+  AddName(2, "device 2");
+  ASSERT_EQ(filter_.GetAvailableSpaces(ApcfFilterType::LOCAL_NAME), available_names - 2);
+
+  ASSERT_EQ(filter_.SetParameters(ApcfAction::DELETE, 1, {}), available_filters);
+  ASSERT_EQ(filter_.GetAvailableSpaces(ApcfFilterType::LOCAL_NAME), available_names - 1);
+  filter_.SetParameters(ApcfAction::CLEAR, 0, {});
+  ASSERT_EQ(filter_.GetAvailableSpaces(ApcfFilterType::LOCAL_NAME), available_names);
+  ASSERT_FALSE(Matches(AdvertisingData().AddName("device 2")));
+}
+
+TEST_F(LeScanningContentFilterTest, malformed_data) {
+  AddFilter(0, ApcfFilterType::LOCAL_NAME);
+  AddName(0, "device");
+  // The length of the name field goes past the end of the data
+  std::vector<uint8_t> data = {0x08, static_cast<uint8_t>(GapDataType::COMPLETE_LOCAL_NAME), 'd', 'e', 'v'};
+  ASSERT_FALSE(filter_.Matches(kPublic, kAddress, kRssi, data.data(), data.size()));
+}
+
+}  // namespace
+}  // namespace hci
+}  // namespace bluetooth
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hci/le_scanning_duplicate_filter.h"
+
+#include <cstdlib>
+
+#include "hci/le_scanning_reassembler.h"
+
+namespace bluetooth {
+namespace hci {
+
+namespace {
+
+// FNV-1a over the event type and the advertising data
+uint64_t HashContent(uint16_t event_type, const uint8_t* data, size_t length) {
+  uint64_t hash = 0xcbf29ce484222325;
+  auto add = [&hash](uint8_t byte) {
+    hash ^= byte;
+    hash *= 0x100000001b3;
+  };
+  add(event_type & 0xff);
+  add(event_type >> 8);
+  for (size_t i = 0; i < length; i++) {
+    add(data[i]);
+  }
+  return hash;
+}
+
+}  // namespace
+
+LeScanningDuplicateFilter::LeScanningDuplicateFilter(uint8_t rssi_change_threshold, size_t capacity)
+    : rssi_change_threshold_(rssi_change_threshold), last_reports_(capacity) {}
+
+bool LeScanningDuplicateFilter::ShouldDeliver(
+    uint16_t event_type,
+    const AddressWithType& address_with_type,
+    uint8_t advertising_sid,
+    int8_t rssi,
+    const uint8_t* data,
+    size_t length) {
+  uint64_t key = AdvertisingSetKey(address_with_type, advertising_sid);
+  uint64_t content_hash = HashContent(event_type, data, length);
+  auto last_report = last_reports_.find(key);
+  if (last_report != last_reports_.end()) {
+    if (last_report->second.content_hash == content_hash &&
+        std::abs(rssi - last_report->second.rssi) < rssi_change_threshold_) {
+      return false;
+    }
+    last_report->second = {content_hash, rssi};
+    return true;
+  }
+  last_reports_.insert_or_assign(key, {content_hash, rssi});
+  return true;
+}
+
+void LeScanningDuplicateFilter::Clear() {
+  last_reports_.clear();
+}
+
+}  // namespace hci
+}  // namespace bluetooth
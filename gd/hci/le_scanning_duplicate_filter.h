@@ -0,0 +1,64 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "common/lru_cache.h"
+#include "hci/address_with_type.h"
+
+namespace bluetooth {
+namespace hci {
+
+// Drops the advertising reports that repeat the last report delivered for the same advertising set, as the controller
+// does when scanning with duplicate filtering, except when the RSSI moved by at least a threshold since, so that the
+// distance to the advertiser can still be followed.
+//
+// The last report of the most recently seen advertising sets is kept, up to a fixed capacity.
+//
+// NOT THREAD SAFE
+class LeScanningDuplicateFilter {
+ public:
+  static constexpr size_t kDefaultCapacity = 1024;
+
+  // An |rssi_change_threshold| of 0 lets every report through
+  explicit LeScanningDuplicateFilter(uint8_t rssi_change_threshold, size_t capacity = kDefaultCapacity);
+
+  // Return true if the report is to be delivered, in which case it becomes the last report of its advertising set
+  bool ShouldDeliver(
+      uint16_t event_type,
+      const AddressWithType& address_with_type,
+      uint8_t advertising_sid,
+      int8_t rssi,
+      const uint8_t* data,
+      size_t length);
+
+  // Forget all the reports seen so far
+  void Clear();
+
+ private:
+  struct LastReport {
+    uint64_t content_hash;
+    int8_t rssi;
+  };
+
+  uint8_t rssi_change_threshold_;
+  common::LruCache<uint64_t, LastReport> last_reports_;
+};
+
+}  // namespace hci
+}  // namespace bluetooth
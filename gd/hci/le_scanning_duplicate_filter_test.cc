@@ -0,0 +1,86 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hci/le_scanning_duplicate_filter.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "hci/le_scanning_reassembler.h"
+
+namespace bluetooth {
+namespace hci {
+namespace {
+
+constexpr uint16_t kEventType = 1 << kLegacyBit;
+constexpr uint8_t kSid = 0;
+constexpr uint8_t kRssiChangeThreshold = 5;
+
+const AddressWithType kAddress(Address({0x01, 0x02, 0x03, 0x04, 0x05, 0x06}), AddressType::PUBLIC_DEVICE_ADDRESS);
+const AddressWithType kOtherAddress(
+    Address({0x11, 0x12, 0x13, 0x14, 0x15, 0x16}), AddressType::PUBLIC_DEVICE_ADDRESS);
+
+class LeScanningDuplicateFilterTest : public ::testing::Test {
+ protected:
+  bool Deliver(const AddressWithType& address, int8_t rssi, const std::vector<uint8_t>& data) {
+    return filter_.ShouldDeliver(kEventType, address, kSid, rssi, data.data(), data.size());
+  }
+
+  LeScanningDuplicateFilter filter_{kRssiChangeThreshold};
+  std::vector<uint8_t> data_ = {0x02, 0x01, 0x06};
+};
+
+TEST_F(LeScanningDuplicateFilterTest, duplicate_is_dropped) {
+  ASSERT_TRUE(Deliver(kAddress, -60, data_));
+  ASSERT_FALSE(Deliver(kAddress, -60, data_));
+  ASSERT_FALSE(Deliver(kAddress, -60 + kRssiChangeThreshold - 1, data_));
+  ASSERT_TRUE(Deliver(kOtherAddress, -60, data_));
+}
+
+TEST_F(LeScanningDuplicateFilterTest, rssi_change_is_delivered) {
+  ASSERT_TRUE(Deliver(kAddress, -60, data_));
+  ASSERT_TRUE(Deliver(kAddress, -60 - kRssiChangeThreshold, data_));
+  // Compared to the last delivered report
+  ASSERT_FALSE(Deliver(kAddress, -60 - kRssiChangeThreshold + 1, data_));
+  ASSERT_TRUE(Deliver(kAddress, -60, data_));
+}
+
+TEST_F(LeScanningDuplicateFilterTest, data_change_is_delivered) {
+  ASSERT_TRUE(Deliver(kAddress, -60, data_));
+  std::vector<uint8_t> other_data = {0x02, 0x01, 0x1a};
+  ASSERT_TRUE(Deliver(kAddress, -60, other_data));
+  ASSERT_FALSE(Deliver(kAddress, -60, other_data));
+  ASSERT_TRUE(Deliver(kAddress, -60, data_));
+}
+
+TEST_F(LeScanningDuplicateFilterTest, clear_forgets_reports) {
+  ASSERT_TRUE(Deliver(kAddress, -60, data_));
+  filter_.Clear();
+  ASSERT_TRUE(Deliver(kAddress, -60, data_));
+}
+
+TEST(LeScanningDuplicateFilterNoThresholdTest, every_report_is_delivered) {
+  LeScanningDuplicateFilter filter(0);
+  std::vector<uint8_t> data = {0x02, 0x01, 0x06};
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(filter.ShouldDeliver(kEventType, kAddress, kSid, -60, data.data(), data.size()));
+  }
+}
+
+}  // namespace
+}  // namespace hci
+}  // namespace bluetooth
@@ -21,8 +21,11 @@
 #include "hci/controller.h"
 #include "hci/hci_layer.h"
 #include "hci/hci_packets.h"
+#include "hci/le_scanning_content_filter.h"
+#include "hci/le_scanning_duplicate_filter.h"
 #include "hci/le_scanning_interface.h"
 #include "hci/le_scanning_manager.h"
+#include "hci/le_scanning_reassembler.h"
 #include "hci/vendor_specific_event_manager.h"
 #include "module.h"
 #include "os/handler.h"
@@ -40,11 +43,15 @@ constexpr uint16_t kLeScanIntervalMax = 0x4000;
 constexpr uint16_t kDefaultLeExtendedScanInterval = 4800;
 constexpr uint16_t kLeExtendedScanIntervalMax = 0xFFFF;
 
-constexpr uint8_t kScannableBit = 1;
-constexpr uint8_t kDirectedBit = 2;
-constexpr uint8_t kScanResponseBit = 3;
-constexpr uint8_t kLegacyBit = 4;
-constexpr uint8_t kDataStatusBits = 5;
+// The reports of an advertising report event follow the event code, the parameter length, the subevent code and the
+// number of reports
+constexpr int kNumReportsOffset = 3;
+// Event type, address type, address and data length. The data and the RSSI follow
+constexpr int kReportHeaderLength = 9;
+// Event type, address type, address, primary PHY, secondary PHY, SID, TX power, RSSI, periodic advertising interval
+constexpr int kExtendedReportHeaderLength = 16;
+// Direct address type and direct address
+constexpr int kExtendedReportDirectAddressLength = 7;
 
 const ModuleFactory LeScanningManager::Factory = ModuleFactory([]() { return new LeScanningManager(); });
 
@@ -59,80 +66,6 @@ struct Scanner {
   bool in_use;
 };
 
-class AdvertisingCache {
- public:
-  const std::vector<uint8_t>& Set(const AddressWithType& address_with_type, std::vector<uint8_t> data) {
-    auto it = Find(address_with_type);
-    if (it != items.end()) {
-      it->data = std::move(data);
-      return it->data;
-    }
-
-    if (items.size() > cache_max) {
-      items.pop_back();
-    }
-
-    items.emplace_front(address_with_type, std::move(data));
-    return items.front().data;
-  }
-
-  bool Exist(const AddressWithType& address_with_type) {
-    auto it = Find(address_with_type);
-    if (it == items.end()) {
-      return false;
-    }
-    return true;
-  }
-
-  const std::vector<uint8_t>& Append(const AddressWithType& address_with_type, std::vector<uint8_t> data) {
-    auto it = Find(address_with_type);
-    if (it != items.end()) {
-      it->data.insert(it->data.end(), data.begin(), data.end());
-      return it->data;
-    }
-
-    if (items.size() > cache_max) {
-      items.pop_back();
-    }
-
-    items.emplace_front(address_with_type, std::move(data));
-    return items.front().data;
-  }
-
-  /* Clear data for device |addr_type, addr| */
-  void Clear(AddressWithType address_with_type) {
-    auto it = Find(address_with_type);
-    if (it != items.end()) {
-      items.erase(it);
-    }
-  }
-
-  void ClearAll() {
-    items.clear();
-  }
-
-  struct Item {
-    AddressWithType address_with_type;
-    std::vector<uint8_t> data;
-
-    Item(const AddressWithType& address_with_type, std::vector<uint8_t> data)
-        : address_with_type(address_with_type), data(data) {}
-  };
-
-  std::list<Item>::iterator Find(const AddressWithType& address_with_type) {
-    for (auto it = items.begin(); it != items.end(); it++) {
-      if (it->address_with_type == address_with_type) {
-        return it;
-      }
-    }
-    return items.end();
-  }
-
-  /* we keep maximum 7 devices in the cache */
-  const size_t cache_max = 1000;
-  std::list<Item> items;
-};
-
 class NullScanningCallback : public ScanningCallback {
   void OnScannerRegistered(const bluetooth::hci::Uuid app_uuid, ScannerId scanner_id, ScanningStatus status) {
     LOG_INFO("OnScannerRegistered in NullScanningCallback");
@@ -301,15 +234,34 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
       LOG_INFO("Dropping invalid advertising event");
       return;
     }
-    std::vector<LeAdvertisingReport> reports = event_view.GetAdvertisingReports();
-    if (reports.empty()) {
+    // Reports are read in place, GetAdvertisingReports() would copy each of them with its data
+    auto it = event_view.begin() + kNumReportsOffset;
+    uint8_t num_reports = it.extract<uint8_t>();
+    if (num_reports == 0) {
       LOG_INFO("Zero results in advertising event");
       return;
     }
 
-    for (LeAdvertisingReport report : reports) {
+    // The array contents are not validated with the event, stop at the first report the event does not hold
+    for (uint8_t i = 0; i < num_reports; i++) {
+      if (it.NumBytesRemaining() < kReportHeaderLength) {
+        LOG_WARN("Truncated advertising report %d of %d", i, num_reports);
+        return;
+      }
+      auto event_type = static_cast<AdvertisingEventType>(it.extract<uint8_t>());
+      uint8_t address_type = it.extract<uint8_t>();
+      Address address = it.extract<Address>();
+      uint8_t advertising_data_length = it.extract<uint8_t>();
+      if (it.NumBytesRemaining() < advertising_data_length + sizeof(int8_t)) {
+        LOG_WARN("Truncated advertising data in report %d of %d", i, num_reports);
+        return;
+      }
+      const uint8_t* advertising_data = get_report_data(it, advertising_data_length);
+      it += advertising_data_length;
+      int8_t rssi = it.extract<int8_t>();
+
       uint16_t extended_event_type = 0;
-      switch (report.event_type_) {
+      switch (event_type) {
         case hci::AdvertisingEventType::ADV_IND:
           transform_to_extended_event_type(
               &extended_event_type, {.connectable = true, .scannable = true, .legacy = true});
@@ -329,28 +281,22 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
               &extended_event_type, {.connectable = true, .scannable = true, .scan_response = true, .legacy = true});
           break;
         default:
-          LOG_WARN("Unsupported event type:%d", (uint16_t)report.event_type_);
+          LOG_WARN("Unsupported event type:%d", (uint16_t)event_type);
           return;
       }
 
-      std::vector<uint8_t> advertising_data = {};
-      for (auto gap_data : report.advertising_data_) {
-        advertising_data.push_back((uint8_t)gap_data.size() - 1);
-        advertising_data.push_back((uint8_t)gap_data.data_type_);
-        advertising_data.insert(advertising_data.end(), gap_data.data_.begin(), gap_data.data_.end());
-      }
-
       process_advertising_package_content(
           extended_event_type,
-          (uint8_t)report.address_type_,
-          report.address_,
+          address_type,
+          address,
           (uint8_t)PrimaryPhyType::LE_1M,
           (uint8_t)SecondaryPhyType::NO_PACKETS,
           kAdvertisingDataInfoNotPresent,
           kTxPowerInformationNotPresent,
-          report.rssi_,
+          rssi,
           kNotPeriodicAdvertisement,
-          advertising_data);
+          advertising_data,
+          advertising_data_length);
     }
   }
 
@@ -374,30 +320,70 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
       LOG_INFO("Dropping invalid advertising event");
       return;
     }
-    std::vector<LeExtendedAdvertisingReport> reports = event_view.GetAdvertisingReports();
-    if (reports.empty()) {
+    // Reports are read in place, GetAdvertisingReports() would copy each of them with its data
+    auto it = event_view.begin() + kNumReportsOffset;
+    uint8_t num_reports = it.extract<uint8_t>();
+    if (num_reports == 0) {
       LOG_INFO("Zero results in advertising event");
       return;
     }
 
-    for (LeExtendedAdvertisingReport report : reports) {
-      uint16_t event_type = report.connectable_ | (report.scannable_ << kScannableBit) |
-                            (report.directed_ << kDirectedBit) | (report.scan_response_ << kScanResponseBit) |
-                            (report.legacy_ << kLegacyBit) | ((uint16_t)report.data_status_ << kDataStatusBits);
+    // The array contents are not validated with the event, stop at the first report the event does not hold
+    for (uint8_t i = 0; i < num_reports; i++) {
+      if (it.NumBytesRemaining() < kExtendedReportHeaderLength + kExtendedReportDirectAddressLength + 1) {
+        LOG_WARN("Truncated extended advertising report %d of %d", i, num_reports);
+        return;
+      }
+      auto report_header = it;
+      // Connectable, scannable, directed, scan response and legacy bits, then the data status. The rest is reserved
+      uint16_t event_type = it.extract<uint16_t>() & ((1 << (kDataStatusBits + 2)) - 1);
+      uint8_t address_type = it.extract<uint8_t>();
+      Address address = it.extract<Address>();
+      uint8_t primary_phy = it.extract<uint8_t>();
+      uint8_t secondary_phy = it.extract<uint8_t>();
+      uint8_t advertising_sid = it.extract<uint8_t>();
+      int8_t tx_power = it.extract<int8_t>();
+      int8_t rssi = it.extract<int8_t>();
+      uint16_t periodic_advertising_interval = it.extract<uint16_t>();
+      ASSERT(it == report_header + kExtendedReportHeaderLength);
+      it += kExtendedReportDirectAddressLength;
+      uint8_t advertising_data_length = it.extract<uint8_t>();
+      if (it.NumBytesRemaining() < advertising_data_length) {
+        LOG_WARN("Truncated advertising data in extended report %d of %d", i, num_reports);
+        return;
+      }
+      const uint8_t* advertising_data = get_report_data(it, advertising_data_length);
+      it += advertising_data_length;
+
       process_advertising_package_content(
           event_type,
-          (uint8_t)report.address_type_,
-          report.address_,
-          (uint8_t)report.primary_phy_,
-          (uint8_t)report.secondary_phy_,
-          report.advertising_sid_,
-          report.tx_power_,
-          report.rssi_,
-          report.periodic_advertising_interval_,
-          report.advertising_data_);
+          address_type,
+          address,
+          primary_phy,
+          secondary_phy,
+          advertising_sid,
+          tx_power,
+          rssi,
+          periodic_advertising_interval,
+          advertising_data,
+          advertising_data_length);
     }
   }
 
+  // Return the |length| bytes at |it|, in place when the event is in a single buffer, which is nearly always the case
+  const uint8_t* get_report_data(const packet::Iterator<packet::kLittleEndian>& it, size_t length) {
+    const uint8_t* data = it.ContiguousBytes(length);
+    if (data != nullptr) {
+      return data;
+    }
+    report_data_.resize(length);
+    auto byte = it;
+    for (size_t i = 0; i < length; i++, ++byte) {
+      report_data_[i] = *byte;
+    }
+    return report_data_.data();
+  }
+
   void process_advertising_package_content(
       uint16_t event_type,
       uint8_t address_type,
@@ -408,23 +394,26 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
       int8_t tx_power,
       int8_t rssi,
       uint16_t periodic_advertising_interval,
-      std::vector<uint8_t> advertising_data) {
-    bool is_scannable = event_type & (1 << kScannableBit);
-    bool is_scan_response = event_type & (1 << kScanResponseBit);
-    bool is_legacy = event_type & (1 << kLegacyBit);
+      const uint8_t* advertising_data,
+      size_t advertising_data_length) {
+    ScanResultView scan_result{
+        event_type,
+        address_type,
+        address,
+        primary_phy,
+        secondary_phy,
+        advertising_sid,
+        tx_power,
+        rssi,
+        periodic_advertising_interval,
+        advertising_data,
+        advertising_data_length};
 
     if (address_type == (uint8_t)DirectAdvertisingAddressType::NO_ADDRESS) {
-      scanning_callbacks_->OnScanResult(
-          event_type,
-          address_type,
-          address,
-          primary_phy,
-          secondary_phy,
-          advertising_sid,
-          tx_power,
-          rssi,
-          periodic_advertising_interval,
-          advertising_data);
+      if (!content_filter_enabled_ ||
+          content_filter_.Matches(address_type, address, rssi, advertising_data, advertising_data_length)) {
+        scanning_callbacks_->OnScanResultView(scan_result);
+      }
       return;
     } else if (address == Address::kEmpty) {
       LOG_WARN("Receive non-anonymous advertising report with empty address, skip!");
@@ -432,40 +421,25 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
     }
 
     AddressWithType address_with_type(address, (AddressType)address_type);
-
-    if (is_legacy && is_scan_response && !advertising_cache_.Exist(address_with_type)) {
+    auto complete_data = reassembler_.ProcessAdvertisingReport(
+        event_type, address_with_type, advertising_sid, advertising_data, advertising_data_length);
+    if (!complete_data) {
+      // Waiting for the rest of the data or for the scan response
       return;
     }
+    scan_result.advertising_data = complete_data->data;
+    scan_result.advertising_data_length = complete_data->length;
 
-    bool is_start = is_legacy && is_scannable && !is_scan_response;
-
-    std::vector<uint8_t> const& adv_data = is_start ? advertising_cache_.Set(address_with_type, advertising_data)
-                                                    : advertising_cache_.Append(address_with_type, advertising_data);
-
-    uint8_t data_status = event_type >> kDataStatusBits;
-    if (data_status == (uint8_t)DataStatus::CONTINUING) {
-      // Waiting for whole data
+    if (content_filter_enabled_ &&
+        !content_filter_.Matches(address_type, address, rssi, complete_data->data, complete_data->length)) {
       return;
     }
-
-    if (is_scannable && !is_scan_response) {
-      // Waiting for scan response
+    if (duplicate_filter_ != nullptr &&
+        !duplicate_filter_->ShouldDeliver(
+            event_type, address_with_type, advertising_sid, rssi, complete_data->data, complete_data->length)) {
       return;
     }
-
-    scanning_callbacks_->OnScanResult(
-        event_type,
-        address_type,
-        address,
-        primary_phy,
-        secondary_phy,
-        advertising_sid,
-        tx_power,
-        rssi,
-        periodic_advertising_interval,
-        adv_data);
-
-    advertising_cache_.Clear(address_with_type);
+    scanning_callbacks_->OnScanResultView(scan_result);
   }
 
   void configure_scan() {
@@ -563,6 +537,10 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
       return;
     }
     is_scanning_ = true;
+    if (duplicate_filter_ != nullptr) {
+      // Each scan reports every advertiser at least once
+      duplicate_filter_->Clear();
+    }
     if (!address_manager_registered_) {
       le_address_manager_->Register(this);
       address_manager_registered_ = true;
@@ -629,12 +607,13 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
   }
 
   void scan_filter_enable(bool enable) {
+    Enable apcf_enable = enable ? Enable::ENABLED : Enable::DISABLED;
     if (!is_filter_support_) {
-      LOG_WARN("Advertising filter is not supported");
+      content_filter_enabled_ = enable;
+      scanning_callbacks_->OnFilterEnable(apcf_enable, (uint8_t)ErrorCode::SUCCESS);
       return;
     }
 
-    Enable apcf_enable = enable ? Enable::ENABLED : Enable::DISABLED;
     le_scanning_interface_->EnqueueCommand(
         LeAdvFilterEnableBuilder::Create(apcf_enable),
         module_handler_->BindOnceOn(this, &impl::on_advertising_filter_complete));
@@ -643,7 +622,8 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
   void scan_filter_parameter_setup(
       ApcfAction action, uint8_t filter_index, AdvertisingFilterParameter advertising_filter_parameter) {
     if (!is_filter_support_) {
-      LOG_WARN("Advertising filter is not supported");
+      uint8_t available_spaces = content_filter_.SetParameters(action, filter_index, advertising_filter_parameter);
+      scanning_callbacks_->OnFilterParamSetup(available_spaces, action, (uint8_t)ErrorCode::SUCCESS);
       return;
     }
 
@@ -680,9 +660,25 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
     }
   }
 
+  uint8_t get_max_host_scan_filters() const {
+    if (is_filter_support_) {
+      return 0;
+    }
+    // Filter indices are 8 bits, but the count has to fit as well
+    return LeScanningContentFilter::kMaxFilters - 1;
+  }
+
   void scan_filter_add(uint8_t filter_index, std::vector<AdvertisingPacketContentFilterCommand> filters) {
     if (!is_filter_support_) {
-      LOG_WARN("Advertising filter is not supported");
+      for (const auto& filter : filters) {
+        ErrorCode status = content_filter_.AddEntry(filter_index, filter) ? ErrorCode::SUCCESS
+                                                                          : ErrorCode::INVALID_HCI_COMMAND_PARAMETERS;
+        scanning_callbacks_->OnFilterConfigCallback(
+            filter.filter_type,
+            content_filter_.GetAvailableSpaces(filter.filter_type),
+            ApcfAction::ADD,
+            (uint8_t)status);
+      }
       return;
     }
 
@@ -1001,6 +997,14 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
     tracker_id = scanner_id;
   }
 
+  void duplicate_filter_enable(bool enable, uint8_t rssi_change_threshold) {
+    if (enable) {
+      duplicate_filter_ = std::make_unique<LeScanningDuplicateFilter>(rssi_change_threshold);
+    } else {
+      duplicate_filter_.reset();
+    }
+  }
+
   void register_scanning_callback(ScanningCallback* scanning_callbacks) {
     scanning_callbacks_ = scanning_callbacks;
   }
@@ -1225,7 +1229,14 @@ struct LeScanningManager::impl : public bluetooth::hci::LeAddressManagerCallback
   bool is_scanning_ = false;
   bool scan_on_resume_ = false;
   bool paused_ = false;
-  AdvertisingCache advertising_cache_;
+  LeScanningReassembler reassembler_;
+  // Filters the reports on the host when the controller does not support advertising packet content filters
+  LeScanningContentFilter content_filter_;
+  bool content_filter_enabled_ = false;
+  // Only set when host side duplicate filtering is enabled
+  std::unique_ptr<LeScanningDuplicateFilter> duplicate_filter_;
+  // Advertising data of the current report, when it cannot be read in place
+  std::vector<uint8_t> report_data_;
   bool is_filter_support_ = false;
   bool is_batch_scan_support_ = false;
 
@@ -1316,6 +1327,10 @@ void LeScanningManager::SetScanParameters(LeScanType scan_type, uint16_t scan_in
   CallOn(pimpl_.get(), &impl::set_scan_parameters, scan_type, scan_interval, scan_window);
 }
 
+void LeScanningManager::DuplicateFilterEnable(bool enable, uint8_t rssi_change_threshold) {
+  CallOn(pimpl_.get(), &impl::duplicate_filter_enable, enable, rssi_change_threshold);
+}
+
 void LeScanningManager::ScanFilterEnable(bool enable) {
   CallOn(pimpl_.get(), &impl::scan_filter_enable, enable);
 }
@@ -1330,6 +1345,10 @@ void LeScanningManager::ScanFilterAdd(
   CallOn(pimpl_.get(), &impl::scan_filter_add, filter_index, filters);
 }
 
+uint8_t LeScanningManager::GetMaxHostScanFilters() const {
+  return pimpl_->get_max_host_scan_filters();
+}
+
 void LeScanningManager::BatchScanConifgStorage(
     uint8_t batch_scan_full_max,
     uint8_t batch_scan_truncated_max,
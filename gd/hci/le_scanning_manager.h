@@ -43,6 +43,24 @@ class AdvertisingFilterOnFoundOnLostInfo {
   std::vector<uint8_t> scan_response;
 };
 
+// A complete advertising report, as passed to ScanningCallback::OnScanResultView()
+//
+// The advertising data is not owned: it points into the HCI event or into a reassembly buffer, and is only valid for
+// the duration of the callback.
+struct ScanResultView {
+  uint16_t event_type;
+  uint8_t address_type;
+  Address address;
+  uint8_t primary_phy;
+  uint8_t secondary_phy;
+  uint8_t advertising_sid;
+  int8_t tx_power;
+  int8_t rssi;
+  uint16_t periodic_advertising_interval;
+  const uint8_t* advertising_data;
+  size_t advertising_data_length;
+};
+
 class ScanningCallback {
  public:
   enum ScanningStatus {
@@ -65,6 +83,22 @@ class ScanningCallback {
       int8_t rssi,
       uint16_t periodic_advertising_interval,
       std::vector<uint8_t> advertising_data) = 0;
+  // Called for each complete advertising report. Callbacks that can read the report in place override it; by default
+  // the advertising data is copied for OnScanResult().
+  virtual void OnScanResultView(const ScanResultView& scan_result) {
+    OnScanResult(
+        scan_result.event_type,
+        scan_result.address_type,
+        scan_result.address,
+        scan_result.primary_phy,
+        scan_result.secondary_phy,
+        scan_result.advertising_sid,
+        scan_result.tx_power,
+        scan_result.rssi,
+        scan_result.periodic_advertising_interval,
+        std::vector<uint8_t>(
+            scan_result.advertising_data, scan_result.advertising_data + scan_result.advertising_data_length));
+  }
   virtual void OnTrackAdvFoundLost(AdvertisingFilterOnFoundOnLostInfo on_found_on_lost_info) = 0;
   virtual void OnBatchScanReports(
       int client_if, int status, int report_format, int num_records, std::vector<uint8_t> data) = 0;
@@ -128,7 +162,10 @@ class LeScanningManager : public bluetooth::Module {
 
   void SetScanParameters(LeScanType scan_type, uint16_t scan_interval, uint16_t scan_window);
 
-  /* Scan filter */
+  /* Drop reports repeating the last one of their advertiser, unless the RSSI changed by rssi_change_threshold dBm */
+  void DuplicateFilterEnable(bool enable, uint8_t rssi_change_threshold);
+
+  /* Scan filter, done on the host when the controller does not support LE_ADV_FILTER */
   void ScanFilterEnable(bool enable);
 
   void ScanFilterParameterSetup(
@@ -136,6 +173,9 @@ class LeScanningManager : public bluetooth::Module {
 
   void ScanFilterAdd(uint8_t filter_index, std::vector<AdvertisingPacketContentFilterCommand> filters);
 
+  /* Number of scan filters available on the host, or 0 when the controller supports LE_ADV_FILTER */
+  uint8_t GetMaxHostScanFilters() const;
+
   /*Batch Scan*/
   void BatchScanConifgStorage(
       uint8_t batch_scan_full_max,
@@ -39,6 +39,9 @@ using packet::kLittleEndian;
 using packet::PacketView;
 using packet::RawBuilder;
 
+// Event code and parameter length
+constexpr size_t kEventHeaderSize = 2;
+
 PacketView<kLittleEndian> GetPacketView(std::unique_ptr<packet::BasePacketBuilder> packet) {
   auto bytes = std::make_shared<std::vector<uint8_t>>();
   BitInserter i(*bytes);
@@ -141,7 +144,21 @@ class TestHciLayer : public HciLayer {
   }
 
   void IncomingLeMetaEvent(std::unique_ptr<LeMetaEventBuilder> event_builder) {
-    auto packet = GetPacketView(std::move(event_builder));
+    IncomingLeMetaEvent(GetPacketView(std::move(event_builder)));
+  }
+
+  // Deliver the event without its last |num_bytes| bytes, with its parameter length fixed up
+  void IncomingTruncatedLeMetaEvent(std::unique_ptr<LeMetaEventBuilder> event_builder, size_t num_bytes) {
+    auto bytes = std::make_shared<std::vector<uint8_t>>();
+    BitInserter i(*bytes);
+    event_builder->Serialize(i);
+    ASSERT_GT(bytes->size(), kEventHeaderSize + num_bytes);
+    bytes->resize(bytes->size() - num_bytes);
+    (*bytes)[1] = bytes->size() - kEventHeaderSize;
+    IncomingLeMetaEvent(PacketView<kLittleEndian>(bytes));
+  }
+
+  void IncomingLeMetaEvent(PacketView<kLittleEndian> packet) {
     EventView event = EventView::Create(packet);
     LeMetaEventView meta_event_view = LeMetaEventView::Create(event);
     ASSERT_TRUE(meta_event_view.IsValid());
@@ -400,6 +417,109 @@ TEST_F(LeScanningManagerTest, start_scan_test) {
   test_hci_layer_->IncomingLeMetaEvent(LeAdvertisingReportBuilder::Create({report}));
 }
 
+TEST_F(LeScanningManagerTest, max_host_scan_filters_test) {
+  // Without LE_ADV_FILTER, the filters done on the host are reported to the upper layers
+  EXPECT_EQ(le_scanning_manager->GetMaxHostScanFilters(), 255);
+}
+
+TEST_F(LeScanningManagerTest, scan_filter_on_host_test) {
+  EXPECT_CALL(mock_callbacks_, OnFilterEnable(Enable::ENABLED, (uint8_t)ErrorCode::SUCCESS));
+  le_scanning_manager->ScanFilterEnable(true);
+
+  AdvertisingFilterParameter advertising_filter_parameter{};
+  advertising_filter_parameter.feature_selection = 1 << (uint8_t)ApcfFilterType::LOCAL_NAME;
+  advertising_filter_parameter.list_logic_type = 1 << (uint8_t)ApcfFilterType::LOCAL_NAME;
+  advertising_filter_parameter.rssi_high_thresh = (uint8_t)INT8_MIN;
+  advertising_filter_parameter.delivery_mode = DeliveryMode::IMMEDIATE;
+  EXPECT_CALL(mock_callbacks_, OnFilterParamSetup(testing::_, ApcfAction::ADD, (uint8_t)ErrorCode::SUCCESS));
+  le_scanning_manager->ScanFilterParameterSetup(ApcfAction::ADD, 0x01, advertising_filter_parameter);
+
+  AdvertisingPacketContentFilterCommand filter{};
+  filter.filter_type = ApcfFilterType::LOCAL_NAME;
+  filter.name = {'r', 'a', 'n', 'd', 'o', 'm', ' ', 'd', 'e', 'v', 'i', 'c', 'e'};
+  EXPECT_CALL(
+      mock_callbacks_,
+      OnFilterConfigCallback(ApcfFilterType::LOCAL_NAME, testing::_, ApcfAction::ADD, (uint8_t)ErrorCode::SUCCESS));
+  le_scanning_manager->ScanFilterAdd(0x01, {filter});
+
+  auto next_command_future = test_hci_layer_->GetCommandFuture();
+  le_scanning_manager->Scan(true);
+  auto result = next_command_future.wait_for(std::chrono::duration(std::chrono::milliseconds(100)));
+  ASSERT_EQ(std::future_status::ready, result);
+  test_hci_layer_->IncomingEvent(LeSetScanEnableCompleteBuilder::Create(uint8_t{1}, ErrorCode::SUCCESS));
+
+  LeAdvertisingReport matching_report{};
+  matching_report.event_type_ = AdvertisingEventType::ADV_NONCONN_IND;
+  matching_report.address_type_ = AddressType::PUBLIC_DEVICE_ADDRESS;
+  Address::FromString("12:34:56:78:9a:bc", matching_report.address_);
+  GapData data_item{};
+  data_item.data_type_ = GapDataType::COMPLETE_LOCAL_NAME;
+  data_item.data_ = filter.name;
+  matching_report.advertising_data_ = {data_item};
+
+  LeAdvertisingReport other_report = matching_report;
+  Address::FromString("12:34:56:78:9a:bd", other_report.address_);
+  other_report.advertising_data_[0].data_ = {'o', 't', 'h', 'e', 'r'};
+
+  EXPECT_CALL(
+      mock_callbacks_,
+      OnScanResult(
+          testing::_,
+          testing::_,
+          matching_report.address_,
+          testing::_,
+          testing::_,
+          testing::_,
+          testing::_,
+          testing::_,
+          testing::_,
+          testing::_))
+      .Times(1);
+  test_hci_layer_->IncomingLeMetaEvent(LeAdvertisingReportBuilder::Create({other_report, matching_report}));
+  fake_registry_.SynchronizeModuleHandler(&LeScanningManager::Factory, std::chrono::milliseconds(20));
+}
+
+TEST_F(LeScanningManagerTest, truncated_advertising_report_test) {
+  auto next_command_future = test_hci_layer_->GetCommandFuture();
+  le_scanning_manager->Scan(true);
+  auto result = next_command_future.wait_for(std::chrono::duration(std::chrono::milliseconds(100)));
+  ASSERT_EQ(std::future_status::ready, result);
+  test_hci_layer_->IncomingEvent(LeSetScanEnableCompleteBuilder::Create(uint8_t{1}, ErrorCode::SUCCESS));
+
+  LeAdvertisingReport report{};
+  report.event_type_ = AdvertisingEventType::ADV_NONCONN_IND;
+  report.address_type_ = AddressType::PUBLIC_DEVICE_ADDRESS;
+  Address::FromString("12:34:56:78:9a:bc", report.address_);
+  GapData data_item{};
+  data_item.data_type_ = GapDataType::COMPLETE_LOCAL_NAME;
+  data_item.data_ = {'r', 'a', 'n', 'd', 'o', 'm', ' ', 'd', 'e', 'v', 'i', 'c', 'e'};
+  report.advertising_data_ = {data_item};
+  LeAdvertisingReport truncated_report = report;
+  Address::FromString("12:34:56:78:9a:bd", truncated_report.address_);
+
+  // Only the complete report is delivered, whether the second one is cut in its RSSI, its data or its header
+  for (size_t num_bytes : {1, 5, 20}) {
+    EXPECT_CALL(
+        mock_callbacks_,
+        OnScanResult(
+            testing::_,
+            testing::_,
+            report.address_,
+            testing::_,
+            testing::_,
+            testing::_,
+            testing::_,
+            testing::_,
+            testing::_,
+            testing::_))
+        .Times(1);
+    test_hci_layer_->IncomingTruncatedLeMetaEvent(
+        LeAdvertisingReportBuilder::Create({report, truncated_report}), num_bytes);
+    fake_registry_.SynchronizeModuleHandler(&LeScanningManager::Factory, std::chrono::milliseconds(20));
+    testing::Mock::VerifyAndClearExpectations(&mock_callbacks_);
+  }
+}
+
 TEST_F(LeAndroidHciScanningManagerTest, start_scan_test) {
   auto next_command_future = test_hci_layer_->GetCommandFuture();
   le_scanning_manager->Scan(true);
@@ -427,6 +547,10 @@ TEST_F(LeAndroidHciScanningManagerTest, start_scan_test) {
   test_hci_layer_->IncomingLeMetaEvent(LeAdvertisingReportBuilder::Create({report}));
 }
 
+TEST_F(LeAndroidHciScanningManagerTest, max_host_scan_filters_test) {
+  EXPECT_EQ(le_scanning_manager->GetMaxHostScanFilters(), 0);
+}
+
 TEST_F(LeAndroidHciScanningManagerTest, scan_filter_enable_test) {
   auto next_command_future = test_hci_layer_->GetCommandFuture();
   le_scanning_manager->ScanFilterEnable(true);
@@ -553,6 +677,56 @@ TEST_F(LeExtendedScanningManagerTest, start_scan_test) {
   test_hci_layer_->IncomingLeMetaEvent(LeExtendedAdvertisingReportBuilder::Create({report}));
 }
 
+TEST_F(LeExtendedScanningManagerTest, truncated_advertising_report_test) {
+  auto next_command_future = test_hci_layer_->GetCommandFuture();
+  le_scanning_manager->Scan(true);
+
+  auto result = next_command_future.wait_for(std::chrono::duration(std::chrono::milliseconds(100)));
+  ASSERT_EQ(std::future_status::ready, result);
+  test_hci_layer_->GetCommand(OpCode::LE_SET_EXTENDED_SCAN_ENABLE);
+  test_hci_layer_->IncomingEvent(LeSetScanEnableCompleteBuilder::Create(uint8_t{1}, ErrorCode::SUCCESS));
+
+  result = next_command_future.wait_for(std::chrono::duration(std::chrono::milliseconds(100)));
+  ASSERT_EQ(std::future_status::ready, result);
+  test_hci_layer_->GetCommand(OpCode::LE_SET_EXTENDED_SCAN_PARAMETERS);
+  test_hci_layer_->IncomingEvent(LeSetExtendedScanParametersCompleteBuilder::Create(uint8_t{1}, ErrorCode::SUCCESS));
+
+  result = next_command_future.wait_for(std::chrono::duration(std::chrono::milliseconds(100)));
+  ASSERT_EQ(std::future_status::ready, result);
+  test_hci_layer_->GetCommand(OpCode::LE_SET_EXTENDED_SCAN_ENABLE);
+  test_hci_layer_->IncomingEvent(LeSetScanEnableCompleteBuilder::Create(uint8_t{1}, ErrorCode::SUCCESS));
+
+  LeExtendedAdvertisingReport report{};
+  report.connectable_ = 1;
+  report.address_type_ = DirectAdvertisingAddressType::PUBLIC_DEVICE_ADDRESS;
+  Address::FromString("12:34:56:78:9a:bc", report.address_);
+  report.advertising_data_ = {0x02, (uint8_t)GapDataType::FLAGS, 0x34};
+  LeExtendedAdvertisingReport truncated_report = report;
+  Address::FromString("12:34:56:78:9a:bd", truncated_report.address_);
+
+  // Only the complete report is delivered, whether the second one is cut in its data or its header
+  for (size_t num_bytes : {1, 10}) {
+    EXPECT_CALL(
+        mock_callbacks_,
+        OnScanResult(
+            testing::_,
+            testing::_,
+            report.address_,
+            testing::_,
+            testing::_,
+            testing::_,
+            testing::_,
+            testing::_,
+            testing::_,
+            testing::_))
+        .Times(1);
+    test_hci_layer_->IncomingTruncatedLeMetaEvent(
+        LeExtendedAdvertisingReportBuilder::Create({report, truncated_report}), num_bytes);
+    fake_registry_.SynchronizeModuleHandler(&LeScanningManager::Factory, std::chrono::milliseconds(20));
+    testing::Mock::VerifyAndClearExpectations(&mock_callbacks_);
+  }
+}
+
 }  // namespace
 }  // namespace hci
 }  // namespace bluetooth
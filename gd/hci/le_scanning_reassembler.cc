@@ -0,0 +1,154 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hci/le_scanning_reassembler.h"
+
+#include <algorithm>
+
+#include "hci/hci_packets.h"
+#include "os/log.h"
+
+namespace bluetooth {
+namespace hci {
+
+uint64_t AdvertisingSetKey(const AddressWithType& address_with_type, uint8_t advertising_sid) {
+  uint64_t key = 0;
+  Address address = address_with_type.GetAddress();
+  for (size_t i = 0; i < Address::kLength; i++) {
+    key |= static_cast<uint64_t>(address.address[i]) << (8 * i);
+  }
+  key |= static_cast<uint64_t>(address_with_type.GetAddressType()) << 48;
+  key |= static_cast<uint64_t>(advertising_sid) << 56;
+  return key;
+}
+
+LeScanningReassembler::LeScanningReassembler(size_t capacity) : slots_(capacity) {
+  ASSERT(capacity > 0 && capacity < kEmptyBucket);
+  size_t num_buckets = 1;
+  while (num_buckets < 2 * capacity) {
+    num_buckets *= 2;
+  }
+  buckets_.resize(num_buckets, kEmptyBucket);
+}
+
+std::optional<LeScanningReassembler::AdvertisingData> LeScanningReassembler::ProcessAdvertisingReport(
+    uint16_t event_type,
+    const AddressWithType& address_with_type,
+    uint8_t advertising_sid,
+    const uint8_t* data,
+    size_t length) {
+  bool is_scannable = event_type & (1 << kScannableBit);
+  bool is_scan_response = event_type & (1 << kScanResponseBit);
+  bool is_legacy = event_type & (1 << kLegacyBit);
+  bool is_continuing = ((event_type >> kDataStatusBits) & 0x3) == static_cast<uint8_t>(DataStatus::CONTINUING);
+  // A scannable advertisement is only complete with its scan response
+  bool is_complete = !is_continuing && !(is_scannable && !is_scan_response);
+
+  uint64_t key = AdvertisingSetKey(address_with_type, advertising_sid);
+  size_t bucket = find_bucket(key);
+  if (bucket == buckets_.size()) {
+    if (is_legacy && is_scan_response) {
+      // The advertisement it responds to was not received, or was dropped
+      return std::nullopt;
+    }
+    if (is_complete) {
+      return AdvertisingData{data, length};
+    }
+    Slot* slot = allocate(key);
+    slot->data.assign(data, data + length);
+    return std::nullopt;
+  }
+
+  Slot& slot = slots_[buckets_[bucket]];
+  if (is_legacy && is_scannable && !is_scan_response) {
+    // A new advertisement from the same advertiser replaces the one still waiting for its scan response
+    slot.data.assign(data, data + length);
+  } else {
+    if (slot.data.size() + length > kMaxAdvertisingDataLength) {
+      LOG_WARN("Dropping advertisement longer than %zu bytes", kMaxAdvertisingDataLength);
+      release(bucket);
+      return std::nullopt;
+    }
+    slot.data.insert(slot.data.end(), data, data + length);
+  }
+  if (!is_complete) {
+    return std::nullopt;
+  }
+  // The slot keeps its data until it is taken again, which is after the next call at the earliest
+  release(bucket);
+  return AdvertisingData{slot.data.data(), slot.data.size()};
+}
+
+void LeScanningReassembler::Clear() {
+  for (auto& slot : slots_) {
+    slot.in_use = false;
+  }
+  std::fill(buckets_.begin(), buckets_.end(), kEmptyBucket);
+}
+
+size_t LeScanningReassembler::home_bucket(uint64_t key) const {
+  // Fibonacci hashing, so that keys differing only in their high bytes still spread over the table
+  return (key * 0x9e3779b97f4a7c15) >> (64 - __builtin_ctzll(buckets_.size()));
+}
+
+size_t LeScanningReassembler::find_bucket(uint64_t key) const {
+  size_t mask = buckets_.size() - 1;
+  for (size_t i = home_bucket(key); buckets_[i] != kEmptyBucket; i = (i + 1) & mask) {
+    if (slots_[buckets_[i]].key == key) {
+      return i;
+    }
+  }
+  return buckets_.size();
+}
+
+LeScanningReassembler::Slot* LeScanningReassembler::allocate(uint64_t key) {
+  size_t index = next_slot_;
+  next_slot_ = (next_slot_ + 1) % slots_.size();
+  Slot* slot = &slots_[index];
+  if (slot->in_use) {
+    release(find_bucket(slot->key));
+  }
+  slot->key = key;
+  slot->in_use = true;
+  size_t mask = buckets_.size() - 1;
+  size_t i = home_bucket(key);
+  while (buckets_[i] != kEmptyBucket) {
+    i = (i + 1) & mask;
+  }
+  buckets_[i] = index;
+  return slot;
+}
+
+void LeScanningReassembler::release(size_t bucket) {
+  slots_[buckets_[bucket]].in_use = false;
+  // Shift back the following entries of the probe sequence into the hole, so that lookups can stop at the first empty
+  // bucket without needing tombstones
+  size_t mask = buckets_.size() - 1;
+  size_t hole = bucket;
+  for (size_t i = (hole + 1) & mask; buckets_[i] != kEmptyBucket; i = (i + 1) & mask) {
+    size_t home = home_bucket(slots_[buckets_[i]].key);
+    // The entry at i can move to the hole if its home bucket is not in (hole, i], cyclically
+    bool home_after_hole = hole < i ? (home > hole && home <= i) : (home > hole || home <= i);
+    if (!home_after_hole) {
+      buckets_[hole] = buckets_[i];
+      hole = i;
+    }
+  }
+  buckets_[hole] = kEmptyBucket;
+}
+
+}  // namespace hci
+}  // namespace bluetooth
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "hci/address_with_type.h"
+
+namespace bluetooth {
+namespace hci {
+
+// Bits of the extended advertising report event type
+constexpr uint8_t kConnectableBit = 0;
+constexpr uint8_t kScannableBit = 1;
+constexpr uint8_t kDirectedBit = 2;
+constexpr uint8_t kScanResponseBit = 3;
+constexpr uint8_t kLegacyBit = 4;
+constexpr uint8_t kDataStatusBits = 5;
+
+// Identify the advertisements of one advertising set: the address in the low 48 bits, then the address type and SID
+uint64_t AdvertisingSetKey(const AddressWithType& address_with_type, uint8_t advertising_sid);
+
+// Reassembles the advertising data of advertisements received over several reports: legacy scannable advertisements
+// followed by their scan response, and extended advertisements split in fragments.
+//
+// Pending advertisements are kept in a fixed number of slots, found through an open addressing hash table on the
+// advertiser address, address type and SID. When all the slots are taken, the oldest pending advertisement is dropped.
+// Slot buffers are reused, so that reassembling does not allocate once they have grown. Advertisements received in a
+// single report, the vast majority, do not go through the slots at all.
+//
+// NOT THREAD SAFE
+class LeScanningReassembler {
+ public:
+  static constexpr size_t kDefaultCapacity = 1024;
+  // Largest advertising data of an extended advertisement
+  static constexpr size_t kMaxAdvertisingDataLength = 1650;
+
+  // Complete advertising data, not owned. Points into the report passed to ProcessAdvertisingReport() or into a
+  // reassembly buffer, and is only valid until the next call to the reassembler.
+  struct AdvertisingData {
+    const uint8_t* data;
+    size_t length;
+  };
+
+  explicit LeScanningReassembler(size_t capacity = kDefaultCapacity);
+
+  // Process the advertising data of one report, with its extended advertising report |event_type|. Return the complete
+  // advertising data if this report completes an advertisement, or std::nullopt if more reports are expected or this
+  // one is dropped.
+  std::optional<AdvertisingData> ProcessAdvertisingReport(
+      uint16_t event_type,
+      const AddressWithType& address_with_type,
+      uint8_t advertising_sid,
+      const uint8_t* data,
+      size_t length);
+
+  // Drop all the pending advertisements
+  void Clear();
+
+ private:
+  struct Slot {
+    uint64_t key = 0;
+    bool in_use = false;
+    std::vector<uint8_t> data;
+  };
+
+  static constexpr uint32_t kEmptyBucket = UINT32_MAX;
+
+  std::vector<Slot> slots_;
+  // Indices into |slots_| of the pending advertisements, kept at most half full
+  std::vector<uint32_t> buckets_;
+  // Slots are taken in turn, so that the next one holds the oldest pending advertisement
+  size_t next_slot_ = 0;
+
+  size_t home_bucket(uint64_t key) const;
+  size_t find_bucket(uint64_t key) const;
+  Slot* allocate(uint64_t key);
+  void release(size_t bucket);
+};
+
+}  // namespace hci
+}  // namespace bluetooth
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "hci/address_with_type.h"
+#include "hci/le_scanning_duplicate_filter.h"
+#include "hci/le_scanning_reassembler.h"
+
+using ::benchmark::State;
+using ::bluetooth::hci::Address;
+using ::bluetooth::hci::AddressType;
+using ::bluetooth::hci::AddressWithType;
+using ::bluetooth::hci::kConnectableBit;
+using ::bluetooth::hci::kLegacyBit;
+using ::bluetooth::hci::kScannableBit;
+using ::bluetooth::hci::kScanResponseBit;
+using ::bluetooth::hci::LeScanningDuplicateFilter;
+using ::bluetooth::hci::LeScanningReassembler;
+
+namespace {
+
+constexpr uint16_t kLegacyScannable = (1 << kConnectableBit) | (1 << kScannableBit) | (1 << kLegacyBit);
+constexpr uint16_t kLegacyScanResponse = kLegacyScannable | (1 << kScanResponseBit);
+constexpr uint16_t kLegacyNonConnectable = 1 << kLegacyBit;
+
+std::vector<AddressWithType> MakeAdvertisers(size_t num_advertisers) {
+  std::vector<AddressWithType> advertisers;
+  for (size_t i = 0; i < num_advertisers; i++) {
+    advertisers.emplace_back(
+        Address({static_cast<uint8_t>(i), static_cast<uint8_t>(i >> 8), 0x5a, 0x00, 0x00, 0xc0}),
+        AddressType::RANDOM_DEVICE_ADDRESS);
+  }
+  return advertisers;
+}
+
+// Every advertiser sends a scannable advertisement, then its scan response once all the others have advertised, which
+// keeps all of them pending at once
+void BM_ScannableAdvertisements(State& state) {
+  auto advertisers = MakeAdvertisers(state.range(0));
+  std::vector<uint8_t> advertisement(31, 0xaa);
+  std::vector<uint8_t> scan_response(31, 0x55);
+  LeScanningReassembler reassembler;
+  for (auto _ : state) {
+    for (const auto& advertiser : advertisers) {
+      reassembler.ProcessAdvertisingReport(
+          kLegacyScannable, advertiser, 0, advertisement.data(), advertisement.size());
+    }
+    for (const auto& advertiser : advertisers) {
+      auto data = reassembler.ProcessAdvertisingReport(
+          kLegacyScanResponse, advertiser, 0, scan_response.data(), scan_response.size());
+      benchmark::DoNotOptimize(data);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * advertisers.size() * 2);
+}
+
+BENCHMARK(BM_ScannableAdvertisements)->Arg(10)->Arg(100)->Arg(1000);
+
+// Non scannable advertisements, repeated by the same advertisers, through the reassembler and the duplicate filter
+void BM_RepeatedAdvertisements(State& state) {
+  auto advertisers = MakeAdvertisers(state.range(0));
+  std::vector<uint8_t> advertisement(31, 0xaa);
+  LeScanningReassembler reassembler;
+  LeScanningDuplicateFilter duplicate_filter(5);
+  for (auto _ : state) {
+    for (const auto& advertiser : advertisers) {
+      auto data = reassembler.ProcessAdvertisingReport(
+          kLegacyNonConnectable, advertiser, 0, advertisement.data(), advertisement.size());
+      bool deliver =
+          duplicate_filter.ShouldDeliver(kLegacyNonConnectable, advertiser, 0, -60, data->data, data->length);
+      benchmark::DoNotOptimize(deliver);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * advertisers.size());
+}
+
+BENCHMARK(BM_RepeatedAdvertisements)->Arg(10)->Arg(100)->Arg(1000);
+
+}  // namespace
@@ -0,0 +1,181 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hci/le_scanning_reassembler.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "hci/hci_packets.h"
+
+namespace bluetooth {
+namespace hci {
+namespace {
+
+constexpr uint16_t kLegacyScannable = (1 << kConnectableBit) | (1 << kScannableBit) | (1 << kLegacyBit);
+constexpr uint16_t kLegacyScanResponse = kLegacyScannable | (1 << kScanResponseBit);
+constexpr uint16_t kLegacyNonConnectable = 1 << kLegacyBit;
+constexpr uint16_t kExtendedComplete = static_cast<uint16_t>(DataStatus::COMPLETE) << kDataStatusBits;
+constexpr uint16_t kExtendedContinuing = static_cast<uint16_t>(DataStatus::CONTINUING) << kDataStatusBits;
+constexpr uint8_t kSid = 1;
+
+const AddressWithType kAddress(Address({0x01, 0x02, 0x03, 0x04, 0x05, 0x06}), AddressType::PUBLIC_DEVICE_ADDRESS);
+
+AddressWithType MakeAddress(uint32_t index) {
+  return AddressWithType(
+      Address({static_cast<uint8_t>(index),
+               static_cast<uint8_t>(index >> 8),
+               static_cast<uint8_t>(index >> 16),
+               0x00,
+               0x00,
+               0x01}),
+      AddressType::RANDOM_DEVICE_ADDRESS);
+}
+
+std::vector<uint8_t> ToVector(const std::optional<LeScanningReassembler::AdvertisingData>& data) {
+  return std::vector<uint8_t>(data->data, data->data + data->length);
+}
+
+TEST(LeScanningReassemblerTest, single_report_is_not_copied) {
+  LeScanningReassembler reassembler;
+  std::vector<uint8_t> data = {0x02, 0x01, 0x06};
+  auto result =
+      reassembler.ProcessAdvertisingReport(kLegacyNonConnectable, kAddress, kSid, data.data(), data.size());
+  ASSERT_TRUE(result.has_value());
+  ASSERT_EQ(result->data, data.data());
+  ASSERT_EQ(result->length, data.size());
+}
+
+TEST(LeScanningReassemblerTest, scannable_advertisement_waits_for_scan_response) {
+  LeScanningReassembler reassembler;
+  std::vector<uint8_t> advertisement = {0x02, 0x01, 0x06};
+  std::vector<uint8_t> scan_response = {0x03, 0x09, 'a', 'b'};
+  ASSERT_FALSE(reassembler
+                   .ProcessAdvertisingReport(
+                       kLegacyScannable, kAddress, kSid, advertisement.data(), advertisement.size())
+                   .has_value());
+  auto result = reassembler.ProcessAdvertisingReport(
+      kLegacyScanResponse, kAddress, kSid, scan_response.data(), scan_response.size());
+  ASSERT_TRUE(result.has_value());
+  std::vector<uint8_t> expected = {0x02, 0x01, 0x06, 0x03, 0x09, 'a', 'b'};
+  ASSERT_EQ(ToVector(result), expected);
+
+  // The scan response completed the advertisement, a second one has nothing to go with
+  ASSERT_FALSE(reassembler
+                   .ProcessAdvertisingReport(
+                       kLegacyScanResponse, kAddress, kSid, scan_response.data(), scan_response.size())
+                   .has_value());
+}
+
+TEST(LeScanningReassemblerTest, new_advertisement_replaces_the_pending_one) {
+  LeScanningReassembler reassembler;
+  std::vector<uint8_t> first = {0x02, 0x01, 0x06};
+  std::vector<uint8_t> second = {0x02, 0x01, 0x1a};
+  std::vector<uint8_t> scan_response = {0x02, 0x0a, 0x00};
+  reassembler.ProcessAdvertisingReport(kLegacyScannable, kAddress, kSid, first.data(), first.size());
+  reassembler.ProcessAdvertisingReport(kLegacyScannable, kAddress, kSid, second.data(), second.size());
+  auto result = reassembler.ProcessAdvertisingReport(
+      kLegacyScanResponse, kAddress, kSid, scan_response.data(), scan_response.size());
+  std::vector<uint8_t> expected = {0x02, 0x01, 0x1a, 0x02, 0x0a, 0x00};
+  ASSERT_EQ(ToVector(result), expected);
+}
+
+TEST(LeScanningReassemblerTest, scan_response_without_advertisement_is_dropped) {
+  LeScanningReassembler reassembler;
+  std::vector<uint8_t> scan_response = {0x02, 0x0a, 0x00};
+  ASSERT_FALSE(reassembler
+                   .ProcessAdvertisingReport(
+                       kLegacyScanResponse, kAddress, kSid, scan_response.data(), scan_response.size())
+                   .has_value());
+}
+
+TEST(LeScanningReassemblerTest, extended_fragments_are_concatenated) {
+  LeScanningReassembler reassembler;
+  std::vector<uint8_t> expected;
+  for (uint8_t i = 0; i < 3; i++) {
+    std::vector<uint8_t> fragment(200, i);
+    expected.insert(expected.end(), fragment.begin(), fragment.end());
+    ASSERT_FALSE(reassembler
+                     .ProcessAdvertisingReport(kExtendedContinuing, kAddress, kSid, fragment.data(), fragment.size())
+                     .has_value());
+  }
+  std::vector<uint8_t> last_fragment = {0xff};
+  expected.push_back(0xff);
+  auto result = reassembler.ProcessAdvertisingReport(
+      kExtendedComplete, kAddress, kSid, last_fragment.data(), last_fragment.size());
+  ASSERT_TRUE(result.has_value());
+  ASSERT_EQ(ToVector(result), expected);
+}
+
+TEST(LeScanningReassemblerTest, advertising_sets_are_reassembled_separately) {
+  LeScanningReassembler reassembler;
+  std::vector<uint8_t> fragment_1 = {0x01};
+  std::vector<uint8_t> fragment_2 = {0x02};
+  reassembler.ProcessAdvertisingReport(kExtendedContinuing, kAddress, 1, fragment_1.data(), fragment_1.size());
+  reassembler.ProcessAdvertisingReport(kExtendedContinuing, kAddress, 2, fragment_2.data(), fragment_2.size());
+  auto result =
+      reassembler.ProcessAdvertisingReport(kExtendedComplete, kAddress, 1, fragment_1.data(), fragment_1.size());
+  ASSERT_EQ(ToVector(result), std::vector<uint8_t>({0x01, 0x01}));
+  result = reassembler.ProcessAdvertisingReport(kExtendedComplete, kAddress, 2, fragment_2.data(), fragment_2.size());
+  ASSERT_EQ(ToVector(result), std::vector<uint8_t>({0x02, 0x02}));
+}
+
+TEST(LeScanningReassemblerTest, too_long_advertisement_is_dropped) {
+  LeScanningReassembler reassembler;
+  std::vector<uint8_t> fragment(251, 0xaa);
+  size_t received = 0;
+  while (received + fragment.size() <= LeScanningReassembler::kMaxAdvertisingDataLength) {
+    reassembler.ProcessAdvertisingReport(kExtendedContinuing, kAddress, kSid, fragment.data(), fragment.size());
+    received += fragment.size();
+  }
+  ASSERT_FALSE(reassembler
+                   .ProcessAdvertisingReport(kExtendedComplete, kAddress, kSid, fragment.data(), fragment.size())
+                   .has_value());
+
+  // The next advertisement starts from scratch
+  auto result =
+      reassembler.ProcessAdvertisingReport(kExtendedComplete, kAddress, kSid, fragment.data(), fragment.size());
+  ASSERT_EQ(result->length, fragment.size());
+}
+
+TEST(LeScanningReassemblerTest, oldest_pending_advertisement_is_evicted) {
+  constexpr size_t kCapacity = 16;
+  LeScanningReassembler reassembler(kCapacity);
+  std::vector<uint8_t> data = {0x02, 0x01, 0x06};
+  for (uint32_t i = 0; i <= kCapacity; i++) {
+    reassembler.ProcessAdvertisingReport(kLegacyScannable, MakeAddress(i), kSid, data.data(), data.size());
+  }
+  // The first advertiser was evicted to make room for the last one
+  ASSERT_FALSE(reassembler.ProcessAdvertisingReport(kLegacyScanResponse, MakeAddress(0), kSid, nullptr, 0).has_value());
+  for (uint32_t i = 1; i <= kCapacity; i++) {
+    auto result = reassembler.ProcessAdvertisingReport(kLegacyScanResponse, MakeAddress(i), kSid, nullptr, 0);
+    ASSERT_TRUE(result.has_value()) << "advertiser " << i;
+    ASSERT_EQ(ToVector(result), data);
+  }
+}
+
+TEST(LeScanningReassemblerTest, clear_drops_pending_advertisements) {
+  LeScanningReassembler reassembler;
+  std::vector<uint8_t> data = {0x02, 0x01, 0x06};
+  reassembler.ProcessAdvertisingReport(kLegacyScannable, kAddress, kSid, data.data(), data.size());
+  reassembler.Clear();
+  ASSERT_FALSE(reassembler.ProcessAdvertisingReport(kLegacyScanResponse, kAddress, kSid, nullptr, 0).has_value());
+}
+
+}  // namespace
+}  // namespace hci
+}  // namespace bluetooth
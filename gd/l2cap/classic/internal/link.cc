@@ -45,7 +45,8 @@ Link::Link(
     LinkManager* link_manager)
     : l2cap_handler_(l2cap_handler),
       acl_connection_(std::move(acl_connection)),
-      data_pipeline_manager_(l2cap_handler, this, acl_connection_->GetAclQueueEnd()),
+      data_pipeline_manager_(l2cap_handler, this, acl_connection_->GetAclQueueEnd(),
+                             l2cap::internal::DataPipelineManager::GetSchedulerType()),
       parameter_provider_(parameter_provider),
       dynamic_service_manager_(dynamic_service_manager),
       fixed_service_manager_(fixed_service_manager),
@@ -175,6 +176,10 @@ void Link::SetChannelTxPriority(Cid local_cid, bool high_priority) {
   data_pipeline_manager_.SetChannelTxPriority(local_cid, high_priority);
 }
 
+void Link::SetChannelWeight(Cid local_cid, uint8_t weight) {
+  data_pipeline_manager_.SetChannelWeight(local_cid, weight);
+}
+
 void Link::SetPendingDynamicChannels(std::list<Psm> psm_list,
                                      std::list<Link::PendingDynamicChannelConnection> callback_list) {
   ASSERT(psm_list.size() == callback_list.size());
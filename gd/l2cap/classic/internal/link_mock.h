@@ -46,6 +46,7 @@ class MockLink : public Link {
 
   MOCK_METHOD(bool, IsFixedChannelAllocated, (Cid cid), (override));
   MOCK_METHOD(void, RefreshRefCount, (), (override));
+  MOCK_METHOD(void, SetChannelWeight, (Cid local_cid, uint8_t weight), (override));
 };
 
 }  // namespace testing
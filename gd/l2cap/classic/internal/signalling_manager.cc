@@ -21,6 +21,7 @@
 #include "common/bind.h"
 #include "l2cap/classic/internal/channel_configuration_state.h"
 #include "l2cap/classic/internal/link.h"
+#include "l2cap/internal/enhanced_retransmission_mode_channel_data_controller.h"
 #include "l2cap/internal/data_pipeline_manager.h"
 #include "l2cap/l2cap_packets.h"
 #include "os/log.h"
@@ -414,7 +415,7 @@ void ClassicSignallingManager::SendInitialConfigRequest(Cid local_cid) {
       configuration_state.retransmission_and_flow_control_mode_ =
           RetransmissionAndFlowControlModeOption::ENHANCED_RETRANSMISSION;
       // TODO: Decide where to put initial values
-      retransmission_flow_control_configuration->tx_window_size_ = 10;
+      retransmission_flow_control_configuration->tx_window_size_ = l2cap::internal::ErtmController::GetLocalTxWindow();
       retransmission_flow_control_configuration->max_transmit_ = 20;
       retransmission_flow_control_configuration->retransmission_time_out_ = 2000;
       retransmission_flow_control_configuration->monitor_time_out_ = 12000;
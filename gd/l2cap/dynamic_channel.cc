@@ -47,5 +47,9 @@ void DynamicChannel::HACK_SetChannelTxPriority(bool high_priority) {
   return impl_->SetChannelTxPriority(high_priority);
 }
 
+void DynamicChannel::SetChannelWeight(uint8_t weight) {
+  l2cap_handler_->CallOn(impl_.get(), &l2cap::internal::DynamicChannelImpl::SetChannelWeight, weight);
+}
+
 }  // namespace l2cap
 }  // namespace bluetooth
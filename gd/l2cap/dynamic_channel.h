@@ -78,6 +78,13 @@ class DynamicChannel {
    */
   void HACK_SetChannelTxPriority(bool high_priority);
 
+  /**
+   * Set the share of the link given to this channel, relative to the other channels of the link with the same
+   * priority. Only used when the link scheduler shares the link by weight, see DataPipelineManager::kSchedulerProperty.
+   * @param weight 1 by default
+   */
+  void SetChannelWeight(uint8_t weight);
+
  private:
   std::shared_ptr<l2cap::internal::DynamicChannelImpl> impl_;
   os::Handler* l2cap_handler_;
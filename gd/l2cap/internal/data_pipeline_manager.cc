@@ -22,11 +22,21 @@
 #include "l2cap/internal/data_pipeline_manager.h"
 #include "l2cap/internal/sender.h"
 #include "os/log.h"
+#include "os/system_properties.h"
 
 namespace bluetooth {
 namespace l2cap {
 namespace internal {
 
+const std::string DataPipelineManager::kSchedulerProperty = "persist.bluetooth.l2capscheduler";
+
+DataPipelineManager::SchedulerType DataPipelineManager::GetSchedulerType() {
+  if (os::GetSystemProperty(kSchedulerProperty) == "drr") {
+    return SchedulerType::DEFICIT_ROUND_ROBIN;
+  }
+  return SchedulerType::FIFO;
+}
+
 void DataPipelineManager::AttachChannel(Cid cid, std::shared_ptr<ChannelImpl> channel, ChannelMode mode) {
   ASSERT(sender_map_.find(cid) == sender_map_.end());
   sender_map_.emplace(std::piecewise_construct, std::forward_as_tuple(cid),
@@ -62,6 +72,22 @@ void DataPipelineManager::SetChannelTxPriority(Cid cid, bool high_priority) {
   scheduler_->SetChannelTxPriority(cid, high_priority);
 }
 
+void DataPipelineManager::SetChannelWeight(Cid cid, uint8_t weight) {
+  ASSERT(sender_map_.find(cid) != sender_map_.end());
+  scheduler_->SetChannelWeight(cid, weight);
+}
+
+std::unique_ptr<Scheduler> DataPipelineManager::create_scheduler(SchedulerType scheduler_type,
+                                                                 LowerQueueUpEnd* link_queue_up_end) {
+  switch (scheduler_type) {
+    case SchedulerType::FIFO:
+      return std::make_unique<Fifo>(this, link_queue_up_end, handler_);
+    case SchedulerType::DEFICIT_ROUND_ROBIN:
+      return std::make_unique<DeficitRoundRobin>(this, link_queue_up_end, handler_);
+  }
+  LOG_ALWAYS_FATAL("unknown scheduler type %d", static_cast<int>(scheduler_type));
+}
+
 }  // namespace internal
 }  // namespace l2cap
 }  // namespace bluetooth
@@ -27,6 +27,7 @@
 #include "l2cap/internal/channel_impl.h"
 #include "l2cap/internal/receiver.h"
 #include "l2cap/internal/scheduler.h"
+#include "l2cap/internal/scheduler_drr.h"
 #include "l2cap/internal/scheduler_fifo.h"
 #include "l2cap/l2cap_packets.h"
 #include "l2cap/mtu.h"
@@ -55,8 +56,21 @@ class DataPipelineManager {
   using LowerDequeue = UpperEnqueue;
   using LowerQueueUpEnd = common::BidiQueueEnd<LowerEnqueue, LowerDequeue>;
 
-  DataPipelineManager(os::Handler* handler, ILink* link, LowerQueueUpEnd* link_queue_up_end)
-      : handler_(handler), link_(link), scheduler_(std::make_unique<Fifo>(this, link_queue_up_end, handler)),
+  enum class SchedulerType {
+    // Channels are served in the order they have packets ready. The default.
+    FIFO,
+    // Control channels first, then the rest shared by weight, see DeficitRoundRobin. Opt-in only.
+    DEFICIT_ROUND_ROBIN,
+  };
+
+  // Set to "drr" to create new links with DEFICIT_ROUND_ROBIN
+  static const std::string kSchedulerProperty;
+  // The scheduler new links should be created with
+  static SchedulerType GetSchedulerType();
+
+  DataPipelineManager(os::Handler* handler, ILink* link, LowerQueueUpEnd* link_queue_up_end,
+                      SchedulerType scheduler_type = SchedulerType::FIFO)
+      : handler_(handler), link_(link), scheduler_(create_scheduler(scheduler_type, link_queue_up_end)),
         receiver_(link_queue_up_end, handler, this) {}
 
   using ChannelMode = Sender::ChannelMode;
@@ -67,6 +81,7 @@ class DataPipelineManager {
   virtual void OnPacketSent(Cid cid);
   virtual void UpdateClassicConfiguration(Cid cid, classic::internal::ChannelConfigurationState config);
   virtual void SetChannelTxPriority(Cid cid, bool high_priority);
+  virtual void SetChannelWeight(Cid cid, uint8_t weight);
   virtual ~DataPipelineManager() = default;
 
  private:
@@ -75,6 +90,8 @@ class DataPipelineManager {
   std::unordered_map<Cid, Sender> sender_map_;
   std::unique_ptr<Scheduler> scheduler_;
   Receiver receiver_;
+
+  std::unique_ptr<Scheduler> create_scheduler(SchedulerType scheduler_type, LowerQueueUpEnd* link_queue_up_end);
 };
 }  // namespace internal
 }  // namespace l2cap
@@ -70,6 +70,10 @@ class DynamicChannelImpl : public l2cap::internal::ChannelImpl {
     link_->SetChannelTxPriority(cid_, high_priority);
   }
 
+  virtual void SetChannelWeight(uint8_t weight) {
+    link_->SetChannelWeight(cid_, weight);
+  }
+
   // TODO(cmanton) Do something a little bit better than this
   bool local_initiated_{false};
 
@@ -167,6 +167,15 @@ TEST_F(L2capClassicDynamicChannelImplTest, multiple_registeration_should_fail) {
   delete my_status;
 }
 
+TEST_F(L2capClassicDynamicChannelImplTest, set_channel_weight_on_link) {
+  MockParameterProvider mock_parameter_provider;
+  MockLink mock_classic_link(l2cap_handler_, &mock_parameter_provider);
+  DynamicChannelImpl dynamic_channel_impl(0x01, kFirstDynamicChannel, kFirstDynamicChannel, &mock_classic_link,
+                                          l2cap_handler_);
+  EXPECT_CALL(mock_classic_link, SetChannelWeight(kFirstDynamicChannel, 4));
+  dynamic_channel_impl.SetChannelWeight(4);
+}
+
 }  // namespace internal
 }  // namespace l2cap
 }  // namespace bluetooth
@@ -16,23 +16,41 @@
 
 #include "l2cap/internal/enhanced_retransmission_mode_channel_data_controller.h"
 
-#include <map>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <deque>
+#include <optional>
 #include <queue>
+#include <tuple>
 #include <vector>
 
 #include "common/bind.h"
+#include "common/strings.h"
 #include "l2cap/internal/ilink.h"
 #include "os/alarm.h"
-#include "packet/fragmenting_inserter.h"
-#include "packet/raw_builder.h"
+#include "os/system_properties.h"
+#include "packet/bit_inserter.h"
+#include "packet/fragment_builder.h"
 
 namespace bluetooth {
 namespace l2cap {
 namespace internal {
+
+namespace {
+constexpr uint16_t kDefaultTxWindow = 10;
+// Largest TxWindow with the standard control field, which is the only one we support
+constexpr uint16_t kMaxStandardTxWindow = 63;
+}  // namespace
+
+const std::string ErtmController::kTxWindowProperty = "persist.bluetooth.ertmtxwindow";
+const std::string ErtmController::kRejOnlyProperty = "persist.bluetooth.ertmrejonly";
+
 ErtmController::ErtmController(ILink* link, Cid cid, Cid remote_cid, UpperQueueDownEnd* channel_queue_end,
                                os::Handler* handler, Scheduler* scheduler)
     : link_(link), cid_(cid), remote_cid_(remote_cid), enqueue_buffer_(channel_queue_end), handler_(handler),
-      scheduler_(scheduler), pimpl_(std::make_unique<impl>(this, handler)) {}
+      scheduler_(scheduler), srej_enabled_(os::GetSystemProperty(kRejOnlyProperty) != "true"),
+      pimpl_(std::make_unique<impl>(this, handler)) {}
 
 ErtmController::~ErtmController() {
   enqueue_buffer_.Clear();
@@ -40,7 +58,8 @@ ErtmController::~ErtmController() {
 
 struct ErtmController::impl {
   impl(ErtmController* controller, os::Handler* handler)
-      : controller_(controller), handler_(handler), retrans_timer_(handler), monitor_timer_(handler) {}
+      : controller_(controller), handler_(handler), retrans_timer_(handler), monitor_timer_(handler),
+        ack_timer_(handler) {}
 
   ErtmController* controller_;
   os::Handler* handler_;
@@ -48,8 +67,9 @@ struct ErtmController::impl {
   // We don't support extended window
   static constexpr uint8_t kMaxTxWin = 64;
 
-  // We don't support sending SREJ
-  static constexpr bool kSendSrej = false;
+  // Received I-frames are acknowledged at the latest after this delay, when they are not acknowledged by an I-frame
+  // we send or by filling 3/4 of the window first. It has to be well below the retransmission timeout of the remote.
+  static constexpr std::chrono::milliseconds kAckTimeout = std::chrono::milliseconds(200);
 
   // States (@see 8.6.5.2): Transmitter state and receiver state
 
@@ -78,26 +98,51 @@ struct ErtmController::impl {
   bool remote_busy_ = false;
   bool local_busy_ = false;
   int unacked_frames_ = 0;
-  // TODO: Instead of having a map, we may consider about a better data structure
-  // Map from TxSeq to (SAR, SDU size for START packet, information payload)
-  std::map<uint8_t, std::tuple<SegmentationAndReassembly, uint16_t, std::shared_ptr<packet::RawBuilder>>> unacked_list_;
+
+  // An I-frame sent and not acknowledged yet
+  struct UnackedFrame {
+    SegmentationAndReassembly sar = SegmentationAndReassembly::UNSEGMENTED;
+    // Only applies to START frames
+    uint16_t sdu_size = 0;
+    // nullptr if the slot is free. Each (re)transmission sends a copy of the segment, which shares its bytes
+    std::unique_ptr<packet::FragmentBuilder> segment;
+    int retry_count = 0;
+  };
+  // Indexed by TxSeq. The frames from ExpectedAckSeq to NextTxSeq are in use.
+  std::array<UnackedFrame, kMaxTxWin> unacked_list_;
   // Stores (SAR, SDU size for START packet, information payload)
-  std::queue<std::tuple<SegmentationAndReassembly, uint16_t, std::unique_ptr<packet::RawBuilder>>> pending_frames_;
+  std::queue<std::tuple<SegmentationAndReassembly, uint16_t, std::unique_ptr<packet::FragmentBuilder>>>
+      pending_frames_;
+
+  // An I-frame received out of sequence, held until the frames before it are retransmitted
+  struct SavedFrame {
+    SegmentationAndReassembly sar;
+    uint16_t sdu_size;
+    packet::PacketView<kLittleEndian> payload;
+  };
+  // Indexed by TxSeq. Only used in the SREJ_SENT state, for the frames from BufferSeq to ExpectedTxSeq.
+  std::array<std::optional<SavedFrame>, kMaxTxWin> srej_saved_frames_;
+  // TxSeq of the I-frames requested with SREJ and not received yet, in the order they were requested
+  std::deque<uint8_t> srej_list_;
+
   int retry_count_ = 0;
-  std::map<uint8_t /* tx_seq, */, int /* count */> retry_i_frames_;
   bool rnr_sent_ = false;
   bool rej_actioned_ = false;
   bool srej_actioned_ = false;
   uint16_t srej_save_req_seq_ = 0;
   bool send_rej_ = false;
-  int buffer_seq_srej_ = 0;
   int frames_sent_ = 0;
+  // I-frames delivered since BufferSeq was last sent to the remote
+  int frames_to_ack_ = 0;
   os::Alarm retrans_timer_;
   os::Alarm monitor_timer_;
+  os::Alarm ack_timer_;
+  bool ack_timer_running_ = false;
 
   // Events (@see 8.6.5.4)
 
-  void data_request(SegmentationAndReassembly sar, std::unique_ptr<packet::RawBuilder> pdu, uint16_t sdu_size = 0) {
+  void data_request(SegmentationAndReassembly sar, std::unique_ptr<packet::FragmentBuilder> pdu,
+                    uint16_t sdu_size = 0) {
     // Note: sdu_size only applies to START packet
     if (tx_state_ == TxState::XMIT && !remote_busy() && rem_window_not_full()) {
       send_data(sar, sdu_size, std::move(pdu));
@@ -172,6 +217,13 @@ struct ErtmController::impl {
     }
   }
 
+  void ack_timer_expires() {
+    ack_timer_running_ = false;
+    if (frames_to_ack_ > 0 && rx_state_ != RxState::SREJ_SENT) {
+      send_rr_or_rnr();
+    }
+  }
+
   void recv_i_frame(Final f, uint8_t tx_seq, uint8_t req_seq, SegmentationAndReassembly sar, uint16_t sdu_size,
                     const packet::PacketView<true>& payload) {
     if (rx_state_ == RxState::RECV) {
@@ -186,19 +238,17 @@ struct ErtmController::impl {
         increment_expected_tx_seq();
         pass_to_tx(req_seq, f);
         data_indication(sar, sdu_size, payload);
-        if (!rej_actioned_) {
-          retransmit_i_frames(req_seq);
-          send_pending_i_frames();
-        } else {
-          rej_actioned_ = false;
-        }
+        retransmit_on_poll_response(req_seq);
         send_ack(Final::NOT_SET);
       } else if (with_duplicate_tx_seq(tx_seq) && with_valid_req_seq(req_seq) && with_valid_f_bit(f) && !local_busy()) {
         pass_to_tx(req_seq, f);
       } else if (with_unexpected_tx_seq(tx_seq) && with_valid_req_seq(req_seq) && with_valid_f_bit(f) &&
                  !local_busy()) {
-        if constexpr (kSendSrej) {
-          // We don't support sending SREJ
+        if (controller_->srej_enabled_) {
+          pass_to_tx(req_seq, f);
+          save_i_frame_srej(tx_seq, sar, sdu_size, payload);
+          init_srej(tx_seq);
+          rx_state_ = RxState::SREJ_SENT;
         } else {
           pass_to_tx(req_seq, f);
           send_rej();
@@ -228,19 +278,49 @@ struct ErtmController::impl {
         increment_expected_tx_seq();
         pass_to_tx(req_seq, f);
         data_indication(sar, sdu_size, payload);
-        if (!rej_actioned_) {
-          retransmit_i_frames(req_seq);
-          send_pending_i_frames();
-        } else {
-          rej_actioned_ = false;
-        }
+        retransmit_on_poll_response(req_seq);
         send_ack(Final::NOT_SET);
         rx_state_ = RxState::RECV;
       } else if (with_unexpected_tx_seq(tx_seq) && with_valid_req_seq(req_seq) && with_valid_f_bit(f)) {
         pass_to_tx(req_seq, f);
       }
     } else if (rx_state_ == RxState::SREJ_SENT) {
-      // SREJ NOT SUPPORTED
+      if (with_invalid_req_seq(req_seq)) {
+        CloseChannel();
+        return;
+      }
+      if (!with_valid_f_bit(f)) {
+        return;
+      }
+      if (with_expected_tx_seq_srej(tx_seq)) {
+        pass_to_tx(req_seq, f);
+        save_i_frame_srej(tx_seq, sar, sdu_size, payload);
+        pop_srej_list();
+        data_indication_srej();
+        if (f == Final::POLL_RESPONSE) {
+          retransmit_on_poll_response(req_seq);
+        }
+        if (srej_list_.empty()) {
+          rx_state_ = RxState::RECV;
+          send_ack(Final::NOT_SET);
+        }
+      } else if (with_expected_tx_seq(tx_seq)) {
+        increment_expected_tx_seq();
+        pass_to_tx(req_seq, f);
+        save_i_frame_srej(tx_seq, sar, sdu_size, payload);
+      } else if (with_unexpected_tx_seq_srej(tx_seq)) {
+        pass_to_tx(req_seq, f);
+        save_i_frame_srej(tx_seq, sar, sdu_size, payload);
+        resend_srej_before(tx_seq);
+      } else if (with_unexpected_tx_seq(tx_seq)) {
+        pass_to_tx(req_seq, f);
+        save_i_frame_srej(tx_seq, sar, sdu_size, payload);
+        send_srej_up_to(tx_seq);
+      } else if (with_duplicate_tx_seq(tx_seq)) {
+        pass_to_tx(req_seq, f);
+      } else if (with_invalid_tx_seq(tx_seq) && controller_->local_tx_window_ > kMaxTxWin / 2) {
+        CloseChannel();
+      }
     }
   }
 
@@ -296,23 +376,7 @@ struct ErtmController::impl {
         CloseChannel();
       }
     } else if (rx_state_ == RxState::SREJ_SENT) {
-      // SREJ NOT SUPPORTED
-    }
-  }
-
-  void recv_rej(uint8_t req_seq, Poll p = Poll::NOT_SET, Final f = Final::NOT_SET) {
-    if (rx_state_ == RxState::RECV) {
-      if (f == Final::NOT_SET && with_valid_req_seq_retrans(req_seq) &&
-          retry_i_frames_less_than_max_transmit(req_seq) && with_valid_f_bit(f)) {
-        remote_busy_ = false;
-        pass_to_tx(req_seq, f);
-        retransmit_i_frames(req_seq, p);
-        send_pending_i_frames();
-        if (p_bit_outstanding()) {
-          rej_actioned_ = true;
-        }
-      } else if (f == Final::POLL_RESPONSE && with_valid_req_seq_retrans(req_seq) &&
-                 retry_i_frames_less_than_max_transmit(req_seq) && with_valid_f_bit(f)) {
+      if (f == Final::POLL_RESPONSE && with_valid_req_seq(req_seq) && with_valid_f_bit(f)) {
         remote_busy_ = false;
         pass_to_tx(req_seq, f);
         if (!rej_actioned_) {
@@ -321,38 +385,51 @@ struct ErtmController::impl {
           rej_actioned_ = false;
         }
         send_pending_i_frames();
-      } else if (with_valid_req_seq_retrans(req_seq) && !retry_i_frames_less_than_max_transmit(req_seq)) {
-        CloseChannel();
-      } else if (with_invalid_req_seq_retrans(req_seq)) {
-        CloseChannel();
-      }
-    } else if (rx_state_ == RxState::REJ_SENT) {
-      if (f == Final::NOT_SET && with_valid_req_seq_retrans(req_seq) &&
-          retry_i_frames_less_than_max_transmit(req_seq) && with_valid_f_bit(f)) {
-        remote_busy_ = false;
+      } else if (p == Poll::NOT_SET && f == Final::NOT_SET && with_valid_req_seq(req_seq) && with_valid_f_bit(f)) {
         pass_to_tx(req_seq, f);
-        retransmit_i_frames(req_seq, p);
-        send_pending_i_frames();
-        if (p_bit_outstanding()) {
-          rej_actioned_ = true;
+        if (remote_busy() && unacked_frames_ > 0) {
+          start_retrans_timer();
         }
-      } else if (f == Final::POLL_RESPONSE && with_valid_req_seq_retrans(req_seq) &&
-                 retry_i_frames_less_than_max_transmit(req_seq) && with_valid_f_bit(f)) {
         remote_busy_ = false;
+        send_pending_i_frames();
+      } else if (p == Poll::POLL && with_valid_req_seq(req_seq) && with_valid_f_bit(f)) {
         pass_to_tx(req_seq, f);
-        if (!rej_actioned_) {
-          retransmit_i_frames(req_seq, p);
-        } else {
-          rej_actioned_ = false;
+        if (remote_busy() && unacked_frames_ > 0) {
+          start_retrans_timer();
         }
-        send_pending_i_frames();
-      } else if (with_valid_req_seq_retrans(req_seq) && !retry_i_frames_less_than_max_transmit(req_seq)) {
-        CloseChannel();
-      } else if (with_invalid_req_seq_retrans(req_seq)) {
+        remote_busy_ = false;
+        send_srej_tail();
+      } else if (with_invalid_req_seq(req_seq)) {
         CloseChannel();
       }
-    } else if (rx_state_ == RxState::SREJ_SENT) {
-      // SREJ NOT SUPPORTED
+    }
+  }
+
+  // REJ is handled the same way in all receiver states
+  void recv_rej(uint8_t req_seq, Poll p = Poll::NOT_SET, Final f = Final::NOT_SET) {
+    if (f == Final::NOT_SET && with_valid_req_seq_retrans(req_seq) && retry_i_frames_less_than_max_transmit(req_seq) &&
+        with_valid_f_bit(f)) {
+      remote_busy_ = false;
+      pass_to_tx(req_seq, f);
+      retransmit_i_frames(req_seq, p);
+      send_pending_i_frames();
+      if (p_bit_outstanding()) {
+        rej_actioned_ = true;
+      }
+    } else if (f == Final::POLL_RESPONSE && with_valid_req_seq_retrans(req_seq) &&
+               retry_i_frames_less_than_max_transmit(req_seq) && with_valid_f_bit(f)) {
+      remote_busy_ = false;
+      pass_to_tx(req_seq, f);
+      if (!rej_actioned_) {
+        retransmit_i_frames(req_seq, p);
+      } else {
+        rej_actioned_ = false;
+      }
+      send_pending_i_frames();
+    } else if (with_valid_req_seq_retrans(req_seq) && !retry_i_frames_less_than_max_transmit(req_seq)) {
+      CloseChannel();
+    } else if (with_invalid_req_seq_retrans(req_seq)) {
+      CloseChannel();
     }
   }
 
@@ -383,81 +460,53 @@ struct ErtmController::impl {
         CloseChannel();
       }
     } else if (rx_state_ == RxState::SREJ_SENT) {
-      // SREJ NOT SUPPORTED
+      if (p == Poll::NOT_SET && with_valid_req_seq(req_seq) && with_valid_f_bit(f)) {
+        remote_busy_ = true;
+        pass_to_tx(req_seq, f);
+      } else if (p == Poll::POLL && with_valid_req_seq(req_seq) && with_valid_f_bit(f)) {
+        remote_busy_ = true;
+        pass_to_tx(req_seq, f);
+        send_srej_tail();
+      } else if (with_invalid_req_seq_retrans(req_seq)) {
+        CloseChannel();
+      }
     }
   }
 
+  // SREJ is handled the same way in all receiver states
   void recv_srej(uint8_t req_seq, Poll p = Poll::NOT_SET, Final f = Final::NOT_SET) {
-    if (rx_state_ == RxState::RECV) {
-      if (p == Poll::NOT_SET && f == Final::NOT_SET && with_valid_req_seq_retrans(req_seq) &&
-          retry_i_frames_less_than_max_transmit(req_seq) && with_valid_f_bit(f)) {
-        remote_busy_ = false;
-        pass_to_tx_f_bit(f);
-        retransmit_requested_i_frame(req_seq, p);
-        if (p_bit_outstanding()) {
-          srej_actioned_ = true;
-          srej_save_req_seq_ = req_seq;
-        }
-      } else if (f == Final::POLL_RESPONSE && with_valid_req_seq_retrans(req_seq) &&
-                 retry_i_frames_less_than_max_transmit(req_seq) && with_valid_f_bit(f)) {
-        remote_busy_ = false;
-        pass_to_tx_f_bit(f);
-        if (srej_actioned_ && srej_save_req_seq_ == req_seq) {
-          srej_actioned_ = false;
-        } else {
-          retransmit_requested_i_frame(req_seq, p);
-        }
-      } else if (p == Poll::POLL && with_valid_req_seq_retrans(req_seq) &&
-                 retry_i_frames_less_than_max_transmit(req_seq) && with_valid_f_bit(f)) {
-        remote_busy_ = false;
-        pass_to_tx(req_seq, f);
-        retransmit_requested_i_frame(req_seq, p);
-        send_pending_i_frames();
-        if (p_bit_outstanding()) {
-          srej_actioned_ = true;
-          srej_save_req_seq_ = req_seq;
-        }
-      } else if (with_valid_req_seq_retrans(req_seq) && !retry_i_frames_less_than_max_transmit(req_seq)) {
-        CloseChannel();
-      } else if (with_invalid_req_seq_retrans(req_seq)) {
-        CloseChannel();
+    if (p == Poll::NOT_SET && f == Final::NOT_SET && with_valid_req_seq_retrans(req_seq) &&
+        retry_i_frames_less_than_max_transmit(req_seq) && with_valid_f_bit(f)) {
+      remote_busy_ = false;
+      pass_to_tx_f_bit(f);
+      retransmit_requested_i_frame(req_seq, p);
+      if (p_bit_outstanding()) {
+        srej_actioned_ = true;
+        srej_save_req_seq_ = req_seq;
       }
-    } else if (rx_state_ == RxState::REJ_SENT) {
-      if (p == Poll::NOT_SET && f == Final::NOT_SET && with_valid_req_seq_retrans(req_seq) &&
-          retry_i_frames_less_than_max_transmit(req_seq) && with_valid_f_bit(f)) {
-        remote_busy_ = false;
-        pass_to_tx_f_bit(f);
-        retransmit_requested_i_frame(req_seq, p);
-        if (p_bit_outstanding()) {
-          srej_actioned_ = true;
-          srej_save_req_seq_ = req_seq;
-        }
-      } else if (f == Final::POLL_RESPONSE && with_valid_req_seq_retrans(req_seq) &&
-                 retry_i_frames_less_than_max_transmit(req_seq) && with_valid_f_bit(f)) {
-        remote_busy_ = false;
-        pass_to_tx_f_bit(f);
-        if (srej_actioned_ && srej_save_req_seq_ == req_seq) {
-          srej_actioned_ = false;
-        } else {
-          retransmit_requested_i_frame(req_seq, p);
-        }
-      } else if (p == Poll::POLL && with_valid_req_seq_retrans(req_seq) &&
-                 retry_i_frames_less_than_max_transmit(req_seq) && with_valid_f_bit(f)) {
-        remote_busy_ = false;
-        pass_to_tx(req_seq, f);
+    } else if (f == Final::POLL_RESPONSE && with_valid_req_seq_retrans(req_seq) &&
+               retry_i_frames_less_than_max_transmit(req_seq) && with_valid_f_bit(f)) {
+      remote_busy_ = false;
+      pass_to_tx_f_bit(f);
+      if (srej_actioned_ && srej_save_req_seq_ == req_seq) {
+        srej_actioned_ = false;
+      } else {
         retransmit_requested_i_frame(req_seq, p);
-        send_pending_i_frames();
-        if (p_bit_outstanding()) {
-          srej_actioned_ = true;
-          srej_save_req_seq_ = req_seq;
-        }
-      } else if (with_valid_req_seq_retrans(req_seq) && !retry_i_frames_less_than_max_transmit(req_seq)) {
-        CloseChannel();
-      } else if (with_invalid_req_seq_retrans(req_seq)) {
-        CloseChannel();
       }
-    } else if (rx_state_ == RxState::SREJ_SENT) {
-      // SREJ NOT SUPPORTED
+    } else if (p == Poll::POLL && with_valid_req_seq_retrans(req_seq) &&
+               retry_i_frames_less_than_max_transmit(req_seq) && with_valid_f_bit(f)) {
+      remote_busy_ = false;
+      pass_to_tx(req_seq, f);
+      retransmit_requested_i_frame(req_seq, p);
+      send_pending_i_frames();
+      if (p_bit_outstanding()) {
+        srej_actioned_ = true;
+        srej_save_req_seq_ = req_seq;
+      }
+    } else if (with_valid_req_seq_retrans(req_seq) && !retry_i_frames_less_than_max_transmit(req_seq)) {
+      CloseChannel();
+    } else if (with_invalid_req_seq_retrans(req_seq)) {
+      CloseChannel();
     }
   }
 
@@ -475,7 +524,7 @@ struct ErtmController::impl {
   }
 
   bool rem_window_full() {
-    return unacked_frames_ == controller_->remote_tx_window_;
+    return unacked_frames_ >= controller_->remote_tx_window_;
   }
 
   bool rnr_sent() {
@@ -483,98 +532,92 @@ struct ErtmController::impl {
   }
 
   bool retry_i_frames_less_than_max_transmit(uint8_t req_seq) {
-    return retry_i_frames_[req_seq] < controller_->local_max_transmit_;
+    return unacked_list_[req_seq].retry_count < controller_->local_max_transmit_;
   }
 
   bool retry_count_less_than_max_transmit() {
     return retry_count_ < controller_->local_max_transmit_;
   }
 
-  // Compares two sequence numbers (tx_seq or rx_seq)
-  bool sequence_less_than(uint8_t x, uint8_t y) {
-    // Assuming the maximum overflow of sequence number is the same as local_tx_window_ (10 by default).
-    return x < y || kMaxTxWin - (x - y) < controller_->local_tx_window_;
+  // Number of sequence numbers from |from| up to |to|, modulo kMaxTxWin
+  static uint8_t sequence_distance(uint8_t from, uint8_t to) {
+    return (to + kMaxTxWin - from) % kMaxTxWin;
   }
 
-  // Compares two sequence numbers (tx_seq or rx_seq)
-  bool sequence_less_than_or_equal(uint8_t x, uint8_t y) {
-    // Assuming the maximum overflow of sequence number is the same as local_tx_window_ (10 by default).
-    return x <= y || kMaxTxWin - (x - y) <= controller_->local_tx_window_;
+  static uint8_t next_sequence(uint8_t seq) {
+    return (seq + 1) % kMaxTxWin;
   }
 
   bool with_expected_tx_seq(uint8_t tx_seq) {
     return tx_seq == expected_tx_seq_;
   }
 
+  // ReqSeq acknowledges frames from ExpectedAckSeq up to NextTxSeq
   bool with_valid_req_seq(uint8_t req_seq) {
-    return sequence_less_than_or_equal(expected_ack_seq_, req_seq) &&
-           sequence_less_than_or_equal(req_seq, next_tx_seq_);
+    return sequence_distance(expected_ack_seq_, req_seq) <= sequence_distance(expected_ack_seq_, next_tx_seq_);
   }
 
   bool with_valid_req_seq_retrans(uint8_t req_seq) {
-    return sequence_less_than_or_equal(expected_ack_seq_, req_seq) &&
-           sequence_less_than_or_equal(req_seq, next_tx_seq_);
+    return with_valid_req_seq(req_seq);
   }
 
   bool with_valid_f_bit(Final f) {
     return f == Final::NOT_SET ^ tx_state_ == TxState::WAIT_F;
   }
 
+  // A new I-frame after ExpectedTxSeq, within the receive window starting at BufferSeq
   bool with_unexpected_tx_seq(uint8_t tx_seq) {
-    return sequence_less_than(expected_tx_seq_, tx_seq) &&
-           sequence_less_than_or_equal(tx_seq, expected_tx_seq_ + controller_->local_tx_window_);
+    auto distance = sequence_distance(buffer_seq_, tx_seq);
+    return distance > sequence_distance(buffer_seq_, expected_tx_seq_) && distance < controller_->local_tx_window_;
   }
 
+  // An I-frame which was already delivered, or already saved while waiting for SREJ responses. Delivered I-frames are
+  // only looked for outside the receive window, which leaves 64 - TxWindow of them once TxWindow is above 32.
   bool with_duplicate_tx_seq(uint8_t tx_seq) {
-    return sequence_less_than(tx_seq, expected_tx_seq_) &&
-           sequence_less_than_or_equal(expected_tx_seq_ - controller_->local_tx_window_, tx_seq);
+    auto distance_before_buffer_seq = sequence_distance(tx_seq, buffer_seq_);
+    uint16_t tx_window = controller_->local_tx_window_;
+    auto duplicate_window = std::min<uint16_t>(tx_window, kMaxTxWin - tx_window);
+    if (distance_before_buffer_seq > 0 && distance_before_buffer_seq <= duplicate_window) {
+      return true;
+    }
+    return sequence_distance(buffer_seq_, tx_seq) < sequence_distance(buffer_seq_, expected_tx_seq_) &&
+           !is_in_srej_list(tx_seq);
   }
 
   bool with_invalid_tx_seq(uint8_t tx_seq) {
-    return sequence_less_than(tx_seq, expected_tx_seq_ - controller_->local_tx_window_) ||
-           sequence_less_than(expected_tx_seq_ + controller_->local_tx_window_, tx_seq);
+    return !with_expected_tx_seq(tx_seq) && !with_unexpected_tx_seq(tx_seq) && !with_duplicate_tx_seq(tx_seq) &&
+           !is_in_srej_list(tx_seq);
   }
 
   bool with_invalid_req_seq(uint8_t req_seq) {
-    return sequence_less_than(req_seq, expected_ack_seq_) || sequence_less_than(next_tx_seq_, req_seq);
+    return !with_valid_req_seq(req_seq);
   }
 
   bool with_invalid_req_seq_retrans(uint8_t req_seq) {
-    return sequence_less_than(req_seq, expected_ack_seq_) || sequence_less_than(next_tx_seq_, req_seq);
+    return !with_valid_req_seq_retrans(req_seq);
   }
 
   bool not_with_expected_tx_seq(uint8_t tx_seq) {
     return !with_invalid_tx_seq(tx_seq) && !with_expected_tx_seq(tx_seq);
   }
 
-  bool with_expected_tx_seq_srej() {
-    // We don't support sending SREJ
-    return false;
-  }
-
-  bool send_req_is_true() {
-    // We don't support sending SREJ
-    return false;
+  bool is_in_srej_list(uint8_t tx_seq) {
+    return std::find(srej_list_.begin(), srej_list_.end(), tx_seq) != srej_list_.end();
   }
 
-  bool srej_list_is_one() {
-    // We don't support sending SREJ
-    return false;
+  // The oldest I-frame requested with SREJ
+  bool with_expected_tx_seq_srej(uint8_t tx_seq) {
+    return !srej_list_.empty() && srej_list_.front() == tx_seq;
   }
 
-  bool with_unexpected_tx_seq_srej() {
-    // We don't support sending SREJ
-    return false;
-  }
-
-  bool with_duplicate_tx_seq_srej() {
-    // We don't support sending SREJ
-    return false;
+  // An I-frame requested with SREJ, while the ones requested before it are still missing
+  bool with_unexpected_tx_seq_srej(uint8_t tx_seq) {
+    return !with_expected_tx_seq_srej(tx_seq) && is_in_srej_list(tx_seq);
   }
 
   // Actions (@see 8.6.5.6)
 
-  void _send_i_frame(SegmentationAndReassembly sar, std::unique_ptr<CopyablePacketBuilder> segment, uint8_t req_seq,
+  void _send_i_frame(SegmentationAndReassembly sar, std::unique_ptr<packet::FragmentBuilder> segment, uint8_t req_seq,
                      uint8_t tx_seq, uint16_t sdu_size = 0, Final f = Final::NOT_SET) {
     std::unique_ptr<packet::BasePacketBuilder> builder;
     if (sar == SegmentationAndReassembly::START) {
@@ -594,35 +637,36 @@ struct ErtmController::impl {
                                                           std::move(segment));
       }
     }
+    // ReqSeq acknowledges everything we received so far
+    acknowledged(req_seq);
     controller_->send_pdu(std::move(builder));
   }
 
-  void send_data(SegmentationAndReassembly sar, uint16_t sdu_size, std::unique_ptr<packet::RawBuilder> segment,
+  void send_data(SegmentationAndReassembly sar, uint16_t sdu_size, std::unique_ptr<packet::FragmentBuilder> segment,
                  Final f = Final::NOT_SET) {
-    std::shared_ptr<packet::RawBuilder> shared_segment(segment.release());
-    unacked_list_.emplace(std::piecewise_construct, std::forward_as_tuple(next_tx_seq_),
-                          std::forward_as_tuple(sar, sdu_size, shared_segment));
-
-    std::unique_ptr<CopyablePacketBuilder> copyable_packet_builder =
-        std::make_unique<CopyablePacketBuilder>(std::get<2>(unacked_list_.find(next_tx_seq_)->second));
-    _send_i_frame(sar, std::move(copyable_packet_builder), buffer_seq_, next_tx_seq_, sdu_size, f);
+    auto& frame = unacked_list_[next_tx_seq_];
+    frame.sar = sar;
+    frame.sdu_size = sdu_size;
+    frame.segment = std::move(segment);
+    frame.retry_count = 1;
+    _send_i_frame(sar, std::make_unique<packet::FragmentBuilder>(*frame.segment), buffer_seq_, next_tx_seq_, sdu_size,
+                  f);
     unacked_frames_++;
     frames_sent_++;
-    retry_i_frames_[next_tx_seq_] = 1;
-    next_tx_seq_ = (next_tx_seq_ + 1) % kMaxTxWin;
+    next_tx_seq_ = next_sequence(next_tx_seq_);
     start_retrans_timer();
   }
 
-  void pend_data(SegmentationAndReassembly sar, uint16_t sdu_size, std::unique_ptr<packet::RawBuilder> data) {
+  void pend_data(SegmentationAndReassembly sar, uint16_t sdu_size, std::unique_ptr<packet::FragmentBuilder> data) {
     pending_frames_.emplace(std::make_tuple(sar, sdu_size, std::move(data)));
   }
 
   void process_req_seq(uint8_t req_seq) {
-    for (int i = expected_ack_seq_; i < req_seq; i++) {
-      unacked_list_.erase(i);
-      retry_i_frames_[i] = 0;
+    for (uint8_t i = expected_ack_seq_; i != req_seq; i = next_sequence(i)) {
+      unacked_list_[i].segment.reset();
+      unacked_list_[i].retry_count = 0;
     }
-    unacked_frames_ -= ((req_seq - expected_ack_seq_) + kMaxTxWin) % kMaxTxWin;
+    unacked_frames_ -= sequence_distance(expected_ack_seq_, req_seq);
     expected_ack_seq_ = req_seq;
     if (unacked_frames_ == 0) {
       stop_retrans_timer();
@@ -636,23 +680,26 @@ struct ErtmController::impl {
     } else {
       builder = EnhancedSupervisoryFrameBuilder::Create(controller_->remote_cid_, s, p, f, req_seq);
     }
+    if (s != SupervisoryFunction::SELECT_REJECT) {
+      acknowledged(req_seq);
+    }
     controller_->send_pdu(std::move(builder));
   }
 
   void send_rr(Poll p) {
-    _send_s_frame(SupervisoryFunction::RECEIVER_READY, expected_tx_seq_, p, Final::NOT_SET);
+    _send_s_frame(SupervisoryFunction::RECEIVER_READY, buffer_seq_, p, Final::NOT_SET);
   }
 
   void send_rr(Final f) {
-    _send_s_frame(SupervisoryFunction::RECEIVER_READY, expected_tx_seq_, Poll::NOT_SET, f);
+    _send_s_frame(SupervisoryFunction::RECEIVER_READY, buffer_seq_, Poll::NOT_SET, f);
   }
 
   void send_rnr(Poll p) {
-    _send_s_frame(SupervisoryFunction::RECEIVER_NOT_READY, expected_tx_seq_, p, Final::NOT_SET);
+    _send_s_frame(SupervisoryFunction::RECEIVER_NOT_READY, buffer_seq_, p, Final::NOT_SET);
   }
 
   void send_rnr(Final f) {
-    _send_s_frame(SupervisoryFunction::RECEIVER_NOT_READY, expected_tx_seq_, Poll::NOT_SET, f);
+    _send_s_frame(SupervisoryFunction::RECEIVER_NOT_READY, buffer_seq_, Poll::NOT_SET, f);
     rnr_sent_ = true;
   }
 
@@ -683,8 +730,14 @@ struct ErtmController::impl {
     }
   }
 
-  void send_srej() {
-    // Sending SREJ is not supported
+  void send_srej(uint8_t tx_seq) {
+    _send_s_frame(SupervisoryFunction::SELECT_REJECT, tx_seq, Poll::NOT_SET, Final::NOT_SET);
+  }
+
+  // Answer a poll in the SREJ_SENT state by requesting the last missing frame again, rather than with an RR which
+  // would make the remote retransmit everything after BufferSeq
+  void send_srej_tail() {
+    _send_s_frame(SupervisoryFunction::SELECT_REJECT, srej_list_.back(), Poll::NOT_SET, Final::POLL_RESPONSE);
   }
 
   void start_retrans_timer() {
@@ -697,6 +750,31 @@ struct ErtmController::impl {
                             std::chrono::milliseconds(controller_->local_monitor_timeout_ms_));
   }
 
+  // Unlike the other timers, the ack timer is not restarted by each received frame, so that a steady stream of
+  // frames below the threshold is still acknowledged in time
+  void start_ack_timer() {
+    if (ack_timer_running_) {
+      return;
+    }
+    ack_timer_running_ = true;
+    ack_timer_.Schedule(common::BindOnce(&impl::ack_timer_expires, common::Unretained(this)), kAckTimeout);
+  }
+
+  void stop_ack_timer() {
+    if (ack_timer_running_) {
+      ack_timer_running_ = false;
+      ack_timer_.Cancel();
+    }
+  }
+
+  // The remote has been told about all the frames received before |req_seq|
+  void acknowledged(uint8_t req_seq) {
+    if (req_seq == buffer_seq_) {
+      frames_to_ack_ = 0;
+      stop_ack_timer();
+    }
+  }
+
   void pass_to_tx(uint8_t req_seq, Final f) {
     recv_req_seq_and_f_bit(req_seq, f);
   }
@@ -707,11 +785,12 @@ struct ErtmController::impl {
 
   void data_indication(SegmentationAndReassembly sar, uint16_t sdu_size, const packet::PacketView<true>& segment) {
     controller_->stage_for_reassembly(sar, sdu_size, segment);
-    buffer_seq_ = (buffer_seq_ + 1) % kMaxTxWin;
+    buffer_seq_ = next_sequence(buffer_seq_);
+    frames_to_ack_++;
   }
 
   void increment_expected_tx_seq() {
-    expected_tx_seq_ = (expected_tx_seq_ + 1) % kMaxTxWin;
+    expected_tx_seq_ = next_sequence(expected_tx_seq_);
   }
 
   void stop_retrans_timer() {
@@ -722,22 +801,53 @@ struct ErtmController::impl {
     monitor_timer_.Cancel();
   }
 
+  // Acknowledgements are coalesced: received frames are acknowledged by the next I-frame we send, or by an RR once 3/4
+  // of the window is used or the ack timer expires, instead of one RR per frame
   void send_ack(Final f = Final::NOT_SET) {
     if (local_busy()) {
       send_rnr(f);
-    } else if (!remote_busy() && !pending_frames_.empty() && rem_window_not_full()) {
+    } else if (!remote_busy() && !pending_frames_.empty() && rem_window_not_full() && !p_bit_outstanding()) {
       send_pending_i_frames(f);
-    } else {
+    } else if (f == Final::POLL_RESPONSE || frames_to_ack_ >= ack_threshold()) {
       send_rr(f);
+    } else if (frames_to_ack_ > 0) {
+      start_ack_timer();
+    }
+  }
+
+  int ack_threshold() {
+    return std::max(1, controller_->local_tx_window_ * 3 / 4);
+  }
+
+  // Request every missing I-frame before |tx_seq|, which was received out of sequence
+  void init_srej(uint8_t tx_seq) {
+    srej_list_.clear();
+    send_srej_up_to(tx_seq);
+  }
+
+  void send_srej_up_to(uint8_t tx_seq) {
+    for (uint8_t i = expected_tx_seq_; i != tx_seq; i = next_sequence(i)) {
+      send_srej(i);
+      srej_list_.push_back(i);
     }
+    expected_tx_seq_ = next_sequence(tx_seq);
   }
 
-  void init_srej() {
-    // We don't support sending SREJ
+  // |tx_seq| was requested after the frames ahead of it in the SREJ list, so they or their SREJ got lost and they are
+  // requested again
+  void resend_srej_before(uint8_t tx_seq) {
+    while (srej_list_.front() != tx_seq) {
+      auto missing = srej_list_.front();
+      srej_list_.pop_front();
+      send_srej(missing);
+      srej_list_.push_back(missing);
+    }
+    srej_list_.pop_front();
   }
 
-  void save_i_frame_srej() {
-    // We don't support sending SREJ
+  void save_i_frame_srej(uint8_t tx_seq, SegmentationAndReassembly sar, uint16_t sdu_size,
+                         const packet::PacketView<kLittleEndian>& payload) {
+    srej_saved_frames_[tx_seq] = SavedFrame{sar, sdu_size, payload};
   }
 
   void store_or_ignore() {
@@ -748,22 +858,34 @@ struct ErtmController::impl {
     return tx_state_ == TxState::WAIT_F;
   }
 
+  void retransmit_on_poll_response(uint8_t req_seq) {
+    if (!rej_actioned_) {
+      retransmit_i_frames(req_seq);
+      send_pending_i_frames();
+    } else {
+      rej_actioned_ = false;
+    }
+  }
+
+  void retransmit_i_frame(uint8_t tx_seq, Final f) {
+    auto& frame = unacked_list_[tx_seq];
+    _send_i_frame(frame.sar, std::make_unique<packet::FragmentBuilder>(*frame.segment), buffer_seq_, tx_seq,
+                  frame.sdu_size, f);
+    frame.retry_count++;
+    frames_sent_++;
+  }
+
   void retransmit_i_frames(uint8_t req_seq, Poll p = Poll::NOT_SET) {
     uint8_t i = req_seq;
     Final f = (p == Poll::NOT_SET ? Final::NOT_SET : Final::POLL_RESPONSE);
-    while (unacked_list_.find(i) != unacked_list_.end()) {
-      if (retry_i_frames_[i] == controller_->local_max_transmit_) {
+    while (i != next_tx_seq_ && unacked_list_[i].segment != nullptr) {
+      if (unacked_list_[i].retry_count == controller_->local_max_transmit_) {
         CloseChannel();
         return;
       }
-      std::unique_ptr<CopyablePacketBuilder> copyable_packet_builder =
-          std::make_unique<CopyablePacketBuilder>(std::get<2>(unacked_list_.find(i)->second));
-      _send_i_frame(std::get<0>(unacked_list_.find(i)->second), std::move(copyable_packet_builder), buffer_seq_, i,
-                    std::get<1>(unacked_list_.find(i)->second), f);
-      retry_i_frames_[i]++;
-      frames_sent_++;
+      retransmit_i_frame(i, f);
       f = Final::NOT_SET;
-      i++;
+      i = next_sequence(i);
     }
     if (i != req_seq) {
       start_retrans_timer();
@@ -772,15 +894,11 @@ struct ErtmController::impl {
 
   void retransmit_requested_i_frame(uint8_t req_seq, Poll p) {
     Final f = p == Poll::POLL ? Final::POLL_RESPONSE : Final::NOT_SET;
-    if (unacked_list_.find(req_seq) == unacked_list_.end()) {
+    if (unacked_list_[req_seq].segment == nullptr) {
       LOG_ERROR("Received invalid SREJ");
       return;
     }
-    std::unique_ptr<CopyablePacketBuilder> copyable_packet_builder =
-        std::make_unique<CopyablePacketBuilder>(std::get<2>(unacked_list_.find(req_seq)->second));
-    _send_i_frame(std::get<0>(unacked_list_.find(req_seq)->second), std::move(copyable_packet_builder), buffer_seq_,
-                  req_seq, std::get<1>(unacked_list_.find(req_seq)->second), f);
-    retry_i_frames_[req_seq]++;
+    retransmit_i_frame(req_seq, f);
     start_retrans_timer();
   }
 
@@ -801,32 +919,44 @@ struct ErtmController::impl {
   }
 
   void pop_srej_list() {
-    // We don't support sending SREJ
+    srej_list_.pop_front();
   }
 
+  // Deliver the saved I-frames which are now in sequence
   void data_indication_srej() {
-    // We don't support sending SREJ
+    while (srej_saved_frames_[buffer_seq_].has_value()) {
+      auto frame = std::move(srej_saved_frames_[buffer_seq_].value());
+      srej_saved_frames_[buffer_seq_].reset();
+      data_indication(frame.sar, frame.sdu_size, frame.payload);
+    }
   }
 };
 
 // Segmentation is handled here
 void ErtmController::OnSdu(std::unique_ptr<packet::BasePacketBuilder> sdu) {
   auto sdu_size = sdu->size();
-  std::vector<std::unique_ptr<packet::RawBuilder>> segments;
-  auto size_each_packet = (remote_mps_ - 4 /* basic L2CAP header */ - 2 /* SDU length */ - 2 /* Enhanced control */ -
-                           (fcs_enabled_ ? 2 : 0));
-  packet::FragmentingInserter fragmenting_inserter(size_each_packet, std::back_insert_iterator(segments));
-  sdu->Serialize(fragmenting_inserter);
-  fragmenting_inserter.finalize();
-  if (segments.size() == 1) {
-    pimpl_->data_request(SegmentationAndReassembly::UNSEGMENTED, std::move(segments[0]));
+  size_t size_each_packet = (remote_mps_ - 4 /* basic L2CAP header */ - 2 /* SDU length */ -
+                             2 /* Enhanced control */ - (fcs_enabled_ ? 2 : 0));
+  // The SDU is serialized once, and its segments share the buffer until they are all acknowledged
+  auto buffer = std::make_shared<std::vector<uint8_t>>();
+  buffer->reserve(sdu_size);
+  packet::BitInserter inserter(*buffer);
+  sdu->Serialize(inserter);
+  std::shared_ptr<const std::vector<uint8_t>> segments(std::move(buffer));
+  auto make_segment = [&segments, size_each_packet](size_t offset) {
+    return std::make_unique<packet::FragmentBuilder>(segments, offset,
+                                                     std::min(size_each_packet, segments->size() - offset));
+  };
+  if (segments->size() <= size_each_packet) {
+    pimpl_->data_request(SegmentationAndReassembly::UNSEGMENTED, make_segment(0));
     return;
   }
-  pimpl_->data_request(SegmentationAndReassembly::START, std::move(segments[0]), sdu_size);
-  for (auto i = 1; i < segments.size() - 1; i++) {
-    pimpl_->data_request(SegmentationAndReassembly::CONTINUATION, std::move(segments[i]));
+  pimpl_->data_request(SegmentationAndReassembly::START, make_segment(0), sdu_size);
+  size_t offset = size_each_packet;
+  for (; segments->size() - offset > size_each_packet; offset += size_each_packet) {
+    pimpl_->data_request(SegmentationAndReassembly::CONTINUATION, make_segment(offset));
   }
-  pimpl_->data_request(SegmentationAndReassembly::END, std::move(segments.back()));
+  pimpl_->data_request(SegmentationAndReassembly::END, make_segment(offset));
 }
 
 void ErtmController::OnPdu(packet::PacketView<true> pdu) {
@@ -1038,23 +1168,34 @@ void ErtmController::send_pdu(std::unique_ptr<packet::BasePacketBuilder> pdu) {
 
 void ErtmController::SetRetransmissionAndFlowControlOptions(
     const RetransmissionAndFlowControlConfigurationOption& option) {
-  remote_tx_window_ = option.tx_window_size_;
+  remote_tx_window_ = std::min<uint16_t>(option.tx_window_size_, kMaxStandardTxWindow);
   local_max_transmit_ = option.max_transmit_;
   local_retransmit_timeout_ms_ = option.retransmission_time_out_;
   local_monitor_timeout_ms_ = option.monitor_time_out_;
   remote_mps_ = option.maximum_pdu_size_;
 }
 
-void ErtmController::close_channel() {
-  link_->SendDisconnectionRequest(cid_, remote_cid_);
+void ErtmController::SetLocalTxWindow(uint16_t tx_window) {
+  local_tx_window_ = std::clamp<uint16_t>(tx_window, 1, kMaxStandardTxWindow);
+}
+
+void ErtmController::EnableSrej(bool enabled) {
+  srej_enabled_ = enabled;
 }
 
-size_t ErtmController::CopyablePacketBuilder::size() const {
-  return builder_->size();
+uint16_t ErtmController::GetLocalTxWindow() {
+  auto tx_window_prop = os::GetSystemProperty(kTxWindowProperty);
+  if (tx_window_prop) {
+    auto tx_window = common::Uint64FromString(tx_window_prop.value());
+    if (tx_window && tx_window.value() > 0) {
+      return std::min<uint64_t>(tx_window.value(), kMaxStandardTxWindow);
+    }
+  }
+  return kDefaultTxWindow;
 }
 
-void ErtmController::CopyablePacketBuilder::Serialize(BitInserter& it) const {
-  builder_->Serialize(it);
+void ErtmController::close_channel() {
+  link_->SendDisconnectionRequest(cid_, remote_cid_);
 }
 
 }  // namespace internal
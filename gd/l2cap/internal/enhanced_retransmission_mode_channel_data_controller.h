@@ -17,6 +17,7 @@
 #pragma once
 
 #include <memory>
+#include <string>
 #include <unordered_map>
 #include <utility>
 
@@ -52,6 +53,18 @@ class ErtmController : public DataController {
   std::unique_ptr<packet::BasePacketBuilder> GetNextPacket() override;
   void EnableFcs(bool enabled) override;
   void SetRetransmissionAndFlowControlOptions(const RetransmissionAndFlowControlConfigurationOption& option) override;
+  // Number of I-frames the remote may send before waiting for our acknowledgement, as sent in our configuration request
+  void SetLocalTxWindow(uint16_t tx_window);
+
+  // Missing I-frames are requested one by one with SREJ when enabled, which is the default. Otherwise a single REJ
+  // asks the remote to send again every I-frame from the first missing one.
+  void EnableSrej(bool enabled);
+
+  // Overrides the TxWindow we request, up to 63. A larger window keeps the link busy when acknowledgements are slow.
+  static const std::string kTxWindowProperty;
+  static uint16_t GetLocalTxWindow();
+  // Set to "true" to request missing I-frames with REJ only, for remotes that mishandle SREJ
+  static const std::string kRejOnlyProperty;
 
  private:
   ILink* link_;
@@ -68,6 +81,7 @@ class ErtmController : public DataController {
   uint16_t local_max_transmit_ = 20;
   uint16_t local_retransmit_timeout_ms_ = 2000;
   uint16_t local_monitor_timeout_ms_ = 12000;
+  bool srej_enabled_ = true;
 
   uint16_t remote_tx_window_ = 10;
   uint16_t remote_mps_ = 1010;
@@ -80,18 +94,6 @@ class ErtmController : public DataController {
     }
   };
 
-  class CopyablePacketBuilder : public packet::BasePacketBuilder {
-   public:
-    CopyablePacketBuilder(std::shared_ptr<packet::RawBuilder> builder) : builder_(std::move(builder)) {}
-
-    void Serialize(BitInserter& it) const override;
-
-    size_t size() const override;
-
-   private:
-    std::shared_ptr<packet::RawBuilder> builder_;
-  };
-
   PacketViewForReassembly reassembly_stage_{PacketView<kLittleEndian>(std::make_shared<std::vector<uint8_t>>())};
   SegmentationAndReassembly sar_state_ = SegmentationAndReassembly::END;
   uint16_t remaining_sdu_continuation_packet_size_ = 0;
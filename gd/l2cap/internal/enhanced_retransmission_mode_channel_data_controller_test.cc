@@ -204,6 +204,184 @@ TEST_F(ErtmDataControllerTest, receive_packet_with_fcs) {
   EXPECT_EQ(data, "abcd");
 }
 
+TEST_F(ErtmDataControllerTest, transmit_segmented_sdu) {
+  common::BidiQueue<Scheduler::UpperEnqueue, Scheduler::UpperDequeue> channel_queue{10};
+  testing::MockScheduler scheduler;
+  testing::MockILink link;
+  ErtmController controller{&link, 1, 1, channel_queue.GetDownEnd(), queue_handler_, &scheduler};
+  RetransmissionAndFlowControlConfigurationOption option;
+  option.tx_window_size_ = 10;
+  option.max_transmit_ = 20;
+  option.retransmission_time_out_ = 2000;
+  option.monitor_time_out_ = 12000;
+  // Leaves 2 bytes of payload in each I-frame
+  option.maximum_pdu_size_ = 12;
+  controller.SetRetransmissionAndFlowControlOptions(option);
+  EXPECT_CALL(scheduler, OnPacketsReady(1, 1)).Times(3);
+  controller.OnSdu(CreateSdu({'a', 'b', 'c', 'd', 'e'}));
+
+  auto start_view = GetPacketView(controller.GetNextPacket());
+  auto start_frame_view = EnhancedInformationStartFrameView::Create(
+      EnhancedInformationFrameView::Create(StandardFrameView::Create(BasicFrameView::Create(start_view))));
+  ASSERT_TRUE(start_frame_view.IsValid());
+  EXPECT_EQ(start_frame_view.GetTxSeq(), 0);
+  EXPECT_EQ(start_frame_view.GetL2capSduLength(), 5);
+  auto payload = start_frame_view.GetPayload();
+  EXPECT_EQ(std::string(payload.begin(), payload.end()), "ab");
+
+  auto continuation_view = GetPacketView(controller.GetNextPacket());
+  auto continuation_frame_view =
+      EnhancedInformationFrameView::Create(StandardFrameView::Create(BasicFrameView::Create(continuation_view)));
+  ASSERT_TRUE(continuation_frame_view.IsValid());
+  EXPECT_EQ(continuation_frame_view.GetTxSeq(), 1);
+  EXPECT_EQ(continuation_frame_view.GetSar(), SegmentationAndReassembly::CONTINUATION);
+  payload = continuation_frame_view.GetPayload();
+  EXPECT_EQ(std::string(payload.begin(), payload.end()), "cd");
+
+  auto end_view = GetPacketView(controller.GetNextPacket());
+  auto end_frame_view =
+      EnhancedInformationFrameView::Create(StandardFrameView::Create(BasicFrameView::Create(end_view)));
+  ASSERT_TRUE(end_frame_view.IsValid());
+  EXPECT_EQ(end_frame_view.GetTxSeq(), 2);
+  EXPECT_EQ(end_frame_view.GetSar(), SegmentationAndReassembly::END);
+  payload = end_frame_view.GetPayload();
+  EXPECT_EQ(std::string(payload.begin(), payload.end()), "e");
+}
+
+TEST_F(ErtmDataControllerTest, receive_acks_are_coalesced) {
+  common::BidiQueue<Scheduler::UpperEnqueue, Scheduler::UpperDequeue> channel_queue{10};
+  testing::MockScheduler scheduler;
+  testing::MockILink link;
+  ErtmController controller{&link, 1, 1, channel_queue.GetDownEnd(), queue_handler_, &scheduler};
+  // With the default window of 10, one RR acknowledges the first 7 I-frames
+  EXPECT_CALL(scheduler, OnPacketsReady(1, 1)).Times(1);
+  for (uint8_t tx_seq = 0; tx_seq < 7; tx_seq++) {
+    auto builder = EnhancedInformationFrameBuilder::Create(1, tx_seq, Final::NOT_SET, 0,
+                                                           SegmentationAndReassembly::UNSEGMENTED, CreateSdu({'a'}));
+    controller.OnPdu(GetPacketView(std::move(builder)));
+    sync_handler(queue_handler_);
+    EXPECT_NE(channel_queue.GetUpEnd()->TryDequeue(), nullptr);
+  }
+  auto s_frame_view = EnhancedSupervisoryFrameView::Create(
+      StandardFrameView::Create(BasicFrameView::Create(GetPacketView(controller.GetNextPacket()))));
+  ASSERT_TRUE(s_frame_view.IsValid());
+  EXPECT_EQ(s_frame_view.GetS(), SupervisoryFunction::RECEIVER_READY);
+  EXPECT_EQ(s_frame_view.GetReqSeq(), 7);
+}
+
+TEST_F(ErtmDataControllerTest, receive_out_of_sequence_sends_srej) {
+  common::BidiQueue<Scheduler::UpperEnqueue, Scheduler::UpperDequeue> channel_queue{10};
+  testing::MockScheduler scheduler;
+  testing::MockILink link;
+  ErtmController controller{&link, 1, 1, channel_queue.GetDownEnd(), queue_handler_, &scheduler};
+  auto builder0 = EnhancedInformationFrameBuilder::Create(1, 0, Final::NOT_SET, 0,
+                                                          SegmentationAndReassembly::UNSEGMENTED, CreateSdu({'a'}));
+  controller.OnPdu(GetPacketView(std::move(builder0)));
+  sync_handler(queue_handler_);
+
+  // I-frame 1 is lost, so it is requested alone when I-frame 2 arrives
+  EXPECT_CALL(scheduler, OnPacketsReady(1, 1)).Times(1);
+  auto builder2 = EnhancedInformationFrameBuilder::Create(1, 2, Final::NOT_SET, 0,
+                                                          SegmentationAndReassembly::UNSEGMENTED, CreateSdu({'c'}));
+  controller.OnPdu(GetPacketView(std::move(builder2)));
+  auto s_frame_view = EnhancedSupervisoryFrameView::Create(
+      StandardFrameView::Create(BasicFrameView::Create(GetPacketView(controller.GetNextPacket()))));
+  ASSERT_TRUE(s_frame_view.IsValid());
+  EXPECT_EQ(s_frame_view.GetS(), SupervisoryFunction::SELECT_REJECT);
+  EXPECT_EQ(s_frame_view.GetReqSeq(), 1);
+  ::testing::Mock::VerifyAndClearExpectations(&scheduler);
+
+  auto builder1 = EnhancedInformationFrameBuilder::Create(1, 1, Final::NOT_SET, 0,
+                                                          SegmentationAndReassembly::UNSEGMENTED, CreateSdu({'b'}));
+  controller.OnPdu(GetPacketView(std::move(builder1)));
+  sync_handler(queue_handler_);
+  std::string data;
+  while (auto payload = channel_queue.GetUpEnd()->TryDequeue()) {
+    data += std::string(payload->begin(), payload->end());
+  }
+  EXPECT_EQ(data, "abc");
+}
+
+TEST_F(ErtmDataControllerTest, receive_out_of_sequence_sends_rej_when_srej_disabled) {
+  common::BidiQueue<Scheduler::UpperEnqueue, Scheduler::UpperDequeue> channel_queue{10};
+  testing::MockScheduler scheduler;
+  testing::MockILink link;
+  ErtmController controller{&link, 1, 1, channel_queue.GetDownEnd(), queue_handler_, &scheduler};
+  controller.EnableSrej(false);
+  auto builder0 = EnhancedInformationFrameBuilder::Create(1, 0, Final::NOT_SET, 0,
+                                                          SegmentationAndReassembly::UNSEGMENTED, CreateSdu({'a'}));
+  controller.OnPdu(GetPacketView(std::move(builder0)));
+  sync_handler(queue_handler_);
+
+  // I-frame 1 is lost, so everything from it is requested again when I-frame 2 arrives
+  EXPECT_CALL(scheduler, OnPacketsReady(1, 1)).Times(1);
+  auto builder2 = EnhancedInformationFrameBuilder::Create(1, 2, Final::NOT_SET, 0,
+                                                          SegmentationAndReassembly::UNSEGMENTED, CreateSdu({'c'}));
+  controller.OnPdu(GetPacketView(std::move(builder2)));
+  auto s_frame_view = EnhancedSupervisoryFrameView::Create(
+      StandardFrameView::Create(BasicFrameView::Create(GetPacketView(controller.GetNextPacket()))));
+  ASSERT_TRUE(s_frame_view.IsValid());
+  EXPECT_EQ(s_frame_view.GetS(), SupervisoryFunction::REJECT);
+  EXPECT_EQ(s_frame_view.GetReqSeq(), 1);
+
+  // Out of sequence I-frames are dropped until I-frame 1 arrives, without another REJ
+  auto builder3 = EnhancedInformationFrameBuilder::Create(1, 3, Final::NOT_SET, 0,
+                                                          SegmentationAndReassembly::UNSEGMENTED, CreateSdu({'d'}));
+  controller.OnPdu(GetPacketView(std::move(builder3)));
+  ::testing::Mock::VerifyAndClearExpectations(&scheduler);
+
+  std::vector<uint8_t> retransmitted = {'b', 'c', 'd'};
+  for (uint8_t tx_seq = 1; tx_seq <= 3; tx_seq++) {
+    auto builder = EnhancedInformationFrameBuilder::Create(
+        1, tx_seq, Final::NOT_SET, 0, SegmentationAndReassembly::UNSEGMENTED, CreateSdu({retransmitted[tx_seq - 1]}));
+    controller.OnPdu(GetPacketView(std::move(builder)));
+  }
+  sync_handler(queue_handler_);
+  std::string data;
+  while (auto payload = channel_queue.GetUpEnd()->TryDequeue()) {
+    data += std::string(payload->begin(), payload->end());
+  }
+  EXPECT_EQ(data, "abcd");
+}
+
+TEST_F(ErtmDataControllerTest, receive_out_of_sequence_sends_srej_with_large_tx_window) {
+  common::BidiQueue<Scheduler::UpperEnqueue, Scheduler::UpperDequeue> channel_queue{10};
+  testing::MockScheduler scheduler;
+  testing::MockILink link;
+  ErtmController controller{&link, 1, 1, channel_queue.GetDownEnd(), queue_handler_, &scheduler};
+  controller.SetLocalTxWindow(63);
+  auto builder0 = EnhancedInformationFrameBuilder::Create(1, 0, Final::NOT_SET, 0,
+                                                          SegmentationAndReassembly::UNSEGMENTED, CreateSdu({'a'}));
+  controller.OnPdu(GetPacketView(std::move(builder0)));
+  sync_handler(queue_handler_);
+
+  // With a TxWindow above 32, I-frame 2 is still ahead of the receive window and not taken for a duplicate
+  EXPECT_CALL(scheduler, OnPacketsReady(1, 1)).Times(1);
+  auto builder2 = EnhancedInformationFrameBuilder::Create(1, 2, Final::NOT_SET, 0,
+                                                          SegmentationAndReassembly::UNSEGMENTED, CreateSdu({'c'}));
+  controller.OnPdu(GetPacketView(std::move(builder2)));
+  auto s_frame_view = EnhancedSupervisoryFrameView::Create(
+      StandardFrameView::Create(BasicFrameView::Create(GetPacketView(controller.GetNextPacket()))));
+  ASSERT_TRUE(s_frame_view.IsValid());
+  EXPECT_EQ(s_frame_view.GetS(), SupervisoryFunction::SELECT_REJECT);
+  EXPECT_EQ(s_frame_view.GetReqSeq(), 1);
+  ::testing::Mock::VerifyAndClearExpectations(&scheduler);
+
+  auto builder1 = EnhancedInformationFrameBuilder::Create(1, 1, Final::NOT_SET, 0,
+                                                          SegmentationAndReassembly::UNSEGMENTED, CreateSdu({'b'}));
+  controller.OnPdu(GetPacketView(std::move(builder1)));
+  // I-frame 2 again is a duplicate, and is not delivered twice
+  auto builder2_again = EnhancedInformationFrameBuilder::Create(
+      1, 2, Final::NOT_SET, 0, SegmentationAndReassembly::UNSEGMENTED, CreateSdu({'c'}));
+  controller.OnPdu(GetPacketView(std::move(builder2_again)));
+  sync_handler(queue_handler_);
+  std::string data;
+  while (auto payload = channel_queue.GetUpEnd()->TryDequeue()) {
+    data += std::string(payload->begin(), payload->end());
+  }
+  EXPECT_EQ(data, "abc");
+}
+
 }  // namespace
 }  // namespace internal
 }  // namespace l2cap
@@ -41,6 +41,9 @@ class ILink {
 
   // Used by A2dp software encoding
   virtual void SetChannelTxPriority(Cid local_cid, bool high_priority) {}
+
+  // Share of the link given to the channel, if the link scheduler shares it by weight
+  virtual void SetChannelWeight(Cid local_cid, uint8_t weight) {}
 };
 }  // namespace internal
 }  // namespace l2cap
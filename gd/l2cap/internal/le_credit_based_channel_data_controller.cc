@@ -16,15 +16,27 @@
 
 #include "l2cap/internal/le_credit_based_channel_data_controller.h"
 
+#include <algorithm>
+
+#include "common/bind.h"
 #include "l2cap/l2cap_packets.h"
 #include "l2cap/le/internal/link.h"
-#include "packet/fragmenting_inserter.h"
-#include "packet/raw_builder.h"
+#include "packet/bit_inserter.h"
+#include "packet/fragment_builder.h"
 
 namespace bluetooth {
 namespace l2cap {
 namespace internal {
 
+namespace {
+// If EnqueueBuffer has this many SDUs, the upper layer does not keep up, and credits are withheld until it is empty
+constexpr size_t kEnqueueBufferBusyThreshold = 3;
+// K-frames received less than half the minimum connection interval (7.5 ms) apart come from the same connection event
+constexpr auto kConnectionEventGap = std::chrono::microseconds(3750);
+// The credit target only grows above the initial credits up to this
+constexpr uint16_t kMaxRxCreditTarget = 64;
+}  // namespace
+
 LeCreditBasedDataController::LeCreditBasedDataController(ILink* link, Cid cid, Cid remote_cid,
                                                          UpperQueueDownEnd* channel_queue_end, os::Handler* handler,
                                                          Scheduler* scheduler)
@@ -40,27 +52,26 @@ void LeCreditBasedDataController::OnSdu(std::unique_ptr<packet::BasePacketBuilde
   if (sdu_size > mtu_) {
     LOG_WARN("Received sdu_size %d > mtu %d", static_cast<int>(sdu_size), mtu_);
   }
-  std::vector<std::unique_ptr<packet::RawBuilder>> segments;
-  // TODO: We don't need to waste 2 bytes for continuation segment.
-  packet::FragmentingInserter fragmenting_inserter(mps_ - 2, std::back_insert_iterator(segments));
-  sdu->Serialize(fragmenting_inserter);
-  fragmenting_inserter.finalize();
-  std::unique_ptr<BasicFrameBuilder> builder;
-  builder = FirstLeInformationFrameBuilder::Create(remote_cid_, sdu_size, std::move(segments[0]));
-  pdu_queue_.emplace(std::move(builder));
-  for (auto i = 1; i < segments.size(); i++) {
-    builder = BasicFrameBuilder::Create(remote_cid_, std::move(segments[i]));
-    pdu_queue_.emplace(std::move(builder));
-  }
-  if (credits_ >= segments.size()) {
-    scheduler_->OnPacketsReady(cid_, segments.size());
-    credits_ -= segments.size();
+  auto buffer = std::make_shared<std::vector<uint8_t>>();
+  buffer->reserve(sdu_size);
+  packet::BitInserter inserter(*buffer);
+  sdu->Serialize(inserter);
+  // The first K-frame carries the SDU length, the following ones are filled up to the MPS
+  size_t number_of_frames = 1;
+  size_t first_frame_size = mps_ - 2;
+  if (sdu_size > first_frame_size) {
+    number_of_frames += (sdu_size - first_frame_size + mps_ - 1) / mps_;
+  }
+  sdu_queue_.push({std::move(buffer), mps_, 0});
+  if (credits_ >= number_of_frames) {
+    scheduler_->OnPacketsReady(cid_, number_of_frames);
+    credits_ -= number_of_frames;
   } else if (credits_ > 0) {
     scheduler_->OnPacketsReady(cid_, credits_);
-    pending_frames_count_ += (segments.size() - credits_);
+    pending_frames_count_ += (number_of_frames - credits_);
     credits_ = 0;
   } else {
-    pending_frames_count_ += segments.size();
+    pending_frames_count_ += number_of_frames;
   }
 }
 
@@ -70,14 +81,19 @@ void LeCreditBasedDataController::OnPdu(packet::PacketView<true> pdu) {
     LOG_WARN("Received invalid frame");
     return;
   }
+  // Every K-frame used a credit, even if it is dropped
+  on_rx_frame();
+  credits_to_return_++;
   if (basic_frame_view.size() > mps_) {
     LOG_WARN("Received frame size %d > mps %d, dropping the packet", static_cast<int>(basic_frame_view.size()), mps_);
+    replenish_credits();
     return;
   }
   if (remaining_sdu_continuation_packet_size_ == 0) {
     auto start_frame_view = FirstLeInformationFrameView::Create(basic_frame_view);
     if (!start_frame_view.IsValid()) {
       LOG_WARN("Received invalid frame");
+      replenish_credits();
       return;
     }
     auto payload = start_frame_view.GetPayload();
@@ -91,20 +107,41 @@ void LeCreditBasedDataController::OnPdu(packet::PacketView<true> pdu) {
   }
   if (remaining_sdu_continuation_packet_size_ == 0) {
     enqueue_buffer_.Enqueue(std::make_unique<PacketView<kLittleEndian>>(reassembly_stage_), handler_);
+    if (enqueue_buffer_.Size() >= kEnqueueBufferBusyThreshold && !local_busy_) {
+      local_busy_ = true;
+      if (rx_credit_target_ > 0) {
+        rx_credit_target_ = std::max<int>(low_watermark() + 1, rx_credit_target_ - rx_credit_target_ / 4);
+      }
+      enqueue_buffer_.NotifyOnEmpty(
+          common::BindOnce(&LeCreditBasedDataController::on_local_busy_clear, common::Unretained(this)));
+    }
   } else if (remaining_sdu_continuation_packet_size_ < 0 || reassembly_stage_.size() > mtu_) {
     LOG_WARN("Received larger SDU size than expected");
     reassembly_stage_ = PacketViewForReassembly(PacketView<kLittleEndian>(std::make_shared<std::vector<uint8_t>>()));
     remaining_sdu_continuation_packet_size_ = 0;
     link_->SendDisconnectionRequest(cid_, remote_cid_);
   }
-  // TODO: Improve the logic by sending credit only after user dequeued the SDU
-  link_->SendLeCredit(cid_, 1);
+  replenish_credits();
 }
 
 std::unique_ptr<packet::BasePacketBuilder> LeCreditBasedDataController::GetNextPacket() {
-  ASSERT(!pdu_queue_.empty());
-  auto next = std::move(pdu_queue_.front());
-  pdu_queue_.pop();
+  ASSERT(!sdu_queue_.empty());
+  auto& sdu = sdu_queue_.front();
+  std::unique_ptr<packet::BasePacketBuilder> next;
+  if (sdu.offset == 0) {
+    size_t length = std::min<size_t>(sdu.mps - 2, sdu.buffer->size());
+    next = FirstLeInformationFrameBuilder::Create(remote_cid_, sdu.buffer->size(),
+                                                  std::make_unique<packet::FragmentBuilder>(sdu.buffer, 0, length));
+    sdu.offset = length;
+  } else {
+    size_t length = std::min<size_t>(sdu.mps, sdu.buffer->size() - sdu.offset);
+    next = BasicFrameBuilder::Create(remote_cid_,
+                                     std::make_unique<packet::FragmentBuilder>(sdu.buffer, sdu.offset, length));
+    sdu.offset += length;
+  }
+  if (sdu.offset == sdu.buffer->size()) {
+    sdu_queue_.pop();
+  }
   return next;
 }
 
@@ -116,23 +153,90 @@ void LeCreditBasedDataController::SetMps(uint16_t mps) {
   mps_ = mps;
 }
 
+void LeCreditBasedDataController::SetInitialRxCredits(uint16_t credits) {
+  initial_rx_credits_ = credits;
+  rx_credit_target_ = credits;
+  remote_credits_ = credits;
+}
+
 void LeCreditBasedDataController::OnCredit(uint16_t credits) {
   int total_credits = credits_ + credits;
   if (total_credits > 0xffff) {
     link_->SendDisconnectionRequest(cid_, remote_cid_);
+    return;
   }
   credits_ = total_credits;
   if (pending_frames_count_ > 0 && credits_ >= pending_frames_count_) {
     scheduler_->OnPacketsReady(cid_, pending_frames_count_);
-    pending_frames_count_ = 0;
     credits_ -= pending_frames_count_;
-  } else if (pending_frames_count_ > 0) {
+    pending_frames_count_ = 0;
+  } else if (pending_frames_count_ > 0 && credits_ > 0) {
     scheduler_->OnPacketsReady(cid_, credits_);
     pending_frames_count_ -= credits_;
     credits_ = 0;
   }
 }
 
+void LeCreditBasedDataController::on_rx_frame() {
+  auto now = std::chrono::steady_clock::now();
+  if (now - last_rx_frame_time_ > kConnectionEventGap) {
+    // Let the estimate come down slowly after a burst of K-frames that were held back on the way
+    uint16_t decayed = std::max(frames_per_connection_event_ - frames_per_connection_event_ / 8, 1);
+    frames_per_connection_event_ = std::max(frames_in_connection_event_, decayed);
+    frames_in_connection_event_ = 0;
+  }
+  last_rx_frame_time_ = now;
+  frames_in_connection_event_++;
+  frames_per_connection_event_ = std::max(frames_per_connection_event_, frames_in_connection_event_);
+
+  if (remote_credits_ > 0) {
+    remote_credits_--;
+  }
+  uint16_t max_rx_credit_target = std::max(initial_rx_credits_, kMaxRxCreditTarget);
+  if (remote_credits_ == 0 && rx_credit_target_ > 0 && !local_busy_ && rx_credit_target_ < max_rx_credit_target) {
+    // The remote ran out of credits while we keep up with it
+    rx_credit_target_ = std::min<int>(max_rx_credit_target, rx_credit_target_ + frames_per_connection_event_);
+  }
+}
+
+void LeCreditBasedDataController::on_local_busy_clear() {
+  local_busy_ = false;
+  replenish_credits();
+}
+
+uint16_t LeCreditBasedDataController::low_watermark() const {
+  // Our credits reach the remote at best one connection event after they are sent
+  return 2 * frames_per_connection_event_;
+}
+
+uint16_t LeCreditBasedDataController::replenish_batch() const {
+  if (rx_credit_target_ <= low_watermark()) {
+    return 1;
+  }
+  return std::max((rx_credit_target_ - low_watermark()) / 2, 1);
+}
+
+void LeCreditBasedDataController::replenish_credits() {
+  if (local_busy_) {
+    return;
+  }
+  int credits = credits_to_return_;
+  if (rx_credit_target_ > 0) {
+    // Top the remote up to the target, which also applies any change of the target
+    credits = rx_credit_target_ - remote_credits_;
+  }
+  if (credits <= 0) {
+    credits_to_return_ = 0;
+    return;
+  }
+  if (credits < replenish_batch() && remote_credits_ > low_watermark()) {
+    return;
+  }
+  link_->SendLeCredit(cid_, credits);
+  remote_credits_ += credits;
+  credits_to_return_ = 0;
+}
+
 }  // namespace internal
 }  // namespace l2cap
 }  // namespace bluetooth
@@ -16,9 +16,12 @@
 
 #pragma once
 
+#include <chrono>
 #include <memory>
+#include <queue>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "common/bidi_queue.h"
 #include "l2cap/cid.h"
@@ -55,7 +58,8 @@ class LeCreditBasedDataController : public DataController {
   // TODO: Set MTU and MPS from signalling channel
   void SetMtu(Mtu mtu);
   void SetMps(uint16_t mps);
-  // TODO: Handle credits
+  // Credits granted to the remote in the connection request or response
+  void SetInitialRxCredits(uint16_t credits);
   void OnCredit(uint16_t credits);
 
  private:
@@ -63,7 +67,14 @@ class LeCreditBasedDataController : public DataController {
   Cid remote_cid_;
   os::EnqueueBuffer<UpperEnqueue> enqueue_buffer_;
   os::Handler* handler_;
-  std::queue<std::unique_ptr<packet::BasePacketBuilder>> pdu_queue_;
+  // An SDU being sent. Its K-frames are built when the scheduler dequeues them, as slices of the serialized SDU.
+  struct PendingSdu {
+    std::shared_ptr<const std::vector<uint8_t>> buffer;
+    uint16_t mps;
+    // Start of the next K-frame
+    size_t offset;
+  };
+  std::queue<PendingSdu> sdu_queue_;
   Scheduler* scheduler_;
   ILink* link_;
   Mtu mtu_ = 512;
@@ -71,6 +82,29 @@ class LeCreditBasedDataController : public DataController {
   uint16_t credits_ = 0;
   uint16_t pending_frames_count_ = 0;
 
+  // Receive credits are given back in batches. We aim to keep rx_credit_target_ credits granted to the remote, which
+  // grows when the remote runs out of credits and shrinks when the upper layer does not keep up. Credits are returned
+  // once the batch is large enough, or earlier if the remote is left with less than two connection events worth of
+  // K-frames.
+  uint16_t initial_rx_credits_ = 0;
+  // 0 if the credits granted at connection are not known
+  uint16_t rx_credit_target_ = 0;
+  // Credits the remote has left, as far as we know
+  uint16_t remote_credits_ = 0;
+  // K-frames received and not credited back yet
+  uint16_t credits_to_return_ = 0;
+  bool local_busy_ = false;
+  std::chrono::steady_clock::time_point last_rx_frame_time_;
+  uint16_t frames_in_connection_event_ = 0;
+  // Most K-frames recently received in one connection event
+  uint16_t frames_per_connection_event_ = 1;
+
+  void on_rx_frame();
+  void on_local_busy_clear();
+  void replenish_credits();
+  uint16_t low_watermark() const;
+  uint16_t replenish_batch() const;
+
   class PacketViewForReassembly : public packet::PacketView<kLittleEndian> {
    public:
     PacketViewForReassembly(const PacketView& packetView) : PacketView(packetView) {}
@@ -179,6 +179,148 @@ TEST_F(LeCreditBasedDataControllerTest, receive_segmented_with_wrong_sdu_length)
   EXPECT_EQ(payload, nullptr);
 }
 
+TEST_F(LeCreditBasedDataControllerTest, transmit_segmented_uses_full_mps_after_first_frame) {
+  common::BidiQueue<Scheduler::UpperEnqueue, Scheduler::UpperDequeue> channel_queue{10};
+  testing::MockScheduler scheduler;
+  testing::MockILink link;
+  LeCreditBasedDataController controller{&link, 0x41, 0x41, channel_queue.GetDownEnd(), queue_handler_, &scheduler};
+  controller.OnCredit(1);
+  controller.SetMps(4);
+  // Divided into 'ab', 'cdef' and 'g', but only the first K-frame has a credit
+  EXPECT_CALL(scheduler, OnPacketsReady(0x41, 1));
+  controller.OnSdu(CreateSdu({'a', 'b', 'c', 'd', 'e', 'f', 'g'}));
+  auto first_le_info_view =
+      FirstLeInformationFrameView::Create(BasicFrameView::Create(GetPacketView(controller.GetNextPacket())));
+  EXPECT_TRUE(first_le_info_view.IsValid());
+  auto payload = first_le_info_view.GetPayload();
+  EXPECT_EQ(std::string(payload.begin(), payload.end()), "ab");
+  EXPECT_EQ(first_le_info_view.GetL2capSduLength(), 7);
+
+  EXPECT_CALL(scheduler, OnPacketsReady(0x41, 2));
+  controller.OnCredit(5);
+  auto pdu_view = BasicFrameView::Create(GetPacketView(controller.GetNextPacket()));
+  EXPECT_TRUE(pdu_view.IsValid());
+  payload = pdu_view.GetPayload();
+  EXPECT_EQ(std::string(payload.begin(), payload.end()), "cdef");
+  pdu_view = BasicFrameView::Create(GetPacketView(controller.GetNextPacket()));
+  EXPECT_TRUE(pdu_view.IsValid());
+  payload = pdu_view.GetPayload();
+  EXPECT_EQ(std::string(payload.begin(), payload.end()), "g");
+}
+
+TEST_F(LeCreditBasedDataControllerTest, receive_credits_are_returned_in_batches) {
+  common::BidiQueue<Scheduler::UpperEnqueue, Scheduler::UpperDequeue> channel_queue{10};
+  testing::MockScheduler scheduler;
+  testing::MockILink link;
+  LeCreditBasedDataController controller{&link, 0x41, 0x41, channel_queue.GetDownEnd(), queue_handler_, &scheduler};
+  controller.SetInitialRxCredits(100);
+  // The remote has plenty of credits left, so they are not returned one K-frame at a time
+  EXPECT_CALL(link, SendLeCredit(0x41, ::testing::_)).Times(0);
+  for (int i = 0; i < 2; i++) {
+    auto builder = FirstLeInformationFrameBuilder::Create(0x41, 4, CreateSdu({'a', 'b', 'c', 'd'}));
+    controller.OnPdu(GetPacketView(std::move(builder)));
+  }
+  sync_handler(queue_handler_);
+  EXPECT_NE(channel_queue.GetUpEnd()->TryDequeue(), nullptr);
+  EXPECT_NE(channel_queue.GetUpEnd()->TryDequeue(), nullptr);
+}
+
+TEST_F(LeCreditBasedDataControllerTest, receive_credits_are_returned_before_remote_runs_out) {
+  common::BidiQueue<Scheduler::UpperEnqueue, Scheduler::UpperDequeue> channel_queue{10};
+  testing::MockScheduler scheduler;
+  testing::MockILink link;
+  LeCreditBasedDataController controller{&link, 0x41, 0x41, channel_queue.GetDownEnd(), queue_handler_, &scheduler};
+  controller.SetInitialRxCredits(10);
+  int remote_credits = 10;
+  EXPECT_CALL(link, SendLeCredit(0x41, ::testing::_))
+      .WillRepeatedly(::testing::Invoke([&remote_credits](Cid, uint16_t credits) { remote_credits += credits; }));
+  // The remote sends as long as it has credits, and the upper layer keeps up
+  for (int i = 0; i < 100; i++) {
+    ASSERT_GT(remote_credits, 0);
+    remote_credits--;
+    auto builder = FirstLeInformationFrameBuilder::Create(0x41, 4, CreateSdu({'a', 'b', 'c', 'd'}));
+    controller.OnPdu(GetPacketView(std::move(builder)));
+    sync_handler(queue_handler_);
+    EXPECT_NE(channel_queue.GetUpEnd()->TryDequeue(), nullptr);
+  }
+  EXPECT_GT(remote_credits, 0);
+}
+
+TEST_F(LeCreditBasedDataControllerTest, receive_credits_withheld_while_busy_are_returned_when_drained) {
+  common::BidiQueue<Scheduler::UpperEnqueue, Scheduler::UpperDequeue> channel_queue{1};
+  testing::MockScheduler scheduler;
+  testing::MockILink link;
+  LeCreditBasedDataController controller{&link, 0x41, 0x41, channel_queue.GetDownEnd(), queue_handler_, &scheduler};
+  controller.SetInitialRxCredits(4);
+  int remote_credits = 4;
+  EXPECT_CALL(link, SendLeCredit(0x41, ::testing::_))
+      .WillRepeatedly(::testing::Invoke([&remote_credits](Cid, uint16_t credits) { remote_credits += credits; }));
+  // The upper layer does not dequeue, so the remote eventually uses up its credits
+  for (int i = 0; i < 100 && remote_credits > 0; i++) {
+    remote_credits--;
+    auto builder = FirstLeInformationFrameBuilder::Create(0x41, 4, CreateSdu({'a', 'b', 'c', 'd'}));
+    controller.OnPdu(GetPacketView(std::move(builder)));
+    sync_handler(queue_handler_);
+  }
+  EXPECT_EQ(remote_credits, 0);
+  while (channel_queue.GetUpEnd()->TryDequeue() != nullptr) {
+    sync_handler(queue_handler_);
+  }
+  EXPECT_GT(remote_credits, 0);
+}
+
+TEST_F(LeCreditBasedDataControllerTest, receive_credit_target_grows_when_remote_runs_out) {
+  common::BidiQueue<Scheduler::UpperEnqueue, Scheduler::UpperDequeue> channel_queue{10};
+  testing::MockScheduler scheduler;
+  testing::MockILink link;
+  LeCreditBasedDataController controller{&link, 0x41, 0x41, channel_queue.GetDownEnd(), queue_handler_, &scheduler};
+  controller.SetInitialRxCredits(1);
+  // The remote used its only credit, so it gets more than the initial credits back
+  EXPECT_CALL(link, SendLeCredit(0x41, 2));
+  auto builder = FirstLeInformationFrameBuilder::Create(0x41, 4, CreateSdu({'a', 'b', 'c', 'd'}));
+  controller.OnPdu(GetPacketView(std::move(builder)));
+  sync_handler(queue_handler_);
+  EXPECT_NE(channel_queue.GetUpEnd()->TryDequeue(), nullptr);
+}
+
+TEST_F(LeCreditBasedDataControllerTest, receive_credit_target_shrinks_when_upper_layer_is_busy) {
+  common::BidiQueue<Scheduler::UpperEnqueue, Scheduler::UpperDequeue> channel_queue{1};
+  testing::MockScheduler scheduler;
+  testing::MockILink link;
+  LeCreditBasedDataController controller{&link, 0x41, 0x41, channel_queue.GetDownEnd(), queue_handler_, &scheduler};
+  controller.SetInitialRxCredits(40);
+  int remote_credits = 40;
+  int credits_returned = 0;
+  EXPECT_CALL(link, SendLeCredit(0x41, ::testing::_))
+      .WillRepeatedly(::testing::Invoke([&](Cid, uint16_t credits) {
+        remote_credits += credits;
+        credits_returned += credits;
+      }));
+  // The first SDU fills the channel queue, the next three stay in the EnqueueBuffer
+  for (int i = 0; i < 4; i++) {
+    remote_credits--;
+    auto builder = FirstLeInformationFrameBuilder::Create(0x41, 4, CreateSdu({'a', 'b', 'c', 'd'}));
+    controller.OnPdu(GetPacketView(std::move(builder)));
+    sync_handler(queue_handler_);
+  }
+  EXPECT_EQ(credits_returned, 0);
+  while (channel_queue.GetUpEnd()->TryDequeue() != nullptr) {
+    sync_handler(queue_handler_);
+  }
+  // The remote still has more credits than the reduced target
+  EXPECT_EQ(credits_returned, 0);
+  for (int i = 0; i < 40 && credits_returned == 0; i++) {
+    remote_credits--;
+    auto builder = FirstLeInformationFrameBuilder::Create(0x41, 4, CreateSdu({'a', 'b', 'c', 'd'}));
+    controller.OnPdu(GetPacketView(std::move(builder)));
+    sync_handler(queue_handler_);
+    EXPECT_NE(channel_queue.GetUpEnd()->TryDequeue(), nullptr);
+  }
+  EXPECT_GT(credits_returned, 0);
+  // Topped up to three quarters of the initial credits
+  EXPECT_EQ(remote_credits, 30);
+}
+
 }  // namespace
 }  // namespace internal
 }  // namespace l2cap
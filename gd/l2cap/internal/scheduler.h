@@ -60,6 +60,12 @@ class Scheduler {
    */
   virtual void SetChannelTxPriority(Cid cid, bool high_priority) {}
 
+  /**
+   * Set the share of the link given to the specified cid, relative to the other channels of the same priority.
+   * Ignored by schedulers that do not share the link by weight.
+   */
+  virtual void SetChannelWeight(Cid cid, uint8_t weight) {}
+
   /**
    * Called by data controller to indicate that a channel is closed and packets should be dropped
    */
@@ -0,0 +1,298 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <deque>
+#include <future>
+#include <map>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "common/bidi_queue.h"
+#include "common/bind.h"
+#include "l2cap/cid.h"
+#include "l2cap/internal/data_controller.h"
+#include "l2cap/internal/data_pipeline_manager.h"
+#include "l2cap/internal/scheduler.h"
+#include "l2cap/internal/scheduler_drr.h"
+#include "l2cap/internal/scheduler_fifo.h"
+#include "l2cap/l2cap_packets.h"
+#include "os/handler.h"
+#include "os/log.h"
+#include "os/thread.h"
+#include "packet/raw_builder.h"
+
+using ::benchmark::State;
+using ::bluetooth::common::BidiQueue;
+using ::bluetooth::l2cap::BasicFrameBuilder;
+using ::bluetooth::l2cap::BasicFrameView;
+using ::bluetooth::l2cap::Cid;
+using ::bluetooth::l2cap::RetransmissionAndFlowControlConfigurationOption;
+using ::bluetooth::l2cap::internal::DataController;
+using ::bluetooth::l2cap::internal::DataPipelineManager;
+using ::bluetooth::l2cap::internal::DeficitRoundRobin;
+using ::bluetooth::l2cap::internal::Fifo;
+using ::bluetooth::l2cap::internal::Scheduler;
+using ::bluetooth::os::Handler;
+using ::bluetooth::os::Thread;
+using ::bluetooth::packet::BasePacketBuilder;
+
+namespace {
+
+// Air slots simulated per iteration
+constexpr uint64_t kSimulatedSlots = 20000;
+// Bytes the simulated link sends over the air per slot, the size of an LE data packet
+constexpr size_t kBytesPerSlot = 251;
+// Packets the simulated controller takes from the link queue ahead of sending them
+constexpr size_t kControllerBufferPackets = 2;
+
+class SimulatedDataController : public DataController {
+ public:
+  void OnSdu(std::unique_ptr<BasePacketBuilder> sdu) override {}
+  void OnPdu(bluetooth::packet::PacketView<true> pdu) override {}
+  std::unique_ptr<BasePacketBuilder> GetNextPacket() override {
+    auto next = std::move(packets_.front());
+    packets_.pop();
+    return next;
+  }
+  void EnableFcs(bool enabled) override {}
+  void SetRetransmissionAndFlowControlOptions(const RetransmissionAndFlowControlConfigurationOption& option) override {
+  }
+
+  std::queue<std::unique_ptr<BasePacketBuilder>> packets_;
+};
+
+struct SimulatedChannel {
+  std::string name_;
+  Cid cid_;
+  bool high_priority_;
+  uint8_t weight_;
+  size_t payload_size_;
+  // A packet is queued every period_ slots, or whenever the previous one is sent if 0
+  uint64_t period_;
+
+  SimulatedDataController data_controller_;
+  // Slot at which each packet that is not fully sent yet was queued
+  std::queue<uint64_t> queued_at_;
+  uint64_t bytes_sent_ = 0;
+  std::vector<uint64_t> latencies_;
+};
+
+// Hands the packets of the simulated channels to the scheduler, in place of the senders of a link
+class SimulatedDataPipelineManager : public DataPipelineManager {
+ public:
+  SimulatedDataPipelineManager(Handler* handler, LowerQueueUpEnd* link_queue_up_end,
+                               std::map<Cid, SimulatedChannel*>* channels)
+      : DataPipelineManager(handler, nullptr, link_queue_up_end), channels_(channels) {}
+
+  DataController* GetDataController(Cid cid) override {
+    return &channels_->at(cid)->data_controller_;
+  }
+
+  void OnPacketSent(Cid cid) override {}
+
+ private:
+  std::map<Cid, SimulatedChannel*>* channels_;
+};
+
+}  // namespace
+
+// Simulates a mix of channels sharing one LE link, and reports the latency of each channel in air slots, from the time
+// a packet is queued to the time its last byte is sent over the air, and the share of the link each backlogged
+// channel gets. state.range(0) is 1 for the deficit round robin scheduler, and 0 for the FIFO one.
+class BM_L2capScheduler : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    benchmark::Fixture::SetUp(st);
+    thread_ = std::make_unique<Thread>("BM_L2capScheduler thread", Thread::Priority::NORMAL);
+    handler_ = std::make_unique<Handler>(thread_.get());
+
+    channels_.push_back({"signalling", bluetooth::l2cap::kLeSignallingCid, false, 1, 12, 400});
+    channels_.push_back({"smp", bluetooth::l2cap::kSmpCid, false, 1, 65, 1000});
+    channels_.push_back({"att_notify", bluetooth::l2cap::kLeAttributeCid, false, 1, 23, 25});
+    channels_.push_back({"coc_audio", 0x40, true, 1, 120, 10});
+    channels_.push_back({"coc_sensor", 0x41, false, 1, 40, 15});
+    channels_.push_back({"coc_bulk_large", 0x42, false, 1, 1000, 0});
+    channels_.push_back({"coc_bulk_small", 0x43, false, 3, 200, 0});
+    for (auto& channel : channels_) {
+      cid_to_channel_[channel.cid_] = &channel;
+    }
+
+    data_pipeline_manager_ =
+        std::make_unique<SimulatedDataPipelineManager>(handler_.get(), link_queue_.GetUpEnd(), &cid_to_channel_);
+    if (st.range(0) == 1) {
+      scheduler_ =
+          std::make_unique<DeficitRoundRobin>(data_pipeline_manager_.get(), link_queue_.GetUpEnd(), handler_.get());
+    } else {
+      scheduler_ = std::make_unique<Fifo>(data_pipeline_manager_.get(), link_queue_.GetUpEnd(), handler_.get());
+    }
+    for (auto& channel : channels_) {
+      scheduler_->SetChannelTxPriority(channel.cid_, channel.high_priority_);
+      scheduler_->SetChannelWeight(channel.cid_, channel.weight_);
+    }
+    register_link_queue_dequeue();
+    handler_->Post(
+        bluetooth::common::BindOnce(&BM_L2capScheduler::queue_backlog, bluetooth::common::Unretained(this)));
+  }
+
+  void TearDown(State& st) override {
+    if (link_queue_dequeue_registered_) {
+      link_queue_.GetDownEnd()->UnregisterDequeue();
+    }
+    handler_->Clear();
+    scheduler_ = nullptr;
+    data_pipeline_manager_ = nullptr;
+    channels_.clear();
+    cid_to_channel_.clear();
+    controller_buffer_.clear();
+    handler_ = nullptr;
+    thread_->Stop();
+    thread_ = nullptr;
+    benchmark::Fixture::TearDown(st);
+  }
+
+  void queue_packet(SimulatedChannel* channel) {
+    auto payload = std::make_unique<bluetooth::packet::RawBuilder>();
+    payload->AddOctets(std::vector<uint8_t>(channel->payload_size_));
+    channel->data_controller_.packets_.push(BasicFrameBuilder::Create(channel->cid_, std::move(payload)));
+    channel->queued_at_.push(slot_);
+    scheduler_->OnPacketsReady(channel->cid_, 1);
+  }
+
+  // Backlogged channels always have a packet waiting behind the one being sent
+  void queue_backlog() {
+    for (auto& channel : channels_) {
+      if (channel.period_ == 0) {
+        queue_packet(&channel);
+        queue_packet(&channel);
+      }
+    }
+  }
+
+  // Packets still in flight at the end of a run carry over to the next one
+  void run_simulation() {
+    last_slot_ = slot_ + kSimulatedSlots;
+    send_over_the_air();
+  }
+
+  void register_link_queue_dequeue() {
+    link_queue_dequeue_registered_ = true;
+    link_queue_.GetDownEnd()->RegisterDequeue(
+        handler_.get(),
+        bluetooth::common::Bind(&BM_L2capScheduler::link_queue_dequeue, bluetooth::common::Unretained(this)));
+  }
+
+  // The controller only takes packets from the link queue while it has room for them, so that the scheduler decides
+  // which packet goes next
+  void link_queue_dequeue() {
+    auto packet = link_queue_.GetDownEnd()->TryDequeue();
+    auto bytes = std::make_shared<std::vector<uint8_t>>();
+    bluetooth::packet::BitInserter i(*bytes);
+    bytes->reserve(packet->size());
+    packet->Serialize(i);
+    auto basic_frame_view =
+        BasicFrameView::Create(bluetooth::packet::PacketView<bluetooth::packet::kLittleEndian>(bytes));
+    ASSERT(basic_frame_view.IsValid());
+    controller_buffer_.emplace_back(basic_frame_view.GetChannelId(), bytes->size());
+    if (controller_buffer_.size() == kControllerBufferPackets) {
+      link_queue_.GetDownEnd()->UnregisterDequeue();
+      link_queue_dequeue_registered_ = false;
+    }
+  }
+
+  // One air slot: send the next kBytesPerSlot bytes of the oldest buffered packet, and let the periodic channels queue
+  // packets
+  void send_over_the_air() {
+    slot_++;
+    if (!controller_buffer_.empty()) {
+      auto& [cid, bytes_left] = controller_buffer_.front();
+      SimulatedChannel* channel = cid_to_channel_[cid];
+      size_t bytes_sent = std::min(bytes_left, kBytesPerSlot);
+      bytes_left -= bytes_sent;
+      channel->bytes_sent_ += bytes_sent;
+      if (bytes_left == 0) {
+        controller_buffer_.pop_front();
+        channel->latencies_.push_back(slot_ - channel->queued_at_.front());
+        channel->queued_at_.pop();
+        if (channel->period_ == 0) {
+          queue_packet(channel);
+        }
+        if (!link_queue_dequeue_registered_) {
+          register_link_queue_dequeue();
+        }
+      }
+    }
+    for (auto& channel : channels_) {
+      if (channel.period_ != 0 && slot_ % channel.period_ == 0) {
+        queue_packet(&channel);
+      }
+    }
+    if (slot_ == last_slot_) {
+      simulation_promise_.set_value();
+      return;
+    }
+    handler_->Post(
+        bluetooth::common::BindOnce(&BM_L2capScheduler::send_over_the_air, bluetooth::common::Unretained(this)));
+  }
+
+  std::unique_ptr<Thread> thread_;
+  std::unique_ptr<Handler> handler_;
+  BidiQueue<Scheduler::LowerDequeue, Scheduler::LowerEnqueue> link_queue_{3};
+  std::vector<SimulatedChannel> channels_;
+  std::map<Cid, SimulatedChannel*> cid_to_channel_;
+  std::unique_ptr<SimulatedDataPipelineManager> data_pipeline_manager_;
+  std::unique_ptr<Scheduler> scheduler_;
+  bool link_queue_dequeue_registered_ = false;
+  // Channel and bytes left to send of the packets buffered in the controller, in the order they are sent
+  std::deque<std::pair<Cid, size_t>> controller_buffer_;
+  uint64_t slot_ = 0;
+  uint64_t last_slot_ = 0;
+  std::promise<void> simulation_promise_;
+};
+
+BENCHMARK_DEFINE_F(BM_L2capScheduler, channel_latency)(State& state) {
+  for (auto _ : state) {
+    simulation_promise_ = std::promise<void>();
+    auto simulation_future = simulation_promise_.get_future();
+    handler_->Post(
+        bluetooth::common::BindOnce(&BM_L2capScheduler::run_simulation, bluetooth::common::Unretained(this)));
+    simulation_future.wait();
+  }
+  // The handler thread is done with the channels once the last slot has run
+  uint64_t total_bytes_sent = 0;
+  for (auto& channel : channels_) {
+    total_bytes_sent += channel.bytes_sent_;
+  }
+  for (auto& channel : channels_) {
+    auto& latencies = channel.latencies_;
+    if (latencies.empty()) {
+      continue;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    if (channel.period_ == 0) {
+      state.counters[channel.name_ + "_share"] = static_cast<double>(channel.bytes_sent_) / total_bytes_sent;
+    } else {
+      state.counters[channel.name_ + "_p50"] = latencies[latencies.size() / 2];
+      state.counters[channel.name_ + "_p99"] = latencies[latencies.size() * 99 / 100];
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kSimulatedSlots);
+};
+
+BENCHMARK_REGISTER_F(BM_L2capScheduler, channel_latency)->Arg(0)->Arg(1)->UseRealTime();
@@ -0,0 +1,182 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "l2cap/internal/scheduler_drr.h"
+
+#include "l2cap/internal/data_pipeline_manager.h"
+#include "os/log.h"
+
+namespace bluetooth {
+namespace l2cap {
+namespace internal {
+
+DeficitRoundRobin::DeficitRoundRobin(DataPipelineManager* data_pipeline_manager, LowerQueueUpEnd* link_queue_up_end,
+                                     os::Handler* handler)
+    : data_pipeline_manager_(data_pipeline_manager), link_queue_up_end_(link_queue_up_end), handler_(handler) {
+  ASSERT(link_queue_up_end_ != nullptr && handler_ != nullptr);
+}
+
+DeficitRoundRobin::~DeficitRoundRobin() {
+  try_unregister_link_queue_enqueue();
+}
+
+// Invoked within L2CAP Handler context
+void DeficitRoundRobin::OnPacketsReady(Cid cid, int number_packets) {
+  if (number_packets == 0) {
+    return;
+  }
+  auto& channel = channels_[cid];
+  if (channel.packets_ready == 0) {
+    active_channels_[get_tier(cid, channel)].push_back(cid);
+  }
+  channel.packets_ready += number_packets;
+  try_register_link_queue_enqueue();
+}
+
+// Invoked within L2CAP Handler context
+void DeficitRoundRobin::SetChannelTxPriority(Cid cid, bool high_priority) {
+  auto channel = channels_.find(cid);
+  if (channel == channels_.end()) {
+    if (!high_priority) {
+      return;
+    }
+    channel = channels_.emplace(cid, ChannelState()).first;
+  }
+  Tier previous_tier = get_tier(cid, channel->second);
+  channel->second.high_priority = high_priority;
+  Tier tier = get_tier(cid, channel->second);
+  if (channel->second.packets_ready > 0 && tier != previous_tier) {
+    active_channels_[previous_tier].remove(cid);
+    active_channels_[tier].push_back(cid);
+    channel->second.deficit = 0;
+  }
+}
+
+// Invoked within L2CAP Handler context
+void DeficitRoundRobin::SetChannelWeight(Cid cid, uint8_t weight) {
+  ASSERT_LOG(weight > 0, "cid 0x%hx would never get its turn", cid);
+  channels_[cid].weight = weight;
+}
+
+void DeficitRoundRobin::RemoveChannel(Cid cid) {
+  auto channel = channels_.find(cid);
+  if (channel == channels_.end()) {
+    return;
+  }
+  if (channel->second.packets_ready > 0) {
+    active_channels_[get_tier(cid, channel->second)].remove(cid);
+  }
+  channels_.erase(channel);
+  if (!has_packets_ready()) {
+    try_unregister_link_queue_enqueue();
+  }
+}
+
+DeficitRoundRobin::Tier DeficitRoundRobin::get_tier(Cid cid, const ChannelState& channel) {
+  switch (cid) {
+    case kClassicSignallingCid:
+    case kLeSignallingCid:
+    case kSmpCid:
+    case kSmpBrCid:
+      return CONTROL;
+    case kLeAttributeCid:
+      return HIGH_PRIORITY;
+    default:
+      return channel.high_priority ? HIGH_PRIORITY : WEIGHTED;
+  }
+}
+
+Cid DeficitRoundRobin::next_channel_to_send() {
+  for (auto tier : {CONTROL, HIGH_PRIORITY}) {
+    if (!active_channels_[tier].empty()) {
+      return active_channels_[tier].front();
+    }
+  }
+  auto& weighted_channels = active_channels_[WEIGHTED];
+  ASSERT(!weighted_channels.empty());
+  while (true) {
+    Cid cid = weighted_channels.front();
+    auto& channel = channels_[cid];
+    // The channel at the front with no deficit left is starting its turn
+    if (channel.deficit <= 0) {
+      channel.deficit += kQuantum * channel.weight;
+    }
+    if (channel.deficit > 0) {
+      return cid;
+    }
+    // Still paying back a packet larger than its quantum, wait for the next round
+    weighted_channels.splice(weighted_channels.end(), weighted_channels, weighted_channels.begin());
+  }
+}
+
+bool DeficitRoundRobin::has_packets_ready() const {
+  for (const auto& tier : active_channels_) {
+    if (!tier.empty()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Invoked from some external Queue Reactable context
+std::unique_ptr<DeficitRoundRobin::LowerEnqueue> DeficitRoundRobin::link_queue_enqueue_callback() {
+  Cid cid = next_channel_to_send();
+  auto& channel = channels_[cid];
+  auto& active_channels = active_channels_[get_tier(cid, channel)];
+  auto packet = data_pipeline_manager_->GetDataController(cid)->GetNextPacket();
+  channel.packets_ready--;
+  active_channels.pop_front();
+  if (get_tier(cid, channel) != WEIGHTED) {
+    // Channels of a strict priority tier take turns packet by packet
+    if (channel.packets_ready > 0) {
+      active_channels.push_back(cid);
+    }
+  } else if (channel.packets_ready == 0) {
+    // An idle channel does not keep its deficit, so that it cannot burst when it has packets again
+    channel.deficit = 0;
+  } else {
+    channel.deficit -= packet->size();
+    if (channel.deficit > 0) {
+      active_channels.push_front(cid);
+    } else {
+      active_channels.push_back(cid);
+    }
+  }
+
+  data_pipeline_manager_->OnPacketSent(cid);
+  if (!has_packets_ready()) {
+    try_unregister_link_queue_enqueue();
+  }
+  return packet;
+}
+
+void DeficitRoundRobin::try_register_link_queue_enqueue() {
+  if (link_queue_enqueue_registered_.exchange(true)) {
+    return;
+  }
+  link_queue_up_end_->RegisterEnqueue(
+      handler_, common::Bind(&DeficitRoundRobin::link_queue_enqueue_callback, common::Unretained(this)));
+}
+
+void DeficitRoundRobin::try_unregister_link_queue_enqueue() {
+  if (link_queue_enqueue_registered_.exchange(false)) {
+    link_queue_up_end_->UnregisterEnqueue();
+  }
+}
+
+}  // namespace internal
+}  // namespace l2cap
+}  // namespace bluetooth
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+
+#include "common/bidi_queue.h"
+#include "common/bind.h"
+#include "l2cap/cid.h"
+#include "l2cap/internal/scheduler.h"
+#include "os/handler.h"
+#include "os/queue.h"
+
+namespace bluetooth {
+namespace l2cap {
+namespace internal {
+class DataPipelineManager;
+
+/**
+ * Schedule the outgoing packets of the channels of a link by priority tier, then by deficit round robin.
+ *
+ * Signalling and SMP channels are served first, then ATT and the channels set to high priority with
+ * SetChannelTxPriority(). Channels of these two tiers take turns one packet at a time. All other channels share what
+ * is left of the link by weight: in its turn, a channel sends packets while it has a positive deficit, each packet
+ * taking its size in bytes off it, then goes to the back of the list. The deficit is topped up by weight * kQuantum
+ * bytes when the channel gets its turn again, so a channel sending large packets cannot hold back the others for more
+ * than one packet, and over time each channel gets a share of the bytes sent proportional to its weight.
+ */
+class DeficitRoundRobin : public Scheduler {
+ public:
+  // Bytes a channel of weight 1 may send per turn
+  static constexpr int kQuantum = 1024;
+  static constexpr uint8_t kDefaultWeight = 1;
+
+  DeficitRoundRobin(DataPipelineManager* data_pipeline_manager, LowerQueueUpEnd* link_queue_up_end,
+                    os::Handler* handler);
+  ~DeficitRoundRobin();
+  void OnPacketsReady(Cid cid, int number_packets) override;
+  void SetChannelTxPriority(Cid cid, bool high_priority) override;
+  void SetChannelWeight(Cid cid, uint8_t weight) override;
+  void RemoveChannel(Cid cid) override;
+
+ private:
+  // Served in strict priority order
+  enum Tier { CONTROL = 0, HIGH_PRIORITY = 1, WEIGHTED = 2, NUM_TIERS = 3 };
+
+  struct ChannelState {
+    int packets_ready = 0;
+    bool high_priority = false;
+    uint8_t weight = kDefaultWeight;
+    // Bytes the channel may still send in its turn. Goes negative when a packet is larger than what was left
+    int deficit = 0;
+  };
+
+  DataPipelineManager* data_pipeline_manager_;
+  LowerQueueUpEnd* link_queue_up_end_;
+  os::Handler* handler_;
+  std::unordered_map<Cid, ChannelState> channels_;
+  // Channels with packets ready, per tier, in the order they get their turn
+  std::array<std::list<Cid>, NUM_TIERS> active_channels_;
+  std::atomic_bool link_queue_enqueue_registered_ = false;
+
+  static Tier get_tier(Cid cid, const ChannelState& channel);
+  Cid next_channel_to_send();
+  bool has_packets_ready() const;
+  void try_register_link_queue_enqueue();
+  void try_unregister_link_queue_enqueue();
+  std::unique_ptr<LowerEnqueue> link_queue_enqueue_callback();
+};
+
+}  // namespace internal
+}  // namespace l2cap
+}  // namespace bluetooth
@@ -0,0 +1,199 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "l2cap/internal/scheduler_drr.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <map>
+#include <queue>
+#include <vector>
+
+#include "l2cap/internal/data_controller_mock.h"
+#include "l2cap/internal/data_pipeline_manager_mock.h"
+#include "os/handler.h"
+#include "os/mock_queue.h"
+#include "os/system_properties.h"
+#include "os/thread.h"
+#include "packet/raw_builder.h"
+
+namespace bluetooth {
+namespace l2cap {
+namespace internal {
+namespace {
+
+using ::testing::_;
+using ::testing::Invoke;
+
+std::unique_ptr<packet::BasePacketBuilder> CreateSdu(std::vector<uint8_t> payload) {
+  auto raw_builder = std::make_unique<packet::RawBuilder>();
+  raw_builder->AddOctets(payload);
+  return raw_builder;
+}
+
+PacketView<kLittleEndian> GetPacketView(std::unique_ptr<packet::BasePacketBuilder> packet) {
+  auto bytes = std::make_shared<std::vector<uint8_t>>();
+  BitInserter i(*bytes);
+  bytes->reserve(packet->size());
+  packet->Serialize(i);
+  return packet::PacketView<packet::kLittleEndian>(bytes);
+}
+
+class MyDataController : public testing::MockDataController {
+ public:
+  std::unique_ptr<BasePacketBuilder> GetNextPacket() override {
+    auto next = std::move(next_packets.front());
+    next_packets.pop();
+    return next;
+  }
+
+  std::queue<std::unique_ptr<BasePacketBuilder>> next_packets;
+};
+
+class L2capSchedulerDrrTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    thread_ = new os::Thread("test_thread", os::Thread::Priority::NORMAL);
+    queue_handler_ = new os::Handler(thread_);
+    mock_data_pipeline_manager_ = new testing::MockDataPipelineManager(queue_handler_, &queue_end_);
+    drr_ = new DeficitRoundRobin(mock_data_pipeline_manager_, &queue_end_, queue_handler_);
+    ON_CALL(*mock_data_pipeline_manager_, GetDataController(_)).WillByDefault(Invoke([this](Cid cid) {
+      return &data_controllers_[cid];
+    }));
+    EXPECT_CALL(*mock_data_pipeline_manager_, OnPacketSent(_)).Times(::testing::AnyNumber());
+  }
+
+  void TearDown() override {
+    delete drr_;
+    delete mock_data_pipeline_manager_;
+    queue_handler_->Clear();
+    delete queue_handler_;
+    delete thread_;
+  }
+
+  // Queue |number_packets| basic frames of |payload_size| bytes on |cid|, and tell the scheduler about them
+  void QueuePackets(Cid cid, int number_packets, size_t payload_size) {
+    for (int i = 0; i < number_packets; i++) {
+      auto frame = BasicFrameBuilder::Create(cid, CreateSdu(std::vector<uint8_t>(payload_size)));
+      data_controllers_[cid].next_packets.push(std::move(frame));
+    }
+    drr_->OnPacketsReady(cid, number_packets);
+  }
+
+  // Return the channels of the packets sent to the link so far, in order
+  std::vector<Cid> SentChannels() {
+    std::vector<Cid> cids;
+    while (!enqueue_.enqueued.empty()) {
+      auto packet_view = GetPacketView(std::move(enqueue_.enqueued.front()));
+      enqueue_.enqueued.pop();
+      auto basic_frame_view = BasicFrameView::Create(packet_view);
+      EXPECT_TRUE(basic_frame_view.IsValid());
+      cids.push_back(basic_frame_view.GetChannelId());
+    }
+    return cids;
+  }
+
+  os::Thread* thread_ = nullptr;
+  os::Handler* queue_handler_ = nullptr;
+  os::MockIQueueDequeue<Scheduler::LowerDequeue> dequeue_;
+  os::MockIQueueEnqueue<Scheduler::LowerEnqueue> enqueue_;
+  common::BidiQueueEnd<Scheduler::LowerEnqueue, Scheduler::LowerDequeue> queue_end_{&enqueue_, &dequeue_};
+  testing::MockDataPipelineManager* mock_data_pipeline_manager_ = nullptr;
+  std::map<Cid, MyDataController> data_controllers_;
+  DeficitRoundRobin* drr_ = nullptr;
+};
+
+TEST_F(L2capSchedulerDrrTest, send_packet) {
+  auto frame = BasicFrameBuilder::Create(0x40, CreateSdu({'a', 'b', 'c'}));
+  data_controllers_[0x40].next_packets.push(std::move(frame));
+  EXPECT_CALL(*mock_data_pipeline_manager_, OnPacketSent(0x40));
+  drr_->OnPacketsReady(0x40, 1);
+  enqueue_.run_enqueue();
+  ASSERT_EQ(enqueue_.enqueued.size(), 1u);
+  auto packet_view = GetPacketView(std::move(enqueue_.enqueued.front()));
+  enqueue_.enqueued.pop();
+  auto basic_frame_view = BasicFrameView::Create(packet_view);
+  ASSERT_TRUE(basic_frame_view.IsValid());
+  ASSERT_EQ(basic_frame_view.GetChannelId(), 0x40);
+  auto payload = basic_frame_view.GetPayload();
+  ASSERT_EQ(std::string(payload.begin(), payload.end()), "abc");
+  // Nothing left to send
+  ASSERT_EQ(enqueue_.registered_handler, nullptr);
+}
+
+TEST(L2capSchedulerTypeTest, deficit_round_robin_is_opt_in) {
+  os::ClearSystemPropertiesForHost();
+  ASSERT_EQ(DataPipelineManager::GetSchedulerType(), DataPipelineManager::SchedulerType::FIFO);
+  os::SetSystemProperty(DataPipelineManager::kSchedulerProperty, "drr");
+  ASSERT_EQ(DataPipelineManager::GetSchedulerType(), DataPipelineManager::SchedulerType::DEFICIT_ROUND_ROBIN);
+  os::SetSystemProperty(DataPipelineManager::kSchedulerProperty, "fifo");
+  ASSERT_EQ(DataPipelineManager::GetSchedulerType(), DataPipelineManager::SchedulerType::FIFO);
+  os::ClearSystemPropertiesForHost();
+}
+
+TEST_F(L2capSchedulerDrrTest, control_and_att_channels_go_first) {
+  QueuePackets(0x40, 2, 10);
+  QueuePackets(kLeAttributeCid, 1, 10);
+  QueuePackets(kLeSignallingCid, 1, 10);
+  QueuePackets(kSmpCid, 1, 10);
+  enqueue_.run_enqueue(5);
+  ASSERT_THAT(SentChannels(), ::testing::ElementsAre(kLeSignallingCid, kSmpCid, kLeAttributeCid, 0x40, 0x40));
+}
+
+TEST_F(L2capSchedulerDrrTest, prioritize_channel) {
+  QueuePackets(0x40, 1, 10);
+  QueuePackets(0x41, 1, 10);
+  drr_->SetChannelTxPriority(0x41, true);
+  enqueue_.run_enqueue(2);
+  ASSERT_THAT(SentChannels(), ::testing::ElementsAre(0x41, 0x40));
+}
+
+TEST_F(L2capSchedulerDrrTest, channels_share_link_by_weight) {
+  // Basic frames of half a quantum, header included
+  size_t payload_size = DeficitRoundRobin::kQuantum / 2 - 4;
+  drr_->SetChannelWeight(0x41, 2);
+  QueuePackets(0x40, 6, payload_size);
+  QueuePackets(0x41, 6, payload_size);
+  enqueue_.run_enqueue(12);
+  ASSERT_THAT(SentChannels(), ::testing::ElementsAre(0x40, 0x40, 0x41, 0x41, 0x41, 0x41, 0x40, 0x40, 0x41, 0x41,
+                                                     0x40, 0x40));
+}
+
+TEST_F(L2capSchedulerDrrTest, large_packet_does_not_hold_back_other_channels) {
+  QueuePackets(0x40, 2, 3 * DeficitRoundRobin::kQuantum);
+  QueuePackets(0x41, 12, 256);
+  enqueue_.run_enqueue(14);
+  // 0x40 pays back its first packet over the next two rounds, while 0x41 sends a quantum's worth in each of its turns
+  std::vector<Cid> expected = {0x40};
+  expected.insert(expected.end(), 12, 0x41);
+  expected.push_back(0x40);
+  ASSERT_EQ(SentChannels(), expected);
+}
+
+TEST_F(L2capSchedulerDrrTest, remove_channel) {
+  QueuePackets(0x40, 1, 10);
+  QueuePackets(0x41, 1, 10);
+  drr_->RemoveChannel(0x40);
+  enqueue_.run_enqueue(2);
+  ASSERT_THAT(SentChannels(), ::testing::ElementsAre(0x41));
+  ASSERT_EQ(enqueue_.registered_handler, nullptr);
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace l2cap
+}  // namespace bluetooth
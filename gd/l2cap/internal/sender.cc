@@ -103,12 +103,14 @@ void Sender::UpdateClassicConfiguration(classic::internal::ChannelConfigurationS
     return;
   }
   if (mode == RetransmissionAndFlowControlModeOption::ENHANCED_RETRANSMISSION) {
-    data_controller_ =
+    auto ertm_controller =
         std::make_unique<ErtmController>(link_, channel_id_, remote_channel_id_, queue_end_, handler_, scheduler_);
     RetransmissionAndFlowControlConfigurationOption option = config.local_retransmission_and_flow_control_;
     option.tx_window_size_ = config.remote_retransmission_and_flow_control_.tx_window_size_;
-    data_controller_->SetRetransmissionAndFlowControlOptions(option);
-    data_controller_->EnableFcs(config.fcs_type_ == FcsType::DEFAULT);
+    ertm_controller->SetRetransmissionAndFlowControlOptions(option);
+    ertm_controller->SetLocalTxWindow(config.local_retransmission_and_flow_control_.tx_window_size_);
+    ertm_controller->EnableFcs(config.fcs_type_ == FcsType::DEFAULT);
+    data_controller_ = std::move(ertm_controller);
     return;
   }
 }
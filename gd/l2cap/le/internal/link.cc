@@ -40,7 +40,8 @@ Link::Link(os::Handler* l2cap_handler, std::unique_ptr<hci::acl_manager::LeAclCo
            DynamicChannelServiceManagerImpl* dynamic_service_manager,
            FixedChannelServiceManagerImpl* fixed_service_manager, LinkManager* link_manager)
     : l2cap_handler_(l2cap_handler), acl_connection_(std::move(acl_connection)),
-      data_pipeline_manager_(l2cap_handler, this, acl_connection_->GetAclQueueEnd()),
+      data_pipeline_manager_(l2cap_handler, this, acl_connection_->GetAclQueueEnd(),
+                             l2cap::internal::DataPipelineManager::GetSchedulerType()),
       parameter_provider_(parameter_provider), dynamic_service_manager_(dynamic_service_manager),
       signalling_manager_(l2cap_handler_, this, &data_pipeline_manager_, dynamic_service_manager_,
                           &dynamic_channel_allocator_),
@@ -279,6 +280,10 @@ void Link::SendLeCredit(Cid local_cid, uint16_t credit) {
   signalling_manager_.SendCredit(local_cid, credit);
 }
 
+void Link::SetChannelWeight(Cid local_cid, uint8_t weight) {
+  data_pipeline_manager_.SetChannelWeight(local_cid, weight);
+}
+
 void Link::ReadRemoteVersionInformation() {
   acl_connection_->ReadRemoteVersionInformation();
 }
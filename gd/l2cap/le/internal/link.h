@@ -143,6 +143,8 @@ class Link : public l2cap::internal::ILink, public hci::acl_manager::LeConnectio
 
   void SendLeCredit(Cid local_cid, uint16_t credit) override;
 
+  void SetChannelWeight(Cid local_cid, uint8_t weight) override;
+
   LinkOptions* GetLinkOptions() {
     return &link_options_;
   }
@@ -23,6 +23,7 @@
 #include "common/callback.h"
 #include "os/handler.h"
 #include "os/thread.h"
+#include "os/timer_wheel.h"
 #include "os/utils.h"
 
 namespace bluetooth {
@@ -30,7 +31,7 @@ namespace os {
 
 // A single-shot alarm for reactor-based thread, implemented by Linux timerfd.
 // When it's constructed, it will register a reactable on the specified thread; when it's destroyed, it will unregister
-// itself from the thread.
+// itself from the thread. If the handler has a timer wheel enabled, the alarm registers a timer on it instead.
 class Alarm {
  public:
   // Create and register a single-shot alarm on a given handler
@@ -51,9 +52,11 @@ class Alarm {
   common::OnceClosure task_;
   Handler* handler_;
   int fd_ = 0;
-  Reactor::Reactable* token_;
+  Reactor::Reactable* token_ = nullptr;
+  TimerWheel::Timer* timer_ = nullptr;
   mutable std::mutex mutex_;
   void on_fire();
+  void on_timer_expired();
 };
 
 }  // namespace os
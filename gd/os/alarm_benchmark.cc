@@ -17,6 +17,7 @@
 #include <chrono>
 #include <future>
 #include <unordered_map>
+#include <vector>
 
 #include "benchmark/benchmark.h"
 #include "common/bind.h"
@@ -140,3 +141,87 @@ BENCHMARK_REGISTER_F(BM_ReactableAlarm, periodic_accuracy)
     ->Args({2000, 15, 20})
     ->Iterations(1)
     ->UseRealTime();
+
+class BM_ManyAlarms : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    ::benchmark::Fixture::SetUp(st);
+    thread_ = std::make_unique<Thread>("many_alarms_benchmark", Thread::Priority::NORMAL);
+    handler_ = std::make_unique<Handler>(thread_.get());
+  }
+
+  void TearDown(State& st) override {
+    alarms_.clear();
+    handler_->Clear();
+    handler_ = nullptr;
+    thread_->Stop();
+    thread_ = nullptr;
+    ::benchmark::Fixture::TearDown(st);
+  }
+
+  void CreateAlarms(int num_alarms, bool use_timer_wheel) {
+    if (use_timer_wheel) {
+      handler_->EnableTimerWheel();
+    }
+    for (int i = 0; i < num_alarms; i++) {
+      alarms_.push_back(std::make_unique<Alarm>(handler_.get()));
+    }
+  }
+
+  void AlarmFired() {
+    if (++fired_ == static_cast<int>(alarms_.size())) {
+      promise_.set_value();
+    }
+  }
+
+  int fired_ = 0;
+  std::promise<void> promise_;
+  std::unique_ptr<Thread> thread_;
+  std::unique_ptr<Handler> handler_;
+  std::vector<std::unique_ptr<Alarm>> alarms_;
+};
+
+// Arm and cancel a large number of timeouts that never fire, as protocol timers usually do
+BENCHMARK_DEFINE_F(BM_ManyAlarms, schedule_and_cancel)(State& state) {
+  CreateAlarms(state.range(0), state.range(1));
+  for (auto _ : state) {
+    for (auto& alarm : alarms_) {
+      alarm->Schedule(bluetooth::common::BindOnce([] {}), std::chrono::milliseconds(10000));
+    }
+    for (auto& alarm : alarms_) {
+      alarm->Cancel();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * alarms_.size());
+};
+
+BENCHMARK_REGISTER_F(BM_ManyAlarms, schedule_and_cancel)
+    ->Args({10, false})
+    ->Args({10, true})
+    ->Args({1000, false})
+    ->Args({1000, true});
+
+// Arm a large number of alarms with spread out deadlines and wait for all of them to fire
+BENCHMARK_DEFINE_F(BM_ManyAlarms, schedule_and_fire)(State& state) {
+  CreateAlarms(state.range(0), state.range(1));
+  for (auto _ : state) {
+    fired_ = 0;
+    promise_ = std::promise<void>();
+    auto future = promise_.get_future();
+    for (size_t i = 0; i < alarms_.size(); i++) {
+      alarms_[i]->Schedule(
+          bluetooth::common::BindOnce(&BM_ManyAlarms_schedule_and_fire_Benchmark::AlarmFired,
+                                      bluetooth::common::Unretained(this)),
+          std::chrono::milliseconds(1 + i % 20));
+    }
+    future.wait();
+  }
+  state.SetItemsProcessed(state.iterations() * alarms_.size());
+};
+
+BENCHMARK_REGISTER_F(BM_ManyAlarms, schedule_and_fire)
+    ->Args({10, false})
+    ->Args({10, true})
+    ->Args({1000, false})
+    ->Args({1000, true})
+    ->UseRealTime();
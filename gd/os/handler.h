@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -24,12 +25,15 @@
 #include "common/bind.h"
 #include "common/callback.h"
 #include "common/contextual_callback.h"
+#include "common/mpsc_ring.h"
 #include "os/thread.h"
 #include "os/utils.h"
 
 namespace bluetooth {
 namespace os {
 
+class TimerWheel;
+
 // A message-queue style handler for reactor-based thread to handle incoming events from different threads. When it's
 // constructed, it will register a reactable on the specified thread; when it's destroyed, it will unregister itself
 // from the thread.
@@ -38,6 +42,11 @@ class Handler : public common::IPostableContext {
   // Create and register a handler on given thread
   explicit Handler(Thread* thread);
 
+  // Create and register a handler on given thread that runs up to |max_tasks_per_wakeup| closures each time the
+  // reactor wakes it up. Larger values let a burst of posts run back to back instead of interleaving with the other
+  // reactables on the thread.
+  Handler(Thread* thread, size_t max_tasks_per_wakeup);
+
   // Unregister this handler from the thread and release resource. Unhandled events will be discarded and not executed.
   virtual ~Handler();
 
@@ -52,6 +61,10 @@ class Handler : public common::IPostableContext {
   // Die if the current reactable doesn't stop before the timeout.  Must be called after Clear()
   void WaitUntilStopped(std::chrono::milliseconds timeout);
 
+  // Multiplex all Alarms and RepeatingAlarms created on this handler from now on onto a single timer wheel with one
+  // timerfd, instead of giving each of them its own timerfd. Must be called before any alarm is created on it.
+  void EnableTimerWheel();
+
   template <typename Functor, typename... Args>
   void Call(Functor&& functor, Args&&... args) {
     Post(common::BindOnce(std::forward<Functor>(functor), std::forward<Args>(args)...));
@@ -97,15 +110,30 @@ class Handler : public common::IPostableContext {
   friend class RepeatingAlarm;
 
  private:
+  // Number of posted closures the lock-free ring holds before Post() falls back to |overflow_|
+  static constexpr size_t kTaskRingCapacity = 1024;
+
   inline bool was_cleared() const {
-    return tasks_ == nullptr;
+    return cleared_.load();
   };
-  std::queue<common::OnceClosure>* tasks_;
+  // Producers push closures without taking any lock. The eventfd is only written when |pending_| goes from zero to
+  // non-zero and only read when the consumer brings it back to zero.
+  common::MpscRing<common::OnceClosure> tasks_;
+  std::queue<common::OnceClosure> overflow_;
+  std::atomic<size_t> overflow_size_ = 0;
+  std::mutex overflow_mutex_;
+  std::atomic<size_t> pending_ = 0;
+  std::atomic_bool cleared_ = false;
   Thread* thread_;
+  const size_t max_tasks_per_wakeup_;
   int fd_;
   Reactor::Reactable* reactable_;
+  std::unique_ptr<TimerWheel> timer_wheel_;
+  // Serializes the consumer side of |tasks_| between the reactor thread and Clear()
   mutable std::mutex mutex_;
   void handle_next_event();
+  bool take_next_task(common::OnceClosure* closure);
+  void reset_wakeup();
 };
 
 }  // namespace os
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "common/bind.h"
+#include "os/handler.h"
+#include "os/thread.h"
+
+using ::benchmark::State;
+using ::bluetooth::common::BindOnce;
+using ::bluetooth::os::Handler;
+using ::bluetooth::os::Thread;
+
+// Compares the default one-closure-per-wakeup Handler against batched draining. state.range(0) is the number of
+// closures posted in a burst and state.range(1) is the maximum number of closures run per wakeup.
+class BM_HandlerDrain : public ::benchmark::Fixture {
+ protected:
+  void SetUp(State& st) override {
+    benchmark::Fixture::SetUp(st);
+    thread_ = std::make_unique<Thread>("BM_HandlerDrain thread", Thread::Priority::NORMAL);
+    handler_ = std::make_unique<Handler>(thread_.get(), st.range(1));
+  }
+  void TearDown(State& st) override {
+    handler_->Clear();
+    handler_ = nullptr;
+    thread_->Stop();
+    thread_ = nullptr;
+    benchmark::Fixture::TearDown(st);
+  }
+
+  void callback_batch() {
+    counter_++;
+    if (counter_ >= num_messages_to_send_) {
+      counter_promise_.set_value();
+    }
+  }
+
+  int64_t num_messages_to_send_;
+  int64_t counter_;
+  std::promise<void> counter_promise_;
+  std::unique_ptr<Thread> thread_;
+  std::unique_ptr<Handler> handler_;
+};
+
+BENCHMARK_DEFINE_F(BM_HandlerDrain, burst_post)(State& state) {
+  for (auto _ : state) {
+    num_messages_to_send_ = state.range(0);
+    counter_ = 0;
+    counter_promise_ = std::promise<void>();
+    std::future<void> counter_future = counter_promise_.get_future();
+    for (int i = 0; i < num_messages_to_send_; i++) {
+      handler_->Post(
+          BindOnce(&BM_HandlerDrain_burst_post_Benchmark::callback_batch, bluetooth::common::Unretained(this)));
+    }
+    counter_future.wait();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+};
+
+BENCHMARK_REGISTER_F(BM_HandlerDrain, burst_post)
+    ->Args({100, 1})
+    ->Args({100, 64})
+    ->Args({10000, 1})
+    ->Args({10000, 16})
+    ->Args({10000, 64})
+    ->Args({10000, 256})
+    ->Args({100000, 1})
+    ->Args({100000, 64})
+    ->UseRealTime();
+
+// Several producer threads posting concurrently, as the HAL and stack threads do during ACL bursts
+BENCHMARK_DEFINE_F(BM_HandlerDrain, concurrent_post)(State& state) {
+  constexpr int kNumProducers = 4;
+  for (auto _ : state) {
+    num_messages_to_send_ = state.range(0) * kNumProducers;
+    counter_ = 0;
+    counter_promise_ = std::promise<void>();
+    std::future<void> counter_future = counter_promise_.get_future();
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kNumProducers; p++) {
+      producers.emplace_back([this, &state]() {
+        for (int i = 0; i < state.range(0); i++) {
+          handler_->Post(BindOnce(
+              &BM_HandlerDrain_concurrent_post_Benchmark::callback_batch, bluetooth::common::Unretained(this)));
+        }
+      });
+    }
+    for (auto& producer : producers) {
+      producer.join();
+    }
+    counter_future.wait();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) * kNumProducers);
+};
+
+BENCHMARK_REGISTER_F(BM_HandlerDrain, concurrent_post)
+    ->Args({1000, 1})
+    ->Args({1000, 64})
+    ->Args({25000, 1})
+    ->Args({25000, 64})
+    ->UseRealTime();
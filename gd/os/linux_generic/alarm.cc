@@ -37,7 +37,13 @@ namespace os {
 using common::Closure;
 using common::OnceClosure;
 
-Alarm::Alarm(Handler* handler) : handler_(handler), fd_(TIMERFD_CREATE(ALARM_CLOCK, 0)) {
+Alarm::Alarm(Handler* handler) : handler_(handler) {
+  if (handler_->timer_wheel_ != nullptr) {
+    timer_ = handler_->timer_wheel_->Register(common::Bind(&Alarm::on_timer_expired, common::Unretained(this)));
+    return;
+  }
+
+  fd_ = TIMERFD_CREATE(ALARM_CLOCK, 0);
   ASSERT_LOG(fd_ != -1, "cannot create timerfd: %s", strerror(errno));
 
   token_ = handler_->thread_->GetReactor()->Register(
@@ -45,6 +51,11 @@ Alarm::Alarm(Handler* handler) : handler_(handler), fd_(TIMERFD_CREATE(ALARM_CLO
 }
 
 Alarm::~Alarm() {
+  if (timer_ != nullptr) {
+    handler_->timer_wheel_->Unregister(timer_);
+    return;
+  }
+
   handler_->thread_->GetReactor()->Unregister(token_);
 
   int close_status;
@@ -54,6 +65,12 @@ Alarm::~Alarm() {
 
 void Alarm::Schedule(OnceClosure task, std::chrono::milliseconds delay) {
   std::lock_guard<std::mutex> lock(mutex_);
+  if (timer_ != nullptr) {
+    task_ = std::move(task);
+    handler_->timer_wheel_->Schedule(timer_, delay, std::chrono::milliseconds(0));
+    return;
+  }
+
   long delay_ms = delay.count();
   itimerspec timer_itimerspec{{/* interval for periodic timer */}, {delay_ms / 1000, delay_ms % 1000 * 1000000}};
   int result = TIMERFD_SETTIME(fd_, 0, &timer_itimerspec, nullptr);
@@ -64,6 +81,13 @@ void Alarm::Schedule(OnceClosure task, std::chrono::milliseconds delay) {
 
 void Alarm::Cancel() {
   std::lock_guard<std::mutex> lock(mutex_);
+  // Release whatever the task holds now rather than on the next Schedule()
+  task_.Reset();
+  if (timer_ != nullptr) {
+    handler_->timer_wheel_->Cancel(timer_);
+    return;
+  }
+
   itimerspec disarm_itimerspec{/* disarm timer */};
   int result = TIMERFD_SETTIME(fd_, 0, &disarm_itimerspec, nullptr);
   ASSERT(result == 0);
@@ -75,10 +99,23 @@ void Alarm::on_fire() {
   uint64_t times_invoked;
   auto bytes_read = read(fd_, &times_invoked, sizeof(uint64_t));
   lock.unlock();
-  std::move(task).Run();
+  // The task is gone if Cancel() raced with an expiry that was already being delivered
+  if (!task.is_null()) {
+    std::move(task).Run();
+  }
   ASSERT(bytes_read == static_cast<ssize_t>(sizeof(uint64_t)));
   ASSERT(times_invoked == static_cast<uint64_t>(1));
 }
 
+void Alarm::on_timer_expired() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto task = std::move(task_);
+  lock.unlock();
+  // The task is gone if Cancel() or Schedule() raced with an expiry that was already being delivered
+  if (!task.is_null()) {
+    std::move(task).Run();
+  }
+}
+
 }  // namespace os
 }  // namespace bluetooth
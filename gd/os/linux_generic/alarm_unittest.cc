@@ -17,6 +17,7 @@
 #include "os/alarm.h"
 
 #include <future>
+#include <memory>
 
 #include "common/bind.h"
 #include "gtest/gtest.h"
@@ -27,11 +28,15 @@ namespace {
 
 using common::BindOnce;
 
-class AlarmTest : public ::testing::Test {
+// Runs every test with and without the handler's timer wheel
+class AlarmTest : public ::testing::TestWithParam<bool> {
  protected:
   void SetUp() override {
     thread_ = new Thread("test_thread", Thread::Priority::NORMAL);
     handler_ = new Handler(thread_);
+    if (GetParam()) {
+      handler_->EnableTimerWheel();
+    }
     alarm_ = new Alarm(handler_);
   }
 
@@ -48,11 +53,11 @@ class AlarmTest : public ::testing::Test {
   Thread* thread_;
 };
 
-TEST_F(AlarmTest, cancel_while_not_armed) {
+TEST_P(AlarmTest, cancel_while_not_armed) {
   alarm_->Cancel();
 }
 
-TEST_F(AlarmTest, schedule) {
+TEST_P(AlarmTest, schedule) {
   std::promise<void> promise;
   auto future = promise.get_future();
   auto before = std::chrono::steady_clock::now();
@@ -66,18 +71,26 @@ TEST_F(AlarmTest, schedule) {
   ASSERT_NEAR(duration_ms.count(), delay_ms, delay_error_ms);
 }
 
-TEST_F(AlarmTest, cancel_alarm) {
+TEST_P(AlarmTest, cancel_alarm) {
   alarm_->Schedule(BindOnce([]() { ASSERT_TRUE(false) << "Should not happen"; }), std::chrono::milliseconds(3));
   alarm_->Cancel();
   std::this_thread::sleep_for(std::chrono::milliseconds(5));
 }
 
-TEST_F(AlarmTest, cancel_alarm_from_callback) {
+TEST_P(AlarmTest, cancel_releases_task) {
+  auto state = std::make_shared<int>(0);
+  std::weak_ptr<int> weak_state = state;
+  alarm_->Schedule(BindOnce([](std::shared_ptr<int>) {}, std::move(state)), std::chrono::milliseconds(1000));
+  alarm_->Cancel();
+  ASSERT_TRUE(weak_state.expired());
+}
+
+TEST_P(AlarmTest, cancel_alarm_from_callback) {
   alarm_->Schedule(BindOnce(&Alarm::Cancel, common::Unretained(alarm_)), std::chrono::milliseconds(1));
   std::this_thread::sleep_for(std::chrono::milliseconds(5));
 }
 
-TEST_F(AlarmTest, schedule_while_alarm_armed) {
+TEST_P(AlarmTest, schedule_while_alarm_armed) {
   alarm_->Schedule(BindOnce([]() { ASSERT_TRUE(false) << "Should not happen"; }), std::chrono::milliseconds(1));
   std::promise<void> promise;
   auto future = promise.get_future();
@@ -86,13 +99,15 @@ TEST_F(AlarmTest, schedule_while_alarm_armed) {
   future.get();
 }
 
-TEST_F(AlarmTest, delete_while_alarm_armed) {
+TEST_P(AlarmTest, delete_while_alarm_armed) {
   alarm_->Schedule(BindOnce([]() { ASSERT_TRUE(false) << "Should not happen"; }), std::chrono::milliseconds(1));
   delete alarm_;
   alarm_ = nullptr;
   std::this_thread::sleep_for(std::chrono::milliseconds(10));
 }
 
+INSTANTIATE_TEST_SUITE_P(TimerWheel, AlarmTest, ::testing::Bool());
+
 }  // namespace
 }  // namespace os
 }  // namespace bluetooth
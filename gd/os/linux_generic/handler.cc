@@ -20,33 +20,34 @@
 #include <unistd.h>
 
 #include <cstring>
+#include <utility>
 
 #include "common/bind.h"
 #include "common/callback.h"
 #include "os/log.h"
 #include "os/reactor.h"
+#include "os/timer_wheel.h"
 #include "os/utils.h"
 
-#ifndef EFD_SEMAPHORE
-#define EFD_SEMAPHORE 1
-#endif
-
 namespace bluetooth {
 namespace os {
 using common::OnceClosure;
 
-Handler::Handler(Thread* thread)
-    : tasks_(new std::queue<OnceClosure>()), thread_(thread), fd_(eventfd(0, EFD_SEMAPHORE | EFD_NONBLOCK)) {
+Handler::Handler(Thread* thread) : Handler(thread, 1) {}
+
+Handler::Handler(Thread* thread, size_t max_tasks_per_wakeup)
+    : tasks_(kTaskRingCapacity),
+      thread_(thread),
+      max_tasks_per_wakeup_(max_tasks_per_wakeup),
+      fd_(eventfd(0, EFD_NONBLOCK)) {
+  ASSERT(max_tasks_per_wakeup_ > 0);
   ASSERT(fd_ != -1);
   reactable_ = thread_->GetReactor()->Register(
       fd_, common::Bind(&Handler::handle_next_event, common::Unretained(this)), common::Closure());
 }
 
 Handler::~Handler() {
-  {
-    std::lock_guard<std::mutex> lock(mutex_);
-    ASSERT_LOG(was_cleared(), "Handlers must be cleared before they are destroyed");
-  }
+  ASSERT_LOG(was_cleared(), "Handlers must be cleared before they are destroyed");
 
   int close_status;
   RUN_NO_INTR(close_status = close(fd_));
@@ -54,13 +55,18 @@ Handler::~Handler() {
 }
 
 void Handler::Post(OnceClosure closure) {
-  {
-    std::lock_guard<std::mutex> lock(mutex_);
-    if (was_cleared()) {
-      LOG_WARN("Posting to a handler which has been cleared");
-      return;
-    }
-    tasks_->emplace(std::move(closure));
+  if (was_cleared()) {
+    LOG_WARN("Posting to a handler which has been cleared");
+    return;
+  }
+  // Once anything has overflowed, later closures must queue up behind it to keep the order of each producer
+  if (overflow_size_.load() != 0 || !tasks_.TryPush(closure)) {
+    std::lock_guard<std::mutex> lock(overflow_mutex_);
+    overflow_.emplace(std::move(closure));
+    overflow_size_++;
+  }
+  if (pending_.fetch_add(1) != 0) {
+    return;
   }
   uint64_t val = 1;
   auto write_result = eventfd_write(fd_, val);
@@ -68,13 +74,15 @@ void Handler::Post(OnceClosure closure) {
 }
 
 void Handler::Clear() {
-  std::queue<OnceClosure>* tmp = nullptr;
   {
     std::lock_guard<std::mutex> lock(mutex_);
     ASSERT_LOG(!was_cleared(), "Handlers must only be cleared once");
-    std::swap(tasks_, tmp);
+    cleared_ = true;
+    OnceClosure closure;
+    while (take_next_task(&closure)) {
+      closure.Reset();
+    }
   }
-  delete tmp;
 
   uint64_t val;
   while (eventfd_read(fd_, &val) == 0) {
@@ -89,22 +97,58 @@ void Handler::WaitUntilStopped(std::chrono::milliseconds timeout) {
   ASSERT(thread_->GetReactor()->WaitForUnregisteredReactable(timeout));
 }
 
-void Handler::handle_next_event() {
-  common::OnceClosure closure;
-  {
-    std::lock_guard<std::mutex> lock(mutex_);
-    uint64_t val = 0;
-    auto read_result = eventfd_read(fd_, &val);
+void Handler::EnableTimerWheel() {
+  ASSERT_LOG(timer_wheel_ == nullptr, "Timer wheel is already enabled");
+  timer_wheel_ = std::make_unique<TimerWheel>(thread_);
+}
 
-    if (was_cleared()) {
-      return;
+void Handler::handle_next_event() {
+  for (size_t i = 0; i < max_tasks_per_wakeup_; i++) {
+    OnceClosure closure;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (was_cleared()) {
+        return;
+      }
+      if (!take_next_task(&closure)) {
+        // Either a producer has reserved a slot and not published it yet, and the eventfd stays readable until it
+        // does, or this wakeup was signalled for a closure that an earlier wakeup already ran
+        if (pending_.load() == 0) {
+          reset_wakeup();
+        }
+        return;
+      }
+      if (pending_.fetch_sub(1) == 1) {
+        reset_wakeup();
+      }
     }
-    ASSERT_LOG(read_result != -1, "eventfd read error %d %s", errno, strerror(errno));
+    std::move(closure).Run();
+  }
+}
+
+bool Handler::take_next_task(OnceClosure* closure) {
+  if (tasks_.TryPop(closure)) {
+    return true;
+  }
+  if (overflow_size_.load() == 0) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(overflow_mutex_);
+  *closure = std::move(overflow_.front());
+  overflow_.pop();
+  overflow_size_--;
+  return true;
+}
 
-    closure = std::move(tasks_->front());
-    tasks_->pop();
+void Handler::reset_wakeup() {
+  // The producer that made |pending_| non-zero may not have written the eventfd yet, so this read can fail. Its write
+  // then lands as a stale wakeup that gets reset here on the next round.
+  uint64_t val = 0;
+  eventfd_read(fd_, &val);
+  if (pending_.load() != 0) {
+    auto write_result = eventfd_write(fd_, 1);
+    ASSERT(write_result != -1);
   }
-  std::move(closure).Run();
 }
 
 }  // namespace os
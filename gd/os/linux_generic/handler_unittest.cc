@@ -20,6 +20,7 @@
 
 #include <future>
 #include <thread>
+#include <vector>
 
 #include "common/bind.h"
 #include "common/callback.h"
@@ -110,6 +111,148 @@ TEST_F(HandlerTest, callback_with_promise) {
   handler_->Clear();
 }
 
+TEST_F(HandlerTest, post_more_than_ring_capacity_keeps_order) {
+  constexpr int kNumTasks = 5000;
+  std::promise<void> can_continue;
+  auto can_continue_future = can_continue.get_future();
+  handler_->Post(common::BindOnce([](std::future<void> future) { future.wait(); }, std::move(can_continue_future)));
+
+  std::vector<int> order;
+  std::promise<void> all_ran;
+  auto future = all_ran.get_future();
+  for (int i = 0; i < kNumTasks; i++) {
+    handler_->Post(common::BindOnce(
+        [](std::vector<int>* order, int i, std::promise<void>* all_ran) {
+          order->push_back(i);
+          if (order->size() == kNumTasks) {
+            all_ran->set_value();
+          }
+        },
+        common::Unretained(&order),
+        i,
+        common::Unretained(&all_ran)));
+  }
+  can_continue.set_value();
+  future.wait();
+  for (int i = 0; i < kNumTasks; i++) {
+    ASSERT_EQ(order[i], i);
+  }
+  handler_->Clear();
+}
+
+TEST_F(HandlerTest, post_from_multiple_threads) {
+  constexpr int kNumProducers = 4;
+  constexpr int kTasksPerProducer = 2000;
+  int counter = 0;
+  std::promise<void> all_ran;
+  auto future = all_ran.get_future();
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kNumProducers; p++) {
+    producers.emplace_back([this, &counter, &all_ran]() {
+      for (int i = 0; i < kTasksPerProducer; i++) {
+        handler_->Post(common::BindOnce(
+            [](int* counter, std::promise<void>* all_ran) {
+              if (++(*counter) == kNumProducers * kTasksPerProducer) {
+                all_ran->set_value();
+              }
+            },
+            common::Unretained(&counter),
+            common::Unretained(&all_ran)));
+      }
+    });
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  future.wait();
+  handler_->Clear();
+}
+
+class BatchedHandlerTest : public ::testing::Test {
+ protected:
+  static constexpr size_t kMaxTasksPerWakeup = 4;
+
+  void SetUp() override {
+    thread_ = new Thread("test_thread", Thread::Priority::NORMAL);
+    handler_ = new Handler(thread_, kMaxTasksPerWakeup);
+  }
+  void TearDown() override {
+    delete handler_;
+    delete thread_;
+  }
+
+  Handler* handler_;
+  Thread* thread_;
+};
+
+TEST_F(BatchedHandlerTest, post_tasks_invoked_in_order) {
+  constexpr int kNumTasks = 3 * kMaxTasksPerWakeup + 1;
+  std::vector<int> order;
+  std::promise<void> all_ran;
+  auto future = all_ran.get_future();
+  for (int i = 0; i < kNumTasks; i++) {
+    handler_->Post(common::BindOnce(
+        [](std::vector<int>* order, int i, std::promise<void>* all_ran) {
+          order->push_back(i);
+          if (order->size() == kNumTasks) {
+            all_ran->set_value();
+          }
+        },
+        common::Unretained(&order),
+        i,
+        common::Unretained(&all_ran)));
+  }
+  future.wait();
+  for (int i = 0; i < kNumTasks; i++) {
+    ASSERT_EQ(order[i], i);
+  }
+  handler_->Clear();
+}
+
+TEST_F(BatchedHandlerTest, post_from_running_task_invoked) {
+  std::promise<void> inner_ran;
+  auto future = inner_ran.get_future();
+  handler_->Post(common::BindOnce(
+      [](Handler* handler, std::promise<void>* inner_ran) {
+        handler->Post(common::BindOnce(&std::promise<void>::set_value, common::Unretained(inner_ran)));
+      },
+      common::Unretained(handler_),
+      common::Unretained(&inner_ran)));
+  future.wait();
+  handler_->Clear();
+}
+
+TEST_F(BatchedHandlerTest, post_task_in_same_batch_cleared) {
+  int val = 0;
+  std::promise<void> closure_started;
+  auto closure_started_future = closure_started.get_future();
+  std::promise<void> closure_can_continue;
+  auto can_continue_future = closure_can_continue.get_future();
+  std::promise<void> closure_finished;
+  auto closure_finished_future = closure_finished.get_future();
+  handler_->Post(common::BindOnce(
+      [](int* val,
+         std::promise<void> closure_started,
+         std::future<void> can_continue_future,
+         std::promise<void> closure_finished) {
+        closure_started.set_value();
+        *val = *val + 1;
+        can_continue_future.wait();
+        closure_finished.set_value();
+      },
+      common::Unretained(&val),
+      std::move(closure_started),
+      std::move(can_continue_future),
+      std::move(closure_finished)));
+  handler_->Post(common::BindOnce([]() { ASSERT_TRUE(false); }));
+  closure_started_future.wait();
+  handler_->Clear();
+  closure_can_continue.set_value();
+  closure_finished_future.wait();
+  handler_->WaitUntilStopped(std::chrono::milliseconds(2000));
+  ASSERT_EQ(val, 1);
+}
+
 // For Death tests, all the threading needs to be done in the ASSERT_DEATH call
 class HandlerDeathTest : public ::testing::Test {
  protected:
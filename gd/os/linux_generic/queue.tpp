@@ -15,7 +15,8 @@
  */
 
 template <typename T>
-Queue<T>::Queue(size_t capacity) : enqueue_(capacity), dequeue_(0){};
+Queue<T>::Queue(size_t capacity)
+    : capacity_(capacity), queue_(capacity), size_(0), enqueue_(capacity > 0 ? 1 : 0), dequeue_(0){};
 
 template <typename T>
 Queue<T>::~Queue() {
@@ -62,7 +63,9 @@ void Queue<T>::RegisterDequeue(Handler* handler, DequeueCallback callback) {
   ASSERT(dequeue_.reactable_ == nullptr);
   dequeue_.handler_ = handler;
   dequeue_.reactable_ = dequeue_.handler_->thread_->GetReactor()->Register(
-      dequeue_.reactive_semaphore_.GetFd(), callback, base::Closure());
+      dequeue_.reactive_semaphore_.GetFd(),
+      base::Bind(&Queue<T>::DequeueCallbackInternal, base::Unretained(this), std::move(callback)),
+      base::Closure());
 }
 
 template <typename T>
@@ -87,28 +90,63 @@ void Queue<T>::UnregisterDequeue() {
 
 template <typename T>
 std::unique_ptr<T> Queue<T>::TryDequeue() {
-  std::lock_guard<std::mutex> lock(mutex_);
-
-  if (queue_.empty()) {
-    return nullptr;
+#ifndef NDEBUG
+  std::thread::id no_thread;
+  ASSERT_LOG(
+      dequeue_thread_.compare_exchange_strong(no_thread, std::this_thread::get_id()),
+      "TryDequeue is called from two threads at the same time");
+#endif
+  std::unique_ptr<T> data;
+  if (queue_.TryPop(&data)) {
+    int64_t previous_size = size_.fetch_sub(1);
+    if (previous_size == capacity_) {
+      enqueue_.reactive_semaphore_.Increase();
+    }
+    if (previous_size == 1) {
+      ResetSignal(&dequeue_, &Queue<T>::HasData);
+    }
   }
-
-  dequeue_.reactive_semaphore_.Decrease();
-
-  std::unique_ptr<T> data = std::move(queue_.front());
-  queue_.pop();
-
-  enqueue_.reactive_semaphore_.Increase();
-
+#ifndef NDEBUG
+  dequeue_thread_.store(std::thread::id());
+#endif
   return data;
 }
 
 template <typename T>
 void Queue<T>::EnqueueCallbackInternal(EnqueueCallback callback) {
+  if (!HasSpace()) {
+    // Left over from a dequeue that raced with the enqueue end filling the queue up again
+    ResetSignal(&enqueue_, &Queue<T>::HasSpace);
+    return;
+  }
   std::unique_ptr<T> data = callback.Run();
   ASSERT(data != nullptr);
-  std::lock_guard<std::mutex> lock(mutex_);
-  enqueue_.reactive_semaphore_.Decrease();
-  queue_.push(std::move(data));
-  dequeue_.reactive_semaphore_.Increase();
+  bool pushed = queue_.TryPush(data);
+  ASSERT(pushed);
+
+  int64_t previous_size = size_.fetch_add(1);
+  if (previous_size == 0) {
+    dequeue_.reactive_semaphore_.Increase();
+  }
+  if (previous_size + 1 == capacity_) {
+    ResetSignal(&enqueue_, &Queue<T>::HasSpace);
+  }
+}
+
+template <typename T>
+void Queue<T>::DequeueCallbackInternal(DequeueCallback callback) {
+  if (!HasData()) {
+    // Left over from an enqueue that raced with TryDequeue() emptying the queue
+    ResetSignal(&dequeue_, &Queue<T>::HasData);
+    return;
+  }
+  callback.Run();
+}
+
+template <typename T>
+void Queue<T>::ResetSignal(QueueEndpoint* endpoint, bool (Queue<T>::*should_be_signalled)() const) {
+  endpoint->reactive_semaphore_.TryDecrease();
+  if ((this->*should_be_signalled)()) {
+    endpoint->reactive_semaphore_.Increase();
+  }
 }
@@ -45,6 +45,15 @@ void ReactiveSemaphore::Decrease() {
   ASSERT_LOG(read_result != -1, "decrease failed: %s", strerror(errno));
 }
 
+bool ReactiveSemaphore::TryDecrease() {
+  uint64_t val = 0;
+  if (eventfd_read(fd_, &val) == -1) {
+    ASSERT_LOG(errno == EAGAIN, "decrease failed: %s", strerror(errno));
+    return false;
+  }
+  return true;
+}
+
 void ReactiveSemaphore::Increase() {
   uint64_t val = 1;
   auto write_result = eventfd_write(fd_, val);
@@ -29,6 +29,8 @@ class ReactiveSemaphore {
   ~ReactiveSemaphore();
   // Decrements the value of |fd_|, this will cause a crash if |fd_| unreadable.
   void Decrease();
+  // Decrements the value of |fd_| if it is non-zero. Returns false if it was already zero.
+  bool TryDecrease();
   // Increase the value of |fd_|, this will cause a crash if |fd_| unwritable.
   void Increase();
   int GetFd();
@@ -36,7 +36,14 @@ namespace bluetooth {
 namespace os {
 using common::Closure;
 
-RepeatingAlarm::RepeatingAlarm(Handler* handler) : handler_(handler), fd_(TIMERFD_CREATE(ALARM_CLOCK, 0)) {
+RepeatingAlarm::RepeatingAlarm(Handler* handler) : handler_(handler) {
+  if (handler_->timer_wheel_ != nullptr) {
+    timer_ = handler_->timer_wheel_->Register(
+        common::Bind(&RepeatingAlarm::on_timer_expired, common::Unretained(this)));
+    return;
+  }
+
+  fd_ = TIMERFD_CREATE(ALARM_CLOCK, 0);
   ASSERT(fd_ != -1);
 
   token_ = handler_->thread_->GetReactor()->Register(
@@ -44,6 +51,11 @@ RepeatingAlarm::RepeatingAlarm(Handler* handler) : handler_(handler), fd_(TIMERF
 }
 
 RepeatingAlarm::~RepeatingAlarm() {
+  if (timer_ != nullptr) {
+    handler_->timer_wheel_->Unregister(timer_);
+    return;
+  }
+
   handler_->thread_->GetReactor()->Unregister(token_);
 
   int close_status;
@@ -53,6 +65,12 @@ RepeatingAlarm::~RepeatingAlarm() {
 
 void RepeatingAlarm::Schedule(Closure task, std::chrono::milliseconds period) {
   std::lock_guard<std::mutex> lock(mutex_);
+  if (timer_ != nullptr) {
+    task_ = std::move(task);
+    handler_->timer_wheel_->Schedule(timer_, period, period);
+    return;
+  }
+
   long period_ms = period.count();
   itimerspec timer_itimerspec{{period_ms / 1000, period_ms % 1000 * 1000000},
                               {period_ms / 1000, period_ms % 1000 * 1000000}};
@@ -64,6 +82,11 @@ void RepeatingAlarm::Schedule(Closure task, std::chrono::milliseconds period) {
 
 void RepeatingAlarm::Cancel() {
   std::lock_guard<std::mutex> lock(mutex_);
+  if (timer_ != nullptr) {
+    handler_->timer_wheel_->Cancel(timer_);
+    return;
+  }
+
   itimerspec disarm_itimerspec{/* disarm timer */};
   int result = TIMERFD_SETTIME(fd_, 0, &disarm_itimerspec, nullptr);
   ASSERT(result == 0);
@@ -79,5 +102,12 @@ void RepeatingAlarm::on_fire() {
   ASSERT(bytes_read == static_cast<ssize_t>(sizeof(uint64_t)));
 }
 
+void RepeatingAlarm::on_timer_expired() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto task = task_;
+  lock.unlock();
+  task.Run();
+}
+
 }  // namespace os
 }  // namespace bluetooth
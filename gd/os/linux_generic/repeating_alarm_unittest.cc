@@ -27,11 +27,15 @@ namespace {
 
 constexpr int error_ms = 20;
 
-class RepeatingAlarmTest : public ::testing::Test {
+// Runs every test with and without the handler's timer wheel
+class RepeatingAlarmTest : public ::testing::TestWithParam<bool> {
  protected:
   void SetUp() override {
     thread_ = new Thread("test_thread", Thread::Priority::NORMAL);
     handler_ = new Handler(thread_);
+    if (GetParam()) {
+      handler_->EnableTimerWheel();
+    }
     alarm_ = new RepeatingAlarm(handler_);
   }
 
@@ -88,11 +92,11 @@ class RepeatingAlarmTest : public ::testing::Test {
   Handler* handler_;
 };
 
-TEST_F(RepeatingAlarmTest, cancel_while_not_armed) {
+TEST_P(RepeatingAlarmTest, cancel_while_not_armed) {
   alarm_->Cancel();
 }
 
-TEST_F(RepeatingAlarmTest, schedule) {
+TEST_P(RepeatingAlarmTest, schedule) {
   std::promise<void> promise;
   auto future = promise.get_future();
   auto before = std::chrono::steady_clock::now();
@@ -106,19 +110,19 @@ TEST_F(RepeatingAlarmTest, schedule) {
   ASSERT_NEAR(duration.count(), period_ms * 1000000, error_ms * 1000000);
 }
 
-TEST_F(RepeatingAlarmTest, cancel_alarm) {
+TEST_P(RepeatingAlarmTest, cancel_alarm) {
   alarm_->Schedule(should_not_happen_, std::chrono::milliseconds(10));
   alarm_->Cancel();
   std::this_thread::sleep_for(std::chrono::milliseconds(50));
 }
 
-TEST_F(RepeatingAlarmTest, cancel_alarm_from_callback) {
+TEST_P(RepeatingAlarmTest, cancel_alarm_from_callback) {
   alarm_->Schedule(
       common::Bind(&RepeatingAlarm::Cancel, common::Unretained(this->alarm_)), std::chrono::milliseconds(1));
   std::this_thread::sleep_for(std::chrono::milliseconds(5));
 }
 
-TEST_F(RepeatingAlarmTest, schedule_while_alarm_armed) {
+TEST_P(RepeatingAlarmTest, schedule_while_alarm_armed) {
   alarm_->Schedule(should_not_happen_, std::chrono::milliseconds(1));
   std::promise<void> promise;
   auto future = promise.get_future();
@@ -128,21 +132,23 @@ TEST_F(RepeatingAlarmTest, schedule_while_alarm_armed) {
   alarm_->Cancel();
 }
 
-TEST_F(RepeatingAlarmTest, delete_while_alarm_armed) {
+TEST_P(RepeatingAlarmTest, delete_while_alarm_armed) {
   alarm_->Schedule(should_not_happen_, std::chrono::milliseconds(1));
   delete alarm_;
   alarm_ = nullptr;
   std::this_thread::sleep_for(std::chrono::milliseconds(1));
 }
 
-TEST_F(RepeatingAlarmTest, verify_small) {
+TEST_P(RepeatingAlarmTest, verify_small) {
   VerifyMultipleDelayedTasks(100, 1, 10);
 }
 
-TEST_F(RepeatingAlarmTest, verify_large) {
+TEST_P(RepeatingAlarmTest, verify_large) {
   VerifyMultipleDelayedTasks(100, 3, 10);
 }
 
+INSTANTIATE_TEST_SUITE_P(TimerWheel, RepeatingAlarmTest, ::testing::Bool());
+
 }  // namespace
 }  // namespace os
 }  // namespace bluetooth
@@ -0,0 +1,287 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "os/timer_wheel.h"
+
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "common/bind.h"
+#include "os/linux_generic/linux.h"
+#include "os/log.h"
+#include "os/utils.h"
+
+#ifdef OS_ANDROID
+#define ALARM_CLOCK CLOCK_BOOTTIME_ALARM
+#else
+#define ALARM_CLOCK CLOCK_BOOTTIME
+#endif
+
+namespace bluetooth {
+namespace os {
+
+namespace {
+constexpr uint64_t kNanosPerMilli = 1000000;
+constexpr uint64_t kNanosPerSecond = 1000000000;
+
+uint64_t now_ns() {
+  timespec now;
+  clock_gettime(CLOCK_BOOTTIME, &now);
+  return static_cast<uint64_t>(now.tv_sec) * kNanosPerSecond + now.tv_nsec;
+}
+}  // namespace
+
+class TimerWheel::Timer {
+ public:
+  explicit Timer(common::Closure on_expire) : on_expire_(std::move(on_expire)) {}
+
+  common::Closure on_expire_;
+  // Tick at which the timer expires, and the number of ticks until the next expiry if the timer is periodic
+  uint64_t deadline_ = 0;
+  uint64_t period_ = 0;
+  // Position in the wheel. |list_| is nullptr when the timer is not armed, and |level_| is -1 in |expired_|.
+  TimerList* list_ = nullptr;
+  int level_ = -1;
+  int slot_ = -1;
+  Timer* prev_ = nullptr;
+  Timer* next_ = nullptr;
+};
+
+TimerWheel::TimerWheel(Thread* thread)
+    : thread_(thread), fd_(TIMERFD_CREATE(ALARM_CLOCK, TFD_NONBLOCK)), current_tick_(now_ms()) {
+  ASSERT_LOG(fd_ != -1, "cannot create timerfd: %s", strerror(errno));
+
+  reactable_ = thread_->GetReactor()->Register(
+      fd_, common::Bind(&TimerWheel::on_fire, common::Unretained(this)), common::Closure());
+}
+
+TimerWheel::~TimerWheel() {
+  ASSERT_LOG(num_timers_ == 0, "%zu timers are still registered", num_timers_);
+  thread_->GetReactor()->Unregister(reactable_);
+  if (!thread_->IsSameThread()) {
+    thread_->GetReactor()->WaitForUnregisteredReactable(std::chrono::milliseconds(1000));
+  }
+
+  int close_status;
+  RUN_NO_INTR(close_status = TIMERFD_CLOSE(fd_));
+  ASSERT(close_status != -1);
+}
+
+TimerWheel::Timer* TimerWheel::Register(common::Closure on_expire) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  num_timers_++;
+  return new Timer(std::move(on_expire));
+}
+
+void TimerWheel::Unregister(Timer* timer) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  unlink(timer);
+  num_timers_--;
+  delete timer;
+}
+
+void TimerWheel::Schedule(Timer* timer, std::chrono::milliseconds delay, std::chrono::milliseconds period) {
+  // Round the current time up so that the timer never expires before |delay| has fully elapsed
+  uint64_t now_tick = (now_ns() + kNanosPerMilli - 1) / kNanosPerMilli;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  unlink(timer);
+  timer->deadline_ = now_tick + delay.count();
+  timer->period_ = period.count();
+  insert(timer);
+  if (timer->deadline_ < programmed_tick_) {
+    rearm();
+  }
+}
+
+void TimerWheel::Cancel(Timer* timer) {
+  // The timerfd is left as it is. If it was programmed for this timer, the wheel wakes up once, finds nothing due and
+  // reprograms it, which is cheaper than reprogramming it for every cancel of a timeout that never fires.
+  std::lock_guard<std::mutex> lock(mutex_);
+  unlink(timer);
+  timer->period_ = 0;
+}
+
+uint64_t TimerWheel::now_ms() {
+  return now_ns() / kNanosPerMilli;
+}
+
+void TimerWheel::link(TimerList* list, Timer* timer) {
+  timer->list_ = list;
+  if (list->first == nullptr) {
+    timer->prev_ = timer;
+    timer->next_ = timer;
+    list->first = timer;
+    return;
+  }
+  // Append at the tail so that timers expiring on the same tick run in the order they were armed
+  Timer* last = list->first->prev_;
+  timer->prev_ = last;
+  timer->next_ = list->first;
+  last->next_ = timer;
+  list->first->prev_ = timer;
+}
+
+void TimerWheel::unlink(Timer* timer) {
+  TimerList* list = timer->list_;
+  if (list == nullptr) {
+    return;
+  }
+  if (timer->next_ == timer) {
+    list->first = nullptr;
+    if (timer->level_ >= 0) {
+      occupied_[timer->level_] &= ~(uint64_t(1) << timer->slot_);
+    }
+  } else {
+    timer->prev_->next_ = timer->next_;
+    timer->next_->prev_ = timer->prev_;
+    if (list->first == timer) {
+      list->first = timer->next_;
+    }
+  }
+  timer->list_ = nullptr;
+  timer->prev_ = nullptr;
+  timer->next_ = nullptr;
+}
+
+void TimerWheel::insert(Timer* timer) {
+  if (timer->deadline_ <= current_tick_) {
+    timer->level_ = -1;
+    timer->slot_ = -1;
+    link(&expired_, timer);
+    return;
+  }
+
+  // Timers beyond the span of the top level wait in its furthest slot and get placed again when it cascades
+  constexpr uint64_t kMaxDelta = (uint64_t(1) << (kBitsPerLevel * kNumLevels)) - 1;
+  uint64_t delta = std::min(timer->deadline_ - current_tick_, kMaxDelta);
+  uint64_t placement = current_tick_ + delta;
+  int level = 0;
+  while (delta >= (uint64_t(1) << (kBitsPerLevel * (level + 1)))) {
+    level++;
+  }
+  int slot = (placement >> (kBitsPerLevel * level)) & (kSlotsPerLevel - 1);
+  timer->level_ = level;
+  timer->slot_ = slot;
+  link(&slots_[level][slot], timer);
+  occupied_[level] |= uint64_t(1) << slot;
+}
+
+uint64_t TimerWheel::next_event_tick() const {
+  if (expired_.first != nullptr) {
+    return current_tick_;
+  }
+  return next_slot_tick();
+}
+
+uint64_t TimerWheel::next_slot_tick() const {
+  uint64_t next = kNoDeadline;
+  for (int level = 0; level < kNumLevels; level++) {
+    if (occupied_[level] == 0) {
+      continue;
+    }
+    // Occupied slots of a level are all ahead of the current index of that level, at most one lap away. Rotate the
+    // bitmap so that the slot right after the current index comes first.
+    int shift = kBitsPerLevel * level;
+    uint64_t index = current_tick_ >> shift;
+    int start = (index + 1) & (kSlotsPerLevel - 1);
+    uint64_t rotated = start == 0 ? occupied_[level] : (occupied_[level] >> start) | (occupied_[level] << (64 - start));
+    uint64_t next_index = index + 1 + __builtin_ctzll(rotated);
+    next = std::min(next, next_index << shift);
+  }
+  return next;
+}
+
+void TimerWheel::advance(uint64_t target_tick) {
+  while (true) {
+    uint64_t next = next_slot_tick();
+    if (next > target_tick) {
+      current_tick_ = std::max(current_tick_, target_tick);
+      return;
+    }
+    current_tick_ = next;
+
+    // Cascade coarse slots starting at this tick down to the finer levels, highest level first so that the timers
+    // it moves down get cascaded again by the levels below if needed
+    for (int level = kNumLevels - 1; level >= 0; level--) {
+      int shift = kBitsPerLevel * level;
+      if ((current_tick_ & ((uint64_t(1) << shift) - 1)) != 0) {
+        continue;
+      }
+      int slot = (current_tick_ >> shift) & (kSlotsPerLevel - 1);
+      TimerList* list = &slots_[level][slot];
+      while (list->first != nullptr) {
+        Timer* timer = list->first;
+        unlink(timer);
+        insert(timer);
+      }
+    }
+  }
+}
+
+void TimerWheel::rearm() {
+  uint64_t next = next_event_tick();
+  if (next == programmed_tick_) {
+    return;
+  }
+  programmed_tick_ = next;
+
+  itimerspec timer_itimerspec{/* disarm timer */};
+  if (next != kNoDeadline) {
+    uint64_t now = now_ns();
+    uint64_t deadline = next * kNanosPerMilli;
+    // A zero it_value disarms the timer, so something already due is scheduled 1 ns from now
+    uint64_t delay = deadline > now ? deadline - now : 1;
+    timer_itimerspec.it_value.tv_sec = delay / kNanosPerSecond;
+    timer_itimerspec.it_value.tv_nsec = delay % kNanosPerSecond;
+  }
+  int result = TIMERFD_SETTIME(fd_, 0, &timer_itimerspec, nullptr);
+  ASSERT(result == 0);
+}
+
+void TimerWheel::on_fire() {
+  uint64_t times_invoked;
+  // The timerfd may have been reprogrammed since the reactor saw it readable, in which case there is nothing to read
+  auto bytes_read = read(fd_, &times_invoked, sizeof(uint64_t));
+  ASSERT(bytes_read == static_cast<ssize_t>(sizeof(uint64_t)) || errno == EAGAIN);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  programmed_tick_ = kNoDeadline;
+  advance(now_ms());
+  while (expired_.first != nullptr) {
+    Timer* timer = expired_.first;
+    unlink(timer);
+    if (timer->period_ != 0) {
+      // Skip the periods that were missed while the thread was busy, like a periodic timerfd does
+      uint64_t missed_periods = (current_tick_ - timer->deadline_) / timer->period_;
+      timer->deadline_ += (missed_periods + 1) * timer->period_;
+      insert(timer);
+    }
+    // Copy the callback as |timer| may be unregistered while it runs
+    common::Closure on_expire = timer->on_expire_;
+    lock.unlock();
+    on_expire.Run();
+    lock.lock();
+  }
+  rearm();
+}
+
+}  // namespace os
+}  // namespace bluetooth
@@ -0,0 +1,184 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "os/timer_wheel.h"
+
+#include <future>
+#include <vector>
+
+#include "common/bind.h"
+#include "gtest/gtest.h"
+
+namespace bluetooth {
+namespace os {
+namespace {
+
+using std::chrono::milliseconds;
+
+class TimerWheelTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    thread_ = new Thread("test_thread", Thread::Priority::NORMAL);
+    wheel_ = new TimerWheel(thread_);
+  }
+
+  void TearDown() override {
+    delete wheel_;
+    delete thread_;
+  }
+
+  // Arm a timer that records its index in |fired_| and fulfills |promise_| once |expected| timers have fired
+  TimerWheel::Timer* RegisterRecordingTimer(int index) {
+    return wheel_->Register(common::Bind(
+        [](TimerWheelTest* test, int index) {
+          std::lock_guard<std::mutex> lock(test->mutex_);
+          test->fired_.push_back(index);
+          if (test->fired_.size() == test->expected_) {
+            test->promise_.set_value();
+          }
+        },
+        common::Unretained(this),
+        index));
+  }
+
+  TimerWheel* wheel_;
+  std::mutex mutex_;
+  std::vector<int> fired_;
+  size_t expected_ = 0;
+  std::promise<void> promise_;
+
+ private:
+  Thread* thread_;
+};
+
+TEST_F(TimerWheelTest, fires_after_delay) {
+  expected_ = 1;
+  auto future = promise_.get_future();
+  auto timer = RegisterRecordingTimer(0);
+  auto before = std::chrono::steady_clock::now();
+  wheel_->Schedule(timer, milliseconds(10), milliseconds(0));
+  future.wait();
+  auto elapsed = std::chrono::duration_cast<milliseconds>(std::chrono::steady_clock::now() - before);
+  ASSERT_GE(elapsed.count(), 10);
+  ASSERT_LE(elapsed.count(), 15);
+  wheel_->Unregister(timer);
+}
+
+TEST_F(TimerWheelTest, fires_in_deadline_order_across_levels) {
+  // Deadlines on both sides of the 64 ms boundary between level 0 and level 1
+  std::vector<int> delays_ms = {150, 5, 70, 1, 63, 64, 30, 129};
+  expected_ = delays_ms.size();
+  auto future = promise_.get_future();
+  std::vector<TimerWheel::Timer*> timers;
+  for (size_t i = 0; i < delays_ms.size(); i++) {
+    timers.push_back(RegisterRecordingTimer(delays_ms[i]));
+    wheel_->Schedule(timers.back(), milliseconds(delays_ms[i]), milliseconds(0));
+  }
+  future.wait();
+  std::vector<int> expected_order = {1, 5, 30, 63, 64, 70, 129, 150};
+  ASSERT_EQ(fired_, expected_order);
+  for (auto timer : timers) {
+    wheel_->Unregister(timer);
+  }
+}
+
+TEST_F(TimerWheelTest, cancel) {
+  expected_ = 1;
+  auto future = promise_.get_future();
+  auto cancelled = RegisterRecordingTimer(0);
+  auto kept = RegisterRecordingTimer(1);
+  wheel_->Schedule(cancelled, milliseconds(5), milliseconds(0));
+  wheel_->Schedule(kept, milliseconds(20), milliseconds(0));
+  wheel_->Cancel(cancelled);
+  future.wait();
+  std::this_thread::sleep_for(milliseconds(5));
+  ASSERT_EQ(fired_, std::vector<int>{1});
+  wheel_->Unregister(cancelled);
+  wheel_->Unregister(kept);
+}
+
+TEST_F(TimerWheelTest, reschedule_replaces_deadline) {
+  expected_ = 2;
+  auto future = promise_.get_future();
+  auto first = RegisterRecordingTimer(0);
+  auto second = RegisterRecordingTimer(1);
+  wheel_->Schedule(first, milliseconds(5), milliseconds(0));
+  wheel_->Schedule(second, milliseconds(15), milliseconds(0));
+  wheel_->Schedule(first, milliseconds(30), milliseconds(0));
+  future.wait();
+  std::vector<int> expected_order = {1, 0};
+  ASSERT_EQ(fired_, expected_order);
+  wheel_->Unregister(first);
+  wheel_->Unregister(second);
+}
+
+TEST_F(TimerWheelTest, periodic) {
+  expected_ = 5;
+  auto future = promise_.get_future();
+  auto timer = RegisterRecordingTimer(0);
+  auto before = std::chrono::steady_clock::now();
+  wheel_->Schedule(timer, milliseconds(10), milliseconds(10));
+  future.wait();
+  wheel_->Cancel(timer);
+  auto elapsed = std::chrono::duration_cast<milliseconds>(std::chrono::steady_clock::now() - before);
+  ASSERT_GE(elapsed.count(), 50);
+  ASSERT_LE(elapsed.count(), 60);
+  wheel_->Unregister(timer);
+}
+
+TEST_F(TimerWheelTest, zero_delay) {
+  expected_ = 1;
+  auto future = promise_.get_future();
+  auto timer = RegisterRecordingTimer(0);
+  wheel_->Schedule(timer, milliseconds(0), milliseconds(0));
+  future.wait();
+  wheel_->Unregister(timer);
+}
+
+TEST_F(TimerWheelTest, many_timers) {
+  constexpr int kNumTimers = 500;
+  expected_ = kNumTimers;
+  auto future = promise_.get_future();
+  std::vector<TimerWheel::Timer*> timers;
+  for (int i = 0; i < kNumTimers; i++) {
+    timers.push_back(RegisterRecordingTimer(i));
+    wheel_->Schedule(timers.back(), milliseconds(1 + (i * 7) % 200), milliseconds(0));
+  }
+  future.wait();
+  for (auto timer : timers) {
+    wheel_->Unregister(timer);
+  }
+}
+
+TEST_F(TimerWheelTest, unregister_from_callback) {
+  std::promise<void> promise;
+  auto future = promise.get_future();
+  TimerWheel::Timer* timer = nullptr;
+  timer = wheel_->Register(common::Bind(
+      [](TimerWheel* wheel, TimerWheel::Timer** timer, std::promise<void>* promise) {
+        wheel->Unregister(*timer);
+        promise->set_value();
+      },
+      common::Unretained(wheel_),
+      common::Unretained(&timer),
+      common::Unretained(&promise)));
+  wheel_->Schedule(timer, milliseconds(1), milliseconds(1));
+  future.wait();
+}
+
+}  // namespace
+}  // namespace os
+}  // namespace bluetooth
@@ -18,12 +18,15 @@
 
 #include <unistd.h>
 
+#include <atomic>
 #include <functional>
 #include <mutex>
 #include <queue>
+#include <thread>
 
 #include "common/bind.h"
 #include "common/callback.h"
+#include "common/mpsc_ring.h"
 #include "os/handler.h"
 #ifdef OS_LINUX_GENERIC
 #include "os/linux_generic/reactive_semaphore.h"
@@ -51,6 +54,8 @@ class IQueueDequeue {
   virtual ~IQueueDequeue() = default;
   virtual void RegisterDequeue(Handler* handler, DequeueCallback callback) = 0;
   virtual void UnregisterDequeue() = 0;
+  // Single consumer: must not be called from two threads at the same time, usually it is only called from the
+  // registered DequeueCallback.
   virtual std::unique_ptr<T> TryDequeue() = 0;
 };
 
@@ -78,14 +83,38 @@ class Queue : public IQueueEnqueue<T>, public IQueueDequeue<T> {
   void UnregisterDequeue() override;
 
   // Try to dequeue an item from this queue. Return nullptr when there is nothing in the queue.
+  // The queue has a single consumer: the enqueue end may run concurrently with this, but two calls to TryDequeue()
+  // must not overlap, since items are popped from |queue_| without a lock. Debug builds crash on overlapping calls.
   std::unique_ptr<T> TryDequeue() override;
 
  private:
+  class QueueEndpoint;
+
   void EnqueueCallbackInternal(EnqueueCallback callback);
-  // An internal queue that holds at most |capacity| pieces of data
-  std::queue<std::unique_ptr<T>> queue_;
-  // A mutex that guards data in this queue
+  void DequeueCallbackInternal(DequeueCallback callback);
+  bool HasSpace() const {
+    return size_.load() < capacity_;
+  }
+  bool HasData() const {
+    return size_.load() > 0;
+  }
+  // Clear the semaphore of |endpoint| and signal it again if |should_be_signalled| became true in the meantime
+  void ResetSignal(QueueEndpoint* endpoint, bool (Queue<T>::*should_be_signalled)() const);
+  // Maximum number of messages in |queue_|
+  const int64_t capacity_;
+  // An internal ring that holds at most |capacity_| pieces of data. The enqueue end pushes and TryDequeue() pops
+  // without taking a lock.
+  common::MpscRing<std::unique_ptr<T>> queue_;
+  // Number of pieces of data in |queue_|. The enqueue end is signalled while it is below |capacity_| and the dequeue
+  // end while it is non-zero, and each end's semaphore is only touched when |size_| crosses that boundary. A pop can
+  // be counted before the matching push, so this may briefly go below zero.
+  std::atomic<int64_t> size_;
+  // A mutex that guards registration of both ends
   std::mutex mutex_;
+#ifndef NDEBUG
+  // Thread currently in TryDequeue(), to catch a second consumer
+  std::atomic<std::thread::id> dequeue_thread_{};
+#endif
 
   class QueueEndpoint {
    public:
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+#include "common/callback.h"
+#include "os/reactor.h"
+#include "os/thread.h"
+#include "os/utils.h"
+
+namespace bluetooth {
+namespace os {
+
+// A hierarchical timer wheel that multiplexes any number of timers onto a single timerfd registered on a thread.
+//
+// Timers are kept in 4 levels of 64 slots with a resolution of 1 ms. Level 0 holds timers due in the next 64 ms, and
+// each level above covers a 64 times longer span at a 64 times coarser granularity. When the wheel reaches the start
+// of a coarse slot, its timers cascade down to the finer levels. Arming and cancelling a timer is O(1) and does not
+// touch the kernel unless it changes the earliest deadline of the wheel, and the timerfd is only programmed for the
+// next occupied slot, so an idle wheel never wakes the thread up.
+class TimerWheel {
+ public:
+  class Timer;
+
+  // Create a timer wheel and register its timerfd on |thread|
+  explicit TimerWheel(Thread* thread);
+
+  // Unregister the timerfd from the thread. All timers must have been unregistered.
+  ~TimerWheel();
+
+  DISALLOW_COPY_AND_ASSIGN(TimerWheel);
+
+  // Create a timer that runs |on_expire| on the wheel's thread every time it expires
+  Timer* Register(common::Closure on_expire);
+
+  // Cancel and destroy |timer|
+  void Unregister(Timer* timer);
+
+  // Arm |timer| to expire after |delay|, and then every |period| after that if |period| is not zero. Arming an armed
+  // timer replaces its previous schedule.
+  void Schedule(Timer* timer, std::chrono::milliseconds delay, std::chrono::milliseconds period);
+
+  // Disarm |timer|. No-op if it's not armed.
+  void Cancel(Timer* timer);
+
+ private:
+  static constexpr int kBitsPerLevel = 6;
+  static constexpr int kSlotsPerLevel = 1 << kBitsPerLevel;
+  static constexpr int kNumLevels = 4;
+  static constexpr uint64_t kNoDeadline = UINT64_MAX;
+
+  // A circular intrusive list of timers, so that unlinking a timer does not need to know which slot it is in
+  struct TimerList {
+    Timer* first = nullptr;
+  };
+
+  static uint64_t now_ms();
+  static void link(TimerList* list, Timer* timer);
+  // Remove |timer| from whatever list it is in, keeping |occupied_| up to date
+  void unlink(Timer* timer);
+
+  // Place |timer| in the slot matching its deadline relative to |current_tick_|, or in |expired_| if it is due
+  void insert(Timer* timer);
+  // Earliest tick at which the wheel has something to do, which is now if |expired_| is not empty
+  uint64_t next_event_tick() const;
+  // Earliest tick at which a slot needs to be expired or cascaded
+  uint64_t next_slot_tick() const;
+  // Move the wheel forward to |target_tick|, moving due timers to |expired_|
+  void advance(uint64_t target_tick);
+  // Program the timerfd for next_event_tick() if it differs from what is already programmed
+  void rearm();
+  void on_fire();
+
+  Thread* thread_;
+  int fd_;
+  Reactor::Reactable* reactable_;
+  std::mutex mutex_;
+  uint64_t current_tick_;
+  uint64_t programmed_tick_ = kNoDeadline;
+  TimerList slots_[kNumLevels][kSlotsPerLevel];
+  uint64_t occupied_[kNumLevels] = {};
+  TimerList expired_;
+  size_t num_timers_ = 0;
+};
+
+}  // namespace os
+}  // namespace bluetooth
@@ -78,5 +78,26 @@ TEST(BitInserterTest, observerTest) {
   ASSERT_EQ(result.size(), copy.size());
 }
 
+TEST(BitInserterTest, insertBytesTest) {
+  std::vector<uint8_t> bytes;
+  BitInserter it(bytes);
+  std::vector<uint8_t> copy;
+  it.RegisterObserver(ByteObserver([&copy](uint8_t byte) { copy.push_back(byte); }, []() { return 0; }));
+
+  const std::vector<uint8_t> to_insert = {0x01, 0x23, 0x45, 0x67};
+  it.insert_bytes(to_insert.data(), to_insert.size());
+  ASSERT_EQ(to_insert, bytes);
+  ASSERT_EQ(to_insert, copy);
+
+  // Pending bits are shifted into the inserted bytes
+  it.insert_bits(0b1010, 4);
+  it.insert_bytes(to_insert.data(), 2);
+  it.insert_bits(0, 4);
+  std::vector<uint8_t> result = {0x01, 0x23, 0x45, 0x67, 0x1a, 0x30, 0x02};
+  ASSERT_EQ(result, bytes);
+  ASSERT_EQ(result, copy);
+  it.UnregisterObserver();
+}
+
 }  // namespace packet
 }  // namespace bluetooth
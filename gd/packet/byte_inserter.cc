@@ -48,5 +48,12 @@ void ByteInserter::insert_byte(uint8_t byte) {
   std::back_insert_iterator<std::vector<uint8_t>>::operator=(byte);
 }
 
+void ByteInserter::insert_bytes(const uint8_t* bytes, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    on_byte(bytes[i]);
+  }
+  container->insert(container->end(), bytes, bytes + length);
+}
+
 }  // namespace packet
 }  // namespace bluetooth
@@ -0,0 +1,42 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "packet/fragment_builder.h"
+
+#include <utility>
+
+#include "os/log.h"
+
+namespace bluetooth {
+namespace packet {
+
+FragmentBuilder::FragmentBuilder(std::shared_ptr<const std::vector<uint8_t>> buffer, size_t offset, size_t length)
+    : buffer_(std::move(buffer)), offset_(offset), length_(length) {
+  ASSERT(buffer_ != nullptr);
+  ASSERT_LOG(offset_ + length_ <= buffer_->size(), "Fragment [%zu, %zu) is out of a buffer of %zu bytes", offset_,
+             offset_ + length_, buffer_->size());
+}
+
+size_t FragmentBuilder::size() const {
+  return length_;
+}
+
+void FragmentBuilder::Serialize(BitInserter& it) const {
+  it.insert_bytes(buffer_->data() + offset_, length_);
+}
+
+}  // namespace packet
+}  // namespace bluetooth
@@ -0,0 +1,47 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "packet/bit_inserter.h"
+#include "packet/packet_builder.h"
+
+namespace bluetooth {
+namespace packet {
+
+// Builds |length| bytes of a serialized packet starting at |offset|, without copying them. All the fragments of a
+// packet share its buffer, which is released with the last of them.
+class FragmentBuilder : public PacketBuilder<true> {
+ public:
+  FragmentBuilder(std::shared_ptr<const std::vector<uint8_t>> buffer, size_t offset, size_t length);
+  virtual ~FragmentBuilder() = default;
+
+  virtual size_t size() const override;
+
+  virtual void Serialize(BitInserter& it) const override;
+
+ private:
+  std::shared_ptr<const std::vector<uint8_t>> buffer_;
+  size_t offset_;
+  size_t length_;
+};
+
+}  // namespace packet
+}  // namespace bluetooth
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "packet/fragment_builder.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+namespace bluetooth {
+namespace packet {
+
+TEST(FragmentBuilderTest, serializeSliceTest) {
+  auto buffer = std::make_shared<const std::vector<uint8_t>>(std::vector<uint8_t>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9});
+  FragmentBuilder fragment(buffer, 3, 4);
+  ASSERT_EQ(4u, fragment.size());
+
+  std::vector<uint8_t> bytes;
+  BitInserter it(bytes);
+  fragment.Serialize(it);
+  ASSERT_EQ(std::vector<uint8_t>({3, 4, 5, 6}), bytes);
+}
+
+TEST(FragmentBuilderTest, fragmentsShareBufferTest) {
+  std::weak_ptr<const std::vector<uint8_t>> weak_buffer;
+  std::unique_ptr<FragmentBuilder> last_fragment;
+  {
+    auto buffer = std::make_shared<const std::vector<uint8_t>>(std::vector<uint8_t>{0, 1, 2, 3});
+    weak_buffer = buffer;
+    auto first_fragment = std::make_unique<FragmentBuilder>(buffer, 0, 2);
+    last_fragment = std::make_unique<FragmentBuilder>(buffer, 2, 2);
+  }
+  // The buffer outlives the fragments sent before the last one
+  ASSERT_FALSE(weak_buffer.expired());
+
+  std::vector<uint8_t> bytes;
+  BitInserter it(bytes);
+  last_fragment->Serialize(it);
+  ASSERT_EQ(std::vector<uint8_t>({2, 3}), bytes);
+  last_fragment.reset();
+  ASSERT_TRUE(weak_buffer.expired());
+}
+
+}  // namespace packet
+}  // namespace bluetooth
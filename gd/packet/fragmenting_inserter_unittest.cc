@@ -121,6 +121,23 @@ TEST(FragmentingInserterTest, testMtuBoundaries) {
   ASSERT_EQ(kPacketSize, fragments_mtu_is_more[0]->size());
 }
 
+TEST(FragmentingInserterTest, insertBytesTest) {
+  const std::vector<uint8_t> to_insert = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+  std::vector<std::unique_ptr<RawBuilder>> fragments;
+  FragmentingInserter it(4, std::back_insert_iterator(fragments));
+  it.insert_bytes(to_insert.data(), to_insert.size());
+  it.finalize();
+
+  ASSERT_EQ(3, fragments.size());
+  std::vector<uint8_t> bytes;
+  BitInserter bit_inserter(bytes);
+  for (auto& fragment : fragments) {
+    ASSERT_LE(fragment->size(), 4);
+    fragment->Serialize(bit_inserter);
+  }
+  ASSERT_EQ(to_insert, bytes);
+}
+
 constexpr size_t kPacketSize = 128;
 class FragmentingTest : public ::testing::TestWithParam<size_t> {
  public:
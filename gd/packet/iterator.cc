@@ -22,14 +22,17 @@ namespace bluetooth {
 namespace packet {
 
 template <bool little_endian>
-Iterator<little_endian>::Iterator(const std::forward_list<View>& data, size_t offset) {
-  data_ = data;
+Iterator<little_endian>::Iterator(std::shared_ptr<const std::forward_list<View>> data, size_t offset)
+    : data_(std::move(data)) {
   index_ = offset;
   begin_ = 0;
   end_ = 0;
-  for (auto& view : data) {
+  for (auto& view : *data_) {
     end_ += view.size();
   }
+  if (!data_->empty() && std::next(data_->begin()) == data_->end()) {
+    contiguous_data_ = data_->front().data();
+  }
 }
 
 template <bool little_endian>
@@ -81,6 +84,7 @@ template <bool little_endian>
 Iterator<little_endian>& Iterator<little_endian>::operator=(const Iterator<little_endian>& itr) {
   if (this == &itr) return *this;
   this->data_ = itr.data_;
+  this->contiguous_data_ = itr.contiguous_data_;
   this->begin_ = itr.begin_;
   this->end_ = itr.end_;
   this->index_ = itr.index_;
@@ -120,9 +124,12 @@ bool Iterator<little_endian>::operator>=(const Iterator<little_endian>& itr) con
 template <bool little_endian>
 uint8_t Iterator<little_endian>::operator*() const {
   ASSERT_LOG(index_ < end_ && !(begin_ > index_), "Index %zu out of bounds: [%zu,%zu)", index_, begin_, end_);
+  if (contiguous_data_ != nullptr) {
+    return contiguous_data_[index_];
+  }
   size_t index = index_;
 
-  for (auto view : data_) {
+  for (const auto& view : *data_) {
     if (index < view.size()) {
       return view[index];
     }
@@ -157,6 +164,14 @@ Iterator<little_endian> Iterator<little_endian>::Subrange(size_t index, size_t l
   return to_return;
 }
 
+template <bool little_endian>
+const uint8_t* Iterator<little_endian>::ContiguousBytes(size_t length) const {
+  if (contiguous_data_ == nullptr || begin_ > index_ || index_ > end_ || end_ - index_ < length) {
+    return nullptr;
+  }
+  return contiguous_data_ + index_;
+}
+
 // Explicit instantiations for both types of Iterators.
 template class Iterator<true>;
 template class Iterator<false>;
@@ -16,7 +16,9 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <forward_list>
 #include <memory>
 #include <type_traits>
@@ -31,7 +33,7 @@ namespace packet {
 template <bool little_endian>
 class Iterator : public std::iterator<std::random_access_iterator_tag, uint8_t> {
  public:
-  Iterator(const std::forward_list<View>& data, size_t offset);
+  Iterator(std::shared_ptr<const std::forward_list<View>> data, size_t offset);
   Iterator(const Iterator& itr) = default;
   virtual ~Iterator() = default;
 
@@ -62,11 +64,23 @@ class Iterator : public std::iterator<std::random_access_iterator_tag, uint8_t>
 
   Iterator Subrange(size_t index, size_t length) const;
 
+  // Return the next |length| bytes in place, or nullptr if they are out of bounds or not in a single fragment
+  const uint8_t* ContiguousBytes(size_t length) const;
+
   // Get the next sizeof(FixedWidthPODType) bytes and return the filled type
   template <typename FixedWidthPODType, typename std::enable_if<std::is_pod<FixedWidthPODType>::value, int>::type = 0>
   FixedWidthPODType extract() {
     static_assert(std::is_pod<FixedWidthPODType>::value, "Iterator::extract requires a fixed-width type.");
     FixedWidthPODType extracted_value{};
+    if (contiguous_data_ != nullptr && NumBytesRemaining() >= sizeof(FixedWidthPODType)) {
+      std::memcpy(&extracted_value, contiguous_data_ + index_, sizeof(FixedWidthPODType));
+      index_ += sizeof(FixedWidthPODType);
+      if (!little_endian) {
+        extracted_value = reverse_bytes(extracted_value);
+      }
+      return extracted_value;
+    }
+
     uint8_t* value_ptr = (uint8_t*)&extracted_value;
 
     for (size_t i = 0; i < sizeof(FixedWidthPODType); i++) {
@@ -80,6 +94,18 @@ class Iterator : public std::iterator<std::random_access_iterator_tag, uint8_t>
   template <typename T, typename std::enable_if<std::is_base_of_v<CustomFieldFixedSizeInterface<T>, T>, int>::type = 0>
   T extract() {
     T extracted_value{};
+    if (contiguous_data_ != nullptr && NumBytesRemaining() >= CustomFieldFixedSizeInterface<T>::length()) {
+      const uint8_t* first = contiguous_data_ + index_;
+      const uint8_t* last = first + CustomFieldFixedSizeInterface<T>::length();
+      if (little_endian) {
+        std::copy(first, last, extracted_value.data());
+      } else {
+        std::reverse_copy(first, last, extracted_value.data());
+      }
+      index_ += CustomFieldFixedSizeInterface<T>::length();
+      return extracted_value;
+    }
+
     for (size_t i = 0; i < CustomFieldFixedSizeInterface<T>::length(); i++) {
       size_t index = (little_endian ? i : CustomFieldFixedSizeInterface<T>::length() - i - 1);
       extracted_value.data()[index] = this->operator*();
@@ -89,7 +115,35 @@ class Iterator : public std::iterator<std::random_access_iterator_tag, uint8_t>
   }
 
  private:
-  std::forward_list<View> data_;
+  template <typename FixedWidthPODType>
+  static FixedWidthPODType reverse_bytes(FixedWidthPODType value) {
+    if constexpr (sizeof(FixedWidthPODType) == sizeof(uint16_t)) {
+      uint16_t raw;
+      std::memcpy(&raw, &value, sizeof(raw));
+      raw = __builtin_bswap16(raw);
+      std::memcpy(&value, &raw, sizeof(raw));
+    } else if constexpr (sizeof(FixedWidthPODType) == sizeof(uint32_t)) {
+      uint32_t raw;
+      std::memcpy(&raw, &value, sizeof(raw));
+      raw = __builtin_bswap32(raw);
+      std::memcpy(&value, &raw, sizeof(raw));
+    } else if constexpr (sizeof(FixedWidthPODType) == sizeof(uint64_t)) {
+      uint64_t raw;
+      std::memcpy(&raw, &value, sizeof(raw));
+      raw = __builtin_bswap64(raw);
+      std::memcpy(&value, &raw, sizeof(raw));
+    } else {
+      uint8_t* value_ptr = (uint8_t*)&value;
+      std::reverse(value_ptr, value_ptr + sizeof(FixedWidthPODType));
+    }
+    return value;
+  }
+
+  // Shared with the PacketView and all the iterators derived from it, so that copying an iterator doesn't copy the list
+  std::shared_ptr<const std::forward_list<View>> data_;
+  // Start of the bytes when |data_| is a single fragment, which is the case for almost every received packet. Reads
+  // then index it directly instead of searching the fragment list for every byte.
+  const uint8_t* contiguous_data_ = nullptr;
   size_t index_;
   size_t begin_;
   size_t end_;
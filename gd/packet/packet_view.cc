@@ -24,16 +24,18 @@ namespace bluetooth {
 namespace packet {
 
 template <bool little_endian>
-PacketView<little_endian>::PacketView(const std::forward_list<class View> fragments)
-    : fragments_(fragments), length_(0) {
-  for (auto fragment : fragments_) {
+PacketView<little_endian>::PacketView(std::forward_list<class View> fragments)
+    : fragments_(std::make_shared<const std::forward_list<View>>(std::move(fragments))), length_(0) {
+  for (const auto& fragment : *fragments_) {
     length_ += fragment.size();
   }
 }
 
 template <bool little_endian>
 PacketView<little_endian>::PacketView(std::shared_ptr<std::vector<uint8_t>> packet)
-    : fragments_({View(packet, 0, packet->size())}), length_(packet->size()) {}
+    : fragments_(std::make_shared<const std::forward_list<View>>(
+          std::forward_list<View>{View(packet, 0, packet->size())})),
+      length_(packet->size()) {}
 
 template <bool little_endian>
 Iterator<little_endian> PacketView<little_endian>::begin() const {
@@ -53,7 +55,7 @@ uint8_t PacketView<little_endian>::operator[](size_t index) const {
 template <bool little_endian>
 uint8_t PacketView<little_endian>::at(size_t index) const {
   ASSERT_LOG(index < length_, "Index %zu out of bounds", index);
-  for (const auto& fragment : fragments_) {
+  for (const auto& fragment : *fragments_) {
     if (index < fragment.size()) {
       return fragment[index];
     }
@@ -76,7 +78,7 @@ std::forward_list<View> PacketView<little_endian>::GetSubviewList(size_t begin,
   std::forward_list<View> view_list;
   std::forward_list<View>::iterator it = view_list.before_begin();
   size_t length = end - begin;
-  for (const auto& fragment : fragments_) {
+  for (const auto& fragment : *fragments_) {
     if (begin >= fragment.size()) {
       begin -= fragment.size();
     } else {
@@ -101,7 +103,8 @@ PacketView<false> PacketView<little_endian>::GetBigEndianSubview(size_t begin, s
 
 template <bool little_endian>
 void PacketView<little_endian>::Append(PacketView to_add) {
-  auto insertion_point = fragments_.begin();
+  auto fragments = std::make_shared<std::forward_list<View>>(*fragments_);
+  auto insertion_point = fragments->begin();
   size_t remaining_length = length_;
   while (remaining_length > 0) {
     remaining_length -= insertion_point->size();
@@ -109,11 +112,12 @@ void PacketView<little_endian>::Append(PacketView to_add) {
       insertion_point++;
     }
   }
-  ASSERT(insertion_point != fragments_.end());
-  for (const auto& fragment : to_add.fragments_) {
-    fragments_.insert_after(insertion_point, fragment);
+  ASSERT(insertion_point != fragments->end());
+  for (const auto& fragment : *to_add.fragments_) {
+    fragments->insert_after(insertion_point, fragment);
     insertion_point++;
   }
+  fragments_ = std::move(fragments);
   length_ += to_add.length_;
 }
 
@@ -18,6 +18,7 @@
 
 #include <cstdint>
 #include <forward_list>
+#include <memory>
 
 #include "packet/iterator.h"
 #include "packet/view.h"
@@ -57,7 +58,8 @@ class PacketView {
   void Append(PacketView to_add);
 
  private:
-  std::forward_list<View> fragments_;
+  // Immutable and shared between copies of the view and its iterators. Append() replaces it with a new list.
+  std::shared_ptr<const std::forward_list<View>> fragments_;
   size_t length_;
   std::forward_list<View> GetSubviewList(size_t begin, size_t end) const;
 };
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <forward_list>
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "hci/hci_packets.h"
+#include "packet/packet_view.h"
+
+using ::benchmark::State;
+using ::bluetooth::hci::AclView;
+using ::bluetooth::hci::CommandCompleteView;
+using ::bluetooth::hci::EventView;
+using ::bluetooth::hci::LeAdvertisingReportView;
+using ::bluetooth::hci::LeMetaEventView;
+using ::bluetooth::hci::NumberOfCompletedPacketsView;
+using ::bluetooth::hci::ReadBdAddrCompleteView;
+using ::bluetooth::hci::ReadLocalVersionInformationCompleteView;
+using ::bluetooth::packet::kLittleEndian;
+using ::bluetooth::packet::PacketView;
+using ::bluetooth::packet::View;
+
+namespace {
+
+// Test vector of ReadBdAddrComplete in hci_packets.pdl
+const std::vector<uint8_t> kReadBdAddrComplete = {
+    0x0e, 0x0a, 0x01, 0x09, 0x10, 0x00, 0x14, 0x8e, 0x61, 0x5f, 0x36, 0x88};
+
+// Test vector of ReadLocalVersionInformationComplete in hci_packets.pdl
+const std::vector<uint8_t> kReadLocalVersionInformationComplete = {
+    0x0e, 0x0c, 0x01, 0x01, 0x10, 0x00, 0x09, 0x00, 0x00, 0x09, 0x1d, 0x00, 0xbe, 0x02};
+
+// Two connections with completed packets
+const std::vector<uint8_t> kNumberOfCompletedPackets = {
+    0x13, 0x09, 0x02, 0x01, 0x00, 0x05, 0x00, 0x02, 0x00, 0x01, 0x00};
+
+// One ADV_IND report with flags and a complete local name
+const std::vector<uint8_t> kLeAdvertisingReport = {
+    0x3e, 0x16, 0x02, 0x01, 0x00, 0x00, 0x14, 0x8e, 0x61, 0x5f, 0x36, 0x88, 0x0a,
+    0x02, 0x01, 0x06, 0x06, 0x09, 'P',  'i',  'x',  'e',  'l',  0xc4};
+
+// First fragment of an L2CAP basic frame on handle 0x001
+const std::vector<uint8_t> kAcl = {
+    0x01, 0x20, 0x08, 0x00, 0x04, 0x00, 0x40, 0x00, 0x01, 0x02, 0x03, 0x04};
+
+// Split |bytes| into |num_fragments| views of the same buffer, as a packet assembled from several pieces would be
+PacketView<kLittleEndian> MakePacketView(const std::shared_ptr<const std::vector<uint8_t>>& bytes,
+                                         size_t num_fragments) {
+  std::forward_list<View> fragments;
+  auto it = fragments.before_begin();
+  size_t fragment_size = bytes->size() / num_fragments;
+  for (size_t i = 0; i < num_fragments; i++) {
+    size_t begin = i * fragment_size;
+    size_t end = i + 1 == num_fragments ? bytes->size() : begin + fragment_size;
+    it = fragments.insert_after(it, View(bytes, begin, end));
+  }
+  return PacketView<kLittleEndian>(fragments);
+}
+
+}  // namespace
+
+class BM_ParseHciPackets : public ::benchmark::Fixture {
+ protected:
+  PacketView<kLittleEndian> Prepare(State& state, const std::vector<uint8_t>& bytes) {
+    return MakePacketView(std::make_shared<const std::vector<uint8_t>>(bytes), state.range(0));
+  }
+};
+
+BENCHMARK_DEFINE_F(BM_ParseHciPackets, read_bd_addr_complete)(State& state) {
+  auto packet = Prepare(state, kReadBdAddrComplete);
+  for (auto _ : state) {
+    auto view = ReadBdAddrCompleteView::Create(CommandCompleteView::Create(EventView::Create(packet)));
+    benchmark::DoNotOptimize(view.IsValid());
+    benchmark::DoNotOptimize(view.GetBdAddr());
+  }
+  state.SetBytesProcessed(state.iterations() * packet.size());
+};
+
+BENCHMARK_REGISTER_F(BM_ParseHciPackets, read_bd_addr_complete)->Arg(1)->Arg(2);
+
+BENCHMARK_DEFINE_F(BM_ParseHciPackets, read_local_version_information_complete)(State& state) {
+  auto packet = Prepare(state, kReadLocalVersionInformationComplete);
+  for (auto _ : state) {
+    auto view =
+        ReadLocalVersionInformationCompleteView::Create(CommandCompleteView::Create(EventView::Create(packet)));
+    benchmark::DoNotOptimize(view.IsValid());
+    benchmark::DoNotOptimize(view.GetLocalVersionInformation());
+  }
+  state.SetBytesProcessed(state.iterations() * packet.size());
+};
+
+BENCHMARK_REGISTER_F(BM_ParseHciPackets, read_local_version_information_complete)->Arg(1)->Arg(2);
+
+BENCHMARK_DEFINE_F(BM_ParseHciPackets, number_of_completed_packets)(State& state) {
+  auto packet = Prepare(state, kNumberOfCompletedPackets);
+  for (auto _ : state) {
+    auto view = NumberOfCompletedPacketsView::Create(EventView::Create(packet));
+    benchmark::DoNotOptimize(view.IsValid());
+    benchmark::DoNotOptimize(view.GetCompletedPackets());
+  }
+  state.SetBytesProcessed(state.iterations() * packet.size());
+};
+
+BENCHMARK_REGISTER_F(BM_ParseHciPackets, number_of_completed_packets)->Arg(1)->Arg(2);
+
+BENCHMARK_DEFINE_F(BM_ParseHciPackets, le_advertising_report)(State& state) {
+  auto packet = Prepare(state, kLeAdvertisingReport);
+  for (auto _ : state) {
+    auto view = LeAdvertisingReportView::Create(LeMetaEventView::Create(EventView::Create(packet)));
+    benchmark::DoNotOptimize(view.IsValid());
+    benchmark::DoNotOptimize(view.GetAdvertisingReports());
+  }
+  state.SetBytesProcessed(state.iterations() * packet.size());
+};
+
+BENCHMARK_REGISTER_F(BM_ParseHciPackets, le_advertising_report)->Arg(1)->Arg(2);
+
+BENCHMARK_DEFINE_F(BM_ParseHciPackets, acl)(State& state) {
+  auto packet = Prepare(state, kAcl);
+  for (auto _ : state) {
+    auto view = AclView::Create(packet);
+    benchmark::DoNotOptimize(view.IsValid());
+    benchmark::DoNotOptimize(view.GetHandle());
+    benchmark::DoNotOptimize(view.GetPayload());
+  }
+  state.SetBytesProcessed(state.iterations() * packet.size());
+};
+
+BENCHMARK_REGISTER_F(BM_ParseHciPackets, acl)->Arg(1)->Arg(2);
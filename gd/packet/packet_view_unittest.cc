@@ -157,6 +157,27 @@ TEST(IteratorExtractTest, extractBeTest) {
   ASSERT_EQ(0x16, general_case.extract<uint8_t>());
 }
 
+TEST(IteratorExtractTest, extractSubrangeBoundsTest) {
+  PacketView<true> packet({View(std::make_shared<const vector<uint8_t>>(count_all), 0, count_all.size())});
+  auto subrange = packet.begin().Subrange(2, 3);
+
+  ASSERT_EQ(0x0302, subrange.extract<uint16_t>());
+  ASSERT_DEATH(subrange.extract<uint16_t>(), "");
+  ASSERT_EQ(0x04, subrange.extract<uint8_t>());
+  ASSERT_DEATH(subrange.extract<uint8_t>(), "");
+}
+
+TEST(IteratorExtractTest, contiguousBytesTest) {
+  PacketView<true> packet({View(std::make_shared<const vector<uint8_t>>(count_all), 0, count_all.size())});
+  auto subrange = packet.begin().Subrange(2, 3);
+
+  const uint8_t* bytes = subrange.ContiguousBytes(3);
+  ASSERT_NE(nullptr, bytes);
+  ASSERT_EQ(0x02, bytes[0]);
+  ASSERT_EQ(0x04, bytes[2]);
+  ASSERT_EQ(nullptr, subrange.ContiguousBytes(4));
+}
+
 TYPED_TEST(IteratorTest, extractBoundsDeathTest) {
   auto bounds_test = this->packet->end();
 
@@ -545,6 +566,32 @@ TEST_F(PacketViewMultiViewTest, dereferenceTestBigEndian) {
   ASSERT_DEATH(*multi_itr, "");
 }
 
+TEST_F(PacketViewMultiViewTest, extractTestLittleEndian) {
+  auto single_itr = single_view.begin();
+  auto multi_itr = multi_view.begin();
+  // Fields that straddle the fragment boundaries after bytes 2 and 12
+  ASSERT_EQ(single_itr.extract<uint16_t>(), multi_itr.extract<uint16_t>());
+  ASSERT_EQ(single_itr.extract<uint32_t>(), multi_itr.extract<uint32_t>());
+  ASSERT_EQ(single_itr.extract<uint64_t>(), multi_itr.extract<uint64_t>());
+  ASSERT_EQ(single_itr.extract<Address>(), multi_itr.extract<Address>());
+  ASSERT_EQ(single_itr.NumBytesRemaining(), multi_itr.NumBytesRemaining());
+}
+
+TEST_F(PacketViewMultiViewTest, extractTestBigEndian) {
+  auto single_itr = single_view.GetBigEndianSubview(0, single_view.size()).begin();
+  auto multi_itr = multi_view.GetBigEndianSubview(0, multi_view.size()).begin();
+  ASSERT_EQ(single_itr.extract<uint16_t>(), multi_itr.extract<uint16_t>());
+  ASSERT_EQ(single_itr.extract<uint32_t>(), multi_itr.extract<uint32_t>());
+  ASSERT_EQ(single_itr.extract<uint64_t>(), multi_itr.extract<uint64_t>());
+  ASSERT_EQ(single_itr.extract<Address>(), multi_itr.extract<Address>());
+  ASSERT_EQ(single_itr.NumBytesRemaining(), multi_itr.NumBytesRemaining());
+}
+
+TEST_F(PacketViewMultiViewTest, contiguousBytesTest) {
+  ASSERT_NE(nullptr, single_view.begin().ContiguousBytes(single_view.size()));
+  ASSERT_EQ(nullptr, multi_view.begin().ContiguousBytes(1));
+}
+
 TEST_F(PacketViewMultiViewTest, arrayOperatorTest) {
   for (size_t i = 0; i < single_view.size(); i++) {
     ASSERT_EQ(single_view[i], multi_view[i]);
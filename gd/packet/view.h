@@ -33,6 +33,9 @@ class View {
 
   uint8_t operator[](size_t i) const;
 
+  // Pointer to the first byte of the view, valid for size() bytes while the view is alive
+  const uint8_t* data() const;
+
   size_t size() const;
 
  private:
@@ -107,6 +107,155 @@ TEST(SmpEccValidationTest, test_invalid_points) {
   EXPECT_FALSE(ECC_ValidatePoint(p));
 }
 
+// Bluetooth Core Specification Version 5.0 | Vol 2, Part G | 7.1.2, most significant word first
+struct EccSample {
+  uint32_t private_a[8];
+  uint32_t public_a_x[8];
+  uint32_t public_a_y[8];
+  uint32_t private_b[8];
+  uint32_t public_b_x[8];
+  uint32_t public_b_y[8];
+  uint32_t dhkey[8];
+};
+
+const EccSample kEccSamples[] = {
+    {
+        {0x3f49f6d4, 0xa3c55f38, 0x74c9b3e3, 0xd2103f50, 0x4aff607b, 0xeb40b799, 0x5899b8a6, 0xcd3c1abd},
+        {0x20b003d2, 0xf297be2c, 0x5e2c83a7, 0xe9f9a5b9, 0xeff49111, 0xacf4fddb, 0xcc030148, 0x0e359de6},
+        {0xdc809c49, 0x652aeb6d, 0x63329abf, 0x5a52155c, 0x766345c2, 0x8fed3024, 0x741c8ed0, 0x1589d28b},
+        {0x55188b3d, 0x32f6bb9a, 0x900afcfb, 0xeed4e72a, 0x59cb9ac2, 0xf19d7cfb, 0x6b4fdd49, 0xf47fc5fd},
+        {0x1ea1f0f0, 0x1faf1d96, 0x09592284, 0xf19e4c00, 0x47b58afd, 0x8615a69f, 0x559077b2, 0x2faaa190},
+        {0x4c55f33e, 0x429dad37, 0x7356703a, 0x9ab85160, 0x472d1130, 0xe28e3676, 0x5f89aff9, 0x15b1214a},
+        {0xec0234a3, 0x57c8ad05, 0x341010a6, 0x0a397d9b, 0x99796b13, 0xb4f866f1, 0x868d34f3, 0x73bfa698},
+    },
+    {
+        {0x06a51669, 0x3c9aa31a, 0x6084545d, 0x0c5db641, 0xb48572b9, 0x7203ddff, 0xb7ac73f7, 0xd0457663},
+        {0x2c31a47b, 0x5779809e, 0xf44cb5ea, 0xaf5c3e43, 0xd5f8faad, 0x4a8794cb, 0x987e9b03, 0x745c78dd},
+        {0x91951218, 0x3898dfbe, 0xcd52e240, 0x8e43871f, 0xd0211091, 0x17bd3ed4, 0xeaf84377, 0x43715d4f},
+        {0x529aa067, 0x0d72cd64, 0x97502ed4, 0x73502b03, 0x7e8803b5, 0xc60829a5, 0xa3caa219, 0x505530ba},
+        {0xf465e43f, 0xf23d3f1b, 0x9dc7dfc0, 0x4da87581, 0x84dbc966, 0x204796ec, 0xcf0d6cf5, 0xe16500cc},
+        {0x0201d048, 0xbcbbd899, 0xeeefc424, 0x164e33c2, 0x01c2b010, 0xca6b4d43, 0xa8a155ca, 0xd8ecb279},
+        {0xab85843a, 0x2f6d883f, 0x62e5684b, 0x38e30733, 0x5fe6e194, 0x5ecd1960, 0x4105c6f2, 0x3221eb69},
+    },
+};
+
+// Convert the most significant word first |in| to the least significant word first layout of Point and the keys
+void ToLittleEndianWords(const uint32_t in[8], uint32_t out[8]) {
+  for (int i = 0; i < 8; i++) {
+    out[i] = in[7 - i];
+  }
+}
+
+void ExpectWordsEqual(const uint32_t expected_msw_first[8], const uint32_t actual[8]) {
+  uint32_t expected[8];
+  ToLittleEndianWords(expected_msw_first, expected);
+  for (int i = 0; i < 8; i++) {
+    EXPECT_EQ(expected[i], actual[i]) << "word " << i;
+  }
+}
+
+TEST(SmpEccPointMultTest, test_public_keys) {
+  for (const EccSample& sample : kEccSamples) {
+    uint32_t private_key[8];
+    Point public_key;
+
+    ToLittleEndianWords(sample.private_a, private_key);
+    ECC_PointMult_Base(&public_key, private_key);
+    ExpectWordsEqual(sample.public_a_x, public_key.x);
+    ExpectWordsEqual(sample.public_a_y, public_key.y);
+
+    ECC_PointMult(&public_key, &curve_p256.G, private_key);
+    ExpectWordsEqual(sample.public_a_x, public_key.x);
+    ExpectWordsEqual(sample.public_a_y, public_key.y);
+
+    ToLittleEndianWords(sample.private_b, private_key);
+    ECC_PointMult_Base(&public_key, private_key);
+    ExpectWordsEqual(sample.public_b_x, public_key.x);
+    ExpectWordsEqual(sample.public_b_y, public_key.y);
+    EXPECT_EQ(1u, public_key.z[0]);
+  }
+}
+
+TEST(SmpEccPointMultTest, test_dhkeys) {
+  for (const EccSample& sample : kEccSamples) {
+    uint32_t private_key[8];
+    Point peer_public_key, dhkey;
+
+    ToLittleEndianWords(sample.private_a, private_key);
+    ToLittleEndianWords(sample.public_b_x, peer_public_key.x);
+    ToLittleEndianWords(sample.public_b_y, peer_public_key.y);
+    ECC_PointMult(&dhkey, &peer_public_key, private_key);
+    ExpectWordsEqual(sample.dhkey, dhkey.x);
+
+    ToLittleEndianWords(sample.private_b, private_key);
+    ToLittleEndianWords(sample.public_a_x, peer_public_key.x);
+    ToLittleEndianWords(sample.public_a_y, peer_public_key.y);
+    ECC_PointMult(&dhkey, &peer_public_key, private_key);
+    ExpectWordsEqual(sample.dhkey, dhkey.x);
+  }
+}
+
+TEST(SmpEccPointMultTest, test_small_scalars) {
+  uint32_t scalar[8] = {0};
+  Point expected, actual;
+
+  // 0 * G is the point at infinity, returned as (0, 0)
+  ECC_PointMult_Base(&actual, scalar);
+  EXPECT_TRUE(multiprecision_iszero(actual.x));
+  EXPECT_TRUE(multiprecision_iszero(actual.y));
+  ECC_PointMult(&actual, &curve_p256.G, scalar);
+  EXPECT_TRUE(multiprecision_iszero(actual.x));
+  EXPECT_TRUE(multiprecision_iszero(actual.y));
+
+  // n * G, in a single window or spanning several, is the same from both paths and on the curve
+  for (uint32_t n : {1u, 2u, 3u, 15u, 16u, 17u, 0x100u, 0xffffffffu}) {
+    scalar[0] = n;
+    ECC_PointMult_Base(&expected, scalar);
+    ECC_PointMult(&actual, &curve_p256.G, scalar);
+    EXPECT_EQ(0, multiprecision_compare(expected.x, actual.x)) << n;
+    EXPECT_EQ(0, multiprecision_compare(expected.y, actual.y)) << n;
+    EXPECT_TRUE(ECC_ValidatePoint(actual)) << n;
+  }
+
+  scalar[0] = 1;
+  ECC_PointMult(&actual, &curve_p256.G, scalar);
+  EXPECT_EQ(0, multiprecision_compare(curve_p256.G.x, actual.x));
+  EXPECT_EQ(0, multiprecision_compare(curve_p256.G.y, actual.y));
+}
+
+TEST(SmpEccPointMultTest, test_group_order) {
+  // n * G is the point at infinity, and (n - 1) * G is -G
+  uint32_t order[8] = {0xfc632551, 0xf3b9cac2, 0xa7179e84, 0xbce6faad, 0xffffffff, 0xffffffff, 0x00000000, 0xffffffff};
+  Point actual;
+
+  ECC_PointMult_Base(&actual, order);
+  EXPECT_TRUE(multiprecision_iszero(actual.x));
+  EXPECT_TRUE(multiprecision_iszero(actual.y));
+
+  order[0]--;
+  uint32_t minus_y[8];
+  multiprecision_sub(minus_y, curve_p256.p, curve_p256.G.y);
+  ECC_PointMult_Base(&actual, order);
+  EXPECT_EQ(0, multiprecision_compare(curve_p256.G.x, actual.x));
+  EXPECT_EQ(0, multiprecision_compare(minus_y, actual.y));
+  ECC_PointMult(&actual, &curve_p256.G, order);
+  EXPECT_EQ(0, multiprecision_compare(curve_p256.G.x, actual.x));
+  EXPECT_EQ(0, multiprecision_compare(minus_y, actual.y));
+}
+
+TEST(SmpEccValidationTest, test_coordinates_not_reduced) {
+  // (0, sqrt(b)) is on the curve, (p, sqrt(b)) is congruent to it but not valid
+  Point p = {
+      .x = {0},
+      .y = {0x174f93f4, 0x28bf856a, 0x1dae8717, 0x541c2af3, 0x84a06bb6, 0x2433bd5d, 0x0e2f83d7, 0x66485c78},
+      .z = {0},
+  };
+  EXPECT_TRUE(ECC_ValidatePoint(p));
+
+  multiprecision_copy(p.x, curve_p256.p);
+  EXPECT_FALSE(ECC_ValidatePoint(p));
+}
+
 }  // namespace ecc
 }  // namespace security
 }  // namespace bluetooth
@@ -0,0 +1,571 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "security/ecc/p256.h"
+
+#include <array>
+
+namespace bluetooth {
+namespace security {
+namespace ecc {
+namespace p256 {
+
+namespace {
+
+// The loops over the limbs are unrolled so that the carries stay in registers, which GCC does not do at -O2
+constexpr size_t kLimbs = 4;
+
+// Element of the field of order p, little endian limbs, in the Montgomery domain (a * 2^256 mod p) unless noted
+struct Fe {
+  uint64_t limb[kLimbs];
+};
+
+// p = 2^256 - 2^224 + 2^192 + 2^96 - 1. Its lowest limb is 2^64 - 1, so -1/p mod 2^64 is 1 and the Montgomery
+// reduction needs no multiplication to find its quotient digits.
+constexpr Fe kP = {{0xffffffffffffffff, 0x00000000ffffffff, 0x0000000000000000, 0xffffffff00000001}};
+// 2^512 mod p, to enter the Montgomery domain
+constexpr Fe kRSquared = {{0x0000000000000003, 0xfffffffbffffffff, 0xfffffffffffffffe, 0x00000004fffffffd}};
+// 1 and b in the Montgomery domain
+constexpr Fe kOne = {{0x0000000000000001, 0xffffffff00000000, 0xffffffffffffffff, 0x00000000fffffffe}};
+constexpr Fe kB = {{0xd89cdf6229c4bddf, 0xacf005cd78843090, 0xe5a220abf7212ed6, 0xdc30061d04874834}};
+// p - 2, exponent of the inversion
+constexpr Fe kPMinus2 = {{0xfffffffffffffffd, 0x00000000ffffffff, 0x0000000000000000, 0xffffffff00000001}};
+
+// Base point, not in the Montgomery domain
+constexpr uint32_t kGx[kWords] = {
+    0xd898c296, 0xf4a13945, 0x2deb33a0, 0x77037d81, 0x63a440f2, 0xf8bce6e5, 0xe12c4247, 0x6b17d1f2};
+constexpr uint32_t kGy[kWords] = {
+    0x37bf51f5, 0xcbb64068, 0x6b315ece, 0x2bce3357, 0x7c0f9e16, 0x8ee7eb4a, 0xfe1a7f9b, 0x4fe342e2};
+
+// a + b + carry, with the carry out in |carry|
+inline uint64_t add_carry(uint64_t a, uint64_t b, uint64_t* carry) {
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 sum = static_cast<unsigned __int128>(a) + b + *carry;
+  *carry = static_cast<uint64_t>(sum >> 64);
+  return static_cast<uint64_t>(sum);
+#else
+  uint64_t sum = a + b;
+  uint64_t carry_out = sum < a;
+  uint64_t result = sum + *carry;
+  carry_out |= result < sum;
+  *carry = carry_out;
+  return result;
+#endif
+}
+
+// a - b - borrow, with the borrow out in |borrow|
+inline uint64_t sub_borrow(uint64_t a, uint64_t b, uint64_t* borrow) {
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 difference = static_cast<unsigned __int128>(a) - b - *borrow;
+  *borrow = static_cast<uint64_t>(difference >> 64) & 1;
+  return static_cast<uint64_t>(difference);
+#else
+  uint64_t difference = a - b;
+  uint64_t borrow_out = a < b;
+  uint64_t result = difference - *borrow;
+  borrow_out |= difference < *borrow;
+  *borrow = borrow_out;
+  return result;
+#endif
+}
+
+// acc + a * b + carry, which cannot overflow 128 bits, with the high half in |carry|
+inline uint64_t mul_add(uint64_t acc, uint64_t a, uint64_t b, uint64_t* carry) {
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 product = static_cast<unsigned __int128>(a) * b + acc + *carry;
+  *carry = static_cast<uint64_t>(product >> 64);
+  return static_cast<uint64_t>(product);
+#else
+  uint64_t a_lo = a & 0xffffffff, a_hi = a >> 32;
+  uint64_t b_lo = b & 0xffffffff, b_hi = b >> 32;
+  uint64_t lo_lo = a_lo * b_lo;
+  uint64_t hi_lo = a_hi * b_lo;
+  uint64_t lo_hi = a_lo * b_hi;
+  uint64_t hi_hi = a_hi * b_hi;
+  uint64_t middle = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+  uint64_t low = (middle << 32) | (lo_lo & 0xffffffff);
+  uint64_t high = hi_hi + (hi_lo >> 32) + (middle >> 32);
+  uint64_t add_carry_out = 0;
+  low = add_carry(low, acc, &add_carry_out);
+  high += add_carry_out;
+  add_carry_out = 0;
+  low = add_carry(low, *carry, &add_carry_out);
+  high += add_carry_out;
+  *carry = high;
+  return low;
+#endif
+}
+
+// All ones if |a| == |b|, zero otherwise
+inline uint64_t equal_mask(uint64_t a, uint64_t b) {
+  uint64_t x = a ^ b;
+  return ((x | (0 - x)) >> 63) - 1;
+}
+
+// r = mask ? a : r
+inline void fe_select(Fe* r, const Fe& a, uint64_t mask) {
+  #pragma GCC unroll 4
+  for (size_t i = 0; i < kLimbs; i++) {
+    r->limb[i] = (a.limb[i] & mask) | (r->limb[i] & ~mask);
+  }
+}
+
+// r = t mod p, for t < 2p given as the limbs of |t| and the bit |high| above them
+inline void fe_reduce_once(Fe* r, const uint64_t t[kLimbs], uint64_t high) {
+  Fe reduced;
+  uint64_t borrow = 0;
+  #pragma GCC unroll 4
+  for (size_t i = 0; i < kLimbs; i++) {
+    reduced.limb[i] = sub_borrow(t[i], kP.limb[i], &borrow);
+  }
+  // keep t when it is below p, that is when subtracting p borrowed more than the high bit
+  uint64_t keep_t = 0 - (borrow & (high ^ 1));
+  #pragma GCC unroll 4
+  for (size_t i = 0; i < kLimbs; i++) {
+    r->limb[i] = (t[i] & keep_t) | (reduced.limb[i] & ~keep_t);
+  }
+}
+
+void fe_add(Fe* r, const Fe& a, const Fe& b) {
+  uint64_t sum[kLimbs];
+  uint64_t carry = 0;
+  #pragma GCC unroll 4
+  for (size_t i = 0; i < kLimbs; i++) {
+    sum[i] = add_carry(a.limb[i], b.limb[i], &carry);
+  }
+  fe_reduce_once(r, sum, carry);
+}
+
+void fe_sub(Fe* r, const Fe& a, const Fe& b) {
+  uint64_t borrow = 0;
+  #pragma GCC unroll 4
+  for (size_t i = 0; i < kLimbs; i++) {
+    r->limb[i] = sub_borrow(a.limb[i], b.limb[i], &borrow);
+  }
+  // add p back when a < b
+  uint64_t mask = 0 - borrow;
+  uint64_t carry = 0;
+  #pragma GCC unroll 4
+  for (size_t i = 0; i < kLimbs; i++) {
+    r->limb[i] = add_carry(r->limb[i], kP.limb[i] & mask, &carry);
+  }
+}
+
+// r = a * b / 2^256 mod p, interleaving the multiplication and the reduction one limb at a time
+void fe_mul(Fe* r, const Fe& a, const Fe& b) {
+  uint64_t t[kLimbs + 2] = {0};
+  #pragma GCC unroll 4
+  for (size_t i = 0; i < kLimbs; i++) {
+    uint64_t carry = 0;
+    #pragma GCC unroll 4
+    for (size_t j = 0; j < kLimbs; j++) {
+      t[j] = mul_add(t[j], a.limb[j], b.limb[i], &carry);
+    }
+    uint64_t top_carry = 0;
+    t[kLimbs] = add_carry(t[kLimbs], carry, &top_carry);
+    t[kLimbs + 1] = top_carry;
+
+    // add m * p, with m = t[0] since -1/p mod 2^64 = 1, which clears the lowest limb, and shift it out
+    uint64_t m = t[0];
+    carry = 0;
+    mul_add(t[0], m, kP.limb[0], &carry);
+    #pragma GCC unroll 4
+    for (size_t j = 1; j < kLimbs; j++) {
+      t[j - 1] = mul_add(t[j], m, kP.limb[j], &carry);
+    }
+    top_carry = 0;
+    t[kLimbs - 1] = add_carry(t[kLimbs], carry, &top_carry);
+    t[kLimbs] = t[kLimbs + 1] + top_carry;
+  }
+  fe_reduce_once(r, t, t[kLimbs]);
+}
+
+void fe_sqr(Fe* r, const Fe& a) {
+  fe_mul(r, a, a);
+}
+
+// r = a^(p - 2) = 1 / a, or 0 for a = 0. The exponent is public, branching on its bits leaks nothing.
+void fe_inv(Fe* r, const Fe& a) {
+  Fe result = kOne;
+  for (int i = 255; i >= 0; i--) {
+    fe_sqr(&result, result);
+    if ((kPMinus2.limb[i / 64] >> (i % 64)) & 1) {
+      fe_mul(&result, result, a);
+    }
+  }
+  *r = result;
+}
+
+// True if the 256 bit value |words| is below p, that is a canonical coordinate
+bool words_below_p(const uint32_t words[kWords]) {
+  uint64_t borrow = 0;
+  for (size_t i = 0; i < kLimbs; i++) {
+    uint64_t limb = static_cast<uint64_t>(words[2 * i]) | (static_cast<uint64_t>(words[2 * i + 1]) << 32);
+    sub_borrow(limb, kP.limb[i], &borrow);
+  }
+  return borrow == 1;
+}
+
+bool fe_is_equal(const Fe& a, const Fe& b) {
+  uint64_t difference = 0;
+  for (size_t i = 0; i < kLimbs; i++) {
+    difference |= a.limb[i] ^ b.limb[i];
+  }
+  return difference == 0;
+}
+
+void fe_from_words(Fe* r, const uint32_t words[kWords]) {
+  Fe value;
+  for (size_t i = 0; i < kLimbs; i++) {
+    value.limb[i] = static_cast<uint64_t>(words[2 * i]) | (static_cast<uint64_t>(words[2 * i + 1]) << 32);
+  }
+  // works for any 256 bit value, as kRSquared < p keeps the product below p * 2^256
+  fe_mul(r, value, kRSquared);
+}
+
+void fe_to_words(uint32_t words[kWords], const Fe& a) {
+  Fe value;
+  const Fe one = {{1, 0, 0, 0}};
+  fe_mul(&value, a, one);
+  for (size_t i = 0; i < kLimbs; i++) {
+    words[2 * i] = static_cast<uint32_t>(value.limb[i]);
+    words[2 * i + 1] = static_cast<uint32_t>(value.limb[i] >> 32);
+  }
+}
+
+// (X : Y : Z) with x = X / Z and y = Y / Z, the point at infinity being (0 : 1 : 0)
+struct ProjectivePoint {
+  Fe x, y, z;
+};
+
+struct AffinePoint {
+  Fe x, y;
+};
+
+constexpr ProjectivePoint kInfinity = {{{0}}, kOne, {{0}}};
+
+// Complete addition, Algorithm 4 of "Complete addition formulas for prime order elliptic curves", for a = -3. Works
+// for any two points, equal or at infinity, so the same operations run whatever they are.
+void point_add(ProjectivePoint* r, const ProjectivePoint& p, const ProjectivePoint& q) {
+  Fe t0, t1, t2, t3, t4, x3, y3, z3;
+  fe_mul(&t0, p.x, q.x);
+  fe_mul(&t1, p.y, q.y);
+  fe_mul(&t2, p.z, q.z);
+  fe_add(&t3, p.x, p.y);
+  fe_add(&t4, q.x, q.y);
+  fe_mul(&t3, t3, t4);
+  fe_add(&t4, t0, t1);
+  fe_sub(&t3, t3, t4);
+  fe_add(&t4, p.y, p.z);
+  fe_add(&x3, q.y, q.z);
+  fe_mul(&t4, t4, x3);
+  fe_add(&x3, t1, t2);
+  fe_sub(&t4, t4, x3);
+  fe_add(&x3, p.x, p.z);
+  fe_add(&y3, q.x, q.z);
+  fe_mul(&x3, x3, y3);
+  fe_add(&y3, t0, t2);
+  fe_sub(&y3, x3, y3);
+  fe_mul(&z3, kB, t2);
+  fe_sub(&x3, y3, z3);
+  fe_add(&z3, x3, x3);
+  fe_add(&x3, x3, z3);
+  fe_sub(&z3, t1, x3);
+  fe_add(&x3, t1, x3);
+  fe_mul(&y3, kB, y3);
+  fe_add(&t1, t2, t2);
+  fe_add(&t2, t1, t2);
+  fe_sub(&y3, y3, t2);
+  fe_sub(&y3, y3, t0);
+  fe_add(&t1, y3, y3);
+  fe_add(&y3, t1, y3);
+  fe_add(&t1, t0, t0);
+  fe_add(&t0, t1, t0);
+  fe_sub(&t0, t0, t2);
+  fe_mul(&t1, t4, y3);
+  fe_mul(&t2, t0, y3);
+  fe_mul(&y3, x3, z3);
+  fe_add(&y3, y3, t2);
+  fe_mul(&x3, t3, x3);
+  fe_sub(&x3, x3, t1);
+  fe_mul(&z3, t4, z3);
+  fe_mul(&t1, t3, t0);
+  fe_add(&z3, z3, t1);
+  r->x = x3;
+  r->y = y3;
+  r->z = z3;
+}
+
+// Mixed addition, Algorithm 5 of the same paper, with |q| affine. Does not handle |q| at infinity, which affine
+// coordinates cannot represent: r = p when |q_is_infinity| is all ones.
+void point_add_mixed(ProjectivePoint* r, const ProjectivePoint& p, const AffinePoint& q, uint64_t q_is_infinity) {
+  Fe t0, t1, t3, t4, x3, y3, z3;
+  fe_mul(&t0, p.x, q.x);
+  fe_mul(&t1, p.y, q.y);
+  fe_add(&t3, q.x, q.y);
+  fe_add(&t4, p.x, p.y);
+  fe_mul(&t3, t3, t4);
+  fe_add(&t4, t0, t1);
+  fe_sub(&t3, t3, t4);
+  fe_mul(&t4, q.y, p.z);
+  fe_add(&t4, t4, p.y);
+  fe_mul(&y3, q.x, p.z);
+  fe_add(&y3, y3, p.x);
+  fe_mul(&z3, kB, p.z);
+  fe_sub(&x3, y3, z3);
+  fe_add(&z3, x3, x3);
+  fe_add(&x3, x3, z3);
+  fe_sub(&z3, t1, x3);
+  fe_add(&x3, t1, x3);
+  fe_mul(&y3, kB, y3);
+  Fe t2;
+  fe_add(&t1, p.z, p.z);
+  fe_add(&t2, t1, p.z);
+  fe_sub(&y3, y3, t2);
+  fe_sub(&y3, y3, t0);
+  fe_add(&t1, y3, y3);
+  fe_add(&y3, t1, y3);
+  fe_add(&t1, t0, t0);
+  fe_add(&t0, t1, t0);
+  fe_sub(&t0, t0, t2);
+  fe_mul(&t1, t4, y3);
+  fe_mul(&t2, t0, y3);
+  fe_mul(&y3, x3, z3);
+  fe_add(&y3, y3, t2);
+  fe_mul(&x3, t3, x3);
+  fe_sub(&x3, x3, t1);
+  fe_mul(&z3, t4, z3);
+  fe_mul(&t1, t3, t0);
+  fe_add(&z3, z3, t1);
+
+  ProjectivePoint sum = {x3, y3, z3};
+  fe_select(&sum.x, p.x, q_is_infinity);
+  fe_select(&sum.y, p.y, q_is_infinity);
+  fe_select(&sum.z, p.z, q_is_infinity);
+  *r = sum;
+}
+
+// Doubling, Algorithm 6 of the same paper
+void point_double(ProjectivePoint* r, const ProjectivePoint& p) {
+  Fe t0, t1, t2, t3, x3, y3, z3;
+  fe_sqr(&t0, p.x);
+  fe_sqr(&t1, p.y);
+  fe_sqr(&t2, p.z);
+  fe_mul(&t3, p.x, p.y);
+  fe_add(&t3, t3, t3);
+  fe_mul(&z3, p.x, p.z);
+  fe_add(&z3, z3, z3);
+  fe_mul(&y3, kB, t2);
+  fe_sub(&y3, y3, z3);
+  fe_add(&x3, y3, y3);
+  fe_add(&y3, x3, y3);
+  fe_sub(&x3, t1, y3);
+  fe_add(&y3, t1, y3);
+  fe_mul(&y3, x3, y3);
+  fe_mul(&x3, x3, t3);
+  fe_add(&t3, t2, t2);
+  fe_add(&t2, t2, t3);
+  fe_mul(&z3, kB, z3);
+  fe_sub(&z3, z3, t2);
+  fe_sub(&z3, z3, t0);
+  fe_add(&t3, z3, z3);
+  fe_add(&z3, z3, t3);
+  fe_add(&t3, t0, t0);
+  fe_add(&t0, t3, t0);
+  fe_sub(&t0, t0, t2);
+  fe_mul(&t0, t0, z3);
+  fe_add(&y3, y3, t0);
+  fe_mul(&t0, p.y, p.z);
+  fe_add(&t0, t0, t0);
+  fe_mul(&z3, t0, z3);
+  fe_sub(&x3, x3, z3);
+  fe_mul(&z3, t0, t1);
+  fe_add(&z3, z3, z3);
+  fe_add(&z3, z3, z3);
+  r->x = x3;
+  r->y = y3;
+  r->z = z3;
+}
+
+void point_to_words(uint32_t x[kWords], uint32_t y[kWords], const ProjectivePoint& p) {
+  Fe z_inv, affine_x, affine_y;
+  fe_inv(&z_inv, p.z);
+  fe_mul(&affine_x, p.x, z_inv);
+  fe_mul(&affine_y, p.y, z_inv);
+  fe_to_words(x, affine_x);
+  fe_to_words(y, affine_y);
+}
+
+// 4 bit window |index| of the scalar, from the least significant
+inline uint32_t scalar_window(const uint32_t k[kWords], size_t index) {
+  return (k[index / 8] >> ((index % 8) * 4)) & 0xf;
+}
+
+// Window multiples of a point, 0 to 15 times it
+using WindowTable = std::array<ProjectivePoint, 16>;
+
+// r = table[index], reading every entry
+void select_projective(ProjectivePoint* r, const WindowTable& table, uint32_t index) {
+  *r = table[0];
+  for (size_t i = 1; i < table.size(); i++) {
+    uint64_t mask = equal_mask(i, index);
+    fe_select(&r->x, table[i].x, mask);
+    fe_select(&r->y, table[i].y, mask);
+    fe_select(&r->z, table[i].z, mask);
+  }
+}
+
+// The base point tables cover the scalar a byte at a time: table j holds 1 to 15 times 2^(8j) G, each byte being added
+// as its high window, then as its low window once the sum of the high windows is multiplied by 16.
+constexpr size_t kBaseTables = 32;
+using BaseTable = std::array<AffinePoint, 15>;
+
+// r = table[index - 1], reading every entry, and all ones in |is_infinity| for index 0
+void select_affine(AffinePoint* r, uint64_t* is_infinity, const BaseTable& table, uint32_t index) {
+  *r = {};
+  for (size_t i = 0; i < table.size(); i++) {
+    uint64_t mask = equal_mask(i + 1, index);
+    fe_select(&r->x, table[i].x, mask);
+    fe_select(&r->y, table[i].y, mask);
+  }
+  *is_infinity = equal_mask(0, index);
+}
+
+std::array<BaseTable, kBaseTables> compute_base_tables() {
+  constexpr size_t kNumPoints = kBaseTables * 15;
+  std::array<ProjectivePoint, kNumPoints> points;
+
+  ProjectivePoint base;
+  fe_from_words(&base.x, kGx);
+  fe_from_words(&base.y, kGy);
+  base.z = kOne;
+  for (size_t j = 0; j < kBaseTables; j++) {
+    points[j * 15] = base;
+    for (size_t i = 1; i < 15; i++) {
+      point_add(&points[j * 15 + i], points[j * 15 + i - 1], base);
+    }
+    for (int i = 0; i < 8; i++) {
+      point_double(&base, base);
+    }
+  }
+
+  // Normalize all the points with a single inversion: invert the product of all the Z, then peel it off one by one
+  std::array<Fe, kNumPoints> products;
+  products[0] = points[0].z;
+  for (size_t i = 1; i < kNumPoints; i++) {
+    fe_mul(&products[i], products[i - 1], points[i].z);
+  }
+  Fe inverse;
+  fe_inv(&inverse, products[kNumPoints - 1]);
+
+  std::array<BaseTable, kBaseTables> tables;
+  for (size_t i = kNumPoints; i-- > 0;) {
+    Fe z_inv;
+    if (i > 0) {
+      fe_mul(&z_inv, inverse, products[i - 1]);
+      fe_mul(&inverse, inverse, points[i].z);
+    } else {
+      z_inv = inverse;
+    }
+    AffinePoint* entry = &tables[i / 15][i % 15];
+    fe_mul(&entry->x, points[i].x, z_inv);
+    fe_mul(&entry->y, points[i].y, z_inv);
+  }
+  return tables;
+}
+
+const std::array<BaseTable, kBaseTables>& base_tables() {
+  static const std::array<BaseTable, kBaseTables> tables = compute_base_tables();
+  return tables;
+}
+
+}  // namespace
+
+bool IsOnCurve(const uint32_t x[kWords], const uint32_t y[kWords]) {
+  if (!words_below_p(x) || !words_below_p(y)) {
+    return false;
+  }
+
+  Fe fx, fy, lhs, rhs, three_x;
+  fe_from_words(&fx, x);
+  fe_from_words(&fy, y);
+
+  fe_sqr(&lhs, fy);
+
+  fe_sqr(&rhs, fx);
+  fe_mul(&rhs, rhs, fx);
+  fe_add(&three_x, fx, fx);
+  fe_add(&three_x, three_x, fx);
+  fe_sub(&rhs, rhs, three_x);
+  fe_add(&rhs, rhs, kB);
+
+  return fe_is_equal(lhs, rhs);
+}
+
+void ScalarMult(
+    const uint32_t x[kWords],
+    const uint32_t y[kWords],
+    const uint32_t k[kWords],
+    uint32_t out_x[kWords],
+    uint32_t out_y[kWords]) {
+  WindowTable table;
+  table[0] = kInfinity;
+  fe_from_words(&table[1].x, x);
+  fe_from_words(&table[1].y, y);
+  table[1].z = kOne;
+  for (size_t i = 2; i < table.size(); i += 2) {
+    point_double(&table[i], table[i / 2]);
+    point_add(&table[i + 1], table[i], table[1]);
+  }
+
+  ProjectivePoint result = kInfinity;
+  ProjectivePoint multiple;
+  for (size_t window = 2 * kWords * 4; window-- > 0;) {
+    for (int i = 0; i < 4; i++) {
+      point_double(&result, result);
+    }
+    select_projective(&multiple, table, scalar_window(k, window));
+    point_add(&result, result, multiple);
+  }
+
+  point_to_words(out_x, out_y, result);
+}
+
+void ScalarBaseMult(const uint32_t k[kWords], uint32_t out_x[kWords], uint32_t out_y[kWords]) {
+  const std::array<BaseTable, kBaseTables>& tables = base_tables();
+
+  ProjectivePoint result = kInfinity;
+  AffinePoint multiple;
+  uint64_t is_infinity;
+  for (size_t j = 0; j < kBaseTables; j++) {
+    select_affine(&multiple, &is_infinity, tables[j], scalar_window(k, 2 * j + 1));
+    point_add_mixed(&result, result, multiple, is_infinity);
+  }
+  for (int i = 0; i < 4; i++) {
+    point_double(&result, result);
+  }
+  for (size_t j = 0; j < kBaseTables; j++) {
+    select_affine(&multiple, &is_infinity, tables[j], scalar_window(k, 2 * j));
+    point_add_mixed(&result, result, multiple, is_infinity);
+  }
+
+  point_to_words(out_x, out_y, result);
+}
+
+}  // namespace p256
+}  // namespace ecc
+}  // namespace security
+}  // namespace bluetooth
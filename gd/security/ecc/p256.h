@@ -0,0 +1,56 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// P-256 arithmetic for the LE Secure Connections key pairs and DHKey, shared by the SMP of both stacks.
+//
+// Field elements are kept in the Montgomery domain on four 64 bit limbs, points in projective coordinates added with
+// the complete formulas of Renes, Costello and Batina, so that no operation branches on a secret. Scalar
+// multiplication uses fixed 4 bit windows and reads the tables of multiples in full for every window; multiplication
+// of the base point uses tables computed on first use, and only four doublings.
+//
+// Coordinates and scalars are 256 bit integers as 8 little endian 32 bit words, the layout of ecc::Point and of the
+// keys on the air.
+//
+// Header only depends on the standard library, so that the legacy stack can include it as gd/security/ecc/p256.h.
+namespace bluetooth {
+namespace security {
+namespace ecc {
+namespace p256 {
+
+constexpr size_t kWords = 8;
+
+// Return true if x and y are below p and (x, y) satisfies y^2 = x^3 - 3x + b mod p
+bool IsOnCurve(const uint32_t x[kWords], const uint32_t y[kWords]);
+
+// (out_x, out_y) = k * (x, y), in time independent of |k|. The point at infinity is returned as (0, 0).
+void ScalarMult(
+    const uint32_t x[kWords],
+    const uint32_t y[kWords],
+    const uint32_t k[kWords],
+    uint32_t out_x[kWords],
+    uint32_t out_y[kWords]);
+
+// (out_x, out_y) = k * G, in time independent of |k|
+void ScalarBaseMult(const uint32_t k[kWords], uint32_t out_x[kWords], uint32_t out_y[kWords]);
+
+}  // namespace p256
+}  // namespace ecc
+}  // namespace security
+}  // namespace bluetooth
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cstdint>
+
+#include "benchmark/benchmark.h"
+#include "security/ecc/p_256_ecc_pp.h"
+
+using ::benchmark::State;
+using ::bluetooth::security::ecc::curve_p256;
+using ::bluetooth::security::ecc::ECC_PointMult;
+using ::bluetooth::security::ecc::ECC_PointMult_Base;
+using ::bluetooth::security::ecc::ECC_ValidatePoint;
+using ::bluetooth::security::ecc::Point;
+
+namespace {
+
+// Private key A of the Bluetooth Core Specification Vol 2, Part G 7.1.2, sample 1
+constexpr uint32_t kPrivateKey[8] = {
+    0xcd3c1abd, 0x5899b8a6, 0xeb40b799, 0x4aff607b, 0xd2103f50, 0x74c9b3e3, 0xa3c55f38, 0x3f49f6d4};
+
+// Key pair generation
+void BM_PointMultBase(State& state) {
+  Point public_key;
+  for (auto _ : state) {
+    ECC_PointMult_Base(&public_key, kPrivateKey);
+    benchmark::DoNotOptimize(public_key);
+  }
+}
+BENCHMARK(BM_PointMultBase);
+
+// DHKey computation
+void BM_PointMult(State& state) {
+  Point peer_public_key;
+  ECC_PointMult_Base(&peer_public_key, kPrivateKey);
+  Point dhkey;
+  for (auto _ : state) {
+    ECC_PointMult(&dhkey, &peer_public_key, kPrivateKey);
+    benchmark::DoNotOptimize(dhkey);
+  }
+}
+BENCHMARK(BM_PointMult);
+
+// Check of the peer public key
+void BM_ValidatePoint(State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ECC_ValidatePoint(curve_p256.G));
+  }
+}
+BENCHMARK(BM_ValidatePoint);
+
+}  // namespace
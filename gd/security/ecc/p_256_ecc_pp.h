@@ -67,9 +67,11 @@ static constexpr elliptic_curve_t curve_p256{
 /* This function checks that point is on the elliptic curve*/
 bool ECC_ValidatePoint(const Point& point);
 
-void ECC_PointMult_Bin_NAF(Point* q, const Point* p, uint32_t* n);
+// q = n * p, in affine coordinates with q->z = 1, in time independent of n
+void ECC_PointMult(Point* q, const Point* p, const uint32_t* n);
 
-#define ECC_PointMult(q, p, n) ECC_PointMult_Bin_NAF(q, p, n)
+// q = n * G, faster than ECC_PointMult(q, &curve_p256.G, n)
+void ECC_PointMult_Base(Point* q, const uint32_t* n);
 
 }  // namespace ecc
 }  // namespace security
@@ -18,6 +18,7 @@
 
 #include <ios>
 #include <sstream>
+#include <thread>
 #include <utility>
 
 #include "hci/enum_helper.h"
@@ -52,21 +53,37 @@ ConfigCache::ConfigCache(size_t temp_device_capacity, std::unordered_set<std::st
     : persistent_property_names_(std::move(persistent_property_names)),
       information_sections_(),
       persistent_devices_(),
-      temporary_devices_(temp_device_capacity) {}
+      temporary_devices_(temp_device_capacity) {
+  RebuildIndex();
+}
+
+ConfigCache::~ConfigCache() {
+  delete index_.load();
+}
 
 void ConfigCache::SetPersistentConfigChangedCallback(std::function<void()> persistent_config_changed_callback) {
   std::lock_guard<std::recursive_mutex> lock(mutex_);
   persistent_config_changed_callback_ = std::move(persistent_config_changed_callback);
 }
 
+void ConfigCache::SetPersistentMutationCallback(
+    std::function<void(const MutationEntry&)> persistent_mutation_callback) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  persistent_mutation_callback_ = std::move(persistent_mutation_callback);
+}
+
 ConfigCache::ConfigCache(ConfigCache&& other) noexcept
     : persistent_config_changed_callback_(std::move(other.persistent_config_changed_callback_)),
+      persistent_mutation_callback_(std::move(other.persistent_mutation_callback_)),
       persistent_property_names_(std::move(other.persistent_property_names_)),
       information_sections_(std::move(other.information_sections_)),
       persistent_devices_(std::move(other.persistent_devices_)),
       temporary_devices_(std::move(other.temporary_devices_)) {
   // std::function will be in a valid but unspecified state after std::move(), hence resetting it
   other.persistent_config_changed_callback_ = {};
+  other.persistent_mutation_callback_ = {};
+  RebuildIndex();
+  other.RebuildIndex();
 }
 
 ConfigCache& ConfigCache::operator=(ConfigCache&& other) noexcept {
@@ -77,10 +94,14 @@ ConfigCache& ConfigCache::operator=(ConfigCache&& other) noexcept {
   std::lock_guard<std::recursive_mutex> others_lock(other.mutex_);
   persistent_config_changed_callback_.swap(other.persistent_config_changed_callback_);
   other.persistent_config_changed_callback_ = {};
+  persistent_mutation_callback_.swap(other.persistent_mutation_callback_);
+  other.persistent_mutation_callback_ = {};
   persistent_property_names_ = std::move(other.persistent_property_names_);
   information_sections_ = std::move(other.information_sections_);
   persistent_devices_ = std::move(other.persistent_devices_);
   temporary_devices_ = std::move(other.temporary_devices_);
+  RebuildIndex();
+  other.RebuildIndex();
   return *this;
 }
 
@@ -98,6 +119,11 @@ bool ConfigCache::operator!=(const ConfigCache& rhs) const {
 
 void ConfigCache::Clear() {
   std::lock_guard<std::recursive_mutex> lock(mutex_);
+  for (const auto* config_section : {&information_sections_, &persistent_devices_}) {
+    for (const auto& section : *config_section) {
+      PersistentMutationCallback(MutationEntry::EntryType::REMOVE_SECTION, section.first);
+    }
+  }
   if (information_sections_.size() > 0) {
     information_sections_.clear();
     PersistentConfigChangedCallback();
@@ -109,15 +135,30 @@ void ConfigCache::Clear() {
   if (temporary_devices_.size() > 0) {
     temporary_devices_.clear();
   }
+  RebuildIndex();
 }
 
 bool ConfigCache::HasSection(const std::string& section) const {
+  if (LookUpIndex([&section](const ConfigCacheIndex& index) { return index.Find(section) != nullptr; })) {
+    return true;
+  }
   std::lock_guard<std::recursive_mutex> lock(mutex_);
   return information_sections_.contains(section) || persistent_devices_.contains(section) ||
          temporary_devices_.contains(section);
 }
 
 bool ConfigCache::HasProperty(const std::string& section, const std::string& property) const {
+  // sections are unique among all three maps, hence a section found in the index has all of its properties there
+  auto indexed = LookUpIndex([&section, &property](const ConfigCacheIndex& index) -> std::optional<bool> {
+    auto indexed_section = index.Find(section);
+    if (indexed_section == nullptr) {
+      return std::nullopt;
+    }
+    return indexed_section->GetProperty(property) != nullptr;
+  });
+  if (indexed) {
+    return *indexed;
+  }
   std::lock_guard<std::recursive_mutex> lock(mutex_);
   auto section_iter = information_sections_.find(section);
   if (section_iter != information_sections_.end()) {
@@ -135,6 +176,19 @@ bool ConfigCache::HasProperty(const std::string& section, const std::string& pro
 }
 
 std::optional<std::string> ConfigCache::GetProperty(const std::string& section, const std::string& property) const {
+  bool is_indexed = false;
+  auto value = LookUpIndex([&](const ConfigCacheIndex& index) -> std::optional<std::string> {
+    auto indexed_section = index.Find(section);
+    is_indexed = indexed_section != nullptr;
+    auto indexed_value = is_indexed ? indexed_section->GetProperty(property) : nullptr;
+    if (indexed_value == nullptr) {
+      return std::nullopt;
+    }
+    return *indexed_value;
+  });
+  if (is_indexed) {
+    return value;
+  }
   std::lock_guard<std::recursive_mutex> lock(mutex_);
   auto section_iter = information_sections_.find(section);
   if (section_iter != information_sections_.end()) {
@@ -172,7 +226,9 @@ void ConfigCache::SetProperty(std::string section, std::string property, std::st
     if (section_iter == information_sections_.end()) {
       section_iter = information_sections_.try_emplace_back(section, common::ListMap<std::string, std::string>{}).first;
     }
+    PersistentMutationCallback(MutationEntry::EntryType::SET, section, property, value);
     section_iter->second.insert_or_assign(property, std::move(value));
+    UpdateIndex(section);
     PersistentConfigChangedCallback();
     return;
   }
@@ -181,13 +237,19 @@ void ConfigCache::SetProperty(std::string section, std::string property, std::st
     // move paired devices or create new paired device when a link key is set
     auto section_properties = temporary_devices_.extract(section);
     if (section_properties) {
+      // properties set while the device was temporary were never persisted, so they are persisted along with it
+      for (const auto& temp_property : section_properties->second) {
+        PersistentMutationCallback(MutationEntry::EntryType::SET, section, temp_property.first, temp_property.second);
+      }
       section_iter = persistent_devices_.try_emplace_back(section, std::move(section_properties->second)).first;
     } else {
       section_iter = persistent_devices_.try_emplace_back(section, common::ListMap<std::string, std::string>{}).first;
     }
   }
   if (section_iter != persistent_devices_.end()) {
+    PersistentMutationCallback(MutationEntry::EntryType::SET, section, property, value);
     section_iter->second.insert_or_assign(property, std::move(value));
+    UpdateIndex(section);
     PersistentConfigChangedCallback();
     return;
   }
@@ -203,6 +265,8 @@ bool ConfigCache::RemoveSection(const std::string& section) {
   std::lock_guard<std::recursive_mutex> lock(mutex_);
   // sections are unique among all three maps, hence removing from one of them is enough
   if (information_sections_.extract(section) || persistent_devices_.extract(section)) {
+    PersistentMutationCallback(MutationEntry::EntryType::REMOVE_SECTION, section);
+    UpdateIndex(section);
     PersistentConfigChangedCallback();
     return true;
   } else {
@@ -220,6 +284,8 @@ bool ConfigCache::RemoveProperty(const std::string& section, const std::string&
       information_sections_.erase(section_iter);
     }
     if (value.has_value()) {
+      PersistentMutationCallback(MutationEntry::EntryType::REMOVE_PROPERTY, section, property);
+      UpdateIndex(section);
       PersistentConfigChangedCallback();
       return true;
     } else {
@@ -238,6 +304,8 @@ bool ConfigCache::RemoveProperty(const std::string& section, const std::string&
       temporary_devices_.insert_or_assign(section, std::move(section_properties->second));
     }
     if (value.has_value()) {
+      PersistentMutationCallback(MutationEntry::EntryType::REMOVE_PROPERTY, section, property);
+      UpdateIndex(section);
       PersistentConfigChangedCallback();
       return true;
     } else {
@@ -270,6 +338,7 @@ void ConfigCache::RemoveSectionWithProperty(const std::string& property) {
     for (auto it = config_section->begin(); it != config_section->end();) {
       if (it->second.contains(property)) {
         LOG_INFO("Removing persistent section %s with property %s", it->first.c_str(), property.c_str());
+        PersistentMutationCallback(MutationEntry::EntryType::REMOVE_SECTION, it->first);
         it = config_section->erase(it);
         num_persistent_removed++;
         continue;
@@ -286,6 +355,7 @@ void ConfigCache::RemoveSectionWithProperty(const std::string& property) {
     it++;
   }
   if (num_persistent_removed > 0) {
+    RebuildIndex();
     PersistentConfigChangedCallback();
   }
 }
@@ -406,6 +476,8 @@ bool ConfigCache::FixDeviceTypeInconsistencies() {
   for (auto* config_section : {&information_sections_, &persistent_devices_}) {
     for (auto& elem : *config_section) {
       if (FixDeviceTypeInconsistencyInSection(elem.first, elem.second)) {
+        PersistentMutationCallback(
+            MutationEntry::EntryType::SET, elem.first, "DevType", elem.second.find("DevType")->second);
         persistent_device_changed = true;
       }
     }
@@ -417,6 +489,7 @@ bool ConfigCache::FixDeviceTypeInconsistencies() {
     }
   }
   if (persistent_device_changed) {
+    RebuildIndex();
     PersistentConfigChangedCallback();
   }
   return persistent_device_changed || temp_device_changed;
@@ -451,8 +524,68 @@ bool ConfigCache::HasAtLeastOneMatchingPropertiesInSection(
 }
 
 bool ConfigCache::IsPersistentSection(const std::string& section) const {
-  std::lock_guard<std::recursive_mutex> lock(mutex_);
-  return persistent_devices_.contains(section);
+  return LookUpIndex([&section](const ConfigCacheIndex& index) {
+    auto indexed_section = index.Find(section);
+    return indexed_section != nullptr && indexed_section->IsPersistentDevice();
+  });
+}
+
+void ConfigCache::UpdateIndex(const std::string& section) {
+  std::shared_ptr<const ConfigCacheIndex::Section> indexed_section;
+  auto section_iter = information_sections_.find(section);
+  if (section_iter != information_sections_.end()) {
+    indexed_section =
+        std::make_shared<ConfigCacheIndex::Section>(section, false, section_iter->second, &property_name_pool_);
+  }
+  section_iter = persistent_devices_.find(section);
+  if (section_iter != persistent_devices_.end()) {
+    indexed_section =
+        std::make_shared<ConfigCacheIndex::Section>(section, true, section_iter->second, &property_name_pool_);
+  }
+  // Only called with |mutex_| held, so the index can't change while the new one is built from it
+  PublishIndex(std::make_unique<ConfigCacheIndex>(*index_.load(), section, std::move(indexed_section)));
+}
+
+void ConfigCache::RebuildIndex() {
+  std::vector<std::shared_ptr<const ConfigCacheIndex::Section>> sections;
+  sections.reserve(information_sections_.size() + persistent_devices_.size());
+  for (const auto& section : information_sections_) {
+    sections.push_back(
+        std::make_shared<ConfigCacheIndex::Section>(section.first, false, section.second, &property_name_pool_));
+  }
+  for (const auto& section : persistent_devices_) {
+    sections.push_back(
+        std::make_shared<ConfigCacheIndex::Section>(section.first, true, section.second, &property_name_pool_));
+  }
+  PublishIndex(std::make_unique<ConfigCacheIndex>(sections));
+}
+
+void ConfigCache::PublishIndex(std::unique_ptr<const ConfigCacheIndex> index) {
+  const ConfigCacheIndex* replaced_index = index_.exchange(index.release());
+  auto epoch = epoch_.load();
+  epoch_.store(epoch + 1);
+  // Lookups started from now on count in the next epoch, and only see the new index
+  while (readers_[epoch % 2].load() != 0) {
+    std::this_thread::yield();
+  }
+  delete replaced_index;
+}
+
+ConfigCache::IndexReader::IndexReader(const ConfigCache& config) {
+  while (true) {
+    auto epoch = config.epoch_.load();
+    readers_ = &config.readers_[epoch % 2];
+    readers_->fetch_add(1);
+    // Otherwise a writer may have moved to the next epoch without seeing this reader
+    if (config.epoch_.load() == epoch) {
+      return;
+    }
+    readers_->fetch_sub(1);
+  }
+}
+
+ConfigCache::IndexReader::~IndexReader() {
+  readers_->fetch_sub(1);
 }
 
 }  // namespace storage
@@ -15,8 +15,11 @@
  */
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <functional>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <queue>
@@ -30,6 +33,7 @@
 #include "common/lru_cache.h"
 #include "hci/address.h"
 #include "os/utils.h"
+#include "storage/config_cache_index.h"
 #include "storage/mutation_entry.h"
 
 namespace bluetooth {
@@ -48,11 +52,13 @@ class Mutation;
 // The definition of persistent sections is up to the user and is defined through the |persistent_property_names|
 // argument. When these properties are link key properties, then persistent sections is equal to bonded devices
 //
-// This class is thread safe
+// This class is thread safe. Lookups in sections written to disk, such as properties of bonded devices, do not take the
+// config mutex: every change to these sections publishes a new immutable ConfigCacheIndex that readers use instead.
+// Lookups in temporary sections still take the mutex, as they warm up the section in the LRU cache
 class ConfigCache {
  public:
   ConfigCache(size_t temp_device_capacity, std::unordered_set<std::string_view> persistent_property_names);
-  virtual ~ConfigCache() = default;
+  virtual ~ConfigCache();
 
   // no copy
   DISALLOW_COPY_AND_ASSIGN(ConfigCache);
@@ -107,6 +113,9 @@ class ConfigCache {
   virtual void Clear();
   // Set a callback to notify interested party that a persistent config change has just happened
   virtual void SetPersistentConfigChangedCallback(std::function<void()> persistent_config_changed_callback);
+  // Set a callback to receive each change to the persistent sections as a mutation entry. Committing these entries in
+  // order to a config cache holding the persistent sections from before the changes reproduces the changes
+  virtual void SetPersistentMutationCallback(std::function<void(const MutationEntry&)> persistent_mutation_callback);
 
   // Device config specific methods
   // TODO: methods here should be moved to a device specific config cache if this config cache is supposed to be generic
@@ -121,9 +130,29 @@ class ConfigCache {
   static const std::string kDefaultSectionName;
 
  private:
+  // Marks a lookup in the current index for as long as it lives, the index is not freed until then
+  class IndexReader {
+   public:
+    explicit IndexReader(const ConfigCache& config);
+    ~IndexReader();
+    DISALLOW_COPY_AND_ASSIGN(IndexReader);
+
+   private:
+    std::atomic<uint32_t>* readers_;
+  };
+
   mutable std::recursive_mutex mutex_;
+  // Index of information sections and persistent devices, read without holding |mutex_|. Readers count themselves in
+  // the epoch they start in. A writer replaces the index, moves to the next epoch, and frees the replaced index once
+  // the readers of the previous epoch are gone
+  std::atomic<const ConfigCacheIndex*> index_ = nullptr;
+  std::atomic<uint64_t> epoch_ = 0;
+  mutable std::array<std::atomic<uint32_t>, 2> readers_{};
+  PropertyNamePool property_name_pool_;
   // A callback to notify interested party that a persistent config change has just happened, empty by default
   std::function<void()> persistent_config_changed_callback_;
+  // A callback to journal changes to persistent sections, empty by default
+  std::function<void(const MutationEntry&)> persistent_mutation_callback_;
   // A set of property names that if set would make a section persistent and if non of these properties are set, a
   // section would become temporary again
   std::unordered_set<std::string_view> persistent_property_names_;
@@ -135,12 +164,37 @@ class ConfigCache {
   // if capacity exceeds given value during initialization
   common::LruCache<std::string, common::ListMap<std::string, std::string>> temporary_devices_;
 
+  // Publish a new index where |section| is brought up to date with the config
+  void UpdateIndex(const std::string& section);
+  // Publish a new index built from scratch
+  void RebuildIndex();
+  // Only called with |mutex_| held, returns once no lookup can use the replaced index anymore
+  void PublishIndex(std::unique_ptr<const ConfigCacheIndex> index);
+  // Call |lookup| with the current index, and return its result
+  template <typename Lookup>
+  auto LookUpIndex(Lookup lookup) const {
+    IndexReader reader(*this);
+    return lookup(*index_.load());
+  }
+
   // Convenience method to check if the callback is valid before calling it
   inline void PersistentConfigChangedCallback() const {
     if (persistent_config_changed_callback_) {
       persistent_config_changed_callback_();
     }
   }
+
+  // Convenience method to only build a mutation entry when there is a callback to receive it
+  inline void PersistentMutationCallback(
+      MutationEntry::EntryType entry_type,
+      const std::string& section,
+      const std::string& property = "",
+      const std::string& value = "") const {
+    if (persistent_mutation_callback_) {
+      persistent_mutation_callback_(
+          MutationEntry(entry_type, MutationEntry::PropertyType::NORMAL, section, property, value));
+    }
+  }
 };
 
 }  // namespace storage
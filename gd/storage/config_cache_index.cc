@@ -0,0 +1,176 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/config_cache_index.h"
+
+#include <functional>
+#include <utility>
+
+namespace bluetooth {
+namespace storage {
+
+namespace {
+
+constexpr size_t kMinTableSize = 8;
+constexpr size_t kMinNumBuckets = 16;
+// Number of sections per bucket above which the buckets are doubled, so that a bucket stays cheap to scan and copy
+constexpr size_t kMaxSectionsPerBucket = 4;
+
+// Tables are kept at most half full so that probe sequences stay short
+size_t TableSize(size_t num_entries) {
+  size_t table_size = kMinTableSize;
+  while (table_size < 2 * num_entries) {
+    table_size *= 2;
+  }
+  return table_size;
+}
+
+size_t NumBuckets(size_t num_sections) {
+  size_t num_buckets = kMinNumBuckets;
+  while (num_buckets * kMaxSectionsPerBucket < num_sections) {
+    num_buckets *= 2;
+  }
+  return num_buckets;
+}
+
+}  // namespace
+
+std::shared_ptr<const std::string> PropertyNamePool::Intern(const std::string& name) {
+  auto iter = names_.find(name);
+  if (iter == names_.end()) {
+    iter = names_.emplace(name, std::make_shared<const std::string>(name)).first;
+  }
+  return iter->second;
+}
+
+ConfigCacheIndex::Section::Section(
+    std::string name,
+    bool is_persistent_device,
+    const common::ListMap<std::string, std::string>& properties,
+    PropertyNamePool* property_name_pool)
+    : name_(std::move(name)),
+      hash_(std::hash<std::string>{}(name_)),
+      is_persistent_device_(is_persistent_device),
+      slots_(TableSize(properties.size())) {
+  size_t mask = slots_.size() - 1;
+  for (const auto& property : properties) {
+    size_t hash = std::hash<std::string>{}(property.first);
+    // property names are unique within a section, so there is no need to look for an existing slot
+    size_t i = hash & mask;
+    while (slots_[i].property != nullptr) {
+      i = (i + 1) & mask;
+    }
+    slots_[i].hash = hash;
+    slots_[i].property = property_name_pool->Intern(property.first);
+    slots_[i].value = property.second;
+  }
+}
+
+const std::string* ConfigCacheIndex::Section::GetProperty(const std::string& property) const {
+  size_t hash = std::hash<std::string>{}(property);
+  size_t mask = slots_.size() - 1;
+  for (size_t i = hash & mask; slots_[i].property != nullptr; i = (i + 1) & mask) {
+    if (slots_[i].hash == hash && *slots_[i].property == property) {
+      return &slots_[i].value;
+    }
+  }
+  return nullptr;
+}
+
+ConfigCacheIndex::ConfigCacheIndex() : buckets_(kMinNumBuckets) {}
+
+ConfigCacheIndex::ConfigCacheIndex(const std::vector<std::shared_ptr<const Section>>& sections) {
+  Build(sections);
+}
+
+ConfigCacheIndex::ConfigCacheIndex(
+    const ConfigCacheIndex& previous, const std::string& section_name, std::shared_ptr<const Section> section) {
+  if (section != nullptr && NumBuckets(previous.size_ + 1) > previous.buckets_.size()) {
+    // Redistribute all the sections over more buckets
+    std::vector<std::shared_ptr<const Section>> sections;
+    sections.reserve(previous.size_ + 1);
+    for (const auto& bucket : previous.buckets_) {
+      if (bucket == nullptr) {
+        continue;
+      }
+      for (const auto& previous_section : *bucket) {
+        if (previous_section->GetName() != section_name) {
+          sections.push_back(previous_section);
+        }
+      }
+    }
+    if (section != nullptr) {
+      sections.push_back(std::move(section));
+    }
+    Build(sections);
+    return;
+  }
+
+  buckets_ = previous.buckets_;
+  size_ = previous.size_;
+  size_t hash = std::hash<std::string>{}(section_name);
+  auto& bucket = buckets_[GetBucketIndex(hash)];
+  auto new_bucket = std::make_shared<Bucket>();
+  if (bucket != nullptr) {
+    new_bucket->reserve(bucket->size() + 1);
+    for (const auto& previous_section : *bucket) {
+      if (previous_section->GetHash() == hash && previous_section->GetName() == section_name) {
+        size_--;
+      } else {
+        new_bucket->push_back(previous_section);
+      }
+    }
+  }
+  if (section != nullptr) {
+    new_bucket->push_back(std::move(section));
+    size_++;
+  }
+  if (new_bucket->empty()) {
+    bucket.reset();
+  } else {
+    bucket = std::move(new_bucket);
+  }
+}
+
+const ConfigCacheIndex::Section* ConfigCacheIndex::Find(const std::string& section_name) const {
+  size_t hash = std::hash<std::string>{}(section_name);
+  const auto& bucket = buckets_[GetBucketIndex(hash)];
+  if (bucket == nullptr) {
+    return nullptr;
+  }
+  for (const auto& section : *bucket) {
+    if (section->GetHash() == hash && section->GetName() == section_name) {
+      return section.get();
+    }
+  }
+  return nullptr;
+}
+
+void ConfigCacheIndex::Build(const std::vector<std::shared_ptr<const Section>>& sections) {
+  std::vector<std::shared_ptr<Bucket>> buckets(NumBuckets(sections.size()));
+  for (const auto& section : sections) {
+    auto& bucket = buckets[section->GetHash() & (buckets.size() - 1)];
+    if (bucket == nullptr) {
+      bucket = std::make_shared<Bucket>();
+    }
+    bucket->push_back(section);
+  }
+  buckets_.assign(buckets.begin(), buckets.end());
+  size_ = sections.size();
+}
+
+}  // namespace storage
+}  // namespace bluetooth
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/list_map.h"
+
+namespace bluetooth {
+namespace storage {
+
+// Gives out a single shared copy of each property name, as all device sections repeat the same few of them
+//
+// NOT THREAD SAFE
+class PropertyNamePool {
+ public:
+  std::shared_ptr<const std::string> Intern(const std::string& name);
+
+ private:
+  std::unordered_map<std::string, std::shared_ptr<const std::string>> names_;
+};
+
+// An immutable index of config sections, used by ConfigCache to look up properties without holding its mutex
+//
+// Sections are spread over a power of two number of buckets by the hash of their name, and the properties of each
+// section are stored in an open addressing hash table with linear probing. Since an index is never modified once built,
+// changing a section means building a new index. The new index copies the bucket array and the bucket of the changed
+// section, and shares all the other buckets with the index it was built from.
+//
+// Immutable, hence thread safe
+class ConfigCacheIndex {
+ public:
+  class Section {
+   public:
+    Section(
+        std::string name,
+        bool is_persistent_device,
+        const common::ListMap<std::string, std::string>& properties,
+        PropertyNamePool* property_name_pool);
+
+    const std::string& GetName() const {
+      return name_;
+    }
+    size_t GetHash() const {
+      return hash_;
+    }
+    bool IsPersistentDevice() const {
+      return is_persistent_device_;
+    }
+    // Return the value of |property|, or nullptr if this section does not have it
+    const std::string* GetProperty(const std::string& property) const;
+
+   private:
+    struct Slot {
+      size_t hash = 0;
+      std::shared_ptr<const std::string> property;
+      std::string value;
+    };
+
+    std::string name_;
+    size_t hash_;
+    bool is_persistent_device_;
+    std::vector<Slot> slots_;
+  };
+
+  // An empty index
+  ConfigCacheIndex();
+  // An index with |sections|
+  explicit ConfigCacheIndex(const std::vector<std::shared_ptr<const Section>>& sections);
+  // A copy of |previous| where the section named |section_name| is replaced by |section|, or removed if it is nullptr
+  ConfigCacheIndex(
+      const ConfigCacheIndex& previous, const std::string& section_name, std::shared_ptr<const Section> section);
+
+  // Return the section named |section_name|, or nullptr if the index does not have it
+  const Section* Find(const std::string& section_name) const;
+
+  size_t GetNumBuckets() const {
+    return buckets_.size();
+  }
+
+ private:
+  using Bucket = std::vector<std::shared_ptr<const Section>>;
+
+  // Spread |sections| over new buckets
+  void Build(const std::vector<std::shared_ptr<const Section>>& sections);
+  size_t GetBucketIndex(size_t hash) const {
+    return hash & (buckets_.size() - 1);
+  }
+
+  // An empty bucket is nullptr
+  std::vector<std::shared_ptr<const Bucket>> buckets_;
+  size_t size_ = 0;
+};
+
+}  // namespace storage
+}  // namespace bluetooth
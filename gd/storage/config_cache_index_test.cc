@@ -0,0 +1,133 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/config_cache_index.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace testing {
+
+using bluetooth::common::ListMap;
+using bluetooth::storage::ConfigCacheIndex;
+using bluetooth::storage::PropertyNamePool;
+
+namespace {
+
+std::shared_ptr<const ConfigCacheIndex::Section> MakeSection(
+    const std::string& name, int num_properties, PropertyNamePool* pool) {
+  ListMap<std::string, std::string> properties;
+  for (int i = 0; i < num_properties; i++) {
+    properties.insert_or_assign("Property" + std::to_string(i), name + "Value" + std::to_string(i));
+  }
+  return std::make_shared<ConfigCacheIndex::Section>(name, true, properties, pool);
+}
+
+}  // namespace
+
+TEST(ConfigCacheIndexTest, empty_index_test) {
+  ConfigCacheIndex index;
+  ASSERT_EQ(index.Find("A"), nullptr);
+}
+
+TEST(ConfigCacheIndexTest, section_get_property_test) {
+  PropertyNamePool pool;
+  auto section = MakeSection("A", 100, &pool);
+  ASSERT_EQ(section->GetName(), "A");
+  ASSERT_TRUE(section->IsPersistentDevice());
+  for (int i = 0; i < 100; i++) {
+    auto value = section->GetProperty("Property" + std::to_string(i));
+    ASSERT_NE(value, nullptr);
+    ASSERT_EQ(*value, "AValue" + std::to_string(i));
+  }
+  ASSERT_EQ(section->GetProperty("Property100"), nullptr);
+  ASSERT_EQ(section->GetProperty(""), nullptr);
+}
+
+TEST(ConfigCacheIndexTest, property_names_are_interned_test) {
+  PropertyNamePool pool;
+  auto name = pool.Intern("LinkKey");
+  ASSERT_EQ(pool.Intern("LinkKey"), name);
+  ASSERT_NE(pool.Intern("Name"), name);
+  ASSERT_EQ(*name, "LinkKey");
+}
+
+TEST(ConfigCacheIndexTest, find_section_test) {
+  PropertyNamePool pool;
+  std::vector<std::shared_ptr<const ConfigCacheIndex::Section>> sections;
+  for (int i = 0; i < 50; i++) {
+    sections.push_back(MakeSection("Section" + std::to_string(i), 3, &pool));
+  }
+  ConfigCacheIndex index(sections);
+  for (int i = 0; i < 50; i++) {
+    auto section = index.Find("Section" + std::to_string(i));
+    ASSERT_NE(section, nullptr);
+    ASSERT_EQ(section, sections[i].get());
+  }
+  ASSERT_EQ(index.Find("Section50"), nullptr);
+}
+
+TEST(ConfigCacheIndexTest, replace_and_remove_section_test) {
+  PropertyNamePool pool;
+  auto section_a = MakeSection("A", 1, &pool);
+  auto section_b = MakeSection("B", 1, &pool);
+  ConfigCacheIndex index({section_a, section_b});
+
+  // Sections that did not change are shared with the previous index
+  auto new_section_a = MakeSection("A", 2, &pool);
+  ConfigCacheIndex replaced(index, "A", new_section_a);
+  ASSERT_EQ(replaced.Find("A"), new_section_a.get());
+  ASSERT_EQ(replaced.Find("B"), section_b.get());
+  ASSERT_EQ(index.Find("A"), section_a.get());
+
+  ConfigCacheIndex removed(replaced, "A", nullptr);
+  ASSERT_EQ(removed.Find("A"), nullptr);
+  ASSERT_EQ(removed.Find("B"), section_b.get());
+
+  auto section_c = MakeSection("C", 1, &pool);
+  ConfigCacheIndex added(removed, "C", section_c);
+  ASSERT_EQ(added.Find("B"), section_b.get());
+  ASSERT_EQ(added.Find("C"), section_c.get());
+}
+
+TEST(ConfigCacheIndexTest, add_many_sections_test) {
+  PropertyNamePool pool;
+  ConfigCacheIndex empty;
+  auto index = std::make_unique<ConfigCacheIndex>(empty, "Section0", MakeSection("Section0", 1, &pool));
+  size_t num_buckets = index->GetNumBuckets();
+  // Enough sections to make the index grow its buckets a few times
+  for (int i = 1; i < 500; i++) {
+    auto name = "Section" + std::to_string(i);
+    index = std::make_unique<ConfigCacheIndex>(*index, name, MakeSection(name, 1, &pool));
+  }
+  ASSERT_GT(index->GetNumBuckets(), num_buckets);
+  for (int i = 0; i < 500; i++) {
+    auto section = index->Find("Section" + std::to_string(i));
+    ASSERT_NE(section, nullptr);
+    ASSERT_EQ(section->GetName(), "Section" + std::to_string(i));
+  }
+
+  for (int i = 0; i < 500; i += 2) {
+    index = std::make_unique<ConfigCacheIndex>(*index, "Section" + std::to_string(i), nullptr);
+  }
+  for (int i = 0; i < 500; i++) {
+    ASSERT_EQ(index->Find("Section" + std::to_string(i)) != nullptr, i % 2 == 1);
+  }
+}
+
+}  // namespace testing
@@ -19,7 +19,10 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <cstdio>
+#include <thread>
+#include <vector>
 
 #include "hci/enum_helper.h"
 #include "storage/device.h"
@@ -337,4 +340,67 @@ TEST(ConfigCacheTest, test_empty_persistent_properties) {
   ASSERT_THAT(config.GetPersistentSections(), ElementsAre());
 }
 
-}  // namespace testing
\ No newline at end of file
+TEST(ConfigCacheTest, concurrent_read_write_test) {
+  ConfigCache config(100, Device::kLinkKeyProperties);
+  config.SetProperty("AA:BB:CC:DD:EE:FF", "LinkKey", "AABBAABBCCDDEE");
+  config.SetProperty("AA:BB:CC:DD:EE:FF", "Name", "0");
+  std::atomic<bool> done = false;
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&config, &done] {
+      while (!done) {
+        ASSERT_TRUE(config.IsPersistentSection("AA:BB:CC:DD:EE:FF"));
+        ASSERT_TRUE(config.HasProperty("AA:BB:CC:DD:EE:FF", "LinkKey"));
+        ASSERT_TRUE(config.GetProperty("AA:BB:CC:DD:EE:FF", "Name"));
+        config.GetProperty(GetTestAddress(1), "Name");
+      }
+    });
+  }
+  for (int i = 0; i < 1000; i++) {
+    config.SetProperty("AA:BB:CC:DD:EE:FF", "Name", std::to_string(i));
+    config.SetProperty(GetTestAddress(1), "LinkKey", "AABBAABBCCDDEE");
+    config.RemoveSection(GetTestAddress(1));
+  }
+  done = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  ASSERT_THAT(config.GetProperty("AA:BB:CC:DD:EE:FF", "Name"), Optional(StrEq("999")));
+  ASSERT_FALSE(config.HasSection(GetTestAddress(1)));
+}
+
+TEST(ConfigCacheTest, concurrent_writers_test) {
+  constexpr int kNumReaders = 4;
+  ConfigCache config(100, Device::kLinkKeyProperties);
+  config.SetProperty("AA:BB:CC:DD:EE:FF", "LinkKey", "AABBAABBCCDDEE");
+  std::atomic<bool> done = false;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumReaders; i++) {
+    threads.emplace_back([&config, &done] {
+      while (!done) {
+        ASSERT_TRUE(config.HasProperty("AA:BB:CC:DD:EE:FF", "LinkKey"));
+        config.GetProperty("AA:BB:CC:DD:EE:FF", "Name");
+        config.HasSection(GetTestAddress(1));
+      }
+    });
+  }
+  // A second writer, so that indexes are also replaced while the first one waits for readers
+  threads.emplace_back([&config] {
+    for (int i = 0; i < 1000; i++) {
+      config.SetProperty(GetTestAddress(1), "LinkKey", "AABBAABBCCDDEE");
+      config.RemoveSection(GetTestAddress(1));
+    }
+  });
+  for (int i = 0; i < 1000; i++) {
+    config.SetProperty("AA:BB:CC:DD:EE:FF", "Name", std::to_string(i));
+    // A write is visible to lookups as soon as it returns
+    ASSERT_THAT(config.GetProperty("AA:BB:CC:DD:EE:FF", "Name"), Optional(StrEq(std::to_string(i))));
+  }
+  done = true;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_FALSE(config.HasSection(GetTestAddress(1)));
+}
+
+}  // namespace testing
@@ -0,0 +1,244 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/config_journal.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <queue>
+#include <utility>
+
+#include "os/files.h"
+#include "os/log.h"
+#include "os/utils.h"
+
+namespace bluetooth {
+namespace storage {
+
+namespace {
+
+constexpr char kJournalHeaderPrefix[] = "btconfig-journal 1 ";
+
+constexpr char kSetEntry = 'S';
+constexpr char kRemovePropertyEntry = 'P';
+constexpr char kRemoveSectionEntry = 'R';
+
+// FNV-1a, enough to tell config files apart, and stable across builds unlike std::hash
+uint64_t HashConfig(const std::string& config) {
+  uint64_t hash = 0xcbf29ce484222325;
+  for (unsigned char c : config) {
+    hash ^= c;
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
+
+std::string MakeHeader(const std::string& base_config) {
+  char hash[17];
+  std::snprintf(hash, sizeof(hash), "%016" PRIx64, HashConfig(base_config));
+  return std::string(kJournalHeaderPrefix) + hash + "\n";
+}
+
+void AppendField(std::string& out, const std::string& field) {
+  out += std::to_string(field.size());
+  out += ':';
+  out += field;
+}
+
+// Read a field written by AppendField() at |pos|, advancing |pos| past it
+std::optional<std::string> ReadField(const std::string& in, size_t& pos) {
+  size_t separator = in.find(':', pos);
+  if (separator == std::string::npos || separator == pos || separator - pos > 9) {
+    return std::nullopt;
+  }
+  size_t length = 0;
+  for (size_t i = pos; i < separator; i++) {
+    if (in[i] < '0' || in[i] > '9') {
+      return std::nullopt;
+    }
+    length = length * 10 + (in[i] - '0');
+  }
+  if (length > in.size() - separator - 1) {
+    return std::nullopt;
+  }
+  pos = separator + 1 + length;
+  return in.substr(separator + 1, length);
+}
+
+bool WriteAll(int fd, const std::string& data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t result;
+    RUN_NO_INTR(result = write(fd, data.data() + written, data.size() - written));
+    if (result < 0) {
+      return false;
+    }
+    written += result;
+  }
+  return true;
+}
+
+}  // namespace
+
+ConfigJournal::ConfigJournal(std::string path) : path_(std::move(path)) {
+  ASSERT(!path_.empty());
+}
+
+void ConfigJournal::Append(const MutationEntry& entry) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  switch (entry.entry_type) {
+    case MutationEntry::EntryType::SET:
+      pending_entries_ += kSetEntry;
+      break;
+    case MutationEntry::EntryType::REMOVE_PROPERTY:
+      pending_entries_ += kRemovePropertyEntry;
+      break;
+    case MutationEntry::EntryType::REMOVE_SECTION:
+      pending_entries_ += kRemoveSectionEntry;
+      break;
+      // do not write a default case so that when a new enum is defined, compilation would fail automatically
+  }
+  pending_entries_ += ' ';
+  AppendField(pending_entries_, entry.section);
+  AppendField(pending_entries_, entry.property);
+  AppendField(pending_entries_, entry.value);
+  pending_entries_ += '\n';
+}
+
+void ConfigJournal::ClearPendingEntries() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  pending_entries_.clear();
+}
+
+bool ConfigJournal::Flush() {
+  std::string entries;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!has_base_config_) {
+      return false;
+    }
+    if (pending_entries_.empty()) {
+      return true;
+    }
+    entries.swap(pending_entries_);
+  }
+  int fd;
+  RUN_NO_INTR(fd = open(path_.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC));
+  if (fd < 0) {
+    LOG_ERROR("unable to open journal '%s', error: %s", path_.c_str(), strerror(errno));
+  } else {
+    bool success = WriteAll(fd, entries) && fdatasync(fd) == 0;
+    if (!success) {
+      LOG_ERROR("unable to append to journal '%s', error: %s", path_.c_str(), strerror(errno));
+    }
+    close(fd);
+    if (success) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      file_size_ += entries.size();
+      return true;
+    }
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  // The journal may now end with a torn entry, hiding anything appended after it, so stop appending until Reset()
+  has_base_config_ = false;
+  pending_entries_.insert(0, entries);
+  return false;
+}
+
+bool ConfigJournal::Reset(const std::string& base_config) {
+  std::string header = MakeHeader(base_config);
+  std::lock_guard<std::mutex> lock(mutex_);
+  has_base_config_ = os::WriteToFile(path_, header);
+  file_size_ = has_base_config_ ? header.size() : 0;
+  return has_base_config_;
+}
+
+size_t ConfigJournal::Size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return file_size_ + pending_entries_.size();
+}
+
+bool ConfigJournal::Delete() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  has_base_config_ = false;
+  file_size_ = 0;
+  pending_entries_.clear();
+  if (!os::FileExists(path_)) {
+    return true;
+  }
+  return os::RemoveFile(path_);
+}
+
+size_t ConfigJournal::Replay(const std::string& path, const std::string& base_config, ConfigCache* cache) {
+  ASSERT(cache != nullptr);
+  if (!os::FileExists(path)) {
+    return 0;
+  }
+  auto journal = os::ReadSmallFile(path);
+  if (!journal) {
+    return 0;
+  }
+  std::string header = MakeHeader(base_config);
+  if (journal->compare(0, header.size(), header) != 0) {
+    LOG_INFO("journal '%s' does not apply to the loaded config, skipping it", path.c_str());
+    return 0;
+  }
+  std::queue<MutationEntry> entries;
+  size_t pos = header.size();
+  while (pos < journal->size()) {
+    size_t entry_start = pos;
+    if (journal->size() - pos < 2 || (*journal)[pos + 1] != ' ') {
+      break;
+    }
+    char entry_type = (*journal)[pos];
+    pos += 2;
+    auto section = ReadField(*journal, pos);
+    auto property = section ? ReadField(*journal, pos) : std::nullopt;
+    auto value = property ? ReadField(*journal, pos) : std::nullopt;
+    if (!value || pos >= journal->size() || (*journal)[pos] != '\n' || section->empty()) {
+      pos = entry_start;
+      break;
+    }
+    if (entry_type == kSetEntry && !property->empty()) {
+      entries.push(MutationEntry::Set(
+          MutationEntry::PropertyType::NORMAL, std::move(*section), std::move(*property), std::move(*value)));
+    } else if (entry_type == kRemovePropertyEntry && !property->empty()) {
+      entries.push(
+          MutationEntry::Remove(MutationEntry::PropertyType::NORMAL, std::move(*section), std::move(*property)));
+    } else if (entry_type == kRemoveSectionEntry) {
+      entries.push(MutationEntry::Remove(MutationEntry::PropertyType::NORMAL, std::move(*section)));
+    } else {
+      pos = entry_start;
+      break;
+    }
+    pos++;
+  }
+  if (pos < journal->size()) {
+    LOG_WARN("journal '%s' has a torn entry at offset %zu, ignoring the rest of it", path.c_str(), pos);
+  }
+  size_t num_entries = entries.size();
+  cache->Commit(entries);
+  return num_entries;
+}
+
+}  // namespace storage
+}  // namespace bluetooth
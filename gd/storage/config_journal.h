@@ -0,0 +1,75 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+
+#include "storage/config_cache.h"
+#include "storage/mutation_entry.h"
+
+namespace bluetooth {
+namespace storage {
+
+// An append-only log of the changes made to the persistent sections of a ConfigCache since it was last written to a
+// config file
+//
+// Appending a few entries costs the same no matter how many devices are bonded, unlike rewriting the config file.
+// Hence, changes are journaled and the journal is only compacted into the config file once it grows large enough.
+//
+// The journal starts with a header identifying the content of the config file it applies to, so that it is never
+// replayed on top of a config file that already contains its entries, or that predates them. Each entry is a line of
+// length prefixed fields, and an entry torn by a crash ends the journal.
+//
+// This class is thread safe
+class ConfigJournal {
+ public:
+  explicit ConfigJournal(std::string path);
+
+  // no copy
+  ConfigJournal(const ConfigJournal&) = delete;
+  ConfigJournal& operator=(const ConfigJournal&) = delete;
+
+  // Queue |entry| to be written to disk by the next Flush()
+  void Append(const MutationEntry& entry);
+  // Drop queued entries, e.g. because a config about to be written to disk already contains them
+  void ClearPendingEntries();
+  // Write queued entries to the end of the journal file and sync it to disk. Return false if the write failed or if
+  // the journal file does not apply to any config file yet, in which case the queued entries are kept
+  bool Flush();
+  // Replace the journal file by an empty journal applying to a config file whose content is |base_config|. Entries
+  // queued in the meantime are kept
+  bool Reset(const std::string& base_config);
+  // Size in bytes of the journal file plus the queued entries
+  size_t Size() const;
+  bool Delete();
+
+  // Commit the entries of the journal file at |path| to |cache| if the journal applies to a config file whose content
+  // is |base_config|. Return the number of entries committed
+  static size_t Replay(const std::string& path, const std::string& base_config, ConfigCache* cache);
+
+ private:
+  mutable std::mutex mutex_;
+  std::string path_;
+  std::string pending_entries_;
+  size_t file_size_ = 0;
+  // Whether the journal file on disk was created by Reset() and can be appended to
+  bool has_base_config_ = false;
+};
+
+}  // namespace storage
+}  // namespace bluetooth
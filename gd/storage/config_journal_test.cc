@@ -0,0 +1,176 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/config_journal.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <filesystem>
+
+#include "os/files.h"
+#include "storage/device.h"
+#include "storage/legacy_config_file.h"
+
+namespace testing {
+
+using bluetooth::os::ReadSmallFile;
+using bluetooth::os::WriteToFile;
+using bluetooth::storage::ConfigCache;
+using bluetooth::storage::ConfigJournal;
+using bluetooth::storage::Device;
+using bluetooth::storage::LegacyConfigFile;
+using bluetooth::storage::MutationEntry;
+
+class ConfigJournalTest : public Test {
+ protected:
+  void SetUp() override {
+    temp_journal_ = std::filesystem::temp_directory_path() / "temp_config.journal";
+    std::filesystem::remove(temp_journal_);
+  }
+
+  void TearDown() override {
+    std::filesystem::remove(temp_journal_);
+  }
+
+  // Start journaling the persistent changes made to |config| on top of its current content
+  void StartJournal(ConfigCache& config, ConfigJournal& journal) {
+    base_config_ = config.SerializeToLegacyFormat();
+    ASSERT_TRUE(journal.Reset(base_config_));
+    config.SetPersistentMutationCallback([&journal](const MutationEntry& entry) { journal.Append(entry); });
+  }
+
+  // Rebuild a config from |base_config_| and the journal, as it would be loaded from disk
+  ConfigCache Replay(size_t expected_num_entries) {
+    auto temp_config = std::filesystem::temp_directory_path() / "temp_config.txt";
+    EXPECT_TRUE(WriteToFile(temp_config.string(), base_config_));
+    auto config = LegacyConfigFile::FromPath(temp_config.string()).Read(100);
+    std::filesystem::remove(temp_config);
+    EXPECT_TRUE(config);
+    EXPECT_EQ(ConfigJournal::Replay(temp_journal_.string(), base_config_, &config.value()), expected_num_entries);
+    return std::move(config.value());
+  }
+
+  std::filesystem::path temp_journal_;
+  std::string base_config_;
+};
+
+TEST_F(ConfigJournalTest, replay_reproduces_persistent_changes_test) {
+  ConfigCache config(100, Device::kLinkKeyProperties);
+  config.SetProperty("Adapter", "Address", "01:02:03:ab:cd:ef");
+  config.SetProperty("AA:BB:CC:DD:EE:FF", "LinkKey", "AABBAABBCCDDEE");
+  ConfigJournal journal(temp_journal_.string());
+  StartJournal(config, journal);
+
+  config.SetProperty("Adapter", "Name", "name with = and spaces ");
+  config.SetProperty("AA:BB:CC:DD:EE:FF", "Name", "foo");
+  // Properties of a temporary device are journaled when it becomes persistent
+  config.SetProperty("CC:DD:EE:FF:00:11", "Name", "bar");
+  config.SetProperty("CC:DD:EE:FF:00:11", "LinkKey", "CCDDCCDD");
+  config.SetProperty("11:22:33:44:55:66", "Name", "never paired");
+  config.RemoveProperty("Adapter", "Address");
+  config.RemoveSection("AA:BB:CC:DD:EE:FF");
+  config.FixDeviceTypeInconsistencies();
+  ASSERT_TRUE(journal.Flush());
+
+  auto replayed = Replay(7);
+  ASSERT_EQ(replayed.SerializeToLegacyFormat(), config.SerializeToLegacyFormat());
+  ASSERT_THAT(replayed.GetProperty("CC:DD:EE:FF:00:11", "Name"), Optional(StrEq("bar")));
+  ASSERT_FALSE(replayed.HasSection("11:22:33:44:55:66"));
+}
+
+TEST_F(ConfigJournalTest, unpaired_device_is_not_replayed_test) {
+  ConfigCache config(100, Device::kLinkKeyProperties);
+  config.SetProperty("AA:BB:CC:DD:EE:FF", "Name", "foo");
+  config.SetProperty("AA:BB:CC:DD:EE:FF", "LinkKey", "AABBAABBCCDDEE");
+  ConfigJournal journal(temp_journal_.string());
+  StartJournal(config, journal);
+
+  config.RemoveProperty("AA:BB:CC:DD:EE:FF", "LinkKey");
+  ASSERT_TRUE(journal.Flush());
+
+  auto replayed = Replay(1);
+  ASSERT_THAT(replayed.GetPersistentSections(), IsEmpty());
+  ASSERT_EQ(replayed.SerializeToLegacyFormat(), config.SerializeToLegacyFormat());
+}
+
+TEST_F(ConfigJournalTest, flush_without_base_config_test) {
+  ConfigJournal journal(temp_journal_.string());
+  journal.Append(MutationEntry::Set(MutationEntry::PropertyType::NORMAL, "A", "B", "C"));
+  ASSERT_FALSE(journal.Flush());
+  ASSERT_FALSE(std::filesystem::exists(temp_journal_));
+
+  // Queued entries are kept until a base config is set
+  ASSERT_TRUE(journal.Reset(""));
+  ASSERT_TRUE(journal.Flush());
+  ConfigCache config(100, Device::kLinkKeyProperties);
+  ASSERT_EQ(ConfigJournal::Replay(temp_journal_.string(), "", &config), 1u);
+  ASSERT_THAT(config.GetProperty("A", "B"), Optional(StrEq("C")));
+}
+
+TEST_F(ConfigJournalTest, clear_pending_entries_test) {
+  ConfigJournal journal(temp_journal_.string());
+  ASSERT_TRUE(journal.Reset(""));
+  size_t empty_size = journal.Size();
+  journal.Append(MutationEntry::Set(MutationEntry::PropertyType::NORMAL, "A", "B", "C"));
+  ASSERT_GT(journal.Size(), empty_size);
+  journal.ClearPendingEntries();
+  ASSERT_EQ(journal.Size(), empty_size);
+  ASSERT_TRUE(journal.Flush());
+
+  ConfigCache config(100, Device::kLinkKeyProperties);
+  ASSERT_EQ(ConfigJournal::Replay(temp_journal_.string(), "", &config), 0u);
+}
+
+TEST_F(ConfigJournalTest, journal_for_other_config_is_not_replayed_test) {
+  ConfigJournal journal(temp_journal_.string());
+  ASSERT_TRUE(journal.Reset("[A]\nB = C\n\n"));
+  journal.Append(MutationEntry::Set(MutationEntry::PropertyType::NORMAL, "A", "B", "D"));
+  ASSERT_TRUE(journal.Flush());
+
+  ConfigCache config(100, Device::kLinkKeyProperties);
+  ASSERT_EQ(ConfigJournal::Replay(temp_journal_.string(), "[A]\nB = D\n\n", &config), 0u);
+  ASSERT_FALSE(config.HasSection("A"));
+  ASSERT_EQ(ConfigJournal::Replay(temp_journal_.string(), "[A]\nB = C\n\n", &config), 1u);
+  ASSERT_THAT(config.GetProperty("A", "B"), Optional(StrEq("D")));
+}
+
+TEST_F(ConfigJournalTest, torn_entry_ends_journal_test) {
+  ConfigJournal journal(temp_journal_.string());
+  ASSERT_TRUE(journal.Reset(""));
+  journal.Append(MutationEntry::Set(MutationEntry::PropertyType::NORMAL, "A", "B", "C"));
+  journal.Append(MutationEntry::Set(MutationEntry::PropertyType::NORMAL, "A", "D", "E"));
+  ASSERT_TRUE(journal.Flush());
+
+  // Drop the end of the last entry, as if the process died while appending it
+  auto content = ReadSmallFile(temp_journal_.string());
+  ASSERT_TRUE(content);
+  ASSERT_TRUE(WriteToFile(temp_journal_.string(), content->substr(0, content->size() - 2)));
+
+  ConfigCache config(100, Device::kLinkKeyProperties);
+  ASSERT_EQ(ConfigJournal::Replay(temp_journal_.string(), "", &config), 1u);
+  ASSERT_THAT(config.GetProperty("A", "B"), Optional(StrEq("C")));
+  ASSERT_FALSE(config.HasProperty("A", "D"));
+}
+
+TEST_F(ConfigJournalTest, missing_journal_test) {
+  ConfigCache config(100, Device::kLinkKeyProperties);
+  ASSERT_EQ(ConfigJournal::Replay(temp_journal_.string(), "", &config), 0u);
+  ConfigJournal journal(temp_journal_.string());
+  ASSERT_TRUE(journal.Delete());
+}
+
+}  // namespace testing
@@ -71,7 +71,11 @@ std::optional<ConfigCache> LegacyConfigFile::Read(size_t temp_devices_capacity)
 }
 
 bool LegacyConfigFile::Write(const ConfigCache& cache) {
-  return os::WriteToFile(path_, cache.SerializeToLegacyFormat());
+  return Write(cache.SerializeToLegacyFormat());
+}
+
+bool LegacyConfigFile::Write(const std::string& serialized_config) {
+  return os::WriteToFile(path_, serialized_config);
 }
 
 bool LegacyConfigFile::Delete() {
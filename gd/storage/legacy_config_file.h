@@ -32,6 +32,8 @@ class LegacyConfigFile {
   explicit LegacyConfigFile(std::string path);
   std::optional<ConfigCache> Read(size_t temp_devices_capacity);
   bool Write(const ConfigCache& cache);
+  // Write a config already serialized by ConfigCache::SerializeToLegacyFormat()
+  bool Write(const std::string& serialized_config);
   bool Delete();
 
  private:
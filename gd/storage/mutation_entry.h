@@ -104,6 +104,7 @@ class MutationEntry {
 
  private:
   friend class ConfigCache;
+  friend class ConfigJournal;
   friend class Mutation;
 
   MutationEntry(
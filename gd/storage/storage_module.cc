@@ -16,6 +16,7 @@
 
 #include "storage/storage_module.h"
 
+#include <algorithm>
 #include <chrono>
 #include <ctime>
 #include <iomanip>
@@ -29,6 +30,7 @@
 #include "os/parameter_provider.h"
 #include "os/system_properties.h"
 #include "storage/config_cache.h"
+#include "storage/config_journal.h"
 #include "storage/legacy_config_file.h"
 #include "storage/mutation.h"
 
@@ -48,6 +50,9 @@ static const std::chrono::milliseconds kDefaultConfigSaveDelay = std::chrono::mi
 // Writing a config to disk takes a minimum 10 ms on a decent x86_64 machine, and 20 ms if including backup file
 // The config saving delay must be bigger than this value to avoid overwhelming the disk
 static const std::chrono::milliseconds kMinConfigSaveDelay = std::chrono::milliseconds(20);
+// Changes are journaled until the journal grows bigger than the config file, or than this value for small configs, so
+// that compacting it costs at most as much disk writes as journaling did and replaying it at load time stays cheap
+static const size_t kMinJournalCompactionSize = 16 * 1024;
 
 const std::string StorageModule::kInfoSection = "Info";
 const std::string StorageModule::kFileSourceProperty = "FileSource";
@@ -69,6 +74,7 @@ StorageModule::StorageModule(
       is_single_user_mode_(is_single_user_mode) {
   // e.g. "/data/misc/bluedroid/bt_config.conf" to "/data/misc/bluedroid/bt_config.bak"
   config_backup_path_ = config_file_path_.substr(0, config_file_path_.find_last_of('.')) + ".bak";
+  config_journal_path_ = config_file_path_.substr(0, config_file_path_.find_last_of('.')) + ".journal";
   ASSERT_LOG(
       config_save_delay > kMinConfigSaveDelay,
       "Config save delay of %lld ms is not enough, must be at least %lld ms to avoid overwhelming the disk",
@@ -87,11 +93,16 @@ const ModuleFactory StorageModule::Factory = ModuleFactory([]() {
 });
 
 struct StorageModule::impl {
-  explicit impl(Handler* handler, ConfigCache cache, size_t in_memory_cache_size_limit)
-      : config_save_alarm_(handler), cache_(std::move(cache)), memory_only_cache_(in_memory_cache_size_limit, {}) {}
+  explicit impl(Handler* handler, ConfigCache cache, size_t in_memory_cache_size_limit, std::string journal_path)
+      : config_save_alarm_(handler),
+        cache_(std::move(cache)),
+        memory_only_cache_(in_memory_cache_size_limit, {}),
+        journal_(std::move(journal_path)) {}
   Alarm config_save_alarm_;
   ConfigCache cache_;
   ConfigCache memory_only_cache_;
+  ConfigJournal journal_;
+  size_t config_size_ = 0;
   bool has_pending_config_save_ = false;
 };
 
@@ -126,14 +137,32 @@ void StorageModule::SaveImmediately() {
     pimpl_->config_save_alarm_.Cancel();
     pimpl_->has_pending_config_save_ = false;
   }
+  // The journal has no base config until the first compaction after Start(), in which case Flush() fails
+  if (pimpl_->journal_.Size() < std::max(pimpl_->config_size_, kMinJournalCompactionSize) &&
+      pimpl_->journal_.Flush()) {
+    return;
+  }
+  Compact();
+}
+
+void StorageModule::Compact() {
+  // Entries journaled so far are part of the config serialized below. Entries journaled while it is being serialized
+  // may be part of it too, which is fine since replaying them again leads to the same config
+  pimpl_->journal_.ClearPendingEntries();
+  auto config = pimpl_->cache_.SerializeToLegacyFormat();
   // 1. rename old config to backup name
   if (os::FileExists(config_file_path_)) {
     ASSERT(os::RenameFile(config_file_path_, config_backup_path_));
   }
   // 2. write in-memory config to disk, if failed, backup can still be used
-  ASSERT(LegacyConfigFile::FromPath(config_file_path_).Write(pimpl_->cache_));
+  ASSERT(LegacyConfigFile::FromPath(config_file_path_).Write(config));
   // 3. now write back up to disk as well
-  ASSERT(LegacyConfigFile::FromPath(config_backup_path_).Write(pimpl_->cache_));
+  ASSERT(LegacyConfigFile::FromPath(config_backup_path_).Write(config));
+  // 4. start a new journal on top of it, the old one no longer applies and is ignored at load time until replaced
+  if (!pimpl_->journal_.Reset(config)) {
+    LOG_WARN("cannot reset config journal at %s, config will be compacted again", config_journal_path_.c_str());
+  }
+  pimpl_->config_size_ = config.size();
 }
 
 void StorageModule::ListDependencies(ModuleList* list) {
@@ -146,11 +175,22 @@ void StorageModule::Start() {
   if (os::GetSystemProperty(kFactoryResetProperty) == "true") {
     LegacyConfigFile::FromPath(config_file_path_).Delete();
     LegacyConfigFile::FromPath(config_backup_path_).Delete();
+    ConfigJournal(config_journal_path_).Delete();
   }
-  auto config = LegacyConfigFile::FromPath(config_file_path_).Read(temp_devices_capacity_);
+  // Read a config file, brought up to date with the changes journaled since it was written
+  auto read_config = [this](const std::string& path) {
+    auto config = LegacyConfigFile::FromPath(path).Read(temp_devices_capacity_);
+    auto base_config = config ? os::ReadSmallFile(path) : std::nullopt;
+    if (base_config) {
+      size_t num_entries = ConfigJournal::Replay(config_journal_path_, *base_config, &config.value());
+      LOG_INFO("replayed %zu journaled config changes on top of %s", num_entries, path.c_str());
+    }
+    return config;
+  };
+  auto config = read_config(config_file_path_);
   if (!config || !config->HasSection(kAdapterSection)) {
     LOG_WARN("cannot load config at %s, using backup at %s.", config_file_path_.c_str(), config_backup_path_.c_str());
-    config = LegacyConfigFile::FromPath(config_backup_path_).Read(temp_devices_capacity_);
+    config = read_config(config_backup_path_);
     file_source = "Backup";
   }
   if (!config || !config->HasSection(kAdapterSection)) {
@@ -177,13 +217,22 @@ void StorageModule::Start() {
   config->FixDeviceTypeInconsistencies();
   config->SetPersistentConfigChangedCallback([this] { this->CallOn(this, &StorageModule::SaveDelayed); });
   // TODO (b/158035889) Migrate metrics module to GD
-  pimpl_ = std::make_unique<impl>(GetHandler(), std::move(config.value()), temp_devices_capacity_);
+  pimpl_ = std::make_unique<impl>(
+      GetHandler(), std::move(config.value()), temp_devices_capacity_, config_journal_path_);
+  pimpl_->cache_.SetPersistentMutationCallback(
+      [journal = &pimpl_->journal_](const MutationEntry& entry) { journal->Append(entry); });
+  // The first save compacts the journal replayed above, along with the changes made to the config here
   SaveDelayed();
 }
 
 void StorageModule::Stop() {
   std::lock_guard<std::recursive_mutex> lock(mutex_);
-  SaveImmediately();
+  if (pimpl_->has_pending_config_save_) {
+    pimpl_->config_save_alarm_.Cancel();
+    pimpl_->has_pending_config_save_ = false;
+  }
+  // Leave a config file that is complete on its own behind while the stack is down
+  Compact();
   pimpl_.reset();
 }
 
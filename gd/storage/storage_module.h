@@ -121,10 +121,12 @@ class StorageModule : public bluetooth::Module {
   void SaveDelayed();
   // In some cases, one may want to save the config immediately to disk. Call this method with caution as it runs
   // immediately on the calling thread
+  // Changes are appended to the journal, unless it has outgrown the config file and is compacted into it instead
   void SaveImmediately();
 
   // Create the storage module where:
-  // - config_file_path is the path to the config file on disk, a .bak file will be created with the original
+  // - config_file_path is the path to the config file on disk, a .bak file will be created with the original, and
+  //   changes made since the config file was last written are journaled to a .journal file next to it
   // - config_save_delay is the duration after which to dump config to disk after SaveDelayed() is called
   // - temp_devices_capacity is the number of temporary, typically unpaired devices to hold in a memory based LRU
   // - is_restricted_mode and is_single_user_mode are flags from upper layer
@@ -136,11 +138,15 @@ class StorageModule : public bluetooth::Module {
       bool is_single_user_mode);
 
  private:
+  // Write the whole config to disk and start an empty journal on top of it
+  void Compact();
+
   struct impl;
   mutable std::recursive_mutex mutex_;
   std::unique_ptr<impl> pimpl_;
   std::string config_file_path_;
   std::string config_backup_path_;
+  std::string config_journal_path_;
   std::chrono::milliseconds config_save_delay_;
   size_t temp_devices_capacity_;
   bool is_restricted_mode_;
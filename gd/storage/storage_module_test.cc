@@ -30,6 +30,7 @@
 #include "module.h"
 #include "os/files.h"
 #include "storage/config_cache.h"
+#include "storage/config_journal.h"
 #include "storage/device.h"
 #include "storage/legacy_config_file.h"
 
@@ -38,6 +39,7 @@ namespace testing {
 using bluetooth::TestModuleRegistry;
 using bluetooth::hci::Address;
 using bluetooth::storage::ConfigCache;
+using bluetooth::storage::ConfigJournal;
 using bluetooth::storage::Device;
 using bluetooth::storage::LegacyConfigFile;
 using bluetooth::storage::StorageModule;
@@ -108,6 +110,7 @@ class StorageModuleTest : public Test {
     temp_dir_ = std::filesystem::temp_directory_path();
     temp_config_ = temp_dir_ / "temp_config.txt";
     temp_backup_config_ = temp_dir_ / "temp_config.bak";
+    temp_config_journal_ = temp_dir_ / "temp_config.journal";
     DeleteConfigFiles();
     ASSERT_FALSE(std::filesystem::exists(temp_config_));
     ASSERT_FALSE(std::filesystem::exists(temp_backup_config_));
@@ -124,11 +127,25 @@ class StorageModuleTest : public Test {
     if (std::filesystem::exists(temp_backup_config_)) {
       ASSERT_TRUE(std::filesystem::remove(temp_backup_config_));
     }
+    if (std::filesystem::exists(temp_config_journal_)) {
+      ASSERT_TRUE(std::filesystem::remove(temp_config_journal_));
+    }
+  }
+
+  // Read the config as saved on disk, i.e. the config file with the journal replayed on top of it
+  std::optional<ConfigCache> ReadSavedConfig() {
+    auto config = LegacyConfigFile::FromPath(temp_config_.string()).Read(10);
+    auto base_config = bluetooth::os::ReadSmallFile(temp_config_.string());
+    if (config && base_config) {
+      ConfigJournal::Replay(temp_config_journal_.string(), *base_config, &config.value());
+    }
+    return config;
   }
 
   std::filesystem::path temp_dir_;
   std::filesystem::path temp_config_;
   std::filesystem::path temp_backup_config_;
+  std::filesystem::path temp_config_journal_;
 };
 
 TEST_F(StorageModuleTest, empty_config_no_op_test) {
@@ -251,28 +268,28 @@ TEST_F(StorageModuleTest, save_config_test) {
   storage->GetConfigCachePublic()->SetProperty("01:02:03:ab:cd:ea", "name", "foo");
   ASSERT_THAT(storage->GetConfigCachePublic()->GetProperty("01:02:03:ab:cd:ea", "name"), Optional(StrEq("foo")));
   std::this_thread::sleep_for(kTestConfigSaveWaitDelay);
-  auto config = LegacyConfigFile::FromPath(temp_config_.string()).Read(10);
+  auto config = ReadSavedConfig();
   ASSERT_TRUE(config);
   ASSERT_THAT(config->GetProperty("01:02:03:ab:cd:ea", "name"), Optional(StrEq("foo")));
 
   // Remove a property
   storage->GetConfigCachePublic()->RemoveProperty("01:02:03:ab:cd:ea", "name");
   std::this_thread::sleep_for(kTestConfigSaveWaitDelay);
-  config = LegacyConfigFile::FromPath(temp_config_.string()).Read(10);
+  config = ReadSavedConfig();
   ASSERT_TRUE(config);
   ASSERT_FALSE(config->HasProperty("01:02:03:ab:cd:ea", "name"));
 
   // Remove a section
   storage->GetConfigCachePublic()->RemoveSection("01:02:03:ab:cd:ea");
   std::this_thread::sleep_for(kTestConfigSaveWaitDelay);
-  config = LegacyConfigFile::FromPath(temp_config_.string()).Read(10);
+  config = ReadSavedConfig();
   ASSERT_TRUE(config);
   ASSERT_FALSE(config->HasSection("01:02:03:ab:cd:ea"));
 
   // Add a section and save immediately
   storage->GetConfigCachePublic()->SetProperty("01:02:03:ab:cd:eb", "LinkKey", "123456");
   storage->SaveImmediatelyPublic();
-  config = LegacyConfigFile::FromPath(temp_config_.string()).Read(10);
+  config = ReadSavedConfig();
   ASSERT_TRUE(config);
   ASSERT_TRUE(config->HasSection("01:02:03:ab:cd:eb"));
 
@@ -283,6 +300,47 @@ TEST_F(StorageModuleTest, save_config_test) {
   ASSERT_TRUE(std::filesystem::exists(temp_config_));
 }
 
+TEST_F(StorageModuleTest, journal_replayed_after_crash_test) {
+  // Prepare config file
+  ASSERT_TRUE(bluetooth::os::WriteToFile(temp_config_.string(), kReadTestConfig));
+
+  // Set up
+  auto* storage = new TestStorageModule(temp_config_.string(), kTestConfigSaveDelay, 10, false, false);
+  TestModuleRegistry test_registry;
+  test_registry.InjectTestModule(&StorageModule::Factory, storage);
+  // Wait for the config loaded at start to be saved
+  std::this_thread::sleep_for(kTestConfigSaveWaitDelay);
+  auto compacted_config = bluetooth::os::ReadSmallFile(temp_config_.string());
+  ASSERT_TRUE(compacted_config);
+
+  // Changes are journaled instead of rewriting the config file
+  storage->GetConfigCachePublic()->SetProperty("01:02:03:ab:cd:ea", "name", "foo");
+  storage->GetConfigCachePublic()->SetProperty("01:02:03:ab:cd:eb", "LinkKey", "123456");
+  storage->SaveImmediatelyPublic();
+  ASSERT_THAT(bluetooth::os::ReadSmallFile(temp_config_.string()), Optional(StrEq(*compacted_config)));
+  auto journal = bluetooth::os::ReadSmallFile(temp_config_journal_.string());
+  ASSERT_TRUE(journal);
+
+  // Tear down, then restore the files as they were before, as if the stack had crashed instead
+  test_registry.StopAll();
+  ASSERT_TRUE(bluetooth::os::WriteToFile(temp_config_.string(), *compacted_config));
+  ASSERT_TRUE(bluetooth::os::WriteToFile(temp_config_journal_.string(), *journal));
+
+  // Changes are replayed when the config is loaded again
+  storage = new TestStorageModule(temp_config_.string(), kTestConfigSaveDelay, 10, false, false);
+  test_registry.InjectTestModule(&StorageModule::Factory, storage);
+  ASSERT_THAT(storage->GetConfigCachePublic()->GetProperty("01:02:03:ab:cd:ea", "name"), Optional(StrEq("foo")));
+  ASSERT_THAT(
+      storage->GetConfigCachePublic()->GetPersistentSections(), ElementsAre("01:02:03:ab:cd:ea", "01:02:03:ab:cd:eb"));
+  test_registry.StopAll();
+
+  // Stopping compacts the journal into the config file
+  auto config = LegacyConfigFile::FromPath(temp_config_.string()).Read(10);
+  ASSERT_TRUE(config);
+  ASSERT_THAT(config->GetProperty("01:02:03:ab:cd:ea", "name"), Optional(StrEq("foo")));
+  ASSERT_TRUE(config->HasSection("01:02:03:ab:cd:eb"));
+}
+
 TEST_F(StorageModuleTest, get_bonded_devices_test) {
   // Prepare config file
   ASSERT_TRUE(bluetooth::os::WriteToFile(temp_config_.string(), kReadTestConfig));
@@ -24,6 +24,7 @@
 #include "common/time_util.h"
 #include "device/include/controller.h"
 #include "gd/common/callback.h"
+#include "gd/hci/le_scanning_manager.h"
 #include "gd/neighbor/name.h"
 #include "gd/os/log.h"
 #include "gd/security/security_module.h"
@@ -31,11 +32,13 @@
 #include "main/shim/btm.h"
 #include "main/shim/btm_api.h"
 #include "main/shim/controller.h"
+#include "main/shim/entry.h"
 #include "main/shim/helpers.h"
 #include "main/shim/metric_id_api.h"
 #include "main/shim/shim.h"
 #include "main/shim/stack.h"
 #include "stack/btm/btm_int_types.h"
+#include "stack/include/btm_ble_api.h"
 #include "types/raw_address.h"
 
 using bluetooth::common::MetricIdAllocator;
@@ -1181,6 +1184,18 @@ uint8_t bluetooth::shim::BTM_BleMaxMultiAdvInstanceCount() {
   return Stack::GetInstance()->GetBtm()->GetNumberOfAdvertisingInstances();
 }
 
+void bluetooth::shim::BTM_BleGetVendorCapabilities(
+    tBTM_BLE_VSC_CB* p_cmn_vsc_cb) {
+  ::BTM_BleGetVendorCapabilities(p_cmn_vsc_cb);
+  uint8_t max_host_scan_filters =
+      bluetooth::shim::GetScanning()->GetMaxHostScanFilters();
+  if (max_host_scan_filters > 0) {
+    // The controller has no APCF, advertising reports are filtered on the host
+    p_cmn_vsc_cb->filter_support = 1;
+    p_cmn_vsc_cb->max_filter = max_host_scan_filters;
+  }
+}
+
 bool bluetooth::shim::BTM_BleLocalPrivacyEnabled(void) {
   return controller_get_interface()->supports_ble_privacy();
 }
@@ -35,11 +35,12 @@
 
 #include <hardware/bluetooth.h>
 
+#include <algorithm>
 #include <mutex>
+#include <vector>
 
 #include "osi/include/allocator.h"
 #include "osi/include/fixed_queue.h"
-#include "osi/include/list.h"
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 #include "osi/include/semaphore.h"
@@ -95,6 +96,8 @@ struct alarm_t {
   uint64_t deadline_ms;
   uint64_t prev_deadline_ms;  // Previous deadline - used for accounting of
                               // periodic timers
+  size_t heap_index;      // Position in |alarms|, or INVALID_HEAP_INDEX
+  uint64_t heap_sequence;  // Breaks deadline ties in scheduling order
   bool is_periodic;
   fixed_queue_t* queue;  // The processing queue to add this alarm to
   alarm_callback_t callback;
@@ -114,9 +117,14 @@ static const clockid_t CLOCK_ID = CLOCK_BOOTTIME;
 
 // This mutex ensures that the |alarm_set|, |alarm_cancel|, and alarm callback
 // functions execute serially and not concurrently. As a result, this mutex
-// also protects the |alarms| list.
+// also protects the |alarms| heap.
 static std::mutex alarms_mutex;
-static list_t* alarms;
+// Pending alarms, kept as a binary min-heap ordered by deadline. Every alarm
+// tracks its own position in |heap_index| so that it can be removed from the
+// middle of the heap without searching for it.
+static std::vector<alarm_t*>* alarms;
+static uint64_t alarms_sequence;
+static const size_t INVALID_HEAP_INDEX = SIZE_MAX;
 static timer_t timer;
 static timer_t wakeup_timer;
 static bool timer_set;
@@ -138,6 +146,9 @@ static void alarm_set_internal(alarm_t* alarm, uint64_t period_ms,
                                fixed_queue_t* queue, bool for_msg_loop);
 static void alarm_cancel_internal(alarm_t* alarm);
 static void remove_pending_alarm(alarm_t* alarm);
+static alarm_t* alarm_heap_front(void);
+static void alarm_heap_push(alarm_t* alarm);
+static void alarm_heap_remove(alarm_t* alarm);
 static void schedule_next_instance(alarm_t* alarm);
 static void reschedule_root_alarm(void);
 static void alarm_queue_ready(fixed_queue_t* queue, void* context);
@@ -175,6 +186,7 @@ static alarm_t* alarm_new_internal(const char* name, bool is_periodic) {
   std::shared_ptr<std::recursive_mutex> ptr(new std::recursive_mutex());
   ret->callback_mutex = ptr;
   ret->is_periodic = is_periodic;
+  ret->heap_index = INVALID_HEAP_INDEX;
   ret->stats.name = osi_strdup(name);
 
   ret->for_msg_loop = false;
@@ -259,8 +271,7 @@ void alarm_cancel(alarm_t* alarm) {
 // Internal implementation of canceling an alarm.
 // The caller must hold the |alarms_mutex|
 static void alarm_cancel_internal(alarm_t* alarm) {
-  bool needs_reschedule =
-      (!list_is_empty(alarms) && list_front(alarms) == alarm);
+  bool needs_reschedule = (alarm_heap_front() == alarm);
 
   remove_pending_alarm(alarm);
 
@@ -300,7 +311,10 @@ void alarm_cleanup(void) {
   semaphore_free(alarm_expired);
   alarm_expired = NULL;
 
-  list_free(alarms);
+  // Alarms still pending here must not point into a heap that may be
+  // recreated by a later lazy_initialize.
+  for (alarm_t* alarm : *alarms) alarm->heap_index = INVALID_HEAP_INDEX;
+  delete alarms;
   alarms = NULL;
 }
 
@@ -314,11 +328,7 @@ static bool lazy_initialize(void) {
 
   std::lock_guard<std::mutex> lock(alarms_mutex);
 
-  alarms = list_new(NULL);
-  if (!alarms) {
-    LOG_ERROR("%s unable to allocate alarm list.", __func__);
-    goto error;
-  }
+  alarms = new std::vector<alarm_t*>();
 
   if (!timer_create_internal(CLOCK_ID, &timer)) goto error;
   timer_initialized = true;
@@ -379,7 +389,7 @@ error:
 
   if (timer_initialized) timer_delete(timer);
 
-  list_free(alarms);
+  delete alarms;
   alarms = NULL;
 
   return false;
@@ -397,10 +407,84 @@ static uint64_t now_ms(void) {
   return (ts.tv_sec * 1000LL) + (ts.tv_nsec / 1000000LL);
 }
 
-// Remove alarm from internal alarm list and the processing queue
+// Returns true if |a| is due before |b|. Alarms with the same deadline are
+// ordered by when they were scheduled, so that they fire in that order.
+static bool alarm_precedes(const alarm_t* a, const alarm_t* b) {
+  if (a->deadline_ms != b->deadline_ms) return a->deadline_ms < b->deadline_ms;
+  return a->heap_sequence < b->heap_sequence;
+}
+
+static void alarm_heap_place(size_t index, alarm_t* alarm) {
+  (*alarms)[index] = alarm;
+  alarm->heap_index = index;
+}
+
+static void alarm_heap_sift_up(size_t index) {
+  alarm_t* alarm = (*alarms)[index];
+  while (index > 0) {
+    size_t parent = (index - 1) / 2;
+    if (!alarm_precedes(alarm, (*alarms)[parent])) break;
+    alarm_heap_place(index, (*alarms)[parent]);
+    index = parent;
+  }
+  alarm_heap_place(index, alarm);
+}
+
+static void alarm_heap_sift_down(size_t index) {
+  alarm_t* alarm = (*alarms)[index];
+  size_t size = alarms->size();
+  while (true) {
+    size_t child = 2 * index + 1;
+    if (child >= size) break;
+    if (child + 1 < size &&
+        alarm_precedes((*alarms)[child + 1], (*alarms)[child]))
+      child++;
+    if (!alarm_precedes((*alarms)[child], alarm)) break;
+    alarm_heap_place(index, (*alarms)[child]);
+    index = child;
+  }
+  alarm_heap_place(index, alarm);
+}
+
+// Returns the pending alarm with the earliest deadline, or NULL if there is
+// none. The caller must hold the |alarms_mutex|
+static alarm_t* alarm_heap_front(void) {
+  return alarms->empty() ? NULL : alarms->front();
+}
+
+// The caller must hold the |alarms_mutex|
+static void alarm_heap_push(alarm_t* alarm) {
+  CHECK(alarm->heap_index == INVALID_HEAP_INDEX);
+  alarm->heap_sequence = alarms_sequence++;
+  alarms->push_back(alarm);
+  alarm_heap_sift_up(alarms->size() - 1);
+}
+
+// Removes |alarm| from the heap if it is in it.
+// The caller must hold the |alarms_mutex|
+static void alarm_heap_remove(alarm_t* alarm) {
+  size_t index = alarm->heap_index;
+  if (index == INVALID_HEAP_INDEX) return;
+  alarm->heap_index = INVALID_HEAP_INDEX;
+
+  alarm_t* last = alarms->back();
+  alarms->pop_back();
+  if (last == alarm) return;
+
+  // Move the last alarm into the hole and restore the heap property in
+  // whichever direction it was broken
+  alarm_heap_place(index, last);
+  if (index > 0 && alarm_precedes(last, (*alarms)[(index - 1) / 2])) {
+    alarm_heap_sift_up(index);
+  } else {
+    alarm_heap_sift_down(index);
+  }
+}
+
+// Remove alarm from internal alarm heap and the processing queue
 // The caller must hold the |alarms_mutex|
 static void remove_pending_alarm(alarm_t* alarm) {
-  list_remove(alarms, alarm);
+  alarm_heap_remove(alarm);
 
   if (alarm->for_msg_loop) {
     alarm->closure.i.Cancel();
@@ -415,10 +499,9 @@ static void remove_pending_alarm(alarm_t* alarm) {
 
 // Must be called with |alarms_mutex| held
 static void schedule_next_instance(alarm_t* alarm) {
-  // If the alarm is currently set and it's at the start of the list,
+  // If the alarm is currently set and it's at the top of the heap,
   // we'll need to re-schedule since we've adjusted the earliest deadline.
-  bool needs_reschedule =
-      (!list_is_empty(alarms) && list_front(alarms) == alarm);
+  bool needs_reschedule = (alarm_heap_front() == alarm);
   if (alarm->callback) remove_pending_alarm(alarm);
 
   // Calculate the next deadline for this alarm
@@ -429,26 +512,12 @@ static void schedule_next_instance(alarm_t* alarm) {
         ((just_now_ms - alarm->creation_time_ms) % alarm->period_ms);
   alarm->deadline_ms = just_now_ms + (alarm->period_ms - ms_into_period);
 
-  // Add it into the timer list sorted by deadline (earliest deadline first).
-  if (list_is_empty(alarms) ||
-      ((alarm_t*)list_front(alarms))->deadline_ms > alarm->deadline_ms) {
-    list_prepend(alarms, alarm);
-  } else {
-    for (list_node_t* node = list_begin(alarms); node != list_end(alarms);
-         node = list_next(node)) {
-      list_node_t* next = list_next(node);
-      if (next == list_end(alarms) ||
-          ((alarm_t*)list_node(next))->deadline_ms > alarm->deadline_ms) {
-        list_insert_after(alarms, node, alarm);
-        break;
-      }
-    }
-  }
+  // Add it into the timer heap keyed by deadline (earliest deadline first).
+  alarm_heap_push(alarm);
 
   // If the new alarm has the earliest deadline, we need to re-evaluate our
   // schedule.
-  if (needs_reschedule ||
-      (!list_is_empty(alarms) && list_front(alarms) == alarm)) {
+  if (needs_reschedule || alarm_heap_front() == alarm) {
     reschedule_root_alarm();
   }
 }
@@ -465,9 +534,9 @@ static void reschedule_root_alarm(void) {
   struct itimerspec timer_time;
   memset(&timer_time, 0, sizeof(timer_time));
 
-  if (list_is_empty(alarms)) goto done;
+  next = alarm_heap_front();
+  if (next == NULL) goto done;
 
-  next = static_cast<alarm_t*>(list_front(alarms));
   next_expiration = next->deadline_ms - now_ms();
   if (next_expiration < TIMER_INTERVAL_FOR_WAKELOCK_IN_MS) {
     if (!timer_set) {
@@ -628,14 +697,13 @@ static void callback_dispatch(UNUSED_ATTR void* context) {
     // Take into account that the alarm may get cancelled before we get to it.
     // We're done here if there are no alarms or the alarm at the front is in
     // the future. Exit right away since there's nothing left to do.
-    if (list_is_empty(alarms) ||
-        (alarm = static_cast<alarm_t*>(list_front(alarms)))->deadline_ms >
-            now_ms()) {
+    alarm = alarm_heap_front();
+    if (alarm == NULL || alarm->deadline_ms > now_ms()) {
       reschedule_root_alarm();
       continue;
     }
 
-    list_remove(alarms, alarm);
+    alarm_heap_remove(alarm);
 
     if (alarm->is_periodic) {
       alarm->prev_deadline_ms = alarm->deadline_ms;
@@ -734,12 +802,12 @@ void alarm_debug_dump(int fd) {
 
   uint64_t just_now_ms = now_ms();
 
-  dprintf(fd, "  Total Alarms: %zu\n\n", list_length(alarms));
+  dprintf(fd, "  Total Alarms: %zu\n\n", alarms->size());
 
-  // Dump info for each alarm
-  for (list_node_t* node = list_begin(alarms); node != list_end(alarms);
-       node = list_next(node)) {
-    alarm_t* alarm = (alarm_t*)list_node(node);
+  // Dump info for each alarm, earliest deadline first
+  std::vector<alarm_t*> pending(*alarms);
+  std::sort(pending.begin(), pending.end(), alarm_precedes);
+  for (alarm_t* alarm : pending) {
     alarm_stats_t* stats = &alarm->stats;
 
     dprintf(fd, "  Alarm : %s (%s)\n", stats->name,
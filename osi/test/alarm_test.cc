@@ -332,6 +332,41 @@ TEST_F(AlarmTest, test_callback_ordering_on_mloop) {
   EXPECT_FALSE(WakeLockHeld());
 }
 
+// Test whether the callbacks are invoked in deadline order when alarms are
+// scheduled out of order and some of them are canceled
+TEST_F(AlarmTest, test_callback_ordering_by_deadline) {
+  alarm_t* alarms[100];
+
+  for (int i = 0; i < 100; i++) {
+    const std::string alarm_name =
+        "alarm_test.test_callback_ordering_by_deadline[" + std::to_string(i) +
+        "]";
+    alarms[i] = alarm_new(alarm_name.c_str());
+  }
+
+  // Schedule the latest deadline first, and cancel every other alarm so that
+  // alarms are removed from the middle of the pending set
+  for (int i = 99; i >= 0; i--) {
+    alarm_set(alarms[i], 100 + 4 * i, ordered_cb, INT_TO_PTR(i / 2));
+  }
+  for (int i = 1; i < 100; i += 2) {
+    alarm_cancel(alarms[i]);
+    EXPECT_FALSE(alarm_is_scheduled(alarms[i]));
+  }
+
+  for (int i = 1; i <= 50; i++) {
+    semaphore_wait(semaphore);
+    EXPECT_GE(cb_counter, i);
+  }
+  msleep(EPSILON_MS);
+  EXPECT_EQ(cb_counter, 50);
+  EXPECT_EQ(cb_misordered_counter, 0);
+
+  for (int i = 0; i < 100; i++) alarm_free(alarms[i]);
+
+  EXPECT_FALSE(WakeLockHeld());
+}
+
 // Try to catch any race conditions between the timer callback and |alarm_free|.
 TEST_F(AlarmTest, test_callback_free_race) {
   for (int i = 0; i < 1000; ++i) {
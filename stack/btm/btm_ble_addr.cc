@@ -25,6 +25,8 @@
 #include <base/bind.h>
 #include <string.h>
 
+#include <vector>
+
 #include "bt_types.h"
 #include "btu.h"
 #include "device/include/controller.h"
@@ -32,7 +34,9 @@
 #include "hcimsgs.h"
 
 #include "btm_ble_int.h"
+#include "common/time_util.h"
 #include "main/shim/shim.h"
+#include "stack/btm/btm_ble_rpa_resolver.h"
 #include "stack/btm/btm_dev.h"
 #include "stack/crypto_toolbox/crypto_toolbox.h"
 #include "stack/include/acl_api.h"
@@ -206,11 +210,65 @@ static bool btm_ble_match_random_bda(void* data, void* context) {
   return true;
 }
 
+namespace {
+
+/* Resolver over the IRKs of the security records, rebuilt on the next
+ * resolution whenever a record gains or loses its IRK, or the records are
+ * freed */
+RpaResolver rpa_resolver;
+/* Record of each key of |rpa_resolver|, in the order of btm_cb.sec_dev_rec */
+std::vector<tBTM_SEC_DEV_REC*> rpa_resolver_records;
+bool rpa_resolver_valid = false;
+
+void rpa_resolver_update() {
+  if (rpa_resolver_valid) return;
+
+  /* The device type of a record changes in many places without any IRK
+   * change, so it is checked on each match rather than here */
+  std::vector<Octet16> irks;
+  rpa_resolver_records.clear();
+  if (btm_cb.sec_dev_rec != nullptr) {
+    for (list_node_t* n = list_begin(btm_cb.sec_dev_rec);
+         n != list_end(btm_cb.sec_dev_rec); n = list_next(n)) {
+      tBTM_SEC_DEV_REC* p_dev_rec =
+          static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+      if (!(p_dev_rec->ble.key_type & BTM_LE_KEY_PID)) continue;
+      irks.push_back(p_dev_rec->ble.keys.irk);
+      rpa_resolver_records.push_back(p_dev_rec);
+    }
+  }
+  rpa_resolver.SetKeys(irks);
+  rpa_resolver_valid = true;
+}
+
+}  // namespace
+
+/** This function is called when the IRK of a security record is added or
+ * removed, or the records are freed, to rebuild the resolver keys and drop the
+ * cached resolutions. */
+void btm_ble_rpa_cache_invalidate() {
+  rpa_resolver_valid = false;
+  rpa_resolver_records.clear();
+}
+
 /** This function is called to resolve a random address.
  * Returns pointer to the security record of the device whom a random address is
  * matched to.
  */
 tBTM_SEC_DEV_REC* btm_ble_resolve_random_addr(const RawAddress& random_bda) {
+  if (btm_cb.sec_dev_rec == nullptr) return nullptr;
+
+  rpa_resolver_update();
+  std::optional<size_t> index = rpa_resolver.Resolve(
+      random_bda, bluetooth::common::time_get_os_boottime_ms());
+  if (!index.has_value()) return nullptr;
+
+  tBTM_SEC_DEV_REC* p_dev_rec = rpa_resolver_records[*index];
+  if ((p_dev_rec->device_type & BT_DEVICE_TYPE_BLE) &&
+      (p_dev_rec->ble.key_type & BTM_LE_KEY_PID))
+    return p_dev_rec;
+
+  /* The first record with the IRK is not an LE one, look for the next one */
   list_node_t* n = list_foreach(btm_cb.sec_dev_rec, btm_ble_match_random_bda,
                                 (void*)&random_bda);
   return (n == nullptr) ? (nullptr)
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "stack/btm/btm_ble_rpa_resolver.h"
+
+#include <algorithm>
+
+namespace {
+
+uint64_t address_key(const RawAddress& address) {
+  uint64_t key = 0;
+  for (size_t i = 0; i < RawAddress::kLength; i++) {
+    key = (key << 8) | address.address[i];
+  }
+  return key;
+}
+
+}  // namespace
+
+RpaResolver::RpaResolver(size_t cache_capacity)
+    : cache_(cache_capacity, "RpaResolver") {}
+
+void RpaResolver::SetKeys(const std::vector<Octet16>& irks) {
+  key_schedules_.resize(irks.size());
+  for (size_t i = 0; i < irks.size(); i++) {
+    /* keys are stored LSB first, AES takes them MSB first */
+    Octet16 key_reversed;
+    std::reverse_copy(irks[i].begin(), irks[i].end(), key_reversed.begin());
+    aes_set_key(key_reversed.data(), key_reversed.size(), &key_schedules_[i]);
+  }
+  cache_.Clear();
+}
+
+std::optional<size_t> RpaResolver::Resolve(const RawAddress& rpa,
+                                           uint64_t now_ms) {
+  uint64_t key = address_key(rpa);
+  CacheEntry* entry = cache_.Find(key);
+  if (entry != nullptr && entry->expiry_ms > now_ms) {
+    return entry->key_index;
+  }
+  std::optional<size_t> key_index = resolve_uncached(rpa);
+  cache_.Put(key, {key_index, now_ms + kCacheLifetimeMs});
+  return key_index;
+}
+
+void RpaResolver::ClearCache() { cache_.Clear(); }
+
+std::optional<size_t> RpaResolver::resolve_uncached(
+    const RawAddress& rpa) const {
+  /* ah(k, r) = e(k, padding || prand), MSB first, the 3 MSB of the address
+   * being prand and the 3 LSB the hash to compare with */
+  uint8_t plaintext[N_BLOCK] = {0};
+  plaintext[N_BLOCK - 3] = rpa.address[0];
+  plaintext[N_BLOCK - 2] = rpa.address[1];
+  plaintext[N_BLOCK - 1] = rpa.address[2];
+
+  uint8_t ciphertext[N_BLOCK];
+  for (size_t i = 0; i < key_schedules_.size(); i++) {
+    aes_encrypt(plaintext, ciphertext, &key_schedules_[i]);
+    if (ciphertext[N_BLOCK - 3] == rpa.address[3] &&
+        ciphertext[N_BLOCK - 2] == rpa.address[4] &&
+        ciphertext[N_BLOCK - 1] == rpa.address[5]) {
+      return i;
+    }
+  }
+  return std::nullopt;
+}
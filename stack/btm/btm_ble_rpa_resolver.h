@@ -0,0 +1,72 @@
+/*
+ * Copyright 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "common/lru.h"
+#include "stack/crypto_toolbox/aes.h"
+#include "stack/include/bt_types.h"
+#include "types/raw_address.h"
+
+/* Resolves Resolvable Private Addresses (RPA) against a set of Identity
+ * Resolving Keys (IRK), in software.
+ *
+ * The AES key schedule of every IRK is computed once, when the keys are set,
+ * so that resolving an address against all of them is one AES block
+ * encryption per key. The result of each resolution, found or not, is cached
+ * by address until the peer could have rotated it, so that the reports and
+ * connections of an address already seen do not pay for resolving again.
+ *
+ * Not thread safe, meant to be used from the main thread. */
+class RpaResolver {
+ public:
+  /* Longest a peer may keep the same RPA, the 15 minutes of
+   * btm_get_next_private_addrress_interval_ms() */
+  static constexpr uint64_t kCacheLifetimeMs = 15 * 60 * 1000;
+  static constexpr size_t kDefaultCacheCapacity = 256;
+
+  explicit RpaResolver(size_t cache_capacity = kDefaultCacheCapacity);
+
+  /* Replace the keys to resolve with, which drops the cached results. The
+   * index of a key in |irks| is what Resolve() returns when it matches */
+  void SetKeys(const std::vector<Octet16>& irks);
+
+  size_t GetNumKeys() const { return key_schedules_.size(); }
+
+  /* Return the index of the first key |rpa| resolves with, or std::nullopt if
+   * it does not resolve with any. |now_ms| is used to expire cached results */
+  std::optional<size_t> Resolve(const RawAddress& rpa, uint64_t now_ms);
+
+  /* Drop the cached results, but keep the keys */
+  void ClearCache();
+
+ private:
+  struct CacheEntry {
+    std::optional<size_t> key_index;
+    uint64_t expiry_ms;
+  };
+
+  std::vector<aes_context> key_schedules_;
+  /* Keyed on the 48 bits of the address, prand and hash */
+  bluetooth::common::LegacyLruCache<uint64_t, CacheEntry> cache_;
+
+  std::optional<size_t> resolve_uncached(const RawAddress& rpa) const;
+};
@@ -27,6 +27,7 @@
 #include "bt_target.h"
 #include "bt_types.h"
 #include "main/shim/dumpsys.h"
+#include "stack/btm/btm_ble_int.h"
 #include "stack/btm/btm_int_types.h"
 #include "stack/include/btm_client_interface.h"
 #include "stack_config.h"
@@ -51,11 +52,14 @@ void btm_init(void) {
   btm_cb.Init(stack_config_get_interface()->get_pts_secure_only_mode()
                   ? BTM_SEC_MODE_SC
                   : BTM_SEC_MODE_SP);
+  btm_ble_rpa_cache_invalidate();
 }
 
 /** This function is called to free dynamic memory and system resource allocated by btm_init */
 void btm_free(void) {
   btm_cb.Free();
+  /* the resolver holds pointers to the freed security records */
+  btm_ble_rpa_cache_invalidate();
 }
 
 constexpr size_t kMaxLogHistoryTagLength = 6;
@@ -315,6 +315,7 @@ tGATT_STATUS GATTS_AddService(tGATT_IF gatt_if, btgatt_db_element_t* service,
     elem.sdp_handle = 0;
   }
 
+  gatts_db_invalidate_index();
   gatt_update_last_srv_info();
 
   VLOG(1) << __func__ << ": allocated el s_hdl=" << loghex(elem.s_hdl)
@@ -416,6 +417,7 @@ void GATTS_StopService(uint16_t service_handle) {
   }
 
   gatt_cb.srv_list_info->erase(it);
+  gatts_db_invalidate_index();
   gatt_update_last_srv_info();
 }
 /*******************************************************************************
@@ -29,6 +29,9 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <algorithm>
+#include <map>
+#include <vector>
 #include "gatt_int.h"
 #include "l2c_api.h"
 #include "osi/include/osi.h"
@@ -39,6 +42,34 @@
 using base::StringPrintf;
 using bluetooth::Uuid;
 
+namespace {
+
+/* An attribute of a started service in the server attribute index */
+typedef struct {
+  tGATT_ATTR* p_attr;
+  uint16_t srv_e_hdl; /* end handle of the service holding the attribute */
+  /* Find Information pair of the attribute, and its format */
+  uint8_t info_format;
+  uint8_t info[2 + Uuid::kNumBytes128];
+  /* Value of a declaration, which the stack owns and which cannot change once
+   * the service is started. Empty if the value is read from the attribute. */
+  std::vector<uint8_t> value;
+} tGATT_SR_INDEX_ATTR;
+
+/* Attributes of all the started services in handle order, the position of the
+ * attributes of each type in |attrs|, and the services in handle order. Built
+ * on first use, and dropped whenever a service is started or stopped. */
+typedef struct {
+  bool valid;
+  std::vector<tGATT_SR_INDEX_ATTR> attrs;
+  std::map<Uuid, std::vector<uint32_t>> attrs_by_type;
+  std::vector<std::list<tGATT_SRV_LIST_ELEM>::iterator> services;
+} tGATT_SR_INDEX;
+
+tGATT_SR_INDEX gatt_sr_index;
+
+}  // namespace
+
 /*******************************************************************************
  *             L O C A L    F U N C T I O N     P R O T O T Y P E S            *
  ******************************************************************************/
@@ -47,6 +78,7 @@ static tGATT_ATTR& allocate_attr_in_db(tGATT_SVC_DB& db, const Uuid& uuid,
 static tGATT_STATUS gatts_send_app_read_request(
     tGATT_TCB& tcb, uint16_t cid, uint8_t op_code, uint16_t handle,
     uint16_t offset, uint32_t trans_id, bt_gatt_db_attribute_type_t gatt_type);
+static const tGATT_SR_INDEX& gatts_db_get_index(void);
 
 /**
  * Initialize a memory space to be a service database.
@@ -246,14 +278,44 @@ static tGATT_STATUS read_attr_value(tGATT_ATTR& attr16, uint16_t offset,
   return GATT_PENDING;
 }
 
+/*******************************************************************************
+ *
+ * Function         read_indexed_attr_value
+ *
+ * Description      Read the value of an attribute of the server attribute
+ *                  index, from the cached value of a declaration if it has
+ *                  one, as read_attr_value() does at offset 0.
+ *
+ * Returns          status of operation.
+ *
+ ******************************************************************************/
+static tGATT_STATUS read_indexed_attr_value(const tGATT_SR_INDEX_ATTR& entry,
+                                            uint8_t** p_data, uint16_t mtu,
+                                            uint16_t* p_len,
+                                            tGATT_SEC_FLAG sec_flag,
+                                            uint8_t key_size) {
+  if (entry.value.empty()) {
+    return read_attr_value(*entry.p_attr, 0, p_data, false, mtu, p_len,
+                           sec_flag, key_size);
+  }
+
+  *p_len = entry.value.size();
+  if (mtu < *p_len) return GATT_NO_RESOURCES;
+
+  uint8_t* p = *p_data;
+  ARRAY_TO_STREAM(p, entry.value.data(), (int)entry.value.size());
+  *p_data = p;
+  return GATT_SUCCESS;
+}
+
 /*******************************************************************************
  *
  * Function         gatts_db_read_attr_value_by_type
  *
- * Description      Query attribute value by attribute type.
+ * Description      Query attribute value by attribute type, across all the
+ *                  started services.
  *
- * Parameter        p_db: pointer to the attribute database.
- *                  p_rsp: Read By type response data.
+ * Parameter        p_rsp: Read By type response data.
  *                  s_handle: starting handle of the range we are looking for.
  *                  e_handle: ending handle of the range we are looking for.
  *                  type: Attribute type.
@@ -265,49 +327,58 @@ static tGATT_STATUS read_attr_value(tGATT_ATTR& attr16, uint16_t offset,
  *
  ******************************************************************************/
 tGATT_STATUS gatts_db_read_attr_value_by_type(
-    tGATT_TCB& tcb, uint16_t cid, tGATT_SVC_DB* p_db, uint8_t op_code,
-    BT_HDR* p_rsp, uint16_t s_handle, uint16_t e_handle, const Uuid& type,
-    uint16_t* p_len, tGATT_SEC_FLAG sec_flag, uint8_t key_size,
-    uint32_t trans_id, uint16_t* p_cur_handle) {
+    tGATT_TCB& tcb, uint16_t cid, uint8_t op_code, BT_HDR* p_rsp,
+    uint16_t s_handle, uint16_t e_handle, const Uuid& type, uint16_t* p_len,
+    tGATT_SEC_FLAG sec_flag, uint8_t key_size, uint32_t trans_id,
+    uint16_t* p_cur_handle) {
   tGATT_STATUS status = GATT_NOT_FOUND;
   uint16_t len = 0;
   uint8_t* p = (uint8_t*)(p_rsp + 1) + p_rsp->len + L2CAP_MIN_OFFSET;
 
-  if (p_db) {
-    for (tGATT_ATTR& attr : p_db->attr_list) {
-      if (attr.handle >= s_handle && type == attr.uuid) {
-        if (*p_len <= 2) {
-          status = GATT_NO_RESOURCES;
-          break;
-        }
+  const tGATT_SR_INDEX& index = gatts_db_get_index();
+  auto by_type = index.attrs_by_type.find(type);
+  if (by_type == index.attrs_by_type.end()) return status;
+
+  const std::vector<uint32_t>& positions = by_type->second;
+  auto it = std::lower_bound(positions.begin(), positions.end(), s_handle,
+                             [&index](uint32_t pos, uint16_t handle) {
+                               return index.attrs[pos].p_attr->handle < handle;
+                             });
+  for (; it != positions.end(); it++) {
+    const tGATT_SR_INDEX_ATTR& entry = index.attrs[*it];
+    tGATT_ATTR& attr = *entry.p_attr;
+    if (attr.handle > e_handle) break;
+
+    if (*p_len <= 2) {
+      status = GATT_NO_RESOURCES;
+      break;
+    }
 
-        UINT16_TO_STREAM(p, attr.handle);
+    UINT16_TO_STREAM(p, attr.handle);
 
-        status = read_attr_value(attr, 0, &p, false, (uint16_t)(*p_len - 2),
-                                 &len, sec_flag, key_size);
+    status = read_indexed_attr_value(entry, &p, (uint16_t)(*p_len - 2), &len,
+                                     sec_flag, key_size);
 
-        if (status == GATT_PENDING) {
-          status = gatts_send_app_read_request(tcb, cid, op_code, attr.handle,
-                                               0, trans_id, attr.gatt_type);
+    if (status == GATT_PENDING) {
+      status = gatts_send_app_read_request(tcb, cid, op_code, attr.handle, 0,
+                                           trans_id, attr.gatt_type);
 
-          /* one callback at a time */
-          break;
-        } else if (status == GATT_SUCCESS) {
-          if (p_rsp->offset == 0) p_rsp->offset = len + 2;
-
-          if (p_rsp->offset == len + 2) {
-            p_rsp->len += (len + 2);
-            *p_len -= (len + 2);
-          } else {
-            LOG(ERROR) << "format mismatch";
-            status = GATT_NO_RESOURCES;
-            break;
-          }
-        } else {
-          *p_cur_handle = attr.handle;
-          break;
-        }
+      /* one callback at a time */
+      break;
+    } else if (status == GATT_SUCCESS) {
+      if (p_rsp->offset == 0) p_rsp->offset = len + 2;
+
+      if (p_rsp->offset == len + 2) {
+        p_rsp->len += (len + 2);
+        *p_len -= (len + 2);
+      } else {
+        LOG(ERROR) << "format mismatch";
+        status = GATT_NO_RESOURCES;
+        break;
       }
+    } else {
+      *p_cur_handle = attr.handle;
+      break;
     }
   }
 
@@ -439,12 +510,201 @@ uint16_t gatts_add_char_descr(tGATT_SVC_DB& db, tGATT_PERM perm,
 tGATT_ATTR* find_attr_by_handle(tGATT_SVC_DB* p_db, uint16_t handle) {
   if (!p_db) return nullptr;
 
-  for (auto& attr : p_db->attr_list) {
-    if (attr.handle == handle) return &attr;
-    if (attr.handle > handle) return nullptr;
+  /* attributes are allocated in increasing handle order */
+  auto it = std::lower_bound(
+      p_db->attr_list.begin(), p_db->attr_list.end(), handle,
+      [](const tGATT_ATTR& attr, uint16_t handle) {
+        return attr.handle < handle;
+      });
+  if (it == p_db->attr_list.end() || it->handle != handle) return nullptr;
+
+  return &*it;
+}
+
+/*******************************************************************************
+ *
+ * Function         gatts_db_is_value_static
+ *
+ * Description      Check if the value of an attribute is a declaration built
+ *                  by the stack, readable without any security requirement.
+ *
+ * Returns          true if the value can be cached once the service is started.
+ *
+ ******************************************************************************/
+static bool gatts_db_is_value_static(const tGATT_ATTR& attr) {
+  if (attr.permission != GATT_PERM_READ || !attr.p_value ||
+      !attr.uuid.Is16Bit())
+    return false;
+
+  switch (attr.uuid.As16Bit()) {
+    case GATT_UUID_PRI_SERVICE:
+    case GATT_UUID_SEC_SERVICE:
+    case GATT_UUID_CHAR_DECLARE:
+    case GATT_UUID_INCLUDE_SERVICE:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         gatts_db_build_index
+ *
+ * Description      Build the server attribute index from the started services.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void gatts_db_build_index(void) {
+  gatts_db_invalidate_index();
+  gatt_sr_index.valid = true;
+  if (!gatt_cb.srv_list_info) return;
+
+  /* the service list is kept in increasing start handle order, and the
+   * attributes of a service in increasing handle order */
+  for (auto it = gatt_cb.srv_list_info->begin();
+       it != gatt_cb.srv_list_info->end(); it++) {
+    gatt_sr_index.services.push_back(it);
+    if (!it->p_db) continue;
+
+    for (tGATT_ATTR& attr : it->p_db->attr_list) {
+      gatt_sr_index.attrs_by_type[attr.uuid].push_back(
+          gatt_sr_index.attrs.size());
+      gatt_sr_index.attrs.emplace_back();
+      tGATT_SR_INDEX_ATTR& entry = gatt_sr_index.attrs.back();
+      entry.p_attr = &attr;
+      entry.srv_e_hdl = it->e_hdl;
+
+      uint8_t* p = entry.info;
+      UINT16_TO_STREAM(p, attr.handle);
+      if (attr.uuid.GetShortestRepresentationSize() == Uuid::kNumBytes16) {
+        entry.info_format = GATT_INFO_TYPE_PAIR_16;
+        UINT16_TO_STREAM(p, attr.uuid.As16Bit());
+      } else {
+        /* if 32 bit UUID, convert to 128 bit */
+        entry.info_format = GATT_INFO_TYPE_PAIR_128;
+        ARRAY_TO_STREAM(p, attr.uuid.To128BitLE(), (int)Uuid::kNumBytes128);
+      }
+
+      if (gatts_db_is_value_static(attr)) {
+        uint8_t value[3 + Uuid::kNumBytes128];
+        uint8_t* pp = value;
+        uint16_t len = 0;
+        if (read_attr_value(attr, 0, &pp, false, sizeof(value), &len, 0, 0) ==
+            GATT_SUCCESS) {
+          entry.value.assign(value, value + len);
+        }
+      }
+    }
+  }
+}
+
+/** Return the server attribute index, built if it is not up to date */
+static const tGATT_SR_INDEX& gatts_db_get_index(void) {
+  if (!gatt_sr_index.valid) gatts_db_build_index();
+  return gatt_sr_index;
+}
+
+/*******************************************************************************
+ *
+ * Function         gatts_db_invalidate_index
+ *
+ * Description      Drop the server attribute index. To be called whenever a
+ *                  service is added to or removed from the service list.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void gatts_db_invalidate_index(void) {
+  gatt_sr_index.valid = false;
+  gatt_sr_index.attrs.clear();
+  gatt_sr_index.attrs_by_type.clear();
+  gatt_sr_index.services.clear();
+}
+
+/*******************************************************************************
+ *
+ * Description      Search for a service that owns a specific handle.
+ *
+ * Returns          gatt_cb.srv_list_info->end() if not found. Otherwise the
+ *                  service.
+ *
+ ******************************************************************************/
+std::list<tGATT_SRV_LIST_ELEM>::iterator gatt_sr_find_i_rcb_by_handle(
+    uint16_t handle) {
+  const tGATT_SR_INDEX& index = gatts_db_get_index();
+
+  auto it = std::upper_bound(
+      index.services.begin(), index.services.end(), handle,
+      [](uint16_t handle, std::list<tGATT_SRV_LIST_ELEM>::iterator srv) {
+        return handle < srv->s_hdl;
+      });
+  if (it == index.services.begin() || (*--it)->e_hdl < handle)
+    return gatt_cb.srv_list_info->end();
+
+  return *it;
+}
+
+/*******************************************************************************
+ *
+ * Function         gatts_db_build_find_info_rsp
+ *
+ * Description      Fill the Find Information response with the handle and type
+ *                  of the first attribute in the range of each service, for
+ *                  as many services as fit and share the format.
+ *
+ * Parameter        p_msg: response message, to append the pairs to.
+ *                  len: space left in the response.
+ *                  s_hdl: starting handle of the range.
+ *                  e_hdl: ending handle of the range.
+ *
+ * Returns          GATT_NOT_FOUND if no attribute is in the range,
+ *                  GATT_NO_RESOURCES if the response is full, GATT_SUCCESS
+ *                  otherwise.
+ *
+ ******************************************************************************/
+tGATT_STATUS gatts_db_build_find_info_rsp(BT_HDR* p_msg, uint16_t& len,
+                                          uint16_t s_hdl, uint16_t e_hdl) {
+  const uint8_t info_pair_len[2] = {4, 18};
+  tGATT_STATUS status = GATT_NOT_FOUND;
+
+  const tGATT_SR_INDEX& index = gatts_db_get_index();
+  auto lower_bound = [&index](std::vector<tGATT_SR_INDEX_ATTR>::const_iterator
+                                  first,
+                              uint32_t handle) {
+    return std::lower_bound(first, index.attrs.end(), handle,
+                            [](const tGATT_SR_INDEX_ATTR& entry,
+                               uint32_t handle) {
+                              return entry.p_attr->handle < handle;
+                            });
+  };
+
+  uint8_t* p = (uint8_t*)(p_msg + 1) + L2CAP_MIN_OFFSET + p_msg->len;
+
+  auto it = lower_bound(index.attrs.begin(), s_hdl);
+  while (it != index.attrs.end() && it->p_attr->handle <= e_hdl) {
+    if (p_msg->offset == 0) p_msg->offset = it->info_format;
+
+    uint8_t pair_len = info_pair_len[p_msg->offset - 1];
+    if (len < pair_len) return GATT_NO_RESOURCES;
+
+    if (it->info_format != p_msg->offset) {
+      LOG(ERROR) << "format mismatch";
+      return GATT_NO_RESOURCES;
+    }
+
+    ARRAY_TO_STREAM(p, it->info, pair_len);
+    p_msg->len += pair_len;
+    len -= pair_len;
+    status = GATT_SUCCESS;
+
+    /* next service */
+    it = lower_bound(it, (uint32_t)it->srv_e_hdl + 1);
   }
 
-  return nullptr;
+  return status;
 }
 
 /*******************************************************************************
@@ -172,6 +172,7 @@ void gatt_free(void) {
   gatt_cb.srv_list_info->clear();
   delete gatt_cb.srv_list_info;
   gatt_cb.srv_list_info = nullptr;
+  gatts_db_invalidate_index();
 
   EattExtension::GetInstance()->Stop();
 }
@@ -567,60 +567,6 @@ static tGATT_STATUS gatt_build_primary_service_rsp(
   return status;
 }
 
-/**
- * fill the find information response information in the given buffer.
- *
- * Returns          true: if data filled sucessfully.
- *                  false: packet full, or format mismatch.
- */
-static tGATT_STATUS gatt_build_find_info_rsp(tGATT_SRV_LIST_ELEM& el,
-                                             BT_HDR* p_msg, uint16_t& len,
-                                             uint16_t s_hdl, uint16_t e_hdl) {
-  uint8_t info_pair_len[2] = {4, 18};
-
-  if (!el.p_db) return GATT_NOT_FOUND;
-
-  /* check the attribute database */
-
-  uint8_t* p = (uint8_t*)(p_msg + 1) + L2CAP_MIN_OFFSET + p_msg->len;
-
-  for (auto& attr : el.p_db->attr_list) {
-    if (attr.handle > e_hdl) break;
-
-    if (attr.handle < s_hdl) continue;
-
-    uint8_t uuid_len = attr.uuid.GetShortestRepresentationSize();
-    if (p_msg->offset == 0)
-      p_msg->offset = (uuid_len == Uuid::kNumBytes16) ? GATT_INFO_TYPE_PAIR_16
-                                                      : GATT_INFO_TYPE_PAIR_128;
-
-    if (len < info_pair_len[p_msg->offset - 1]) return GATT_NO_RESOURCES;
-
-    if (p_msg->offset == GATT_INFO_TYPE_PAIR_16 &&
-        uuid_len == Uuid::kNumBytes16) {
-      UINT16_TO_STREAM(p, attr.handle);
-      UINT16_TO_STREAM(p, attr.uuid.As16Bit());
-    } else if (p_msg->offset == GATT_INFO_TYPE_PAIR_128 &&
-               uuid_len == Uuid::kNumBytes128) {
-      UINT16_TO_STREAM(p, attr.handle);
-      ARRAY_TO_STREAM(p, attr.uuid.To128BitLE(), (int)Uuid::kNumBytes128);
-    } else if (p_msg->offset == GATT_INFO_TYPE_PAIR_128 &&
-               uuid_len == Uuid::kNumBytes32) {
-      UINT16_TO_STREAM(p, attr.handle);
-      ARRAY_TO_STREAM(p, attr.uuid.To128BitLE(), (int)Uuid::kNumBytes128);
-    } else {
-      LOG(ERROR) << "format mismatch";
-      return GATT_NO_RESOURCES;
-      /* format mismatch */
-    }
-    p_msg->len += info_pair_len[p_msg->offset - 1];
-    len -= info_pair_len[p_msg->offset - 1];
-    return GATT_SUCCESS;
-  }
-
-  return GATT_NOT_FOUND;
-}
-
 static tGATT_STATUS read_handles(uint16_t& len, uint8_t*& p, uint16_t& s_hdl,
                                  uint16_t& e_hdl) {
   if (len < 4) return GATT_INVALID_PDU;
@@ -748,23 +694,14 @@ static void gatts_process_find_info(tGATT_TCB& tcb, uint16_t cid,
       (uint16_t)(sizeof(BT_HDR) + payload_size + L2CAP_MIN_OFFSET);
 
   BT_HDR* p_msg = (BT_HDR*)osi_calloc(buf_len);
-  reason = GATT_NOT_FOUND;
-
   uint8_t* p = (uint8_t*)(p_msg + 1) + L2CAP_MIN_OFFSET;
   *p++ = op_code + 1;
   p_msg->len = 2;
 
   buf_len = payload_size - 2;
 
-  for (tGATT_SRV_LIST_ELEM& el : *gatt_cb.srv_list_info) {
-    if (el.s_hdl <= e_hdl && el.e_hdl >= s_hdl) {
-      reason = gatt_build_find_info_rsp(el, p_msg, buf_len, s_hdl, e_hdl);
-      if (reason == GATT_NO_RESOURCES) {
-        reason = GATT_SUCCESS;
-        break;
-      }
-    }
-  }
+  reason = gatts_db_build_find_info_rsp(p_msg, buf_len, s_hdl, e_hdl);
+  if (reason == GATT_NO_RESOURCES) reason = GATT_SUCCESS;
 
   *p = (uint8_t)p_msg->offset;
 
@@ -886,26 +823,14 @@ void gatts_process_read_by_type_req(tGATT_TCB& tcb, uint16_t cid,
   p_msg->len = 2;
   uint16_t buf_len = payload_size - 2;
 
-  reason = GATT_NOT_FOUND;
-  for (tGATT_SRV_LIST_ELEM& el : *gatt_cb.srv_list_info) {
-    if (el.s_hdl <= e_hdl && el.e_hdl >= s_hdl) {
-      uint8_t sec_flag, key_size;
-      gatt_sr_get_sec_info(tcb.peer_bda, tcb.transport, &sec_flag, &key_size);
-
-      tGATT_STATUS ret = gatts_db_read_attr_value_by_type(
-          tcb, cid, el.p_db, op_code, p_msg, s_hdl, e_hdl, uuid, &buf_len,
-          sec_flag, key_size, 0, &err_hdl);
-      if (ret != GATT_NOT_FOUND) {
-        reason = ret;
-        if (ret == GATT_NO_RESOURCES) reason = GATT_SUCCESS;
-      }
+  uint8_t sec_flag, key_size;
+  gatt_sr_get_sec_info(tcb.peer_bda, tcb.transport, &sec_flag, &key_size);
 
-      if (ret != GATT_SUCCESS && ret != GATT_NOT_FOUND) {
-        s_hdl = err_hdl;
-        break;
-      }
-    }
-  }
+  reason = gatts_db_read_attr_value_by_type(tcb, cid, op_code, p_msg, s_hdl,
+                                            e_hdl, uuid, &buf_len, sec_flag,
+                                            key_size, 0, &err_hdl);
+  if (reason != GATT_SUCCESS && reason != GATT_NOT_FOUND) s_hdl = err_hdl;
+  if (reason == GATT_NO_RESOURCES) reason = GATT_SUCCESS;
   *p = (uint8_t)p_msg->offset;
   p_msg->offset = L2CAP_MIN_OFFSET;
 
@@ -721,27 +721,6 @@ void  gatt_ind_ack_timeout(void* data) {
    */
   attp_send_cl_confirmation_msg(*p_tcb, L2CAP_ATT_CID);
 }
-/*******************************************************************************
- *
- * Description      Search for a service that owns a specific handle.
- *
- * Returns          GATT_MAX_SR_PROFILES if not found. Otherwise the index of
- *                  the service.
- *
- ******************************************************************************/
-std::list<tGATT_SRV_LIST_ELEM>::iterator gatt_sr_find_i_rcb_by_handle(
-    uint16_t handle) {
-  auto it = gatt_cb.srv_list_info->begin();
-
-  for (; it != gatt_cb.srv_list_info->end(); it++) {
-    if (it->s_hdl <= handle && it->e_hdl >= handle) {
-      return it;
-    }
-  }
-
-  return it;
-}
-
 /*******************************************************************************
  *
  * Function         gatt_sr_get_sec_info
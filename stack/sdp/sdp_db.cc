@@ -25,6 +25,12 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <algorithm>
+#include <bitset>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
 #include "bt_target.h"
 
 #include "bt_common.h"
@@ -32,11 +38,34 @@
 #include "sdp_api.h"
 #include "sdpint.h"
 
+using bluetooth::Uuid;
+
+namespace {
+
+/* Records, by position in sdp_cb.server_db.record */
+typedef std::bitset<SDP_MAX_RECORDS> tSDP_RECORD_SET;
+
+/* Records containing each UUID, the UUIDs normalized to 128 bits. Rebuilt on
+ * the first search after the database changes, as the positions of the
+ * records shift when one is deleted */
+std::map<Uuid, tSDP_RECORD_SET> sdp_uuid_index;
+bool sdp_uuid_index_valid = false;
+
+/* All the attributes of a record, serialized as in a response, by record
+ * handle. Built on the first request for them after the record changes */
+std::unordered_map<uint32_t, std::vector<uint8_t>> sdp_attr_list_cache;
+
+}  // namespace
+
 /******************************************************************************/
 /*            L O C A L    F U N C T I O N     P R O T O T Y P E S            */
 /******************************************************************************/
-static bool find_uuid_in_seq(uint8_t* p, uint32_t seq_len, uint8_t* p_his_uuid,
-                             uint16_t his_len, int nest_level);
+static bool sdp_uuid_from_array(uint8_t* p_uuid, uint32_t uuid_len,
+                                Uuid* p_out);
+static void index_uuids_in_seq(uint8_t* p, uint32_t seq_len, int nest_level,
+                               size_t record_index);
+static void sdp_db_build_uuid_index(void);
+static void sdp_db_record_changed(uint32_t handle);
 
 /*******************************************************************************
  *
@@ -50,41 +79,30 @@ static bool find_uuid_in_seq(uint8_t* p, uint32_t seq_len, uint8_t* p_his_uuid,
  *
  ******************************************************************************/
 tSDP_RECORD* sdp_db_service_search(tSDP_RECORD* p_rec, tSDP_UUID_SEQ* p_seq) {
-  uint16_t xx, yy;
-  tSDP_ATTRIBUTE* p_attr;
-  tSDP_RECORD* p_end = &sdp_cb.server_db.record[sdp_cb.server_db.num_records];
-
-  /* If NULL, start at the beginning, else start at the first specified record
-   */
-  if (!p_rec)
-    p_rec = &sdp_cb.server_db.record[0];
-  else
-    p_rec++;
-
-  /* Look through the records. The spec says that a match occurs if */
-  /* the record contains all the passed UUIDs in it.                */
-  for (; p_rec < p_end; p_rec++) {
-    for (yy = 0; yy < p_seq->num_uids; yy++) {
-      p_attr = &p_rec->attribute[0];
-      for (xx = 0; xx < p_rec->num_attributes; xx++, p_attr++) {
-        if (p_attr->type == UUID_DESC_TYPE) {
-          if (sdpu_compare_uuid_arrays(p_attr->value_ptr, p_attr->len,
-                                       &p_seq->uuid_entry[yy].value[0],
-                                       p_seq->uuid_entry[yy].len))
-            break;
-        } else if (p_attr->type == DATA_ELE_SEQ_DESC_TYPE) {
-          if (find_uuid_in_seq(p_attr->value_ptr, p_attr->len,
-                               &p_seq->uuid_entry[yy].value[0],
-                               p_seq->uuid_entry[yy].len, 0))
-            break;
-        }
-      }
-      /* If any UUID was not found,  on to the next record */
-      if (xx == p_rec->num_attributes) break;
-    }
+  tSDP_RECORD_SET matches;
+  size_t xx;
+  uint16_t yy;
+
+  if (!sdp_uuid_index_valid) sdp_db_build_uuid_index();
+
+  /* The spec says that a match occurs if the record contains all the passed
+   * UUIDs in it. */
+  matches.set();
+  for (yy = 0; yy < p_seq->num_uids; yy++) {
+    Uuid uuid;
+    if (!sdp_uuid_from_array(&p_seq->uuid_entry[yy].value[0],
+                             p_seq->uuid_entry[yy].len, &uuid))
+      return (NULL);
+
+    auto it = sdp_uuid_index.find(uuid);
+    if (it == sdp_uuid_index.end()) return (NULL);
+    matches &= it->second;
+  }
 
-    /* If every UUID was found in the record, return the record */
-    if (yy == p_seq->num_uids) return (p_rec);
+  /* If NULL, start at the beginning, else start after the specified record */
+  xx = p_rec ? (p_rec - &sdp_cb.server_db.record[0]) + 1 : 0;
+  for (; xx < sdp_cb.server_db.num_records; xx++) {
+    if (matches.test(xx)) return (&sdp_cb.server_db.record[xx]);
   }
 
   /* If here, no more records found */
@@ -93,21 +111,53 @@ tSDP_RECORD* sdp_db_service_search(tSDP_RECORD* p_rec, tSDP_UUID_SEQ* p_seq) {
 
 /*******************************************************************************
  *
- * Function         find_uuid_in_seq
+ * Function         sdp_uuid_from_array
  *
- * Description      This function searches a data element sequenct for a UUID.
+ * Description      This function converts a 2, 4 or 16 byte big endian UUID to
+ *                  its 128 bit form, so that it compares equal to the same
+ *                  UUID in any other size.
  *
- * Returns          true if found, else false
+ * Returns          true if the length is valid, else false
  *
  ******************************************************************************/
-static bool find_uuid_in_seq(uint8_t* p, uint32_t seq_len, uint8_t* p_uuid,
-                             uint16_t uuid_len, int nest_level) {
+static bool sdp_uuid_from_array(uint8_t* p_uuid, uint32_t uuid_len,
+                                Uuid* p_out) {
+  switch (uuid_len) {
+    case Uuid::kNumBytes16:
+      *p_out = Uuid::From16Bit((p_uuid[0] << 8) | p_uuid[1]);
+      return (true);
+    case Uuid::kNumBytes32:
+      *p_out = Uuid::From32Bit((p_uuid[0] << 24) | (p_uuid[1] << 16) |
+                               (p_uuid[2] << 8) | p_uuid[3]);
+      return (true);
+    case Uuid::kNumBytes128:
+      *p_out = Uuid::From128BitBE(p_uuid);
+      return (true);
+    default:
+      SDP_TRACE_ERROR("%s: invalid length", __func__);
+      return (false);
+  }
+}
+
+/*******************************************************************************
+ *
+ * Function         index_uuids_in_seq
+ *
+ * Description      This function adds the UUIDs of a data element sequence,
+ *                  and of the sequences nested in it, to the UUID index.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void index_uuids_in_seq(uint8_t* p, uint32_t seq_len, int nest_level,
+                               size_t record_index) {
   uint8_t* p_end = p + seq_len;
   uint8_t type;
   uint32_t len;
+  Uuid uuid;
 
   /* A little safety check to avoid excessive recursion */
-  if (nest_level > 3) return (false);
+  if (nest_level > 3) return;
 
   while (p < p_end) {
     type = *p++;
@@ -118,16 +168,77 @@ static bool find_uuid_in_seq(uint8_t* p, uint32_t seq_len, uint8_t* p_uuid,
     }
     type = type >> 3;
     if (type == UUID_DESC_TYPE) {
-      if (sdpu_compare_uuid_arrays(p, len, p_uuid, uuid_len)) return (true);
+      if (sdp_uuid_from_array(p, len, &uuid))
+        sdp_uuid_index[uuid].set(record_index);
     } else if (type == DATA_ELE_SEQ_DESC_TYPE) {
-      if (find_uuid_in_seq(p, len, p_uuid, uuid_len, nest_level + 1))
-        return (true);
+      index_uuids_in_seq(p, len, nest_level + 1, record_index);
     }
     p = p + len;
   }
+}
 
-  /* If here, failed to match */
-  return (false);
+/*******************************************************************************
+ *
+ * Function         sdp_db_build_uuid_index
+ *
+ * Description      This function indexes the records by the UUIDs they
+ *                  contain, in their UUID attributes or in their data element
+ *                  sequences.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void sdp_db_build_uuid_index(void) {
+  tSDP_RECORD* p_rec = &sdp_cb.server_db.record[0];
+  tSDP_ATTRIBUTE* p_attr;
+  Uuid uuid;
+
+  sdp_uuid_index.clear();
+  for (size_t xx = 0; xx < sdp_cb.server_db.num_records; xx++, p_rec++) {
+    p_attr = &p_rec->attribute[0];
+    for (uint16_t yy = 0; yy < p_rec->num_attributes; yy++, p_attr++) {
+      if (p_attr->type == UUID_DESC_TYPE) {
+        if (sdp_uuid_from_array(p_attr->value_ptr, p_attr->len, &uuid))
+          sdp_uuid_index[uuid].set(xx);
+      } else if (p_attr->type == DATA_ELE_SEQ_DESC_TYPE) {
+        index_uuids_in_seq(p_attr->value_ptr, p_attr->len, 0, xx);
+      }
+    }
+  }
+  sdp_uuid_index_valid = true;
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_db_record_changed
+ *
+ * Description      This function drops what was derived from a record, or from
+ *                  all of them if the handle is 0, when they change.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void sdp_db_record_changed(uint32_t handle) {
+  sdp_uuid_index_valid = false;
+  if (handle == 0)
+    sdp_attr_list_cache.clear();
+  else
+    sdp_attr_list_cache.erase(handle);
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_db_reset_index
+ *
+ * Description      This function drops the UUID index and the serialized
+ *                  attributes, when the database is cleared.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void sdp_db_reset_index(void) {
+  sdp_uuid_index.clear();
+  sdp_db_record_changed(0);
 }
 
 /*******************************************************************************
@@ -141,13 +252,16 @@ static bool find_uuid_in_seq(uint8_t* p, uint32_t seq_len, uint8_t* p_uuid,
  *
  ******************************************************************************/
 tSDP_RECORD* sdp_db_find_record(uint32_t handle) {
-  tSDP_RECORD* p_rec;
+  tSDP_RECORD* p_begin = &sdp_cb.server_db.record[0];
   tSDP_RECORD* p_end = &sdp_cb.server_db.record[sdp_cb.server_db.num_records];
 
-  /* Look through the records for the caller's handle */
-  for (p_rec = &sdp_cb.server_db.record[0]; p_rec < p_end; p_rec++) {
-    if (p_rec->record_handle == handle) return (p_rec);
-  }
+  /* The records are in increasing handle order, as SDP_CreateRecord gives
+   * each new one the handle of the last one plus one */
+  tSDP_RECORD* p_rec = std::lower_bound(
+      p_begin, p_end, handle, [](const tSDP_RECORD& rec, uint32_t handle) {
+        return rec.record_handle < handle;
+      });
+  if (p_rec != p_end && p_rec->record_handle == handle) return (p_rec);
 
   /* Record with that handle not found. */
   return (NULL);
@@ -167,19 +281,49 @@ tSDP_RECORD* sdp_db_find_record(uint32_t handle) {
  ******************************************************************************/
 tSDP_ATTRIBUTE* sdp_db_find_attr_in_rec(tSDP_RECORD* p_rec, uint16_t start_attr,
                                         uint16_t end_attr) {
-  tSDP_ATTRIBUTE* p_at;
-  uint16_t xx;
+  tSDP_ATTRIBUTE* p_end = &p_rec->attribute[p_rec->num_attributes];
 
-  /* Note that the attributes in a record are assumed to be in sorted order */
-  for (xx = 0, p_at = &p_rec->attribute[0]; xx < p_rec->num_attributes;
-       xx++, p_at++) {
-    if ((p_at->id >= start_attr) && (p_at->id <= end_attr)) return (p_at);
-  }
+  /* The attributes are in increasing ID order, as SDP_AddAttribute inserts
+   * them */
+  tSDP_ATTRIBUTE* p_at = std::lower_bound(
+      &p_rec->attribute[0], p_end, start_attr,
+      [](const tSDP_ATTRIBUTE& attr, uint16_t id) { return attr.id < id; });
+  if (p_at != p_end && p_at->id <= end_attr) return (p_at);
 
   /* No matching attribute found */
   return (NULL);
 }
 
+/*******************************************************************************
+ *
+ * Function         sdp_db_get_attr_list
+ *
+ * Description      This function returns all the attributes of a record, each
+ *                  serialized as sdpu_build_attrib_entry does, in ID order.
+ *                  They are serialized once and kept until the record changes.
+ *
+ * Returns          Pointer to the serialized attributes, and their length in
+ *                  p_len.
+ *
+ ******************************************************************************/
+uint8_t* sdp_db_get_attr_list(tSDP_RECORD* p_rec, uint16_t* p_len) {
+  std::vector<uint8_t>& attr_list = sdp_attr_list_cache[p_rec->record_handle];
+
+  if (attr_list.empty()) {
+    size_t len = 0;
+    for (uint16_t xx = 0; xx < p_rec->num_attributes; xx++)
+      len += sdpu_get_attrib_entry_len(&p_rec->attribute[xx]);
+
+    attr_list.resize(len);
+    uint8_t* p = attr_list.data();
+    for (uint16_t xx = 0; xx < p_rec->num_attributes; xx++)
+      p = sdpu_build_attrib_entry(p, &p_rec->attribute[xx]);
+  }
+
+  *p_len = (uint16_t)attr_list.size();
+  return (attr_list.data());
+}
+
 /*******************************************************************************
  *
  * Function         sdp_compose_proto_list
@@ -262,6 +406,7 @@ uint32_t SDP_CreateRecord(void) {
     p_db->record[p_db->num_records].record_handle = handle;
 
     p_db->num_records++;
+    sdp_db_record_changed(handle);
     SDP_TRACE_DEBUG("SDP_CreateRecord ok, num_records:%d", p_db->num_records);
     /* Add the first attribute (the handle) automatically */
     UINT32_TO_BE_FIELD(buf, handle);
@@ -295,6 +440,7 @@ bool SDP_DeleteRecord(uint32_t handle) {
   if (handle == 0 || sdp_cb.server_db.num_records == 0) {
     /* Delete all records in the database */
     sdp_cb.server_db.num_records = 0;
+    sdp_db_record_changed(0);
 
     /* require new DI record to be created in SDP_SetLocalDiRecord */
     sdp_cb.server_db.di_primary_handle = 0;
@@ -314,6 +460,7 @@ bool SDP_DeleteRecord(uint32_t handle) {
         }
 
         sdp_cb.server_db.num_records--;
+        sdp_db_record_changed(handle);
 
         SDP_TRACE_DEBUG("SDP_DeleteRecord ok, num_records:%d",
                         sdp_cb.server_db.num_records);
@@ -408,6 +555,8 @@ bool SDP_AddAttribute(uint32_t handle, uint16_t attr_id, uint8_t attr_type,
 
       if (p_rec->num_attributes == SDP_MAX_REC_ATTR) return (false);
 
+      sdp_db_record_changed(handle);
+
       /* If not found, see if we can allocate a new entry */
       if (xx == p_rec->num_attributes)
         p_attr = &p_rec->attribute[p_rec->num_attributes];
@@ -772,6 +921,7 @@ bool SDP_DeleteAttribute(uint32_t handle, uint16_t attr_id) {
       tSDP_ATTRIBUTE* p_attr = &p_rec->attribute[0];
 
       SDP_TRACE_API("Deleting attr_id 0x%04x for handle 0x%x", attr_id, handle);
+      sdp_db_record_changed(handle);
       /* Found it. Now, find the attribute */
       for (uint16_t attribute_index = 0; attribute_index < p_rec->num_attributes; attribute_index++, p_attr++) {
         if (p_attr->id == attr_id) {
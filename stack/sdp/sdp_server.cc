@@ -55,6 +55,8 @@ static void process_service_search_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
                                             uint16_t param_len, uint8_t* p_req,
                                             uint8_t* p_req_end);
 
+static bool is_attr_list_sent_as_is(tSDP_RECORD* p_rec);
+
 /******************************************************************************/
 /*                E R R O R   T E X T   S T R I N G S                         */
 /*                                                                            */
@@ -555,7 +557,8 @@ static void process_service_search_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
   tSDP_ATTRIBUTE attr_sav;
   bool maxxed_out = false, is_cont = false;
   uint8_t* p_seq_start;
-  uint16_t seq_len, attr_len;
+  uint16_t seq_len, attr_len, first_attr_index;
+  uint8_t* p_attr_list;
 
   /* Extract the UUID sequence to search for */
   p_req = sdpu_extract_uid_seq(p_req, param_len, &uid_seq);
@@ -645,8 +648,24 @@ static void process_service_search_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
       p_rsp += 3;
     }
 
+    first_attr_index = p_ccb->cont_info.next_attr_index;
+
+    /* Most requests are for all the attributes: copy them as serialized in
+     * advance when none of them was sent yet and they fit in whole */
+    if (!p_ccb->cont_info.last_attr_seq_desc_sent && first_attr_index == 0 &&
+        p_ccb->cont_info.attr_offset == 0 && sdpu_is_all_attr_seq(&attr_seq) &&
+        is_attr_list_sent_as_is(p_rec)) {
+      p_attr_list = sdp_db_get_attr_list(p_rec, &attr_len);
+      rem_len = max_list_len - (int16_t)(p_rsp - &p_ccb->rsp_list[0]);
+      if ((int16_t)attr_len <= rem_len) {
+        memcpy(p_rsp, p_attr_list, attr_len);
+        p_rsp += attr_len;
+        first_attr_index = attr_seq.num_attr;
+      }
+    }
+
     /* Get a list of handles that match the UUIDs given to us */
-    for (xx = p_ccb->cont_info.next_attr_index; xx < attr_seq.num_attr; xx++) {
+    for (xx = first_attr_index; xx < attr_seq.num_attr; xx++) {
       p_attr = sdp_db_find_attr_in_rec(p_rec, attr_seq.attr_entry[xx].start,
                                        attr_seq.attr_entry[xx].end);
 
@@ -843,3 +862,21 @@ static void process_service_search_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
   /* Send the buffer through L2CAP */
   L2CA_DataWrite(p_ccb->connection_id, p_buf);
 }
+
+/*******************************************************************************
+ *
+ * Function         is_attr_list_sent_as_is
+ *
+ * Description      This function checks if the attributes of a record are sent
+ *                  as they are in the database to every peer, and can be sent
+ *                  as serialized by sdp_db_get_attr_list. The AVRCP profile
+ *                  version is lowered for some peers.
+ *
+ * Returns          true if they are, else false
+ *
+ ******************************************************************************/
+static bool is_attr_list_sent_as_is(tSDP_RECORD* p_rec) {
+  tSDP_ATTRIBUTE* p_attr = sdp_db_find_attr_in_rec(
+      p_rec, ATTR_ID_BT_PROFILE_DESC_LIST, ATTR_ID_BT_PROFILE_DESC_LIST);
+  return p_attr == NULL || sdpu_is_avrcp_profile_description_list(p_attr) == 0;
+}
@@ -1034,6 +1034,12 @@ uint16_t sdpu_get_attrib_seq_len(tSDP_RECORD* p_rec, tSDP_ATTR_SEQ* attr_seq) {
   bool is_range = false;
   uint16_t start_id = 0, end_id = 0;
 
+  /* All the attributes are serialized once per record */
+  if (sdpu_is_all_attr_seq(attr_seq)) {
+    sdp_db_get_attr_list(p_rec, &len1);
+    return len1;
+  }
+
   for (xx = 0; xx < attr_seq->num_attr; xx++) {
     if (!is_range) {
       start_id = attr_seq->attr_entry[xx].start;
@@ -1057,6 +1063,21 @@ uint16_t sdpu_get_attrib_seq_len(tSDP_RECORD* p_rec, tSDP_ATTR_SEQ* attr_seq) {
   return len1;
 }
 
+/*******************************************************************************
+ *
+ * Function         sdpu_is_all_attr_seq
+ *
+ * Description      checks if an attribute sequence is the single range of all
+ *                  the attribute IDs, 0x0000 to 0xFFFF
+ *
+ * Returns          true if it is, else false
+ *
+ ******************************************************************************/
+bool sdpu_is_all_attr_seq(tSDP_ATTR_SEQ* attr_seq) {
+  return attr_seq->num_attr == 1 && attr_seq->attr_entry[0].start == 0 &&
+         attr_seq->attr_entry[0].end == 0xFFFF;
+}
+
 /*******************************************************************************
  *
  * Function         sdpu_get_attrib_entry_len
@@ -222,6 +222,7 @@ extern uint16_t sdpu_get_list_len(tSDP_UUID_SEQ* uid_seq,
                                   tSDP_ATTR_SEQ* attr_seq);
 extern uint16_t sdpu_get_attrib_seq_len(tSDP_RECORD* p_rec,
                                         tSDP_ATTR_SEQ* attr_seq);
+extern bool sdpu_is_all_attr_seq(tSDP_ATTR_SEQ* attr_seq);
 extern uint16_t sdpu_get_attrib_entry_len(tSDP_ATTRIBUTE* p_attr);
 extern uint8_t* sdpu_build_partial_attrib_entry(uint8_t* p_out,
                                                 tSDP_ATTRIBUTE* p_attr,
@@ -236,6 +237,8 @@ extern tSDP_RECORD* sdp_db_find_record(uint32_t handle);
 extern tSDP_ATTRIBUTE* sdp_db_find_attr_in_rec(tSDP_RECORD* p_rec,
                                                uint16_t start_attr,
                                                uint16_t end_attr);
+extern uint8_t* sdp_db_get_attr_list(tSDP_RECORD* p_rec, uint16_t* p_len);
+extern void sdp_db_reset_index(void);
 
 /* Functions provided by sdp_server.cc
  */
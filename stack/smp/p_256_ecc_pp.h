@@ -58,8 +58,10 @@ extern elliptic_curve_t curve_p256;
 
 bool ECC_ValidatePoint(const Point& p);
 
-void ECC_PointMult_Bin_NAF(Point* q, Point* p, uint32_t* n);
+/* q = n * p, in affine coordinates with q->z = 1, in time independent of n */
+void ECC_PointMult(Point* q, const Point* p, const uint32_t* n);
 
-#define ECC_PointMult(q, p, n) ECC_PointMult_Bin_NAF(q, p, n)
+/* q = n * G, faster than ECC_PointMult(q, &curve_p256.G, n) */
+void ECC_PointMult_Base(Point* q, const uint32_t* n);
 
 void p_256_init_curve();
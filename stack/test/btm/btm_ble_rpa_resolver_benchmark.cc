@@ -0,0 +1,102 @@
+/*
+ *
+ *  Copyright 2021 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "stack/btm/btm_ble_rpa_resolver.h"
+#include "stack/crypto_toolbox/crypto_toolbox.h"
+
+using ::benchmark::State;
+
+namespace {
+
+constexpr size_t kNumKeys = 200;
+
+std::vector<Octet16> make_irks(size_t count) {
+  std::vector<Octet16> irks(count);
+  for (size_t i = 0; i < count; i++) {
+    for (size_t j = 0; j < irks[i].size(); j++) {
+      irks[i][j] = static_cast<uint8_t>(i * 31 + j * 7);
+    }
+  }
+  return irks;
+}
+
+/* Address that does not resolve, the worst case of trying every key */
+RawAddress make_unresolvable(uint32_t seed) {
+  RawAddress rpa;
+  rpa.address[0] = 0x40 | (seed & 0x3f);
+  rpa.address[1] = seed >> 6;
+  rpa.address[2] = seed >> 14;
+  rpa.address[3] = 0xde;
+  rpa.address[4] = 0xad;
+  rpa.address[5] = 0xbe;
+  return rpa;
+}
+
+/* Resolution as done before the resolver, one aes_128() call per key */
+bool matches_with_aes_128(const RawAddress& rpa, const Octet16& irk) {
+  uint8_t rand[3] = {rpa.address[2], rpa.address[1], rpa.address[0]};
+  Octet16 x = crypto_toolbox::aes_128(irk, rand, 3);
+  return x[0] == rpa.address[5] && x[1] == rpa.address[4] &&
+         x[2] == rpa.address[3];
+}
+
+void BM_ResolveWithAes128(State& state) {
+  std::vector<Octet16> irks = make_irks(kNumKeys);
+  uint32_t seed = 0;
+  for (auto _ : state) {
+    RawAddress rpa = make_unresolvable(seed++);
+    bool found = false;
+    for (const Octet16& irk : irks) {
+      if (matches_with_aes_128(rpa, irk)) {
+        found = true;
+        break;
+      }
+    }
+    benchmark::DoNotOptimize(found);
+  }
+}
+BENCHMARK(BM_ResolveWithAes128);
+
+void BM_ResolveUncached(State& state) {
+  RpaResolver resolver;
+  resolver.SetKeys(make_irks(kNumKeys));
+  uint32_t seed = 0;
+  for (auto _ : state) {
+    /* Addresses never repeat, every resolution misses the cache */
+    benchmark::DoNotOptimize(resolver.Resolve(make_unresolvable(seed++), 0));
+  }
+}
+BENCHMARK(BM_ResolveUncached);
+
+void BM_ResolveCached(State& state) {
+  RpaResolver resolver;
+  resolver.SetKeys(make_irks(kNumKeys));
+  uint32_t seed = 0;
+  for (auto _ : state) {
+    /* Addresses of a small set of nearby devices, reporting repeatedly */
+    benchmark::DoNotOptimize(
+        resolver.Resolve(make_unresolvable(seed++ % 64), 0));
+  }
+}
+BENCHMARK(BM_ResolveCached);
+
+}  // namespace
@@ -0,0 +1,116 @@
+/*
+ *
+ *  Copyright 2021 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "stack/btm/btm_ble_rpa_resolver.h"
+#include "stack/crypto_toolbox/crypto_toolbox.h"
+
+namespace {
+
+Octet16 make_irk(uint8_t seed) {
+  Octet16 irk;
+  for (size_t i = 0; i < irk.size(); i++) {
+    irk[i] = static_cast<uint8_t>(seed * 31 + i * 7);
+  }
+  return irk;
+}
+
+/* Same construction as generate_rpa_from_irk_and_rand() */
+RawAddress make_rpa(const Octet16& irk, uint8_t r0, uint8_t r1, uint8_t r2) {
+  uint8_t prand[3] = {r0, r1, static_cast<uint8_t>((r2 & 0x3f) | 0x40)};
+  RawAddress rpa;
+  rpa.address[2] = prand[0];
+  rpa.address[1] = prand[1];
+  rpa.address[0] = prand[2];
+  Octet16 hash = crypto_toolbox::aes_128(irk, prand, 3);
+  rpa.address[5] = hash[0];
+  rpa.address[4] = hash[1];
+  rpa.address[3] = hash[2];
+  return rpa;
+}
+
+class RpaResolverTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    for (uint8_t i = 0; i < 16; i++) irks_.push_back(make_irk(i));
+    resolver_.SetKeys(irks_);
+  }
+
+  std::vector<Octet16> irks_;
+  RpaResolver resolver_;
+};
+
+TEST_F(RpaResolverTest, resolves_with_matching_key) {
+  EXPECT_EQ(resolver_.GetNumKeys(), irks_.size());
+  for (size_t i = 0; i < irks_.size(); i++) {
+    RawAddress rpa = make_rpa(irks_[i], i, 0x12, 0x34);
+    std::optional<size_t> index = resolver_.Resolve(rpa, 0);
+    ASSERT_TRUE(index.has_value());
+    EXPECT_EQ(*index, i);
+  }
+}
+
+TEST_F(RpaResolverTest, does_not_resolve_with_other_key) {
+  RawAddress rpa = make_rpa(make_irk(100), 0x01, 0x02, 0x03);
+  EXPECT_FALSE(resolver_.Resolve(rpa, 0).has_value());
+
+  /* Flipping a bit of the hash breaks the match */
+  rpa = make_rpa(irks_[3], 0x01, 0x02, 0x03);
+  rpa.address[5] ^= 0x01;
+  EXPECT_FALSE(resolver_.Resolve(rpa, 0).has_value());
+}
+
+TEST_F(RpaResolverTest, first_matching_key_wins) {
+  std::vector<Octet16> irks = {make_irk(1), make_irk(2), make_irk(2)};
+  resolver_.SetKeys(irks);
+  RawAddress rpa = make_rpa(irks[2], 0xaa, 0xbb, 0xcc);
+  EXPECT_EQ(resolver_.Resolve(rpa, 0), std::optional<size_t>(1));
+}
+
+TEST_F(RpaResolverTest, resolves_again_after_expiry) {
+  RawAddress rpa = make_rpa(irks_[5], 0x10, 0x20, 0x30);
+  uint64_t now_ms = 1000;
+  EXPECT_EQ(resolver_.Resolve(rpa, now_ms), std::optional<size_t>(5));
+  EXPECT_EQ(resolver_.Resolve(rpa, now_ms + RpaResolver::kCacheLifetimeMs - 1),
+            std::optional<size_t>(5));
+  EXPECT_EQ(resolver_.Resolve(rpa, now_ms + RpaResolver::kCacheLifetimeMs),
+            std::optional<size_t>(5));
+}
+
+TEST_F(RpaResolverTest, negative_result_is_cached) {
+  RawAddress rpa = make_rpa(make_irk(200), 0x10, 0x20, 0x30);
+  EXPECT_FALSE(resolver_.Resolve(rpa, 0).has_value());
+  EXPECT_FALSE(resolver_.Resolve(rpa, 1).has_value());
+}
+
+TEST_F(RpaResolverTest, set_keys_drops_cache) {
+  RawAddress rpa = make_rpa(irks_[7], 0x10, 0x20, 0x30);
+  EXPECT_EQ(resolver_.Resolve(rpa, 0), std::optional<size_t>(7));
+
+  resolver_.SetKeys({irks_[0], irks_[1]});
+  EXPECT_FALSE(resolver_.Resolve(rpa, 0).has_value());
+
+  resolver_.SetKeys({});
+  EXPECT_EQ(resolver_.GetNumKeys(), 0u);
+  EXPECT_FALSE(resolver_.Resolve(rpa, 0).has_value());
+}
+
+}  // namespace
@@ -26,7 +26,10 @@
 #include "hci/include/packet_fragmenter.h"
 #include "internal_include/stack_config.h"
 #include "osi/include/osi.h"
+#include "stack/btm/btm_ble_int.h"
+#include "stack/btm/btm_dev.h"
 #include "stack/btm/btm_int_types.h"
+#include "stack/crypto_toolbox/crypto_toolbox.h"
 #include "stack/include/acl_api.h"
 #include "stack/include/acl_hci_link_interface.h"
 #include "stack/include/btm_client_interface.h"
@@ -182,4 +185,41 @@ TEST_F(StackBtmTest, change_packet_type) {
   get_btm_client_interface().lifecycle.btm_free();
 }
 
+
+TEST_F(StackBtmTest, resolve_random_addr_after_restart) {
+  Octet16 irk{};
+  for (uint8_t i = 0; i < OCTET16_LEN; i++) irk[i] = 0x10 + i;
+
+  uint8_t prand[3] = {0x11, 0x22, 0x73};
+  RawAddress rpa;
+  rpa.address[2] = prand[0];
+  rpa.address[1] = prand[1];
+  rpa.address[0] = prand[2];
+  Octet16 hash = crypto_toolbox::aes_128(irk, prand, 3);
+  rpa.address[5] = hash[0];
+  rpa.address[4] = hash[1];
+  rpa.address[3] = hash[2];
+
+  get_btm_client_interface().lifecycle.btm_init();
+  tBTM_SEC_DEV_REC* p_dev_rec = btm_sec_allocate_dev_rec();
+  p_dev_rec->device_type = BT_DEVICE_TYPE_BLE;
+  p_dev_rec->ble.key_type = BTM_LE_KEY_PID;
+  p_dev_rec->ble.keys.irk = irk;
+  btm_ble_rpa_cache_invalidate();
+  ASSERT_EQ(p_dev_rec, btm_ble_resolve_random_addr(rpa));
+
+  // Device type changes are not reported to the resolver
+  p_dev_rec->device_type = BT_DEVICE_TYPE_BREDR;
+  ASSERT_EQ(nullptr, btm_ble_resolve_random_addr(rpa));
+  p_dev_rec->device_type = BT_DEVICE_TYPE_DUMO;
+  ASSERT_EQ(p_dev_rec, btm_ble_resolve_random_addr(rpa));
+
+  // The records are freed and reallocated across an off/on cycle
+  get_btm_client_interface().lifecycle.btm_free();
+  get_btm_client_interface().lifecycle.btm_init();
+  ASSERT_EQ(nullptr, btm_ble_resolve_random_addr(rpa));
+
+  get_btm_client_interface().lifecycle.btm_free();
+}
+
 }  // namespace
@@ -17,15 +17,20 @@
 #include <gtest/gtest.h>
 #include <string.h>
 
+#include <array>
 #include <cstdint>
 #include <map>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "common/message_loop_thread.h"
 #include "common/strings.h"
+#include "osi/include/allocator.h"
 #include "stack/gatt/gatt_int.h"
 #include "stack/include/gatt_api.h"
+#include "stack/include/l2c_api.h"
 
 std::map<std::string, int> mock_function_count_map;
 
@@ -139,3 +144,300 @@ TEST_F(StackGattTest, GATT_Register_Deregister) {
 
   gatt_free();
 }
+
+namespace {
+
+// Response payload available to the attribute database requests
+constexpr uint16_t kPayloadSize = 512;
+
+// A pair of a Read By Type or Find Information response
+using Pair = std::pair<uint16_t, std::vector<uint8_t>>;
+
+std::vector<Pair> SplitPairs(BT_HDR* p_msg, size_t pair_len) {
+  std::vector<Pair> pairs;
+  uint8_t* p = (uint8_t*)(p_msg + 1) + L2CAP_MIN_OFFSET;
+  for (size_t i = 0; pair_len != 0 && i + pair_len <= p_msg->len;
+       i += pair_len) {
+    uint16_t handle = p[i] | (p[i + 1] << 8);
+    pairs.emplace_back(handle,
+                       std::vector<uint8_t>(p + i + 2, p + i + pair_len));
+  }
+  return pairs;
+}
+
+}  // namespace
+
+class StackGattDbTest : public StackGattTest {
+ protected:
+  void SetUp() override {
+    gatt_init();
+    gatt_if_ = GATT_Register(bluetooth::Uuid::GetRandom(), "StackGattDbTest",
+                             &gatt_callbacks, false);
+    ASSERT_NE(0, gatt_if_);
+  }
+
+  void TearDown() override {
+    GATT_Deregister(gatt_if_);
+    gatt_free();
+  }
+
+  // Start a primary service holding one readable characteristic per entry of
+  // |chars|. Returns the handles of the service and of the characteristic
+  // values.
+  std::vector<uint16_t> AddService(uint16_t uuid16,
+                                   const std::vector<bluetooth::Uuid>& chars) {
+    std::vector<btgatt_db_element_t> service(1 + chars.size());
+    service[0].uuid = bluetooth::Uuid::From16Bit(uuid16);
+    service[0].type = BTGATT_DB_PRIMARY_SERVICE;
+    for (size_t i = 0; i < chars.size(); i++) {
+      service[1 + i].uuid = chars[i];
+      service[1 + i].type = BTGATT_DB_CHARACTERISTIC;
+      service[1 + i].properties = GATT_CHAR_PROP_BIT_READ;
+      service[1 + i].permissions = GATT_PERM_READ;
+    }
+    EXPECT_EQ(GATT_SERVICE_STARTED,
+              GATTS_AddService(gatt_if_, service.data(), service.size()));
+
+    std::vector<uint16_t> handles;
+    for (const btgatt_db_element_t& el : service)
+      handles.push_back(el.attribute_handle);
+    return handles;
+  }
+
+  std::vector<Pair> ReadByType(uint16_t s_handle, uint16_t e_handle,
+                               const bluetooth::Uuid& type,
+                               tGATT_STATUS* p_status,
+                               uint16_t payload_size = kPayloadSize) {
+    BT_HDR* p_msg = (BT_HDR*)osi_calloc(sizeof(BT_HDR) + L2CAP_MIN_OFFSET +
+                                        payload_size);
+    uint16_t len = payload_size;
+    uint16_t err_hdl = 0;
+    *p_status = gatts_db_read_attr_value_by_type(
+        gatt_cb.tcb[0], L2CAP_ATT_CID, GATT_REQ_READ_BY_TYPE, p_msg, s_handle,
+        e_handle, type, &len, 0, 0, 0, &err_hdl);
+    std::vector<Pair> pairs = SplitPairs(p_msg, p_msg->offset);
+    osi_free(p_msg);
+    return pairs;
+  }
+
+  std::vector<Pair> FindInfo(uint16_t s_handle, uint16_t e_handle,
+                             tGATT_STATUS* p_status, uint8_t* p_format,
+                             uint16_t payload_size = kPayloadSize) {
+    BT_HDR* p_msg = (BT_HDR*)osi_calloc(sizeof(BT_HDR) + L2CAP_MIN_OFFSET +
+                                        payload_size);
+    uint16_t len = payload_size;
+    *p_status = gatts_db_build_find_info_rsp(p_msg, len, s_handle, e_handle);
+    *p_format = p_msg->offset;
+    std::vector<Pair> pairs =
+        SplitPairs(p_msg, *p_format == GATT_INFO_TYPE_PAIR_128 ? 18 : 4);
+    osi_free(p_msg);
+    return pairs;
+  }
+
+  // Handles of the characteristic declarations returned by Read By Type
+  std::vector<uint16_t> ReadCharDeclarations(uint16_t s_handle,
+                                             uint16_t e_handle) {
+    tGATT_STATUS status;
+    std::vector<uint16_t> handles;
+    for (const Pair& pair :
+         ReadByType(s_handle, e_handle,
+                    bluetooth::Uuid::From16Bit(GATT_UUID_CHAR_DECLARE),
+                    &status)) {
+      handles.push_back(pair.first);
+    }
+    return handles;
+  }
+
+  tGATT_IF gatt_if_;
+};
+
+TEST_F(StackGattDbTest, read_by_type_across_services) {
+  const std::vector<bluetooth::Uuid> chars = {
+      bluetooth::Uuid::From16Bit(0x2a19), bluetooth::Uuid::From16Bit(0x2a29)};
+  std::vector<std::vector<uint16_t>> services = {AddService(0x180f, chars),
+                                                 AddService(0x180a, chars),
+                                                 AddService(0x181c, chars)};
+
+  tGATT_STATUS status;
+  std::vector<Pair> pairs = ReadByType(
+      GATT_APP_START_HANDLE, 0xffff,
+      bluetooth::Uuid::From16Bit(GATT_UUID_CHAR_DECLARE), &status);
+  ASSERT_EQ(GATT_SUCCESS, status);
+  ASSERT_EQ(6u, pairs.size());
+
+  size_t i = 0;
+  for (const std::vector<uint16_t>& handles : services) {
+    for (size_t c = 0; c < chars.size(); c++, i++) {
+      uint16_t value_handle = handles[1 + c];
+      // Properties, value handle and 16-bit UUID of the characteristic
+      std::vector<uint8_t> value = {GATT_CHAR_PROP_BIT_READ,
+                                    (uint8_t)value_handle,
+                                    (uint8_t)(value_handle >> 8),
+                                    (uint8_t)chars[c].As16Bit(),
+                                    (uint8_t)(chars[c].As16Bit() >> 8)};
+      ASSERT_EQ(value_handle - 1, pairs[i].first);
+      ASSERT_EQ(value, pairs[i].second);
+    }
+  }
+
+  // Services are matched by type too
+  pairs = ReadByType(GATT_APP_START_HANDLE, 0xffff,
+                     bluetooth::Uuid::From16Bit(GATT_UUID_PRI_SERVICE),
+                     &status);
+  ASSERT_EQ(GATT_SUCCESS, status);
+  ASSERT_EQ(3u, pairs.size());
+  for (size_t s = 0; s < services.size(); s++)
+    ASSERT_EQ(services[s][0], pairs[s].first);
+
+  // Nothing matches past the last service
+  ReadByType(services[2].back() + 1, 0xffff,
+             bluetooth::Uuid::From16Bit(GATT_UUID_CHAR_DECLARE), &status);
+  ASSERT_EQ(GATT_NOT_FOUND, status);
+}
+
+TEST_F(StackGattDbTest, read_by_type_stops_at_end_handle) {
+  const std::vector<bluetooth::Uuid> chars = {
+      bluetooth::Uuid::From16Bit(0x2a19), bluetooth::Uuid::From16Bit(0x2a29),
+      bluetooth::Uuid::From16Bit(0x2a2a)};
+  std::vector<uint16_t> first = AddService(0x180f, chars);
+  std::vector<uint16_t> second = AddService(0x180a, chars);
+
+  // The range ends on the second declaration of the second service, so its
+  // last declaration is left out
+  std::vector<uint16_t> expected = {first[1] - 1, first[2] - 1, first[3] - 1,
+                                    second[1] - 1, second[2] - 1};
+  ASSERT_EQ(expected, ReadCharDeclarations(first[0], second[2] - 1));
+
+  // Ending right before a declaration leaves it out as well
+  expected.pop_back();
+  ASSERT_EQ(expected, ReadCharDeclarations(first[0], second[2] - 2));
+
+  // The range can start and end inside the same service
+  ASSERT_EQ(std::vector<uint16_t>({first[2] - 1}),
+            ReadCharDeclarations(first[1], first[2]));
+}
+
+TEST_F(StackGattDbTest, read_by_type_stops_when_response_is_full) {
+  const std::vector<bluetooth::Uuid> chars = {
+      bluetooth::Uuid::From16Bit(0x2a19), bluetooth::Uuid::From16Bit(0x2a29)};
+  std::vector<uint16_t> first = AddService(0x180f, chars);
+  std::vector<uint16_t> second = AddService(0x180a, chars);
+
+  // Room for two declarations of 7 bytes each
+  tGATT_STATUS status;
+  std::vector<Pair> pairs = ReadByType(
+      first[0], 0xffff, bluetooth::Uuid::From16Bit(GATT_UUID_CHAR_DECLARE),
+      &status, 14);
+  ASSERT_EQ(GATT_NO_RESOURCES, status);
+  ASSERT_EQ(2u, pairs.size());
+  ASSERT_EQ(first[2] - 1, pairs[1].first);
+
+  // Declarations of another UUID size are not mixed in the same response
+  AddService(0x181c, {bluetooth::Uuid::GetRandom()});
+  pairs = ReadByType(second[0], 0xffff,
+                     bluetooth::Uuid::From16Bit(GATT_UUID_CHAR_DECLARE),
+                     &status);
+  ASSERT_EQ(GATT_NO_RESOURCES, status);
+  ASSERT_EQ(2u, pairs.size());
+  ASSERT_EQ(second[2] - 1, pairs[1].first);
+}
+
+TEST_F(StackGattDbTest, find_info_one_pair_per_service) {
+  const std::vector<bluetooth::Uuid> chars = {
+      bluetooth::Uuid::From16Bit(0x2a19), bluetooth::Uuid::From16Bit(0x2a29)};
+  std::vector<uint16_t> first = AddService(0x180f, chars);
+  std::vector<uint16_t> second = AddService(0x180a, chars);
+  std::vector<uint16_t> third = AddService(0x181c, chars);
+
+  const std::vector<uint8_t> primary_service = {
+      (uint8_t)GATT_UUID_PRI_SERVICE, (uint8_t)(GATT_UUID_PRI_SERVICE >> 8)};
+
+  tGATT_STATUS status;
+  uint8_t format;
+  std::vector<Pair> pairs =
+      FindInfo(GATT_APP_START_HANDLE, 0xffff, &status, &format);
+  ASSERT_EQ(GATT_SUCCESS, status);
+  ASSERT_EQ(GATT_INFO_TYPE_PAIR_16, format);
+  ASSERT_EQ(std::vector<Pair>({{first[0], primary_service},
+                               {second[0], primary_service},
+                               {third[0], primary_service}}),
+            pairs);
+
+  // Starting inside a service returns the first attribute in range, then the
+  // declaration of the next services up to the ending handle
+  pairs = FindInfo(first[1], second.back(), &status, &format);
+  ASSERT_EQ(GATT_SUCCESS, status);
+  ASSERT_EQ(GATT_INFO_TYPE_PAIR_16, format);
+  ASSERT_EQ(std::vector<Pair>({{first[1], {0x19, 0x2a}},
+                               {second[0], primary_service}}),
+            pairs);
+
+  // Room for two pairs of 4 bytes each
+  pairs = FindInfo(GATT_APP_START_HANDLE, 0xffff, &status, &format, 8);
+  ASSERT_EQ(GATT_NO_RESOURCES, status);
+  ASSERT_EQ(2u, pairs.size());
+
+  FindInfo(third.back() + 1, 0xffff, &status, &format);
+  ASSERT_EQ(GATT_NOT_FOUND, status);
+}
+
+TEST_F(StackGattDbTest, find_info_128bit_format) {
+  bluetooth::Uuid uuid = bluetooth::Uuid::GetRandom();
+  std::vector<uint16_t> first = AddService(0x180f, {uuid});
+  AddService(0x180a, {bluetooth::Uuid::From16Bit(0x2a29)});
+
+  // The 128-bit pair sets the format, and the 16-bit declaration of the next
+  // service does not fit in it
+  tGATT_STATUS status;
+  uint8_t format;
+  std::vector<Pair> pairs = FindInfo(first[1], 0xffff, &status, &format);
+  ASSERT_EQ(GATT_NO_RESOURCES, status);
+  ASSERT_EQ(GATT_INFO_TYPE_PAIR_128, format);
+  ASSERT_EQ(1u, pairs.size());
+  ASSERT_EQ(first[1], pairs[0].first);
+  std::array<uint8_t, bluetooth::Uuid::kNumBytes128> uuid_le =
+      uuid.To128BitLE();
+  ASSERT_EQ(std::vector<uint8_t>(uuid_le.begin(), uuid_le.end()),
+            pairs[0].second);
+}
+
+TEST_F(StackGattDbTest, lookup_after_service_added_and_stopped) {
+  const std::vector<bluetooth::Uuid> chars = {
+      bluetooth::Uuid::From16Bit(0x2a19)};
+  std::vector<uint16_t> first = AddService(0x180f, chars);
+  std::vector<uint16_t> second = AddService(0x180a, chars);
+
+  auto it = gatt_sr_find_i_rcb_by_handle(second[1]);
+  ASSERT_NE(gatt_cb.srv_list_info->end(), it);
+  ASSERT_EQ(second[0], it->s_hdl);
+  ASSERT_EQ(gatt_cb.srv_list_info->end(),
+            gatt_sr_find_i_rcb_by_handle(second.back() + 1));
+
+  // A service started after the index is built is found
+  std::vector<uint16_t> third = AddService(0x181c, chars);
+  it = gatt_sr_find_i_rcb_by_handle(third[1]);
+  ASSERT_NE(gatt_cb.srv_list_info->end(), it);
+  ASSERT_EQ(third[0], it->s_hdl);
+  ASSERT_EQ(std::vector<uint16_t>({first[1] - 1, second[1] - 1, third[1] - 1}),
+            ReadCharDeclarations(GATT_APP_START_HANDLE, 0xffff));
+
+  // A stopped service is not found anymore
+  GATTS_StopService(second[0]);
+  ASSERT_EQ(gatt_cb.srv_list_info->end(),
+            gatt_sr_find_i_rcb_by_handle(second[0]));
+  ASSERT_EQ(gatt_cb.srv_list_info->end(),
+            gatt_sr_find_i_rcb_by_handle(second[1]));
+  ASSERT_EQ(first[0], gatt_sr_find_i_rcb_by_handle(first[1])->s_hdl);
+  ASSERT_EQ(third[0], gatt_sr_find_i_rcb_by_handle(third[1])->s_hdl);
+  ASSERT_EQ(std::vector<uint16_t>({first[1] - 1, third[1] - 1}),
+            ReadCharDeclarations(GATT_APP_START_HANDLE, 0xffff));
+
+  tGATT_STATUS status;
+  uint8_t format;
+  std::vector<Pair> pairs =
+      FindInfo(GATT_APP_START_HANDLE, 0xffff, &status, &format);
+  ASSERT_EQ(GATT_SUCCESS, status);
+  ASSERT_EQ(2u, pairs.size());
+  ASSERT_EQ(first[0], pairs[0].first);
+  ASSERT_EQ(third[0], pairs[1].first);
+}
@@ -0,0 +1,366 @@
+/*
+ *  Copyright 2021 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "btif/include/btif_config.h"
+#include "common/message_loop_thread.h"
+#include "device/include/interop.h"
+#include "osi/include/alarm.h"
+#include "osi/include/allocator.h"
+#include "stack/include/avrc_defs.h"
+#include "stack/include/bt_types.h"
+#include "stack/include/l2c_api.h"
+#include "stack/include/sdp_api.h"
+#include "stack/sdp/sdpint.h"
+#include "test/mock/mock_stack_l2cap_api.h"
+#include "types/raw_address.h"
+
+std::map<std::string, int> mock_function_count_map;
+
+namespace {
+bool avrcp_1_4_only = false;
+}  // namespace
+
+bluetooth::common::MessageLoopThread* get_main_thread() { return nullptr; }
+bool btif_config_set_int(const std::string& section, const std::string& key,
+                         int value) {
+  return true;
+}
+bool interop_match_addr(const interop_feature_t feature,
+                        const RawAddress* addr) {
+  return feature == INTEROP_AVRCP_1_4_ONLY && avrcp_1_4_only;
+}
+
+namespace {
+
+constexpr uint16_t kRemoteMtu = 672;
+constexpr uint16_t kAllAttributes[] = {0x0000, 0xFFFF};
+
+constexpr uint8_t kBaseUuid[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                 0x10, 0x00, 0x80, 0x00, 0x00, 0x80,
+                                 0x5F, 0x9B, 0x34, 0xFB};
+
+// Encode |uuid16| as a UUID of |uuid_len| bytes
+std::vector<uint8_t> uuid_bytes(uint16_t uuid16, uint8_t uuid_len) {
+  std::vector<uint8_t> uuid;
+  if (uuid_len == 2) {
+    uuid = {static_cast<uint8_t>(uuid16 >> 8), static_cast<uint8_t>(uuid16)};
+  } else if (uuid_len == 4) {
+    uuid = {0x00, 0x00, static_cast<uint8_t>(uuid16 >> 8),
+            static_cast<uint8_t>(uuid16)};
+  } else {
+    uuid.assign(kBaseUuid, kBaseUuid + sizeof(kBaseUuid));
+    uuid[2] = static_cast<uint8_t>(uuid16 >> 8);
+    uuid[3] = static_cast<uint8_t>(uuid16);
+  }
+  return uuid;
+}
+
+// Set the service class ID list of |handle| to |uuid16|, encoded in
+// |uuid_len| bytes
+bool set_service_class(uint32_t handle, uint16_t uuid16, uint8_t uuid_len) {
+  uint8_t size = uuid_len == 2 ? SIZE_TWO_BYTES
+                 : uuid_len == 4 ? SIZE_FOUR_BYTES
+                                 : SIZE_SIXTEEN_BYTES;
+  std::vector<uint8_t> value = {
+      static_cast<uint8_t>((UUID_DESC_TYPE << 3) | size)};
+  auto uuid = uuid_bytes(uuid16, uuid_len);
+  value.insert(value.end(), uuid.begin(), uuid.end());
+  return SDP_AddAttribute(handle, ATTR_ID_SERVICE_CLASS_ID_LIST,
+                          DATA_ELE_SEQ_DESC_TYPE, value.size(), value.data());
+}
+
+bool set_service_name(uint32_t handle, const std::string& name) {
+  return SDP_AddAttribute(handle, ATTR_ID_SERVICE_NAME, TEXT_STR_DESC_TYPE,
+                          name.size() + 1, (uint8_t*)name.c_str());
+}
+
+// Return the handles of the records that contain |uuid16|, searched for as a
+// UUID of |uuid_len| bytes
+std::vector<uint32_t> search(uint16_t uuid16, uint8_t uuid_len) {
+  tSDP_UUID_SEQ uid_seq = {};
+  uid_seq.num_uids = 1;
+  auto uuid = uuid_bytes(uuid16, uuid_len);
+  uid_seq.uuid_entry[0].len = uuid_len;
+  memcpy(uid_seq.uuid_entry[0].value, uuid.data(), uuid_len);
+
+  std::vector<uint32_t> handles;
+  for (tSDP_RECORD* p_rec = sdp_db_service_search(nullptr, &uid_seq); p_rec;
+       p_rec = sdp_db_service_search(p_rec, &uid_seq)) {
+    handles.push_back(p_rec->record_handle);
+  }
+  return handles;
+}
+
+// The attribute list of |handle|, as encoded attribute by attribute
+std::vector<uint8_t> encode_attributes(uint32_t handle) {
+  tSDP_RECORD* p_rec = sdp_db_find_record(handle);
+  std::vector<uint8_t> encoded;
+  for (uint16_t i = 0; i < p_rec->num_attributes; i++) {
+    uint8_t entry[SDP_MAX_ATTR_LEN + 5];
+    uint8_t* p_end = sdpu_build_attrib_entry(entry, &p_rec->attribute[i]);
+    encoded.insert(encoded.end(), entry, p_end);
+  }
+  return encoded;
+}
+
+std::vector<uint8_t> cached_attributes(uint32_t handle) {
+  uint16_t len = 0;
+  uint8_t* p_list = sdp_db_get_attr_list(sdp_db_find_record(handle), &len);
+  return std::vector<uint8_t>(p_list, p_list + len);
+}
+
+class StackSdpDbTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    memset(&sdp_cb, 0, sizeof(sdp_cb));
+    sdp_db_reset_index();
+    avrcp_1_4_only = false;
+  }
+
+  void TearDown() override { SDP_DeleteRecord(0); }
+};
+
+TEST_F(StackSdpDbTest, search_after_deleting_middle_record) {
+  uint32_t first = SDP_CreateRecord();
+  uint32_t middle = SDP_CreateRecord();
+  uint32_t last = SDP_CreateRecord();
+  ASSERT_TRUE(set_service_class(first, UUID_SERVCLASS_SERIAL_PORT, 2));
+  ASSERT_TRUE(set_service_class(middle, UUID_SERVCLASS_SERIAL_PORT, 2));
+  ASSERT_TRUE(set_service_class(last, UUID_SERVCLASS_SERIAL_PORT, 2));
+  ASSERT_EQ(search(UUID_SERVCLASS_SERIAL_PORT, 2),
+            std::vector<uint32_t>({first, middle, last}));
+
+  ASSERT_TRUE(SDP_DeleteRecord(middle));
+  ASSERT_EQ(search(UUID_SERVCLASS_SERIAL_PORT, 2),
+            std::vector<uint32_t>({first, last}));
+  ASSERT_EQ(sdp_db_find_record(middle), nullptr);
+
+  // The records after the deleted one moved down, and are still indexed
+  ASSERT_TRUE(set_service_class(last, UUID_SERVCLASS_AUDIO_SOURCE, 2));
+  ASSERT_EQ(search(UUID_SERVCLASS_SERIAL_PORT, 2),
+            std::vector<uint32_t>({first}));
+  ASSERT_EQ(search(UUID_SERVCLASS_AUDIO_SOURCE, 2),
+            std::vector<uint32_t>({last}));
+}
+
+TEST_F(StackSdpDbTest, search_after_replacing_and_deleting_attribute) {
+  uint32_t handle = SDP_CreateRecord();
+  ASSERT_TRUE(set_service_class(handle, UUID_SERVCLASS_SERIAL_PORT, 2));
+  ASSERT_TRUE(set_service_name(handle, "Serial"));
+  ASSERT_EQ(search(UUID_SERVCLASS_SERIAL_PORT, 2),
+            std::vector<uint32_t>({handle}));
+  ASSERT_EQ(cached_attributes(handle), encode_attributes(handle));
+
+  ASSERT_TRUE(set_service_class(handle, UUID_SERVCLASS_AUDIO_SOURCE, 2));
+  ASSERT_TRUE(search(UUID_SERVCLASS_SERIAL_PORT, 2).empty());
+  ASSERT_EQ(search(UUID_SERVCLASS_AUDIO_SOURCE, 2),
+            std::vector<uint32_t>({handle}));
+  ASSERT_EQ(cached_attributes(handle), encode_attributes(handle));
+
+  ASSERT_TRUE(SDP_DeleteAttribute(handle, ATTR_ID_SERVICE_CLASS_ID_LIST));
+  ASSERT_TRUE(search(UUID_SERVCLASS_AUDIO_SOURCE, 2).empty());
+  ASSERT_EQ(cached_attributes(handle), encode_attributes(handle));
+}
+
+TEST_F(StackSdpDbTest, search_mixed_uuid_sizes) {
+  std::vector<uint32_t> handles;
+  for (uint8_t uuid_len : {2, 4, 16}) {
+    uint32_t handle = SDP_CreateRecord();
+    ASSERT_TRUE(
+        set_service_class(handle, UUID_SERVCLASS_SERIAL_PORT, uuid_len));
+    handles.push_back(handle);
+  }
+
+  // Each size matches the records that hold the UUID in any size
+  for (uint8_t uuid_len : {2, 4, 16}) {
+    ASSERT_EQ(search(UUID_SERVCLASS_SERIAL_PORT, uuid_len), handles);
+    ASSERT_TRUE(search(UUID_SERVCLASS_AUDIO_SOURCE, uuid_len).empty());
+  }
+
+  // A 128-bit UUID outside of the base UUID only matches itself
+  tSDP_UUID_SEQ uid_seq = {};
+  uid_seq.num_uids = 1;
+  uid_seq.uuid_entry[0].len = 16;
+  auto uuid = uuid_bytes(UUID_SERVCLASS_SERIAL_PORT, 16);
+  uuid[15] ^= 0x01;
+  memcpy(uid_seq.uuid_entry[0].value, uuid.data(), uuid.size());
+  ASSERT_EQ(sdp_db_service_search(nullptr, &uid_seq), nullptr);
+}
+
+class StackSdpServerTest : public StackSdpDbTest {
+ protected:
+  void SetUp() override {
+    StackSdpDbTest::SetUp();
+    memset(&ccb_, 0, sizeof(ccb_));
+    ccb_.connection_id = 0x40;
+    ccb_.rem_mtu_size = kRemoteMtu;
+    ccb_.sdp_conn_timer = alarm_new("sdp.test_conn_timer");
+    test::mock::stack_l2cap_api::L2CA_DataWrite.body = [this](uint16_t cid,
+                                                              BT_HDR* p_buf) {
+      uint8_t* p = (uint8_t*)(p_buf + 1) + p_buf->offset;
+      response_.assign(p, p + p_buf->len);
+      osi_free(p_buf);
+      return L2CAP_DW_SUCCESS;
+    };
+  }
+
+  void TearDown() override {
+    test::mock::stack_l2cap_api::L2CA_DataWrite = {};
+    alarm_free(ccb_.sdp_conn_timer);
+    osi_free(ccb_.rsp_list);
+    StackSdpDbTest::TearDown();
+  }
+
+  // Send a ServiceSearchAttribute request for |uuid16| and the attribute
+  // ranges in |attr_ranges|, and return the response parameters
+  std::vector<uint8_t> ServiceSearchAttr(
+      uint16_t uuid16, uint16_t max_byte_count,
+      const std::vector<std::pair<uint16_t, uint16_t>>& attr_ranges,
+      const std::vector<uint8_t>& cont_state) {
+    std::vector<uint8_t> params = {
+        (DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_BYTE, 3,
+        (UUID_DESC_TYPE << 3) | SIZE_TWO_BYTES,
+        static_cast<uint8_t>(uuid16 >> 8), static_cast<uint8_t>(uuid16),
+        static_cast<uint8_t>(max_byte_count >> 8),
+        static_cast<uint8_t>(max_byte_count),
+        (DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_BYTE,
+        static_cast<uint8_t>(5 * attr_ranges.size())};
+    for (const auto& range : attr_ranges) {
+      params.insert(params.end(),
+                    {(UINT_DESC_TYPE << 3) | SIZE_FOUR_BYTES,
+                     static_cast<uint8_t>(range.first >> 8),
+                     static_cast<uint8_t>(range.first),
+                     static_cast<uint8_t>(range.second >> 8),
+                     static_cast<uint8_t>(range.second)});
+    }
+    params.push_back(cont_state.size());
+    params.insert(params.end(), cont_state.begin(), cont_state.end());
+
+    std::vector<uint8_t> pdu = {
+        SDP_PDU_SERVICE_SEARCH_ATTR_REQ, 0x00, 0x01,
+        static_cast<uint8_t>(params.size() >> 8),
+        static_cast<uint8_t>(params.size())};
+    pdu.insert(pdu.end(), params.begin(), params.end());
+
+    std::vector<uint8_t> msg(sizeof(BT_HDR) + pdu.size());
+    BT_HDR* p_msg = reinterpret_cast<BT_HDR*>(msg.data());
+    p_msg->offset = 0;
+    p_msg->len = pdu.size();
+    memcpy(p_msg + 1, pdu.data(), pdu.size());
+
+    response_.clear();
+    sdp_server_handle_client_req(&ccb_, p_msg);
+    EXPECT_GE(response_.size(), 5u);
+    EXPECT_EQ(response_[0], SDP_PDU_SERVICE_SEARCH_ATTR_RSP);
+    return std::vector<uint8_t>(response_.begin() + 5, response_.end());
+  }
+
+  // Fetch the attribute lists of the records with |uuid16|, following the
+  // continuation state until the end
+  std::vector<uint8_t> FetchAttributeLists(
+      uint16_t uuid16, uint16_t max_byte_count,
+      const std::vector<std::pair<uint16_t, uint16_t>>& attr_ranges) {
+    std::vector<uint8_t> lists;
+    std::vector<uint8_t> cont_state;
+    int num_responses = 0;
+    do {
+      auto params =
+          ServiceSearchAttr(uuid16, max_byte_count, attr_ranges, cont_state);
+      EXPECT_GE(params.size(), 3u);
+      if (params.size() < 3) break;
+      uint16_t byte_count = (params[0] << 8) | params[1];
+      EXPECT_LE(byte_count, max_byte_count);
+      EXPECT_EQ(params.size(), 2u + byte_count + 1 + params[2 + byte_count]);
+      lists.insert(lists.end(), params.begin() + 2,
+                   params.begin() + 2 + byte_count);
+      cont_state.assign(params.begin() + 3 + byte_count, params.end());
+    } while (!cont_state.empty() && ++num_responses < 100);
+    EXPECT_TRUE(cont_state.empty());
+    return lists;
+  }
+
+  // Create records with the serial port service class, and attributes big
+  // enough for the attribute lists to span several responses
+  void CreateSerialPortRecords() {
+    for (int i = 0; i < 3; i++) {
+      uint32_t handle = SDP_CreateRecord();
+      ASSERT_TRUE(set_service_class(handle, UUID_SERVCLASS_SERIAL_PORT,
+                                    i == 1 ? 16 : 2));
+      ASSERT_TRUE(set_service_name(handle, std::string(40 + 20 * i, 'a' + i)));
+      uint16_t profile_version = 0x0102;
+      ASSERT_TRUE(SDP_AddProfileDescriptorList(
+          handle, UUID_SERVCLASS_SERIAL_PORT, profile_version));
+    }
+  }
+
+  tCONN_CB ccb_;
+  std::vector<uint8_t> response_;
+};
+
+TEST_F(StackSdpServerTest, all_attributes_match_attribute_ranges) {
+  CreateSerialPortRecords();
+
+  auto lists = FetchAttributeLists(UUID_SERVCLASS_SERIAL_PORT, 0xFFFF,
+                                   {{kAllAttributes[0], kAllAttributes[1]}});
+  ASSERT_FALSE(lists.empty());
+  // The same attributes requested in two ranges go through the attribute by
+  // attribute encoding
+  ASSERT_EQ(lists, FetchAttributeLists(UUID_SERVCLASS_SERIAL_PORT, 0xFFFF,
+                                       {{0x0000, 0x00FF}, {0x0100, 0xFFFF}}));
+}
+
+TEST_F(StackSdpServerTest, all_attributes_match_attribute_ranges_with_cont) {
+  CreateSerialPortRecords();
+
+  auto expected = FetchAttributeLists(UUID_SERVCLASS_SERIAL_PORT, 0xFFFF,
+                                      {{0x0000, 0x00FF}, {0x0100, 0xFFFF}});
+  for (uint16_t max_byte_count : {7, 20, 64, 100}) {
+    ASSERT_EQ(expected, FetchAttributeLists(
+                            UUID_SERVCLASS_SERIAL_PORT, max_byte_count,
+                            {{kAllAttributes[0], kAllAttributes[1]}}))
+        << "max_byte_count " << max_byte_count;
+  }
+}
+
+TEST_F(StackSdpServerTest, avrcp_profile_version_lowered_for_all_attributes) {
+  uint32_t handle = SDP_CreateRecord();
+  ASSERT_TRUE(set_service_class(handle, UUID_SERVCLASS_AV_REM_CTRL_TARGET, 2));
+  ASSERT_TRUE(SDP_AddProfileDescriptorList(
+      handle, UUID_SERVCLASS_AV_REMOTE_CONTROL, AVRC_REV_1_6));
+  avrcp_1_4_only = true;
+
+  auto lists = FetchAttributeLists(UUID_SERVCLASS_AV_REM_CTRL_TARGET, 0xFFFF,
+                                   {{kAllAttributes[0], kAllAttributes[1]}});
+
+  // Profile descriptor list of AVRCP 1.4, not 1.6
+  const std::vector<uint8_t> profile_descriptor = {
+      (UUID_DESC_TYPE << 3) | SIZE_TWO_BYTES, 0x11, 0x0E,
+      (UINT_DESC_TYPE << 3) | SIZE_TWO_BYTES, 0x01, 0x04};
+  ASSERT_NE(std::search(lists.begin(), lists.end(), profile_descriptor.begin(),
+                        profile_descriptor.end()),
+            lists.end());
+}
+
+}  // namespace
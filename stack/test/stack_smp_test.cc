@@ -292,4 +292,35 @@ TEST(SmpEccValidationTest, test_invalid_points) {
 
   EXPECT_FALSE(ECC_ValidatePoint(p));
 }
+
+// Key pair and DHKey of sample 1, least significant word first
+TEST(SmpEccPointMultTest, test_sample_1) {
+  const uint32_t private_a[KEY_LENGTH_DWORDS_P256] = {
+      0xcd3c1abd, 0x5899b8a6, 0xeb40b799, 0x4aff607b,
+      0xd2103f50, 0x74c9b3e3, 0xa3c55f38, 0x3f49f6d4};
+  const uint32_t public_a_x[KEY_LENGTH_DWORDS_P256] = {
+      0x0e359de6, 0xcc030148, 0xacf4fddb, 0xeff49111,
+      0xe9f9a5b9, 0x5e2c83a7, 0xf297be2c, 0x20b003d2};
+  const uint32_t public_a_y[KEY_LENGTH_DWORDS_P256] = {
+      0x1589d28b, 0x741c8ed0, 0x8fed3024, 0x766345c2,
+      0x5a52155c, 0x63329abf, 0x652aeb6d, 0xdc809c49};
+  Point public_b = {
+      .x = {0x2faaa190, 0x559077b2, 0x8615a69f, 0x47b58afd, 0xf19e4c00,
+            0x09592284, 0x1faf1d96, 0x1ea1f0f0},
+      .y = {0x15b1214a, 0x5f89aff9, 0xe28e3676, 0x472d1130, 0x9ab85160,
+            0x7356703a, 0x429dad37, 0x4c55f33e},
+      .z = {0},
+  };
+  const uint32_t dhkey[KEY_LENGTH_DWORDS_P256] = {
+      0x73bfa698, 0x868d34f3, 0xb4f866f1, 0x99796b13,
+      0x0a397d9b, 0x341010a6, 0x57c8ad05, 0xec0234a3};
+
+  Point result;
+  ECC_PointMult_Base(&result, private_a);
+  EXPECT_EQ(0, memcmp(public_a_x, result.x, sizeof(public_a_x)));
+  EXPECT_EQ(0, memcmp(public_a_y, result.y, sizeof(public_a_y)));
+
+  ECC_PointMult(&result, &public_b, private_a);
+  EXPECT_EQ(0, memcmp(dhkey, result.x, sizeof(dhkey)));
+}
 }  // namespace testing
@@ -264,6 +264,10 @@ void bluetooth::shim::BTM_BleEnableDisableFilterFeature(
     uint8_t enable, tBTM_BLE_PF_STATUS_CBACK p_stat_cback) {
   mock_function_count_map[__func__]++;
 }
+void bluetooth::shim::BTM_BleGetVendorCapabilities(
+    tBTM_BLE_VSC_CB* p_cmn_vsc_cb) {
+  mock_function_count_map[__func__]++;
+}
 void bluetooth::shim::BTM_BleLoadLocalKeys(uint8_t key_type,
                                            tBTM_BLE_LOCAL_KEYS* p_key) {
   mock_function_count_map[__func__]++;
@@ -55,6 +55,7 @@ struct btm_get_next_private_addrress_interval_ms
 struct btm_ble_init_pseudo_addr btm_ble_init_pseudo_addr;
 struct btm_ble_addr_resolvable btm_ble_addr_resolvable;
 struct btm_ble_resolve_random_addr btm_ble_resolve_random_addr;
+struct btm_ble_rpa_cache_invalidate btm_ble_rpa_cache_invalidate;
 struct btm_identity_addr_to_random_pseudo btm_identity_addr_to_random_pseudo;
 struct btm_identity_addr_to_random_pseudo_from_address_with_type
     btm_identity_addr_to_random_pseudo_from_address_with_type;
@@ -98,6 +99,10 @@ tBTM_SEC_DEV_REC* btm_ble_resolve_random_addr(const RawAddress& random_bda) {
   return test::mock::stack_btm_ble_addr::btm_ble_resolve_random_addr(
       random_bda);
 }
+void btm_ble_rpa_cache_invalidate() {
+  mock_function_count_map[__func__]++;
+  test::mock::stack_btm_ble_addr::btm_ble_rpa_cache_invalidate();
+}
 bool btm_identity_addr_to_random_pseudo(RawAddress* bd_addr,
                                         uint8_t* p_addr_type, bool refresh) {
   mock_function_count_map[__func__]++;
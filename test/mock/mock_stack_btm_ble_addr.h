@@ -114,6 +114,14 @@ struct btm_ble_resolve_random_addr {
   };
 };
 extern struct btm_ble_resolve_random_addr btm_ble_resolve_random_addr;
+// Name: btm_ble_rpa_cache_invalidate
+// Params:
+// Returns: void
+struct btm_ble_rpa_cache_invalidate {
+  std::function<void()> body{[]() {}};
+  void operator()() { body(); };
+};
+extern struct btm_ble_rpa_cache_invalidate btm_ble_rpa_cache_invalidate;
 // Name: btm_identity_addr_to_random_pseudo
 // Params: RawAddress* bd_addr, uint8_t* p_addr_type, bool refresh
 // Returns: bool
@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+"""
+This script converts a btsnoop ring file (btsnoop_hci.log.ring) into a
+valid btsnoop log file which can be viewed using standard tools like
+Wireshark.
+
+The ring file is written by the GD SnoopLogger when
+persist.bluetooth.btsnoopringsizemb is set, and is left behind when the
+Bluetooth process crashes. It can be described as:
+
+file_header {
+  identification_pattern "btsnring"
+  version, data_size, oldest_offset, reserved
+}
+data[data_size] {
+  repeated {
+    record_header { sequence, length, reserved }
+    btsnoop packet record, padded to 8 bytes
+  }
+}
+
+Records wrap around to the start of the data area. A record with length
+0xffffffff marks where the ring wrapped. All fields are in the byte order
+of the device that wrote the file, which is assumed to be little endian.
+"""
+
+import struct
+import sys
+
+FILE_HEADER_FORMAT = '<8sIIQQ'
+RECORD_HEADER_FORMAT = '<QII'
+IDENTIFICATION_PATTERN = b'btsnring'
+VERSION_NUMBER = 1
+WRAP_MARKER = 0xffffffff
+RECORD_ALIGNMENT = 8
+BTSNOOP_FILE_HEADER = b'btsnoop\x00\x00\x00\x00\x01\x00\x00\x03\xea'
+
+
+def align_record(length):
+    return (length + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1)
+
+
+def read_records(ring):
+    """
+  Returns the btsnoop packet records of a ring file, oldest first.
+  """
+    file_header_size = struct.calcsize(FILE_HEADER_FORMAT)
+    record_header_size = struct.calcsize(RECORD_HEADER_FORMAT)
+    pattern, version, data_size, offset, _ = struct.unpack_from(FILE_HEADER_FORMAT, ring)
+    if pattern != IDENTIFICATION_PATTERN or version != VERSION_NUMBER:
+        raise RuntimeError('Not a btsnoop ring file')
+    data = ring[file_header_size:file_header_size + data_size]
+
+    records = []
+    expected_sequence = 0
+    for _ in range(data_size // record_header_size + 2):
+        if offset > data_size - record_header_size:
+            offset = 0
+            continue
+        sequence, length, _ = struct.unpack_from(RECORD_HEADER_FORMAT, data, offset)
+        if expected_sequence == 0:
+            expected_sequence = sequence
+        # A record that is stale, or was being written when the process died, ends the ring
+        if sequence == 0 or sequence != expected_sequence:
+            break
+        if length == WRAP_MARKER:
+            offset = 0
+            continue
+        if record_header_size + length > data_size - offset:
+            break
+        records.append(data[offset + record_header_size:offset + record_header_size + length])
+        offset += align_record(record_header_size + length)
+        expected_sequence += 1
+    return records
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.stderr.write('Usage: %s <btsnoop_hci.log.ring> <btsnoop_hci.log>\n' % sys.argv[0])
+        exit(1)
+
+    with open(sys.argv[1], 'rb') as ring_file:
+        records = read_records(ring_file.read())
+    with open(sys.argv[2], 'wb') as btsnoop_file:
+        btsnoop_file.write(BTSNOOP_FILE_HEADER)
+        for record in records:
+            btsnoop_file.write(record)
+
+
+if __name__ == '__main__':
+    main()